@@ -0,0 +1,142 @@
+/*! \file bindless-bench.cpp
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Exercises the bindless texture table (`BindlessTextures`): it checks that
+ * removed slots are reused by later additions and measures the cost of
+ * adding and removing textures.  The benchmark needs a Vulkan device that
+ * supports bindless textures, but it does not open a window.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include <chrono>
+#include <cstdio>
+
+using Clock = std::chrono::steady_clock;
+
+/// the number of textures in the table
+constexpr uint32_t kNumTextures = 256;
+
+/// the number of remove/add cycles that are timed
+constexpr int kNumReps = 1000;
+
+class BindlessBench : public cs237::Application {
+public:
+    BindlessBench (std::vector<std::string> const &args)
+      : cs237::Application (args, "bindless-bench")
+    { }
+
+    void run () override;
+
+    /// did all of the checks pass?
+    bool ok () const { return this->_ok; }
+
+private:
+    bool _ok = true;
+
+    /// report a failed check
+    void _fail (std::string const &msg)
+    {
+        std::cerr << "bindless-bench: " << msg << "\n";
+        this->_ok = false;
+    }
+
+};
+
+void BindlessBench::run ()
+{
+    if (! this->hasBindless()) {
+        std::printf("# bindless textures are not supported by the device\n");
+        return;
+    }
+
+    cs237::BindlessTextures *table = this->enableBindless (kNumTextures);
+    uint32_t n = std::min(kNumTextures, table->capacity());
+
+    // small textures with a single color
+    cs237::DataImage2D img(4, 4, cs237::Channels::RGBA, cs237::ChannelTy::U8);
+    std::memset (img.data(), 0xff, img.nBytes());
+    std::vector<cs237::Texture2D *> txts;
+    for (uint32_t i = 0;  i < n;  ++i) {
+        txts.push_back (new cs237::Texture2D(this, &img));
+    }
+    vk::Sampler sampler = this->createSampler (cs237::Application::SamplerInfo());
+
+    // fill the table; the slots are allocated in order
+    std::vector<uint32_t> ids(n);
+    for (uint32_t i = 0;  i < n;  ++i) {
+        ids[i] = table->add (txts[i], sampler);
+        if (ids[i] != i) {
+            this->_fail ("unexpected index for a new texture");
+        }
+    }
+    if ((table->size() != n) || (table->highWater() != n)) {
+        this->_fail ("wrong size after filling the table");
+    }
+
+    // remove the even slots; the high-water mark does not change
+    for (uint32_t i = 0;  i < n;  i += 2) {
+        table->remove (ids[i]);
+    }
+    if ((table->size() != n / 2) || (table->highWater() != n)) {
+        this->_fail ("wrong size after removing textures");
+    }
+
+    // adding the textures again must reuse the removed slots
+    for (uint32_t i = 0;  i < n;  i += 2) {
+        uint32_t id = table->add (txts[i], sampler);
+        if ((id >= n) || (id % 2 != 0)) {
+            this->_fail ("removed slot was not reused");
+        }
+        ids[i] = id;
+    }
+    if ((table->size() != n) || (table->highWater() != n)) {
+        this->_fail ("wrong size after reusing slots");
+    }
+    for (uint32_t i = 0;  i < n;  ++i) {
+        if (! table->isLive(i)) {
+            this->_fail ("slot is not live after reuse");
+            break;
+        }
+    }
+
+    // time remove/add pairs, which is the cost of replacing a texture
+    auto start = Clock::now();
+    for (int rep = 0;  rep < kNumReps;  ++rep) {
+        uint32_t i = uint32_t(rep) % n;
+        table->remove (ids[i]);
+        ids[i] = table->add (txts[i], sampler);
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    std::printf("%u textures: %.1f ns per remove/add pair\n", n, ns / double(kNumReps));
+
+    // the table is owned by the application, so we only free the textures
+    for (uint32_t i = 0;  i < n;  ++i) {
+        table->remove (ids[i]);
+    }
+    for (auto txt : txts) {
+        delete txt;
+    }
+}
+
+int main (int argc, char *argv[])
+{
+    std::vector<std::string> args(argv, argv+argc);
+    BindlessBench app(args);
+
+    try {
+        app.run();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return app.ok() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
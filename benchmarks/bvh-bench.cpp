@@ -0,0 +1,118 @@
+/*! \file bvh-bench.cpp
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Measures the cost of building and refitting a `BVH`, and of frustum and
+ * ray queries, and compares frustum culling against the flat `BoundsArray`.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include <chrono>
+#include <random>
+#include <cstdio>
+
+using Clock = std::chrono::steady_clock;
+
+/// the number of random rays used for the ray-query measurement
+constexpr int kNumRays = 10000;
+
+/// generate `n` random boxes scattered around the origin
+static std::vector<cs237::AABBf_t> genBoxes (uint32_t n, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> pos(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> sz(0.5f, 10.0f);
+    std::vector<cs237::AABBf_t> boxes;
+    boxes.reserve(n);
+    for (uint32_t i = 0;  i < n;  ++i) {
+        glm::vec3 c(pos(rng), pos(rng), pos(rng));
+        glm::vec3 e(sz(rng), sz(rng), sz(rng));
+        boxes.push_back(cs237::AABBf_t(c - e, c + e));
+    }
+    return boxes;
+}
+
+/// time a function
+/// \return the average time per call in microseconds
+template <typename F>
+static double timeIt (int reps, F fn)
+{
+    auto start = Clock::now();
+    for (int i = 0;  i < reps;  ++i) {
+        fn();
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count()
+        / double(reps);
+}
+
+int main ()
+{
+    std::mt19937 rng(17);
+
+    // a camera looking down the +X axis
+    glm::mat4 projM = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 1.0f, 1000.0f);
+    glm::mat4 viewM = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    cs237::Frustumf_t frustum(projM * viewM);
+
+    std::printf("%10s %10s %10s %13s %13s %10s\n",
+        "# boxes", "build(ms)", "refit(ms)", "BVH cull(us)", "flat cull(us)", "ray(ns)");
+    for (uint32_t n : { 1000u, 100000u, 1000000u }) {
+        auto boxes = genBoxes(n, rng);
+        int reps = std::max(1u, 1000000u / n);
+
+        cs237::BVH bvh;
+        double buildT = timeIt(reps, [&]() { bvh.build(boxes); });
+
+        // jitter the boxes a bit for the refit
+        std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+        for (auto &bb : boxes) {
+            glm::vec3 d(jitter(rng), jitter(rng), jitter(rng));
+            bb = cs237::AABBf_t(bb._min + d, bb._max + d);
+        }
+        double refitT = timeIt(reps, [&]() { bvh.refit(boxes); });
+
+        // frustum culling
+        std::vector<uint32_t> visible;
+        visible.reserve(n);
+        double bvhCullT = timeIt(10 * reps, [&]() { bvh.cullFrustum(frustum, visible); });
+        size_t nBVH = visible.size();
+
+        cs237::BoundsArray flat;
+        flat.reserve(n);
+        for (auto const &bb : boxes) {
+            flat.push_back(bb);
+        }
+        double flatCullT = timeIt(10 * reps, [&]() { flat.cullBoxes(frustum, visible); });
+        if (nBVH != visible.size()) {
+            std::cerr << "bvh-bench: culling mismatch (" << nBVH
+                << " vs. " << visible.size() << ")\n";
+            return 1;
+        }
+
+        // closest-hit ray queries from random points toward the origin
+        std::uniform_real_distribution<float> pos(-500.0f, 500.0f);
+        std::vector<glm::vec3> origs(kNumRays);
+        for (auto &o : origs) {
+            o = glm::vec3(pos(rng), pos(rng), pos(rng));
+        }
+        int nHits = 0;
+        double rayT = timeIt(1, [&]() {
+            for (auto const &o : origs) {
+                float t;
+                nHits += (bvh.closestHit(o, -o, t) >= 0);
+            }
+        });
+
+        std::printf("%10u %10.3f %10.3f %13.1f %13.1f %10.1f\n",
+            n, buildT / 1000.0, refitT / 1000.0, bvhCullT, flatCullT,
+            1000.0 * rayT / double(kNumRays));
+    }
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+/*! \file cs237-bench.cpp
+ *
+ * CS237 scene-replay benchmark harness.
+ *
+ * Runs each of the projects on each of its scenes without a window (using
+ * the `-headless`, `-frames`, and `-bench` options that the library
+ * supports), and collects the frame statistics from the runs into a single
+ * JSON object:
+ *
+ *      { "frames": n,
+ *        "runs": [
+ *          { "project": "proj1", "scene": "simple1", "status": 0, "stats": { ... } },
+ *          ...
+ *        ]
+ *      }
+ *
+ * where "stats" is the object written by `cs237::FrameStats` (or `null`
+ * if the run failed).  During the runs, the camera follows a scripted path
+ * (see `cs237::benchCameraPos`).
+ *
+ * Usage:
+ *
+ *      cs237-bench [-frames n] [-o file] [project ...]
+ *
+ * The projects default to all of them.  Since the runs do not need a window
+ * system, the harness can be run with a software Vulkan driver (e.g.,
+ * Mesa's lavapipe) by setting the `VK_DRIVER_FILES` environment variable.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include "json.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#ifdef CS237_WINDOWS
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+/// the default number of frames per run
+constexpr uint32_t kDefaultFrames = 300;
+
+/// the projects that have scenes
+const std::vector<std::string> kProjects = { "proj1", "proj2", "proj3" };
+
+static void usage (int sts)
+{
+    std::cerr << "usage: cs237-bench [-frames n] [-o file] [project ...]\n";
+    exit (sts);
+}
+
+/// the scenes for a project in sorted order
+static std::vector<std::string> projectScenes (std::string const &proj)
+{
+    std::vector<std::string> scenes;
+    fs::path dir = fs::path(CS237_SOURCE_DIR) / "projects" / proj / "scenes";
+    std::error_code ec;
+    for (auto const &ent : fs::directory_iterator(dir, ec)) {
+        if (ent.is_directory()) {
+            scenes.push_back (ent.path().filename().string());
+        }
+    }
+    std::sort (scenes.begin(), scenes.end());
+    return scenes;
+}
+
+/// read the contents of a file; returns the empty string on failure
+static std::string readFile (fs::path const &path)
+{
+    std::ifstream inS(path);
+    if (! inS) {
+        return "";
+    }
+    std::stringstream ss;
+    ss << inS.rdbuf();
+    return ss.str();
+}
+
+/// run a project on a scene
+/// \param proj     the project
+/// \param scene    the scene
+/// \param nFrames  the number of frames to render
+/// \param[out] stats  the JSON statistics for the run
+/// \return the exit status of the run
+static int runScene (
+    std::string const &proj,
+    std::string const &scene,
+    uint32_t nFrames,
+    std::string &stats)
+{
+    fs::path exe = fs::path(CS237_BINARY_DIR) / "projects" / proj / "src" / proj;
+    // the process ID makes the file name unique, so concurrent runs of the
+    // harness do not clobber each other's results
+    fs::path out = fs::temp_directory_path()
+        / ("cs237-bench-" + std::to_string(getpid()) + "-" + proj + "-" + scene + ".json");
+    fs::remove (out);
+
+    // the project's output goes to stderr, so that it does not get mixed with
+    // the results when they are written to stdout
+    std::string cmd = "\"" + exe.string() + "\" -headless -frames " + std::to_string(nFrames)
+        + " -bench \"" + out.string() + "\" \"" + scene + "\" 1>&2";
+
+    std::cerr << "# " << proj << " " << scene << "\n";
+    int sts = std::system (cmd.c_str());
+#ifndef CS237_WINDOWS
+    // on POSIX systems, the result is a wait status
+    if (sts != -1) {
+        if (WIFEXITED(sts)) {
+            sts = WEXITSTATUS(sts);
+        } else if (WIFSIGNALED(sts)) {
+            sts = 128 + WTERMSIG(sts);
+        }
+    }
+#endif
+    if (sts == -1) {
+        std::cerr << "cs237-bench: unable to run " << proj << "\n";
+        sts = EXIT_FAILURE;
+    }
+
+    // check that the results are well formed before including them
+    stats = "null";
+    json::Value *v = fs::exists(out) ? json::parseFile (out.string()) : nullptr;
+    if ((v != nullptr) && v->isObject()) {
+        stats = readFile (out);
+        // drop the trailing newline
+        while (!stats.empty() && std::isspace(static_cast<unsigned char>(stats.back()))) {
+            stats.pop_back();
+        }
+    } else if (sts == 0) {
+        std::cerr << "cs237-bench: no results for " << proj << " " << scene << "\n";
+        sts = EXIT_FAILURE;
+    }
+    delete v;
+    fs::remove (out);
+
+    return sts;
+}
+
+int main (int argc, char *argv[])
+{
+    uint32_t nFrames = kDefaultFrames;
+    std::string outFile = "-";
+    std::vector<std::string> projects;
+
+    // process the command-line arguments
+    for (int i = 1;  i < argc;  ++i) {
+        std::string arg(argv[i]);
+        if (arg == "-frames") {
+            if (++i >= argc) { usage (EXIT_FAILURE); }
+            nFrames = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 10));
+            if (nFrames == 0) { usage (EXIT_FAILURE); }
+        } else if (arg == "-o") {
+            if (++i >= argc) { usage (EXIT_FAILURE); }
+            outFile = argv[i];
+        } else if (std::find(kProjects.begin(), kProjects.end(), arg) != kProjects.end()) {
+            projects.push_back (arg);
+        } else {
+            usage (EXIT_FAILURE);
+        }
+    }
+    if (projects.empty()) {
+        projects = kProjects;
+    }
+
+    std::ofstream outF;
+    if (outFile != "-") {
+        outF.open (outFile);
+        if (! outF) {
+            std::cerr << "cs237-bench: unable to open '" << outFile << "'\n";
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream &out = (outFile != "-") ? outF : std::cout;
+
+    int nFailed = 0;
+    bool first = true;
+    out << "{\n\"frames\": " << nFrames << ",\n\"runs\": [";
+    for (auto const &proj : projects) {
+        for (auto const &scene : projectScenes(proj)) {
+            std::string stats;
+            int sts = runScene (proj, scene, nFrames, stats);
+            if (sts != 0) {
+                nFailed++;
+            }
+            out << (first ? "\n" : ",\n")
+                << "{ \"project\": \"" << proj << "\", \"scene\": \"" << scene
+                << "\", \"status\": " << sts << ",\n  \"stats\": " << stats << " }";
+            first = false;
+        }
+    }
+    out << "\n]\n}\n";
+
+    if (nFailed > 0) {
+        std::cerr << "cs237-bench: " << nFailed << " runs failed\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
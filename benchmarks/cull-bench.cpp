@@ -0,0 +1,148 @@
+/*! \file cull-bench.cpp
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Compares the cost of culling bounding boxes one at a time using
+ * `Frustum::intersectsBox` with the batched `BoundsArray` kernels.  Before
+ * the measurements, it checks that the occlusion buffer does not cull boxes
+ * that are just past the silhouette of an occluder.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include <chrono>
+#include <random>
+#include <cstdio>
+
+using Clock = std::chrono::steady_clock;
+
+/// the minimum number of box tests per measurement; small problem sizes are
+/// repeated to reach this count
+constexpr uint64_t kMinTests = 50000000;
+
+/// generate `n` random boxes scattered around the origin
+static std::vector<cs237::AABBf_t> genBoxes (uint32_t n)
+{
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<float> pos(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> sz(0.5f, 10.0f);
+    std::vector<cs237::AABBf_t> boxes;
+    boxes.reserve(n);
+    for (uint32_t i = 0;  i < n;  ++i) {
+        glm::vec3 c(pos(rng), pos(rng), pos(rng));
+        glm::vec3 e(sz(rng), sz(rng), sz(rng));
+        boxes.push_back(cs237::AABBf_t(c - e, c + e));
+    }
+    return boxes;
+}
+
+/// run a test function enough times to get a stable measurement
+/// \return the number of instances tested per nanosecond
+template <typename F>
+static double measure (uint32_t n, uint32_t &nVis, F fn)
+{
+    uint32_t reps = std::max(uint64_t(1), kMinTests / n);
+    // warm up the caches
+    nVis = fn();
+    auto start = Clock::now();
+    for (uint32_t i = 0;  i < reps;  ++i) {
+        nVis = fn();
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return (double(n) * double(reps)) / ns;
+}
+
+/// check the coverage of the occlusion buffer along an occluder's silhouette
+/// \return true if the checks pass
+static bool checkOcclusion ()
+{
+    // a 64x64 buffer with the identity view-projection matrix, so NDC x = 0.03
+    // maps to pixel x = 32.96
+    cs237::OcclusionBuffer occBuf(64, 64);
+    occBuf.begin (glm::mat4(1.0f));
+
+    // a two-triangle quad at depth 0.5 that covers NDC x in [-1, 0.03]
+    std::vector<glm::vec3> verts = {
+            glm::vec3(-1.0f, -1.0f, 0.5f), glm::vec3(0.03f, -1.0f, 0.5f),
+            glm::vec3(0.03f, 1.0f, 0.5f), glm::vec3(-1.0f, 1.0f, 0.5f)
+        };
+    std::vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
+    occBuf.addTriangles (glm::mat4(1.0f), verts, indices);
+    occBuf.finish ();
+
+    // a box behind the quad, which covers pixels on both sides of the diagonal
+    cs237::AABBf_t hidden(glm::vec3(-0.8f, -0.5f, 0.7f), glm::vec3(-0.2f, 0.5f, 0.8f));
+    if (! occBuf.isOccluded(hidden)) {
+        std::cerr << "cull-bench: box behind the occluder is not occluded\n";
+        return false;
+    }
+
+    // a box behind the plane of the quad that is just past its right edge; it
+    // lies in pixel 32, whose center is covered by the quad
+    cs237::AABBf_t past(glm::vec3(0.0305f, 0.01f, 0.7f), glm::vec3(0.0309f, 0.02f, 0.8f));
+    if (occBuf.isOccluded(past)) {
+        std::cerr << "cull-bench: box past the occluder's edge is occluded\n";
+        return false;
+    }
+
+    return true;
+}
+
+int main ()
+{
+    if (! checkOcclusion()) {
+        return 1;
+    }
+
+    // a camera looking down the +X axis
+    glm::mat4 projM = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 1.0f, 1000.0f);
+    glm::mat4 viewM = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    cs237::Frustumf_t frustum(projM * viewM);
+
+    std::printf("%10s %12s %12s %12s %10s\n",
+        "# boxes", "scalar", "SoA box", "SoA sphere", "% visible");
+    for (uint32_t n : { 1000u, 100000u, 1000000u }) {
+        auto boxes = genBoxes(n);
+        cs237::BoundsArray bounds;
+        bounds.reserve(n);
+        for (auto const &bb : boxes) {
+            bounds.push_back(bb);
+        }
+        std::vector<uint32_t> visible(n);
+
+        uint32_t nScalar, nBox, nSphere;
+        double scalar = measure(n, nScalar, [&]() {
+            uint32_t nv = 0;
+            for (uint32_t i = 0;  i < n;  ++i) {
+                if (frustum.intersectsBox(boxes[i])) {
+                    visible[nv++] = i;
+                }
+            }
+            return nv;
+        });
+        double soaBox = measure(n, nBox, [&]() {
+            return bounds.cullBoxes(frustum, 0, n, visible.data());
+        });
+        double soaSphere = measure(n, nSphere, [&]() {
+            return bounds.cullSpheres(frustum, 0, n, visible.data());
+        });
+
+        if (nScalar != nBox) {
+            std::cerr << "cull-bench: box kernel mismatch (" << nScalar
+                << " vs. " << nBox << ")\n";
+            return 1;
+        }
+
+        std::printf("%10u %12.3f %12.3f %12.3f %10.1f\n",
+            n, scalar, soaBox, soaSphere, 100.0 * double(nBox) / double(n));
+    }
+    std::printf("# rates are in instances/ns\n");
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*! \file grid-bench.cpp
+ *
+ * Grid index-buffer microbenchmarks.
+ *
+ * Compares the triangle-list and triangle-strip index buffers that are generated
+ * by the Project 3 `grid-indices` functions for the grids used by the LOD
+ * terrain tiles and by full-resolution height fields.  We cannot measure GPU
+ * throughput here, so we report the two costs that the choice of topology
+ * affects: the size of the index data, which the GPU must fetch, and the
+ * average number of vertex-shader invocations per triangle (the ACMR), which
+ * we get by simulating the GPU's post-transform vertex cache as a FIFO.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include "grid-indices.hpp"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+
+using Clock = std::chrono::steady_clock;
+
+/// the post-transform cache sizes that we simulate
+constexpr uint32_t kCacheSizes[] = { 16, 32, 64 };
+
+/// a triangle with its vertices rotated so that the smallest index is first,
+/// which preserves the winding order
+using Tri = std::array<uint32_t, 3>;
+
+static Tri mkTri (uint32_t a, uint32_t b, uint32_t c)
+{
+    if ((b < a) && (b < c)) { return Tri{ b, c, a }; }
+    if ((c < a) && (c < b)) { return Tri{ c, a, b }; }
+    return Tri{ a, b, c };
+}
+
+/// the triangles of an index buffer
+static std::vector<Tri> triangles (std::vector<uint32_t> const &indices, bool strips)
+{
+    std::vector<Tri> tris;
+    if (!strips) {
+        for (size_t i = 0;  i + 2 < indices.size();  i += 3) {
+            tris.push_back(mkTri(indices[i], indices[i+1], indices[i+2]));
+        }
+        return tris;
+    }
+    size_t start = 0;
+    for (size_t i = 0;  i < indices.size();  ++i) {
+        if (indices[i] == kRestartIndex) {
+            start = i + 1;
+        } else if (i >= start + 2) {
+            // every other triangle of a strip has its first two vertices swapped
+            if (((i - start) & 1) == 0) {
+                tris.push_back(mkTri(indices[i-2], indices[i-1], indices[i]));
+            } else {
+                tris.push_back(mkTri(indices[i-1], indices[i-2], indices[i]));
+            }
+        }
+    }
+    return tris;
+}
+
+/// simulate a FIFO post-transform cache of `cacheSz` entries
+/// \return the number of cache misses (i.e., vertex-shader invocations)
+static uint32_t cacheMisses (std::vector<uint32_t> const &indices, uint32_t cacheSz)
+{
+    std::deque<uint32_t> fifo;
+    uint32_t misses = 0;
+    for (auto ix : indices) {
+        if (ix == kRestartIndex) {
+            continue;
+        }
+        if (std::find(fifo.begin(), fifo.end(), ix) == fifo.end()) {
+            misses++;
+            fifo.push_back(ix);
+            if (fifo.size() > cacheSz) {
+                fifo.pop_front();
+            }
+        }
+    }
+    return misses;
+}
+
+/// time a function
+/// \return the average time per call in microseconds
+template <typename F>
+static double timeIt (int reps, F fn)
+{
+    auto start = Clock::now();
+    for (int i = 0;  i < reps;  ++i) {
+        fn();
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count()
+        / double(reps);
+}
+
+int main ()
+{
+    struct Layout { const char *name; bool strips; uint32_t blockSz; };
+    const Layout layouts[] = {
+            { "list", false, 0 },
+            { "row strips", true, 0 },
+            { "z-order/4", true, 4 },
+            { "z-order/8", true, kDefaultStripBlock },
+            { "z-order/16", true, 16 }
+        };
+
+    for (uint32_t sz : { 65u, 257u, 1025u }) {
+        std::vector<Tri> listTris = triangles(gridTriangleList(sz, sz), false);
+        std::sort (listTris.begin(), listTris.end());
+
+        std::printf("%u x %u grid (%zu triangles)\n", sz, sz, listTris.size());
+        std::printf("%12s %10s %8s %10s", "layout", "indices", "KB", "gen (us)");
+        for (auto cacheSz : kCacheSizes) {
+            std::printf("   ACMR/%-3u", cacheSz);
+        }
+        std::printf("\n");
+
+        for (auto const &layout : layouts) {
+            std::vector<uint32_t> indices;
+            int reps = (sz < 1000) ? 100 : 5;
+            double genT = timeIt(reps, [&]() {
+                indices = layout.strips
+                    ? gridTriangleStrips(sz, sz, layout.blockSz)
+                    : gridTriangleList(sz, sz);
+            });
+
+            // check that we get the same triangles with the same winding
+            std::vector<Tri> tris = triangles(indices, layout.strips);
+            std::sort (tris.begin(), tris.end());
+            if (tris != listTris) {
+                std::cerr << "grid-bench: " << layout.name << " triangles do not match the list\n";
+                return 1;
+            }
+
+            std::printf("%12s %10zu %8.1f %10.1f", layout.name, indices.size(),
+                double(indices.size() * sizeof(uint32_t)) / 1024.0, genT);
+            for (auto cacheSz : kCacheSizes) {
+                std::printf("   %9.3f", double(cacheMisses(indices, cacheSz)) / double(tris.size()));
+            }
+            std::printf("\n");
+        }
+    }
+    std::printf("# ACMR is the number of vertex-shader invocations per triangle\n");
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+/*! \file hf-bench.cpp
+ *
+ * Height-field microbenchmarks.
+ *
+ * Measures the cost of building the min/max pyramid of the Project 3
+ * `HeightField` class, and compares region-bounds queries and ray casts that
+ * use the pyramid against brute-force versions that examine every sample.
+ * It also measures the time to generate normal maps of various sizes.
+ * The data is the `ground+rock` height field from the Project 3 scenes.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include "height-field.hpp"
+#include <chrono>
+#include <random>
+#include <cstdio>
+
+using Clock = std::chrono::steady_clock;
+
+/// the height field and its world-space scaling (see the scene's "scene.json" file)
+constexpr char kHFFile[] = CS237_SOURCE_DIR "/projects/proj3/scenes/ground+rock/ground-hf.png";
+constexpr float kWidth = 60.0f;
+constexpr float kHeight = 60.0f;
+constexpr float kVScale = 0.0005f;
+
+/// the number of random queries of each kind
+constexpr int kNumRays = 100000;
+constexpr int kNumBruteRays = 200;
+constexpr int kNumBounds = 100000;
+constexpr int kNumHeights = 1000000;
+
+/// the sizes of the generated normal maps
+constexpr uint32_t kNMapSizes[] = { 1024, 4096, 8192 };
+
+/// time a function
+/// \return the average time per call in microseconds
+template <typename F>
+static double timeIt (int reps, F fn)
+{
+    auto start = Clock::now();
+    for (int i = 0;  i < reps;  ++i) {
+        fn();
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count()
+        / double(reps);
+}
+
+/// Moller-Trumbore ray-triangle intersection for the brute-force ray cast
+static float rayTri (
+    glm::vec3 const &orig, glm::vec3 const &dir,
+    glm::vec3 const &v0, glm::vec3 const &v1, glm::vec3 const &v2)
+{
+    glm::vec3 e1 = v1 - v0;
+    glm::vec3 e2 = v2 - v0;
+    glm::vec3 p = glm::cross(dir, e2);
+    float det = glm::dot(e1, p);
+    if (std::fabs(det) < 1e-12f) {
+        return -1.0f;
+    }
+    glm::vec3 s = orig - v0;
+    float u = glm::dot(s, p) / det;
+    if ((u < 0.0f) || (u > 1.0f)) {
+        return -1.0f;
+    }
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(dir, q) / det;
+    if ((v < 0.0f) || (u + v > 1.0f)) {
+        return -1.0f;
+    }
+    return glm::dot(e2, q) / det;
+}
+
+/// brute-force ray cast that tests every triangle of the height field
+static bool bruteRay (HeightField const &hf, glm::vec3 const &orig, glm::vec3 const &dir, float &t)
+{
+    bool hit = false;
+    t = std::numeric_limits<float>::max();
+    for (uint32_t r = 0;  r+1 < hf.numRows();  ++r) {
+        for (uint32_t c = 0;  c+1 < hf.numCols();  ++c) {
+            glm::vec3 v00 = hf.vertexAt(r, c);
+            glm::vec3 v01 = hf.vertexAt(r, c+1);
+            glm::vec3 v10 = hf.vertexAt(r+1, c);
+            glm::vec3 v11 = hf.vertexAt(r+1, c+1);
+            for (float tt : { rayTri(orig, dir, v00, v10, v01), rayTri(orig, dir, v01, v10, v11) }) {
+                if ((tt >= 0.0f) && (tt < t)) {
+                    t = tt;
+                    hit = true;
+                }
+            }
+        }
+    }
+    return hit;
+}
+
+/// brute-force bounds of a region of the height field
+static cs237::AABBf_t bruteBounds (
+    HeightField const &hf,
+    uint32_t row0, uint32_t col0, uint32_t row1, uint32_t col1)
+{
+    cs237::AABBf_t bb;
+    for (uint32_t r = row0;  r <= row1;  ++r) {
+        for (uint32_t c = col0;  c <= col1;  ++c) {
+            bb.addPt (hf.vertexAt(r, c));
+        }
+    }
+    return bb;
+}
+
+int main ()
+{
+    std::mt19937 rng(17);
+
+    // the normal maps are generated in parallel; we do not have an application,
+    // so we use our own job system
+    cs237::JobSystem js;
+
+    // we time the construction, which is dominated by building the pyramid
+    HeightField *hf = nullptr;
+    double buildT = timeIt(1, [&]() {
+        hf = new HeightField(kHFFile, kWidth, kHeight, kVScale, glm::vec3(1.0f), nullptr, nullptr, js);
+    });
+    uint32_t nRows = hf->numRows();
+    uint32_t nCols = hf->numCols();
+    cs237::AABBf_t bbox = hf->bbox();
+    // the construction includes generating a normal map, since we do not provide one
+    std::printf("height field: %u x %u samples, %u pyramid levels, load+build %.3f ms\n",
+        nCols, nRows, hf->numPyramidLevels(), buildT / 1000.0);
+
+    // random rays that start above the terrain and point downward
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    auto randRay = [&](glm::vec3 &orig, glm::vec3 &dir) {
+        orig = glm::vec3(
+            0.5f * kWidth * unit(rng),
+            bbox.max().y + 1.0f + 4.0f * std::fabs(unit(rng)),
+            0.5f * kHeight * unit(rng));
+        dir = glm::vec3(unit(rng), -0.05f - std::fabs(unit(rng)), unit(rng));
+    };
+
+    // check the pyramid ray cast against the brute-force version
+    for (int i = 0;  i < kNumBruteRays;  ++i) {
+        glm::vec3 o, d;
+        randRay(o, d);
+        float t1 = 0.0f, t2 = 0.0f;
+        bool hit1 = hf->intersectRay(o, d, std::numeric_limits<float>::max(), t1);
+        bool hit2 = bruteRay(*hf, o, d, t2);
+        if ((hit1 != hit2) || (hit1 && (std::fabs(t1 - t2) > 1e-3f * std::max(1.0f, t2)))) {
+            std::cerr << "hf-bench: ray-cast mismatch\n";
+            return 1;
+        }
+    }
+
+    std::vector<glm::vec3> origs(kNumRays), dirs(kNumRays);
+    for (int i = 0;  i < kNumRays;  ++i) {
+        randRay(origs[i], dirs[i]);
+    }
+    int nHits = 0;
+    double rayT = timeIt(1, [&]() {
+        for (int i = 0;  i < kNumRays;  ++i) {
+            float t;
+            nHits += hf->intersectRay(origs[i], dirs[i], std::numeric_limits<float>::max(), t);
+        }
+    });
+    double bruteRayT = timeIt(1, [&]() {
+        for (int i = 0;  i < kNumBruteRays;  ++i) {
+            float t;
+            bruteRay(*hf, origs[i], dirs[i], t);
+        }
+    });
+    std::printf("ray casts: %.0f rays/sec (pyramid), %.0f rays/sec (brute force), %d%% hits\n",
+        1e6 * double(kNumRays) / rayT,
+        1e6 * double(kNumBruteRays) / bruteRayT,
+        (100 * nHits) / kNumRays);
+
+    // random region-bounds queries
+    struct Region { uint32_t r0, c0, r1, c1; };
+    std::vector<Region> regions(kNumBounds);
+    for (auto &rgn : regions) {
+        rgn.r0 = rng() % (nRows - 1);
+        rgn.c0 = rng() % (nCols - 1);
+        rgn.r1 = rgn.r0 + 1 + rng() % (nRows - 1 - rgn.r0);
+        rgn.c1 = rgn.c0 + 1 + rng() % (nCols - 1 - rgn.c0);
+        cs237::AABBf_t b1 = hf->bounds(rgn.r0, rgn.c0, rgn.r1, rgn.c1);
+        cs237::AABBf_t b2 = bruteBounds(*hf, rgn.r0, rgn.c0, rgn.r1, rgn.c1);
+        if ((b1.min().y != b2.min().y) || (b1.max().y != b2.max().y)) {
+            std::cerr << "hf-bench: bounds mismatch\n";
+            return 1;
+        }
+    }
+    float sum = 0.0f;
+    double boundsT = timeIt(1, [&]() {
+        for (auto const &rgn : regions) {
+            sum += hf->bounds(rgn.r0, rgn.c0, rgn.r1, rgn.c1).max().y;
+        }
+    });
+    double bruteBoundsT = timeIt(1, [&]() {
+        for (auto const &rgn : regions) {
+            sum += bruteBounds(*hf, rgn.r0, rgn.c0, rgn.r1, rgn.c1).max().y;
+        }
+    });
+    std::printf("bounds queries: %.1f ns (pyramid), %.1f ns (brute force)\n",
+        1000.0 * boundsT / double(kNumBounds),
+        1000.0 * bruteBoundsT / double(kNumBounds));
+
+    // bilinear height queries
+    double heightT = timeIt(1, [&]() {
+        for (int i = 0;  i < kNumHeights;  ++i) {
+            sum += hf->heightAt(0.5f * kWidth * unit(rng), 0.5f * kHeight * unit(rng));
+        }
+    });
+    std::printf("height queries: %.1f ns (including random-number generation)\n",
+        1000.0 * heightT / double(kNumHeights));
+
+    // normal-map generation; we first check a small map against the normals
+    // at the samples, which give the slopes that the generator interpolates
+    {
+        uint32_t wid = 3 * nCols, ht = 2 * nRows;
+        cs237::DataImage2D *nmap = hf->generateNormalMap(wid, ht, js);
+        const uint8_t *texels = static_cast<const uint8_t *>(nmap->data());
+        auto slopes = [&](uint32_t r, uint32_t c) {
+            glm::vec3 n = hf->normalAt(r, c);
+            return glm::vec2(-n.x / n.y, -n.z / n.y);
+        };
+        for (uint32_t y = 0;  y < ht;  ++y) {
+            float gz = (float(y) + 0.5f) * float(nRows - 1) / float(ht);
+            uint32_t r = std::min(uint32_t(gz), nRows - 2);
+            for (uint32_t x = 0;  x < wid;  ++x) {
+                float gx = (float(x) + 0.5f) * float(nCols - 1) / float(wid);
+                uint32_t c = std::min(uint32_t(gx), nCols - 2);
+                glm::vec2 s = glm::mix(
+                    glm::mix(slopes(r, c), slopes(r, c+1), gx - float(c)),
+                    glm::mix(slopes(r+1, c), slopes(r+1, c+1), gx - float(c)),
+                    gz - float(r));
+                glm::vec3 n = glm::normalize(glm::vec3(-s.x, -s.y, 1.0f));
+                const uint8_t *rgba = texels + 4 * (size_t(y) * wid + x);
+                for (int i = 0;  i < 3;  ++i) {
+                    if (std::abs(int(rgba[i]) - int(127.5f * n[i] + 128.0f)) > 1) {
+                        std::cerr << "hf-bench: normal-map mismatch\n";
+                        return 1;
+                    }
+                }
+            }
+        }
+        delete nmap;
+    }
+    for (uint32_t sz : kNMapSizes) {
+        cs237::DataImage2D *nmap = nullptr;
+        double nmapT = timeIt(1, [&]() { nmap = hf->generateNormalMap(sz, sz, js); });
+        sum += float(static_cast<const uint8_t *>(nmap->data())[0]);
+        delete nmap;
+        std::printf("normal map: %u x %u texels in %.2f ms (%.2f ns/texel)\n",
+            sz, sz, nmapT / 1000.0, 1000.0 * nmapT / (double(sz) * double(sz)));
+    }
+
+    // use the sum so that the compiler does not optimize the queries away
+    if (std::isnan(sum)) {
+        std::cerr << "hf-bench: unexpected NaN\n";
+    }
+
+    delete hf;
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*! \file jobs-bench.cpp
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Measures the overheads of the work-stealing job system (`JobSystem`) as a
+ * function of the number of threads:
+ *
+ *   - fib: naive parallel Fibonacci, which spawns a future per call above a
+ *     cutoff and so stresses spawning, stealing, and cooperative waiting
+ *
+ *   - parallelFor: the time per subrange of a `parallelFor` with an empty
+ *     body, which is the overhead that a parallel loop pays for each piece
+ *
+ *   - throughput: the number of independent empty tasks per second that can
+ *     be spawned from the main thread and run
+ *
+ * It also reports the number of tasks that were stolen by idle workers.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include <chrono>
+#include <cstdio>
+
+using Clock = std::chrono::steady_clock;
+
+/// the Fibonacci argument
+constexpr int kFibN = 30;
+
+/// below this argument, fib is computed sequentially
+constexpr int kFibCutoff = 12;
+
+/// the size of the parallelFor range (which is also the number of subranges)
+constexpr uint32_t kLoopSz = 1000000;
+
+/// the number of tasks for the throughput test
+constexpr uint32_t kNumTasks = 1000000;
+
+/// sequential fib
+static int seqFib (int n)
+{
+    return (n < 2) ? n : seqFib(n - 1) + seqFib(n - 2);
+}
+
+/// parallel fib
+static int parFib (cs237::JobSystem &js, int n)
+{
+    if (n < kFibCutoff) {
+        return seqFib(n);
+    }
+    auto f1 = js.async([&js, n]() { return parFib(js, n - 1); });
+    int f2 = parFib(js, n - 2);
+    return f1.get() + f2;
+}
+
+/// time a function in ms
+template <typename F>
+static double timeIt (F fn)
+{
+    auto start = Clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main ()
+{
+    uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t n = 1;  n < maxThreads;  n *= 2) {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(maxThreads);
+
+    int expected = seqFib(kFibN);
+    double seqTime = timeIt([]() { seqFib(kFibN); });
+    std::printf("sequential fib(%d): %.2f ms\n", kFibN, seqTime);
+
+    std::printf("%8s %10s %8s %12s %12s %10s\n",
+        "threads", "fib (ms)", "speedup", "pfor (ns)", "tasks/s", "steals");
+    for (auto nThreads : threadCounts) {
+        cs237::JobSystem js(nThreads);
+
+        int result;
+        auto before = js.stats();
+        double fibTime = timeIt([&]() { result = parFib(js, kFibN); });
+        if (result != expected) {
+            std::cerr << "jobs-bench: fib mismatch (" << result
+                << " vs. " << expected << ")\n";
+            return 1;
+        }
+
+        // a grain size of one makes every index a separate subrange
+        std::atomic<uint32_t> nItems(0);
+        double pforTime = timeIt([&]() {
+            js.parallelFor (0, kLoopSz, 1, [&](uint32_t lo, uint32_t hi) {
+                nItems.fetch_add(hi - lo, std::memory_order_relaxed);
+            });
+        });
+        if (nItems.load() != kLoopSz) {
+            std::cerr << "jobs-bench: parallelFor covered " << nItems.load()
+                << " of " << kLoopSz << " items\n";
+            return 1;
+        }
+
+        auto after = js.stats();
+
+        double taskTime = timeIt([&]() {
+            cs237::TaskCounter ctr;
+            for (uint32_t i = 0;  i < kNumTasks;  ++i) {
+                js.run ([]() { }, &ctr);
+            }
+            js.wait (ctr);
+        });
+
+        std::printf("%8u %10.2f %8.2f %12.1f %12.3g %10lu\n",
+            nThreads, fibTime, seqTime / fibTime,
+            1.0e6 * pforTime / double(kLoopSz),
+            1.0e3 * double(kNumTasks) / taskTime,
+            (unsigned long)(after.nSteals - before.nSteals));
+    }
+    std::printf("# speedup is relative to sequential fib; pfor is the time per subrange;\n");
+    std::printf("# steals is the number of tasks stolen during fib and parallelFor\n");
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*! \file pipeline-bench.cpp
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Measures the time to create a group of specialized variants of a graphics
+ * pipeline, first one at a time and then as a single batch (see
+ * `Application::createPipelines`).  The variants differ only in the values of
+ * their specialization constants, which are a mix of boolean, floating-point,
+ * and unsigned constants.  The pipelines are compiled using the application's
+ * pipeline cache, which is saved when the program exits, so delete the
+ * `pipeline-bench.pcache` file in the `cache` directory of the build tree
+ * before running the benchmark to measure the cost of compilation.  The
+ * benchmark needs a Vulkan device, but it does not open a window.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include <chrono>
+#include <cstdio>
+
+using Clock = std::chrono::steady_clock;
+
+/// the number of pipeline variants that are created by each method
+constexpr uint32_t kNumVariants = 64;
+
+/// the color format of the render pass
+constexpr vk::Format kColorFormat = vk::Format::eR8G8B8A8Unorm;
+
+/// the `constant_id`s of the specialization constants in the shaders
+constexpr uint32_t kInvertID = 0;
+constexpr uint32_t kScaleID = 1;
+constexpr uint32_t kVariantID = 2;
+
+/// the location of the compiled shaders
+const std::string kShaderDir = CS237_BINARY_DIR "/benchmarks/shaders/";
+
+class PipelineBench : public cs237::Application {
+public:
+    PipelineBench (std::vector<std::string> const &args)
+      : cs237::Application (args, "pipeline-bench")
+    { }
+
+    void run () override;
+
+    /// did all of the checks pass?
+    bool ok () const { return this->_ok; }
+
+private:
+    bool _ok = true;
+    vk::RenderPass _renderPass;
+    vk::PipelineLayout _pipeLayout;
+    cs237::Shaders *_shaders;
+
+    void _initRenderPass ();
+
+    /// \brief create the specialization constants for a variant
+    /// \param id  the variant's index; distinct indices give distinct pipelines
+    static cs237::SpecConstants _variant (uint32_t id)
+    {
+        cs237::SpecConstants consts;
+        consts.setBool (kInvertID, (id & 1) != 0)
+            .setFloat (kScaleID, 1.0f / float(1 + (id % 4)))
+            .setUint (kVariantID, id);
+        return consts;
+    }
+
+    /// \brief check the pipelines that were created for a group of variants
+    void _check (std::vector<vk::Pipeline> const &pipes, char const *what);
+
+};
+
+void PipelineBench::_initRenderPass ()
+{
+    vk::AttachmentDescription colorAttachment(
+        {}, /* flags */
+        kColorFormat, /* format */
+        vk::SampleCountFlagBits::e1, /* samples */
+        vk::AttachmentLoadOp::eClear, /* load op */
+        vk::AttachmentStoreOp::eDontCare, /* store op */
+        vk::AttachmentLoadOp::eDontCare, /* stencil load op */
+        vk::AttachmentStoreOp::eDontCare, /* stencil store op */
+        vk::ImageLayout::eUndefined, /* initial layout */
+        vk::ImageLayout::eColorAttachmentOptimal); /* final layout */
+    vk::AttachmentReference colorRef(0, vk::ImageLayout::eColorAttachmentOptimal);
+    vk::SubpassDescription subpass(
+        {}, /* flags */
+        vk::PipelineBindPoint::eGraphics, /* pipeline bind point */
+        {}, /* input attachments */
+        colorRef, /* color attachments */
+        {}, /* resolve attachments */
+        nullptr, /* depth-stencil attachment */
+        {}); /* preserve attachments */
+    vk::RenderPassCreateInfo renderPassInfo(
+        {}, /* flags */
+        colorAttachment, /* attachments */
+        subpass, /* subpasses */
+        {}); /* dependencies */
+
+    this->_renderPass = this->_device.createRenderPass(renderPassInfo);
+}
+
+void PipelineBench::_check (std::vector<vk::Pipeline> const &pipes, char const *what)
+{
+    if (pipes.size() != kNumVariants) {
+        std::cerr << "pipeline-bench: wrong number of " << what << " pipelines\n";
+        this->_ok = false;
+        return;
+    }
+    for (auto pipe : pipes) {
+        if (! pipe) {
+            std::cerr << "pipeline-bench: null " << what << " pipeline\n";
+            this->_ok = false;
+            return;
+        }
+    }
+}
+
+void PipelineBench::run ()
+{
+    this->_initRenderPass ();
+    this->_pipeLayout = this->createPipelineLayout({}, {});
+    this->_shaders = new cs237::Shaders(
+        this,
+        kShaderDir + "pipeline-bench",
+        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
+
+    vk::VertexInputBindingDescription vBinding(
+        0, /* binding */
+        sizeof(glm::vec3), /* stride */
+        vk::VertexInputRate::eVertex);
+    vk::VertexInputAttributeDescription vAttr(
+        0, /* location */
+        0, /* binding */
+        vk::Format::eR32G32B32Sfloat, /* format */
+        0); /* offset */
+    vk::PipelineVertexInputStateCreateInfo vertexInfo(
+        {}, /* flags */
+        vBinding, /* vertex bindings */
+        vAttr); /* vertex attributes */
+
+    // the two groups use disjoint variant indices, so that the batch does not
+    // hit the pipelines that were created one at a time in the cache
+    std::vector<cs237::SpecConstants> consts;
+    consts.reserve(2 * kNumVariants);
+    std::vector<cs237::Application::PipelineDesc> descs(2 * kNumVariants);
+    for (uint32_t i = 0;  i < 2 * kNumVariants;  ++i) {
+        consts.push_back (_variant (i));
+        descs[i].shaders = this->_shaders;
+        descs[i].specConsts = &consts[i];
+        descs[i].vertexInfo = vertexInfo;
+        descs[i].layout = this->_pipeLayout;
+        descs[i].renderPass = this->_renderPass;
+    }
+
+    // one at a time; a single description is created on the calling thread
+    std::vector<vk::Pipeline> single;
+    auto start = Clock::now();
+    for (uint32_t i = 0;  i < kNumVariants;  ++i) {
+        auto pipes = this->createPipelines ({ descs[i] });
+        single.push_back (pipes[0]);
+    }
+    double singleMS = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    this->_check (single, "single");
+
+    // as one batch, which is split across the job system's threads
+    std::vector<cs237::Application::PipelineDesc> batchDescs(
+        descs.begin() + kNumVariants, descs.end());
+    start = Clock::now();
+    std::vector<vk::Pipeline> batch = this->createPipelines (batchDescs);
+    double batchMS = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    this->_check (batch, "batched");
+
+    std::printf("# %u pipeline variants, %u hardware threads\n",
+        kNumVariants, std::max(std::thread::hardware_concurrency(), 1u));
+    std::printf("one at a time: %8.2f ms (%.3f ms per pipeline)\n",
+        singleMS, singleMS / double(kNumVariants));
+    std::printf("batched:       %8.2f ms (%.3f ms per pipeline)\n",
+        batchMS, batchMS / double(kNumVariants));
+
+    for (auto pipe : single) {
+        this->_device.destroyPipeline(pipe);
+    }
+    for (auto pipe : batch) {
+        this->_device.destroyPipeline(pipe);
+    }
+    delete this->_shaders;
+    this->_device.destroyPipelineLayout(this->_pipeLayout);
+    this->_device.destroyRenderPass(this->_renderPass);
+}
+
+int main (int argc, char *argv[])
+{
+    std::vector<std::string> args(argv, argv+argc);
+    PipelineBench app(args);
+
+    try {
+        app.run();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return app.ok() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,320 @@
+/*! \file record-bench.cpp
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Measures the time to record the draw commands for a stress scene of
+ * 50,000 instances as a function of the number of recording threads (see
+ * `ParallelRecorder`).  Each instance is drawn with its own push constants
+ * and `drawIndexed` call, which is the worst case for command recording.
+ * The command buffers are recorded but never submitted, so the benchmark
+ * needs a Vulkan device, but it does not open a window.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include <chrono>
+#include <random>
+#include <cstdio>
+
+using Clock = std::chrono::steady_clock;
+
+/// the number of instances in the stress scene
+constexpr uint32_t kNumInstances = 50000;
+
+/// the number of times that each measurement is repeated
+constexpr int kNumReps = 20;
+
+/// the size of the (offscreen) framebuffer
+constexpr uint32_t kFBSize = 256;
+
+/// the color format of the framebuffer
+constexpr vk::Format kColorFormat = vk::Format::eR8G8B8A8Unorm;
+
+/// the location of the compiled shaders
+const std::string kShaderDir = CS237_BINARY_DIR "/benchmarks/shaders/";
+
+/// the per-instance push constants; see record-bench.vert
+struct PushConsts {
+    glm::mat4 toClip;
+    glm::vec4 color;
+};
+
+class RecordBench : public cs237::Application {
+public:
+    RecordBench (std::vector<std::string> const &args)
+      : cs237::Application (args, "record-bench")
+    { }
+
+    void run () override;
+
+private:
+    vk::RenderPass _renderPass;
+    vk::PipelineLayout _pipeLayout;
+    vk::Pipeline _pipeline;
+    cs237::VertexBuffer<glm::vec3> *_vBuf;
+    cs237::IndexBuffer<uint16_t> *_iBuf;
+    std::vector<PushConsts> _instances;
+
+    void _initRenderPass ();
+    void _initPipeline ();
+    void _initScene ();
+
+    /// record the draw commands for instances [lo..hi)
+    void _recordDraws (vk::CommandBuffer cmdBuf, uint32_t lo, uint32_t hi);
+
+};
+
+void RecordBench::_initRenderPass ()
+{
+    vk::AttachmentDescription colorAttachment(
+        {}, /* flags */
+        kColorFormat, /* format */
+        vk::SampleCountFlagBits::e1, /* samples */
+        vk::AttachmentLoadOp::eClear, /* load op */
+        vk::AttachmentStoreOp::eDontCare, /* store op */
+        vk::AttachmentLoadOp::eDontCare, /* stencil load op */
+        vk::AttachmentStoreOp::eDontCare, /* stencil store op */
+        vk::ImageLayout::eUndefined, /* initial layout */
+        vk::ImageLayout::eColorAttachmentOptimal); /* final layout */
+    vk::AttachmentReference colorRef(0, vk::ImageLayout::eColorAttachmentOptimal);
+    vk::SubpassDescription subpass(
+        {}, /* flags */
+        vk::PipelineBindPoint::eGraphics, /* pipeline bind point */
+        {}, /* input attachments */
+        colorRef, /* color attachments */
+        {}, /* resolve attachments */
+        nullptr, /* depth-stencil attachment */
+        {}); /* preserve attachments */
+    vk::RenderPassCreateInfo renderPassInfo(
+        {}, /* flags */
+        colorAttachment, /* attachments */
+        subpass, /* subpasses */
+        {}); /* dependencies */
+
+    this->_renderPass = this->_device.createRenderPass(renderPassInfo);
+}
+
+void RecordBench::_initPipeline ()
+{
+    auto shaders = new cs237::Shaders(
+        this,
+        kShaderDir + "record-bench",
+        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
+
+    vk::PushConstantRange pcRange(
+        vk::ShaderStageFlagBits::eVertex, /* stages */
+        0, /* offset */
+        sizeof(PushConsts)); /* size */
+    this->_pipeLayout = this->createPipelineLayout({}, { pcRange });
+
+    vk::VertexInputBindingDescription vBinding(
+        0, /* binding */
+        sizeof(glm::vec3), /* stride */
+        vk::VertexInputRate::eVertex);
+    vk::VertexInputAttributeDescription vAttr(
+        0, /* location */
+        0, /* binding */
+        vk::Format::eR32G32B32Sfloat, /* format */
+        0); /* offset */
+    vk::PipelineVertexInputStateCreateInfo vertexInfo(
+        {}, /* flags */
+        vBinding, /* vertex bindings */
+        vAttr); /* vertex attributes */
+
+    std::array<vk::DynamicState, 2> dynamic = {
+            vk::DynamicState::eViewport, vk::DynamicState::eScissor
+        };
+    this->_pipeline = this->createPipeline(
+        shaders,
+        vertexInfo,
+        vk::PrimitiveTopology::eTriangleList,
+        vk::ArrayProxy<vk::Viewport>(1, nullptr), /* viewports (dynamic) */
+        vk::ArrayProxy<vk::Rect2D>(1, nullptr), /* scissors (dynamic) */
+        vk::PolygonMode::eFill,
+        vk::CullModeFlagBits::eBack,
+        vk::FrontFace::eCounterClockwise,
+        this->_pipeLayout,
+        this->_renderPass,
+        0,
+        dynamic);
+
+    delete shaders;
+}
+
+void RecordBench::_initScene ()
+{
+    // a unit cube
+    std::vector<glm::vec3> verts = {
+            glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3( 0.5f, -0.5f, -0.5f),
+            glm::vec3( 0.5f,  0.5f, -0.5f), glm::vec3(-0.5f,  0.5f, -0.5f),
+            glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3( 0.5f, -0.5f,  0.5f),
+            glm::vec3( 0.5f,  0.5f,  0.5f), glm::vec3(-0.5f,  0.5f,  0.5f)
+        };
+    std::vector<uint16_t> indices = {
+            0, 2, 1,  0, 3, 2,      // -Z
+            4, 5, 6,  4, 6, 7,      // +Z
+            0, 1, 5,  0, 5, 4,      // -Y
+            3, 6, 2,  3, 7, 6,      // +Y
+            0, 4, 7,  0, 7, 3,      // -X
+            1, 2, 6,  1, 6, 5       // +X
+        };
+    this->_vBuf = new cs237::VertexBuffer<glm::vec3>(this, verts);
+    this->_iBuf = new cs237::IndexBuffer<uint16_t>(this, indices);
+
+    // scatter the instances in front of the camera
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    glm::mat4 projView =
+        glm::perspective(glm::radians(60.0f), 1.0f, 1.0f, 500.0f)
+        * glm::lookAt(glm::vec3(0.0f, 0.0f, 250.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    this->_instances.reserve(kNumInstances);
+    for (uint32_t i = 0;  i < kNumInstances;  ++i) {
+        glm::mat4 toWorld = glm::translate(glm::mat4(1.0f), glm::vec3(pos(rng), pos(rng), pos(rng)));
+        this->_instances.push_back(PushConsts{
+                projView * toWorld,
+                glm::vec4(unit(rng), unit(rng), unit(rng), 1.0f)
+            });
+    }
+}
+
+void RecordBench::_recordDraws (vk::CommandBuffer cmdBuf, uint32_t lo, uint32_t hi)
+{
+    // secondary command buffers do not inherit any state, so we have to
+    // set everything up for each chunk
+    cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, this->_pipeline);
+
+    vk::Viewport viewport(0.0f, 0.0f, float(kFBSize), float(kFBSize), 0.0f, 1.0f);
+    cmdBuf.setViewport(0, viewport);
+    vk::Rect2D scissor({0, 0}, {kFBSize, kFBSize});
+    cmdBuf.setScissor(0, scissor);
+
+    vk::DeviceSize offset = 0;
+    cmdBuf.bindVertexBuffers(0, this->_vBuf->vkBuffer(), offset);
+    cmdBuf.bindIndexBuffer(this->_iBuf->vkBuffer(), 0, vk::IndexType::eUint16);
+
+    for (uint32_t i = lo;  i < hi;  ++i) {
+        cmdBuf.pushConstants(
+            this->_pipeLayout,
+            vk::ShaderStageFlagBits::eVertex,
+            0,
+            sizeof(PushConsts),
+            &this->_instances[i]);
+        cmdBuf.drawIndexed(this->_iBuf->nIndices(), 1, 0, 0, 0);
+    }
+}
+
+void RecordBench::run ()
+{
+    this->_initRenderPass ();
+    this->_initPipeline ();
+    this->_initScene ();
+
+    // the offscreen color buffer
+    vk::Image colorImg = this->_createImage (
+        kFBSize, kFBSize, kColorFormat,
+        vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eColorAttachment);
+    vk::DeviceMemory colorMem = this->_allocImageMemory (
+        colorImg,
+        vk::MemoryPropertyFlagBits::eDeviceLocal);
+    vk::ImageView colorView = this->_createImageView (
+        colorImg, kColorFormat, vk::ImageAspectFlagBits::eColor);
+    vk::FramebufferCreateInfo fbInfo(
+        {}, /* flags */
+        this->_renderPass, /* render pass */
+        colorView, /* attachments */
+        kFBSize, /* width */
+        kFBSize, /* height */
+        1); /* layers */
+    vk::Framebuffer fb = this->_device.createFramebuffer(fbInfo);
+
+    vk::CommandBuffer primary = this->newCommandBuf();
+    vk::ClearValue clearColor(vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f));
+    vk::RenderPassBeginInfo rpBeginInfo(
+        this->_renderPass,
+        fb,
+        { {0, 0}, {kFBSize, kFBSize} },
+        clearColor);
+
+    std::printf("%u instances, %d repetitions\n", kNumInstances, kNumReps);
+    std::printf("%8s %10s %8s\n", "threads", "rec (ms)", "speedup");
+
+    // the baseline is recording inline into the primary command buffer
+    double baseTime = 0.0;
+    for (int rep = 0;  rep < kNumReps;  ++rep) {
+        primary.reset();
+        this->beginCommands(primary, true);
+        auto start = Clock::now();
+        primary.beginRenderPass(rpBeginInfo, vk::SubpassContents::eInline);
+        this->_recordDraws (primary, 0, kNumInstances);
+        primary.endRenderPass();
+        baseTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        this->endCommands(primary);
+    }
+    baseTime /= double(kNumReps);
+    std::printf("%8s %10.3f %8.2f\n", "inline", baseTime, 1.0);
+
+    // the thread counts are powers of two, plus the number of hardware threads
+    uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t n = 1;  n < maxThreads;  n *= 2) {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (auto nThreads : threadCounts) {
+        cs237::JobSystem js(nThreads);
+        cs237::ParallelRecorder recorder(this, 1, &js);
+        double t = 0.0;
+        for (int rep = 0;  rep < kNumReps;  ++rep) {
+            primary.reset();
+            this->beginCommands(primary, true);
+            primary.beginRenderPass(rpBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+            recorder.record (
+                0, primary, this->_renderPass, 0, fb, kNumInstances,
+                [this](vk::CommandBuffer cmdBuf, uint32_t lo, uint32_t hi) {
+                    this->_recordDraws (cmdBuf, lo, hi);
+                });
+            primary.endRenderPass();
+            this->endCommands(primary);
+            t += recorder.lastRecordTime();
+        }
+        t /= double(kNumReps);
+        std::printf("%8u %10.3f %8.2f\n", nThreads, t, baseTime / t);
+    }
+    std::printf("# speedup is relative to inline recording on one thread\n");
+
+    // cleanup
+    this->_device.freeCommandBuffers(this->_cmdPool, primary);
+    this->_device.destroyFramebuffer(fb);
+    this->_device.destroyImageView(colorView);
+    this->_device.destroyImage(colorImg);
+    this->_device.freeMemory(colorMem);
+    delete this->_vBuf;
+    delete this->_iBuf;
+    this->_device.destroyPipeline(this->_pipeline);
+    this->_device.destroyPipelineLayout(this->_pipeLayout);
+    this->_device.destroyRenderPass(this->_renderPass);
+}
+
+int main (int argc, char *argv[])
+{
+    std::vector<std::string> args(argv, argv+argc);
+    RecordBench app(args);
+
+    try {
+        app.run();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
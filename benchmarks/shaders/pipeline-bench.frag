@@ -0,0 +1,36 @@
+/*! \file pipeline-bench.frag
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Fragment shader for the pipeline-creation benchmark.  The specialization
+ * constants select the color, so that each variant of the pipeline is
+ * compiled separately.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://www.cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+/// should the color be inverted?
+layout (constant_id = 0) const bool kInvert = false;
+/// the variant's index, which determines its color
+layout (constant_id = 2) const uint kVariant = 0;
+
+layout (location = 0) out vec4 fragColor;
+
+void main ()
+{
+    vec3 color = vec3(
+        float(kVariant & 0xffu) / 255.0,
+        float((kVariant >> 8) & 0xffu) / 255.0,
+        float((kVariant >> 16) & 0xffu) / 255.0);
+    if (kInvert) {
+        color = vec3(1.0) - color;
+    }
+    fragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,25 @@
+/*! \file pipeline-bench.vert
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Vertex shader for the pipeline-creation benchmark.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://www.cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+/// scale factor for the vertex positions
+layout (constant_id = 1) const float kScale = 1.0;
+
+layout (location = 0) in vec3 vPos;
+
+void main ()
+{
+    gl_Position = vec4(kScale * vPos, 1.0);
+}
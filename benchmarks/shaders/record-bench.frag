@@ -0,0 +1,24 @@
+/*! \file record-bench.frag
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Fragment shader for the command-recording benchmark.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://www.cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+layout (location = 0) in vec4 fColor;
+
+layout (location = 0) out vec4 fragColor;
+
+void main ()
+{
+    fragColor = fColor;
+}
@@ -0,0 +1,31 @@
+/*! \file record-bench.vert
+ *
+ * CS237 Library microbenchmarks.
+ *
+ * Vertex shader for the command-recording benchmark; the per-instance
+ * transform and color come from push constants.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://www.cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+layout (push_constant) uniform PC {
+    mat4 toClip;        ///< model-to-clip-space transform
+    vec4 color;         ///< the instance color
+};
+
+layout (location = 0) in vec3 vPos;
+
+layout (location = 0) out vec4 fColor;
+
+void main ()
+{
+    gl_Position = toClip * vec4(vPos, 1.0);
+    fColor = color;
+}
@@ -90,7 +90,7 @@ struct AABB {
     {
         if ((! this->_empty) && (! bb._empty)) {
             this->_min = glm::min(this->_min, bb._min);
-            this->_max = glm::min(this->_max, bb._max);
+            this->_max = glm::max(this->_max, bb._max);
         }
         else if (this->_empty) {
             this->_empty = false;
@@ -109,6 +109,16 @@ struct AABB {
         return *this;
     }
 
+    //! the surface area of the box; this is 0 for empty boxes
+    T area () const
+    {
+        if (this->_empty) {
+            return T(0);
+        }
+        vec3 d = this->_max - this->_min;
+        return T(2) * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
   /***** Warning: the following functions are undefined on empty boxes! *****/
 
     //! minimum extents of the box
@@ -181,6 +191,28 @@ struct AABB {
             (i & 1) ? this->_max.z : this->_min.z);
     }
 
+    //! \brief transform the box by an affine transformation
+    //! \param m  the affine transformation matrix (e.g., an object's `toWorld` matrix)
+    //! \return the smallest axis-aligned box that contains the transformed box
+    //!
+    //! This function uses Arvo's method, which transforms the center of the box
+    //! and then uses the absolute values of the linear part of the matrix to compute
+    //! the new extents.  Unlike the other accessor functions, it is defined on
+    //! empty boxes (the result is empty).
+    AABB transform (glm::mat<4, 4, T, glm::defaultp> const &m) const
+    {
+        if (this->_empty) {
+            return AABB();
+        }
+        vec3 c = T(0.5) * (this->_min + this->_max);
+        vec3 e = T(0.5) * (this->_max - this->_min);
+        glm::mat<3, 3, T, glm::defaultp> absM(
+            glm::abs(vec3(m[0])), glm::abs(vec3(m[1])), glm::abs(vec3(m[2])));
+        vec3 newC = vec3(m * glm::vec<4, T, glm::defaultp>(c, T(1)));
+        vec3 newE = absM * e;
+        return AABB(newC - newE, newC + newE);
+    }
+
     /// return an array of the corners of the box
     std::array<vec3,8> corners () const
     {
@@ -206,12 +238,12 @@ std::ostream& operator<< (std::ostream& s, __detail::AABB<T> const &bb);
 //! \param bb2 an axis-aligned bounding box
 //! \return the smallest AABB that contains both \arg bb1 and \arg bb2.
 template <typename T>
-inline AABB<T> operator+ (AABB<T> const &bb1, AABB<T> &bb2)
+inline AABB<T> operator+ (AABB<T> const &bb1, AABB<T> const &bb2)
 {
-    if ((! bb1._empty) && (! bb2.empty)) {
-        return AABB<T>(glm::min(bb1._min, bb2._min), glm::max(bb1._min, bb2._min));
+    if ((! bb1._empty) && (! bb2._empty)) {
+        return AABB<T>(glm::min(bb1._min, bb2._min), glm::max(bb1._max, bb2._max));
     }
-    else if (bb1.empty) {
+    else if (bb1._empty) {
         return bb2;
     } else {
         return bb1;
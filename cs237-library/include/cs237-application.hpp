@@ -31,12 +31,21 @@ friend class __detail::TextureBase;
 friend class Texture1D;
 friend class Texture2D;
 friend class DepthBuffer;
+friend class Shaders;
+friend class ParallelRecorder;
+friend class FrameStats;
 
 public:
 
     /// \brief constructor for application base class
     /// \param args     vector of the command-line arguments
     /// \param name     optional name of the application
+    ///
+    /// The recognized command-line options are `-debug`, `-verbose`,
+    /// `-headless` (render to offscreen images without a window),
+    /// `-frames` *n* (stop after *n* frames; the default for headless runs
+    /// is one frame), and `-bench` *file* (write frame statistics to *file*
+    /// as JSON; see `FrameStats`).
     Application (std::vector<std::string> const &args, std::string const &name = "CS237 App");
 
     virtual ~Application ();
@@ -49,6 +58,14 @@ public:
 
     /// \brief is the program in debug mode?
     bool debug () const { return this->_debug; }
+    /// \brief is the program running without a window (i.e., rendering offscreen)?
+    bool headless () const { return this->_headless; }
+    /// \brief the number of frames to render before stopping (0 means no limit)
+    uint32_t maxFrames () const { return this->_maxFrames; }
+    /// \brief is the program collecting frame statistics?
+    bool benchmarking () const { return !this->_benchFile.empty(); }
+    /// \brief the file that the frame statistics are written to
+    std::string benchFile () const { return this->_benchFile; }
     /// \brief is the program in verbose mode?
     bool verbose () const
     {
@@ -56,6 +73,14 @@ public:
             == vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose;
     }
 
+    /// \brief the application's job system, which has one thread per hardware
+    ///        thread; it is created on first use
+    JobSystem &jobs ()
+    {
+        std::call_once (this->_jobsInit, [this]() { this->_jobs = new JobSystem(); });
+        return *this->_jobs;
+    }
+
     /// \brief Get the list of supported Vulkan instance extensions
     /// \return The vector of vk::ExtensionProperties for the supported extensions
     static std::vector<vk::ExtensionProperties> supportedExtensions ()
@@ -89,6 +114,9 @@ public:
         vk::SamplerAddressMode addressModeV;
         vk::SamplerAddressMode addressModeW;
         vk::BorderColor borderColor;
+        float maxAnisotropy;    ///< the maximum anisotropy; values less than or
+                                ///  equal to 1 disable anisotropic filtering and
+                                ///  values larger than the device limit are clamped
 
         SamplerInfo ()
           : magFilter(vk::Filter::eLinear), minFilter(vk::Filter::eLinear),
@@ -96,7 +124,8 @@ public:
             addressModeU(vk::SamplerAddressMode::eRepeat),
             addressModeV(vk::SamplerAddressMode::eRepeat),
             addressModeW(vk::SamplerAddressMode::eRepeat),
-            borderColor(vk::BorderColor::eIntOpaqueBlack)
+            borderColor(vk::BorderColor::eIntOpaqueBlack),
+            maxAnisotropy(kDefaultAnisotropy)
         { }
 
         /// sampler info for 1D texture
@@ -105,7 +134,8 @@ public:
             vk::SamplerAddressMode am, vk::BorderColor color)
           : magFilter(magF), minFilter(minF), mipmapMode(mm),
             addressModeU(am), addressModeV(vk::SamplerAddressMode::eRepeat),
-            addressModeW(vk::SamplerAddressMode::eRepeat), borderColor(color)
+            addressModeW(vk::SamplerAddressMode::eRepeat), borderColor(color),
+            maxAnisotropy(kDefaultAnisotropy)
         { }
 
         /// sampler info for 2D texture
@@ -115,19 +145,30 @@ public:
             vk::BorderColor color)
           : magFilter(magF), minFilter(minF), mipmapMode(mm),
             addressModeU(am1), addressModeV(am2),
-            addressModeW(vk::SamplerAddressMode::eRepeat), borderColor(color)
+            addressModeW(vk::SamplerAddressMode::eRepeat), borderColor(color),
+            maxAnisotropy(kDefaultAnisotropy)
         { }
 
+        /// the default maximum anisotropy, which is the largest value that
+        /// is commonly supported
+        static constexpr float kDefaultAnisotropy = 16.0f;
+
     };
 
-    /// \brief Create a texture sampler as specified
+    /// \brief Get a texture sampler as specified
     /// \param info  a simplified sampler specification
-    /// \return the created sampler
+    /// \return the sampler
+    ///
+    /// Samplers are cached, so requests with the same specification return the
+    /// same sampler.  The sampler is owned by the application and must *not* be
+    /// destroyed by the caller.  It is an error to create more samplers than the
+    /// device's `maxSamplerAllocationCount` limit.
     vk::Sampler createSampler (SamplerInfo const &info);
 
-    /// \brief Create a depth-texture sampler as specified
+    /// \brief Get a depth-texture sampler as specified
     /// \param info  a simplified sampler specification
-    /// \return the created depth-texture sampler
+    /// \return the depth-texture sampler, which is owned by the application
+    ///         (see `createSampler`)
     vk::Sampler createDepthSampler (SamplerInfo const &info);
 
     /// \brief get the logical device
@@ -154,12 +195,76 @@ public:
         return this->_featuresCache;
     }
 
+    /// \brief does the logical device support indirect draws with more than one
+    ///        draw and non-zero `firstInstance` values?  These device features
+    ///        (`multiDrawIndirect` and `drawIndirectFirstInstance`) are enabled
+    ///        when the physical device supports them.
+    bool hasMultiDrawIndirect () const { return this->_multiDrawIndirect; }
+
+    /// \brief does the logical device support `vkCmdDrawIndexedIndirectCount`?
+    ///        This Vulkan 1.2 feature is enabled when the physical device
+    ///        supports it.
+    bool hasDrawIndirectCount () const { return this->_drawIndirectCount; }
+
+    /// \brief does the logical device support tessellation shaders?  This device
+    ///        feature (`tessellationShader`) is enabled when the physical device
+    ///        supports it.
+    bool hasTessellation () const { return this->_tessellation; }
+
+    /// \brief does the logical device support bindless textures?  The Vulkan 1.2
+    ///        descriptor-indexing features that are needed for bindless
+    ///        texture arrays (runtime-sized arrays, non-uniform indexing of
+    ///        sampled images, partially-bound and update-after-bind descriptors)
+    ///        are enabled when the physical device supports them.
+    bool hasBindless () const { return this->_bindless; }
+
+    /// \brief switch the application to bindless mode by creating its table of
+    ///        bindless textures.
+    /// \param maxTextures  the capacity of the table; it is clamped to the
+    ///                     device's update-after-bind limits on samplers,
+    ///                     sampled images, and per-stage resources
+    /// \return the table, which is owned by the application
+    ///
+    /// It is an error to call this function when the device does not support
+    /// bindless textures (see `hasBindless`).  Once bindless mode is enabled,
+    /// `createPipelineLayout` uses the table's layout for any descriptor set
+    /// that consists of a runtime-sized `sampler2D[]` array at binding 0.
+    BindlessTextures *enableBindless (uint32_t maxTextures = 4096);
+
+    /// \brief the application's table of bindless textures
+    /// \return the table, or nullptr if bindless mode has not been enabled
+    BindlessTextures *bindlessTextures () const { return this->_bindlessTxts; }
+
     /// \brief access function for the properties of an image format
     vk::FormatProperties formatProps (vk::Format fmt) const
     {
         return this->_gpu.getFormatProperties(fmt);
     }
 
+    /// \brief the application's pipeline cache, which is used by the pipeline
+    ///        creation functions.
+    ///
+    /// The cache is loaded from a file in the `cache` subdirectory of the build
+    /// directory when the application starts and is written back when the
+    /// application exits, so that pipelines do not have to be recompiled from
+    /// scratch on every run.  The file is ignored when it was written by a
+    /// different device or driver version.  Code that creates pipelines directly
+    /// should pass this cache to Vulkan.
+    vk::PipelineCache pipelineCache () const { return this->_pipelineCache; }
+
+    /// \brief Load the pre-compiled shaders in a directory into the shader-module
+    ///        cache.
+    /// \param dir  the directory that holds the `.spv` files
+    /// \return the number of shader modules that were loaded
+    ///
+    /// `Shaders` objects that are created from the application (instead of
+    /// from the device) share their modules through a cache that is keyed
+    /// by the file's path and a hash of its contents.  Preloading the cache
+    /// at startup moves the file I/O and module creation out of the window
+    /// and renderer initialization.  The cached modules are destroyed when
+    /// the application exits.
+    uint32_t preloadShaders (std::string const &dir);
+
     /// \brief Create a pipeline layout
     /// \param descSets the descriptor sets for the pipeline
     /// \param pcrs the push-constant ranged for the pipeline
@@ -195,6 +300,28 @@ public:
         return this->_device.createPipelineLayout(layoutInfo);
     }
 
+    /// \brief Get a descriptor-set layout for a list of bindings
+    /// \param bindings  the layout bindings; immutable samplers are not supported
+    /// \return the layout, which is owned by the application and must *not* be
+    ///         destroyed by the caller
+    ///
+    /// Layouts are cached, so requests with the same bindings (in any order)
+    /// return the same layout object.
+    vk::DescriptorSetLayout descriptorSetLayout (
+        std::vector<vk::DescriptorSetLayoutBinding> const &bindings);
+
+    /// \brief Get the descriptor-set layouts for a pipeline interface
+    /// \param iface  the reflected interface of the pipeline's shaders
+    /// \return a vector of `iface.numSets()` layouts, which are owned by the
+    ///         application (see `descriptorSetLayout`)
+    std::vector<vk::DescriptorSetLayout> descriptorSetLayouts (PipelineInterface const &iface);
+
+    /// \brief Create a pipeline layout from the reflected interface of its shaders
+    /// \param iface  the interface of the shaders that use the layout
+    /// \return the created pipeline layout object, which the caller must destroy;
+    ///         the descriptor-set layouts that it uses are owned by the application
+    vk::PipelineLayout createPipelineLayout (PipelineInterface const &iface);
+
     /// \brief Allocate a graphics pipeline
     /// \param shaders     shaders for the pipeline
     /// \param vertexInfo  vertex info
@@ -304,6 +431,106 @@ public:
             dynamic);
     }
 
+    /// \brief Allocate a graphics pipeline with tessellation shaders
+    /// \param shaders     shaders for the pipeline; these must include tessellation
+    ///                    control and evaluation shaders
+    /// \param vertexInfo  vertex info
+    /// \param patchSz     the number of control points per patch
+    /// \param viewports   vector of viewports; ignored if the viewport state is dynamic
+    /// \param scissors    vector of scissor rectangles; ignored if the scissor state is dynamic
+    /// \param polyMode    polygon mode
+    /// \param cullMode    primitive culling mode
+    /// \param front       the winding order that defines the front face of a triangle
+    /// \param layout      the pipeline layout
+    /// \param renderPass  a render pass that is compatible with the render pass to be used
+    /// \param subPass     the index of the subpass in the render pass where the pipeline
+    ///                    will be used
+    /// \param dynamic     vector that specifies which parts of the pipeline can be
+    ///                    dynamically set during the
+    /// \return the created pipeline
+    ///
+    /// The primitive topology of the pipeline is `ePatchList` and the other
+    /// properties are the same as for the `createPipeline` function that uses
+    /// common defaults.  It is an error to call this function when the device
+    /// does not support tessellation (see `hasTessellation`).
+    vk::Pipeline createTessellationPipeline (
+        cs237::Shaders *shaders,
+        vk::PipelineVertexInputStateCreateInfo const &vertexInfo,
+        uint32_t patchSz,
+        vk::ArrayProxy<vk::Viewport> const &viewports,
+        vk::ArrayProxy<vk::Rect2D> const &scissors,
+        vk::PolygonMode polyMode,
+        vk::CullModeFlags cullMode,
+        vk::FrontFace front,
+        vk::PipelineLayout layout,
+        vk::RenderPass renderPass,
+        uint32_t subPass,
+        vk::ArrayProxy<vk::DynamicState> const &dynamic);
+
+    /// \brief A description of a graphics pipeline for batch creation with the
+    ///        `createPipelines` function.  The fields correspond to the arguments
+    ///        of `createPipeline`; the default values describe a filled
+    ///        triangle-list pipeline with a dynamic viewport and scissor
+    ///        rectangle, back-face culling, and counter-clockwise front faces.
+    ///        Set `patchSz` to the number of control points per patch (and
+    ///        `prim` to `ePatchList`) for a pipeline with tessellation shaders.
+    ///        Several variants of the same shaders can be created by giving
+    ///        each description its own specialization constants.
+    struct PipelineDesc {
+        cs237::Shaders *shaders;                        ///< shaders for the pipeline
+        cs237::SpecConstants const *specConsts;         ///< specialization constants
+                                                        ///  for the shaders (or nullptr)
+        vk::PipelineVertexInputStateCreateInfo vertexInfo;
+                                                        ///< vertex info
+        vk::PrimitiveTopology prim;                     ///< primitive topology
+        bool primRestart;                               ///< enable primitive restart?
+        uint32_t patchSz;                               ///< control points per patch
+                                                        ///  (0 for no tessellation)
+        std::vector<vk::Viewport> viewports;            ///< viewports
+        std::vector<vk::Rect2D> scissors;               ///< scissor rectangles
+        bool depthClamp;                                ///< enable depth clamping?
+        vk::PolygonMode polyMode;                       ///< polygon mode
+        vk::CullModeFlags cullMode;                     ///< primitive culling mode
+        vk::FrontFace front;                            ///< front-face winding order
+        vk::PipelineLayout layout;                      ///< the pipeline layout
+        vk::RenderPass renderPass;                      ///< a compatible render pass
+        uint32_t subPass;                               ///< the subpass index
+        std::vector<vk::DynamicState> dynamic;          ///< the dynamic state
+
+        PipelineDesc ()
+          : shaders(nullptr), specConsts(nullptr), vertexInfo{},
+            prim(vk::PrimitiveTopology::eTriangleList), primRestart(false),
+            patchSz(0), viewports(1), scissors(1), depthClamp(false),
+            polyMode(vk::PolygonMode::eFill), cullMode(vk::CullModeFlagBits::eBack),
+            front(vk::FrontFace::eCounterClockwise), layout(), renderPass(),
+            subPass(0), dynamic{vk::DynamicState::eViewport, vk::DynamicState::eScissor}
+        { }
+    };
+
+    /// \brief Allocate a batch of graphics pipelines
+    /// \param descs  the descriptions of the pipelines
+    /// \return the created pipelines, in the same order as `descs`
+    ///
+    /// The pipelines are split into one batch per hardware thread and the
+    /// batches are compiled concurrently (using the application's pipeline
+    /// cache), so creating all of the pipelines that an application needs with
+    /// a single call is faster than creating them one at a time.  The function
+    /// returns when all of the pipelines are ready.  The other properties of
+    /// the pipelines are the same as for `createPipeline`.
+    std::vector<vk::Pipeline> createPipelines (std::vector<PipelineDesc> const &descs);
+
+    /// \brief Allocate a compute pipeline
+    /// \param shaders  the shaders for the pipeline; this should be a single
+    ///                 compute shader
+    /// \param layout   the pipeline layout
+    /// \param consts   optional specialization constants for the shader (e.g.,
+    ///                 the workgroup size)
+    /// \return the created pipeline
+    vk::Pipeline createComputePipeline (
+        cs237::Shaders *shaders,
+        vk::PipelineLayout layout,
+        cs237::SpecConstants const *consts = nullptr);
+
     /// \brief create and initialize a command buffer
     /// \return the fresh command buffer
     vk::CommandBuffer newCommandBuf ()
@@ -372,16 +599,80 @@ protected:
     vk::DebugUtilsMessageSeverityFlagsEXT _messages;
                                 ///< set to the message severity level
     bool _debug;                ///< set when validation layers should be enabled
+    bool _headless;             ///< set when rendering offscreen without GLFW
+    uint32_t _maxFrames;        ///< the number of frames to render (0 for no limit)
+    std::string _benchFile;     ///< the file for frame statistics (empty when
+                                ///  not benchmarking)
+    std::chrono::steady_clock::time_point _startTime;
+                                ///< when the application was created
     vk::Instance _instance;     ///< the Vulkan instance used by the application
     vk::PhysicalDevice _gpu;    ///< the graphics card (aka device) that we are using
     mutable vk::PhysicalDeviceProperties *_propsCache;
     mutable vk::PhysicalDeviceFeatures *_featuresCache;
                                 ///< a cache of the physical device properties
     vk::Device _device;         ///< the logical device that we are using to render
+    bool _multiDrawIndirect;    ///< true if multi-draw indirect is enabled
+    bool _drawIndirectCount;    ///< true if indirect draws with counts are enabled
+    bool _tessellation;         ///< true if tessellation shaders are enabled
+    bool _bindless;             ///< true if descriptor indexing is enabled
+    bool _memoryBudget;         ///< true if the memory-budget extension is enabled
+    BindlessTextures *_bindlessTxts;
+                                ///< the bindless texture table (if enabled)
+    JobSystem *_jobs;           ///< the job system; nullptr until first use
+    std::once_flag _jobsInit;   ///< used to create `_jobs`
+    vk::PipelineCache _pipelineCache;
+                                ///< the cache used for creating pipelines
+    bool _warmCache;            ///< true if the pipeline cache was loaded from a file
+    uint32_t _nPipelines;       ///< the number of pipelines that have been created
+    double _pipelineTime;       ///< the total time spent creating pipelines (in ms)
+    std::map<std::vector<uint32_t>, vk::DescriptorSetLayout> _dsLayouts;
+                                ///< cache of descriptor-set layouts, which is keyed
+                                ///  by the sorted bindings
+    /// a shader module in the shader-module cache, along with the result of
+    /// reflection on its code
+    struct CachedShader {
+        std::string path;                       ///< the file that the module was loaded from
+        vk::ShaderModule module;                ///< the shader module
+        uint32_t refCount;                      ///< the number of `Shaders` that use the module
+        std::vector<ShaderBinding> bindings;    ///< the module's descriptor bindings
+        vk::PushConstantRange pushConsts;       ///< the module's push-constant range
+    };
+    std::map<std::string, CachedShader> _shaderModules;
+                                ///< cache of shader modules keyed by the file path
+                                ///  and a hash of the file's contents
+    uint32_t _shaderHits;       ///< number of shader loads that hit in the cache
+    /// the key for the sampler cache, which is the fields of a `SamplerInfo`
+    /// plus the depth flag
+    using SamplerKey = std::array<uint32_t, 9>;
+    struct SamplerKeyHash {
+        size_t operator() (SamplerKey const &key) const
+        {
+            size_t h = 0;
+            for (auto v : key) {
+                h = (h * 31) ^ v;
+            }
+            return h;
+        }
+    };
+    std::unordered_map<SamplerKey, vk::Sampler, SamplerKeyHash> _samplers;
+                                ///< cache of samplers
     Queues<uint32_t> _qIdxs;    ///< the queue family indices
     Queues<vk::Queue> _queues;  ///< the device queues that we are using
     vk::CommandPool _cmdPool;   ///< pool for allocating command buffers
 
+    /// \brief get a shader module from the cache, loading it if necessary;
+    ///        this increments the module's reference count.
+    /// \param file  the path to the SPIR-V file
+    CachedShader const &_acquireShaderModule (std::string const &file);
+
+    /// \brief release a reference to a cached shader module
+    void _releaseShaderModule (vk::ShaderModule module);
+
+    /// \brief get a sampler from the cache, creating it if necessary
+    /// \param info   the sampler specification
+    /// \param depth  true for depth-texture samplers
+    vk::Sampler _getSampler (SamplerInfo const &info, bool depth);
+
     /// \brief A helper function to create and initialize the Vulkan instance
     /// used by the application.
     void _createInstance ();
@@ -447,6 +738,40 @@ protected:
     /// instance variables.
     void _createLogicalDevice ();
 
+    /// \brief the path of the file that holds the pipeline cache for the application
+    std::string _pipelineCacheFile () const;
+
+    /// \brief A helper function that creates `_pipelineCache` during initialization.
+    ///
+    /// The initial contents of the cache come from the cache file, if it exists
+    /// and matches the device and driver.
+    void _loadPipelineCache ();
+
+    /// \brief A helper function that writes the contents of `_pipelineCache` to
+    ///        the cache file and then destroys the cache.  Failing to write the
+    ///        file is not an error, since the cache is just an optimization.
+    void _savePipelineCache ();
+
+    /// \brief A helper function for creating a single graphics pipeline; the
+    ///        arguments are the same as for `createPipeline`, plus the number of
+    ///        control points per patch, which is zero when there is no tessellation
+    vk::Pipeline _createPipeline (
+        cs237::Shaders *shaders,
+        vk::PipelineVertexInputStateCreateInfo const &vertexInfo,
+        vk::PrimitiveTopology prim,
+        bool primRestart,
+        uint32_t patchSz,
+        vk::ArrayProxy<vk::Viewport> const &viewports,
+        vk::ArrayProxy<vk::Rect2D> const &scissors,
+        bool depthClamp,
+        vk::PolygonMode polyMode,
+        vk::CullModeFlags cullMode,
+        vk::FrontFace front,
+        vk::PipelineLayout layout,
+        vk::RenderPass renderPass,
+        uint32_t subPass,
+        vk::ArrayProxy<vk::DynamicState> const &dynamic);
+
     /// \brief A helper function for creating a Vulkan image that can be used for
     ///        textures or depth buffers
     /// \param wid      the image width
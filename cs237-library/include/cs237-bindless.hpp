@@ -0,0 +1,115 @@
+/*! \file cs237-bindless.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_BINDLESS_HPP_
+#define _CS237_BINDLESS_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237-bindless.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+/// A "bindless" table of textures, which is a single descriptor set that
+/// holds a large array of combined image samplers.  Shaders select a texture
+/// by its index in the table, which can come from push constants or from
+/// per-instance data, so draws that use different textures do not need to
+/// bind different descriptor sets and can be merged into instanced or
+/// indirect draws.  In GLSL, the table is declared as
+///
+///     #extension GL_EXT_nonuniform_qualifier : require
+///     layout (set = N, binding = 0) uniform sampler2D textures[];
+///
+/// and indices that are not uniform across a draw must be wrapped in
+/// `nonuniformEXT`.  The set uses the descriptor-indexing features
+/// (partially bound, update-after-bind), so textures can be added while the
+/// set is bound, as long as the slot being written is not used by a command
+/// buffer that is executing.
+///
+/// The table is created by `Application::enableBindless`.
+//
+class BindlessTextures {
+  public:
+
+    /// the binding of the texture array in the set
+    static constexpr uint32_t kBinding = 0;
+
+    ~BindlessTextures ();
+
+    /// the maximum number of textures in the table
+    uint32_t capacity () const { return this->_capacity; }
+
+    /// the number of textures in the table
+    uint32_t size () const { return this->_highWater - uint32_t(this->_free.size()); }
+
+    /// the number of slots that have been used (i.e., one plus the largest
+    /// index that `add` has returned); removing a texture does not change it
+    uint32_t highWater () const { return this->_highWater; }
+
+    /// does a slot hold a texture?
+    bool isLive (uint32_t idx) const
+    {
+        return (idx < this->_highWater) && this->_live[idx];
+    }
+
+    /// the descriptor-set layout of the table
+    vk::DescriptorSetLayout layout () const { return this->_layout; }
+
+    /// the descriptor set that holds the table
+    vk::DescriptorSet descriptorSet () const { return this->_descSet; }
+
+    /// \brief add a texture to the table
+    /// \param txt      the texture
+    /// \param sampler  the sampler to use for the texture
+    /// \return the texture's index in the table
+    uint32_t add (__detail::TextureBase const *txt, vk::Sampler sampler);
+
+    /// \brief remove a texture from the table; its index may be reused by a
+    ///        later `add`
+    /// \param idx  the texture's index, which must be live (see `isLive`)
+    void remove (uint32_t idx);
+
+    /// \brief record a command to bind the table
+    /// \param cmdBuf     the command buffer
+    /// \param layout     the pipeline layout
+    /// \param set        the set index of the table in the pipeline layout
+    /// \param bindPoint  the pipeline bind point
+    void bindCmd (
+        vk::CommandBuffer cmdBuf,
+        vk::PipelineLayout layout,
+        uint32_t set,
+        vk::PipelineBindPoint bindPoint = vk::PipelineBindPoint::eGraphics) const
+    {
+        cmdBuf.bindDescriptorSets(bindPoint, layout, set, this->_descSet, nullptr);
+    }
+
+  private:
+    friend class Application;
+
+    Application *_app;                  ///< the owning application
+    uint32_t _capacity;                 ///< the size of the texture array
+    uint32_t _highWater;                ///< the number of slots that have been used
+    std::vector<char> _live;            ///< per-slot flags that are true for the
+                                        ///  slots that hold textures
+    std::vector<uint32_t> _free;        ///< indices of removed textures
+    vk::DescriptorSetLayout _layout;    ///< the layout of `_descSet`
+    vk::DescriptorPool _pool;           ///< the pool for `_descSet`
+    vk::DescriptorSet _descSet;         ///< the table
+
+    /// create the table; the application must support bindless textures
+    BindlessTextures (Application *app, uint32_t capacity);
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_BINDLESS_HPP_
@@ -0,0 +1,164 @@
+/*! \file cs237-bounds-array.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * This file implements a structure-of-arrays representation of a collection
+ * of axis-aligned bounding boxes that supports batched (i.e., SIMD) culling.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_BOUNDS_ARRAY_HPP_
+#define _CS237_BOUNDS_ARRAY_HPP_
+
+#ifndef _CS237_HPP_
+#  error "cs237-bounds-array.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+/// A collection of single-precision axis-aligned bounding boxes stored as
+/// six separate arrays of coordinates.  This representation allows the culling
+/// operations to test four (SSE/NEON) or eight (AVX2) boxes per iteration.
+/// Empty boxes are stored with inverted extents, so they are never visible.
+class BoundsArray {
+public:
+
+    /// the number of boxes in a batch; the arrays are padded to a multiple of
+    /// this value so that the culling loops never have to handle a partial batch.
+    static constexpr uint32_t kBatchSz = 8;
+
+    BoundsArray () : _n(0) { }
+
+    /// construct an array of `n` empty boxes
+    explicit BoundsArray (uint32_t n) : _n(0) { this->resize(n); }
+
+    /// the number of boxes in the array
+    uint32_t size () const { return this->_n; }
+
+    /// remove all of the boxes from the array
+    void clear () { this->resize(0); }
+
+    /// reserve space for `n` boxes
+    void reserve (uint32_t n);
+
+    /// resize the array; new boxes are empty
+    void resize (uint32_t n);
+
+    /// add a box to the end of the array
+    /// \return the index of the new box
+    uint32_t push_back (AABBf_t const &bb)
+    {
+        uint32_t i = this->_n;
+        this->resize(i+1);
+        this->set(i, bb);
+        return i;
+    }
+
+    /// set the i'th box
+    void set (uint32_t i, AABBf_t const &bb)
+    {
+        assert (i < this->_n);
+        if (bb.isEmpty()) {
+            this->_setEmpty (i);
+        } else {
+            this->_minX[i] = bb._min.x; this->_maxX[i] = bb._max.x;
+            this->_minY[i] = bb._min.y; this->_maxY[i] = bb._max.y;
+            this->_minZ[i] = bb._min.z; this->_maxZ[i] = bb._max.z;
+        }
+    }
+
+    /// is the i'th box empty?
+    bool isEmpty (uint32_t i) const
+    {
+        assert (i < this->_n);
+        return (this->_maxX[i] < this->_minX[i]);
+    }
+
+    /// get the i'th box
+    AABBf_t get (uint32_t i) const
+    {
+        if (this->isEmpty(i)) {
+            return AABBf_t();
+        } else {
+            return AABBf_t(
+                glm::vec3(this->_minX[i], this->_minY[i], this->_minZ[i]),
+                glm::vec3(this->_maxX[i], this->_maxY[i], this->_maxZ[i]));
+        }
+    }
+
+    /// \brief test a range of boxes against a view frustum
+    /// \param f        the view frustum
+    /// \param first    the index of the first box to test; must be a multiple of `kBatchSz`
+    /// \param n        the number of boxes to test
+    /// \param visible  output array of the indices of boxes that may be visible;
+    ///                 it must have room for at least `n` indices.
+    /// \return the number of indices written to `visible`
+    ///
+    /// The test is conservative in the same way as `Frustum::intersectsBox`.
+    uint32_t cullBoxes (
+        Frustumf_t const &f, uint32_t first, uint32_t n,
+        uint32_t *visible) const;
+
+    /// \brief test the bounding spheres of a range of boxes against a view frustum
+    /// \param f        the view frustum
+    /// \param first    the index of the first box to test; must be a multiple of `kBatchSz`
+    /// \param n        the number of boxes to test
+    /// \param visible  output array of the indices of boxes that may be visible;
+    ///                 it must have room for at least `n` indices.
+    /// \return the number of indices written to `visible`
+    ///
+    /// This test uses the sphere that circumscribes each box, which is cheaper
+    /// than the box test, but less precise.
+    uint32_t cullSpheres (
+        Frustumf_t const &f, uint32_t first, uint32_t n,
+        uint32_t *visible) const;
+
+    /// \brief test all of the boxes against a view frustum
+    /// \param f        the view frustum
+    /// \param visible  set to the indices of the boxes that may be visible
+    void cullBoxes (Frustumf_t const &f, std::vector<uint32_t> &visible) const
+    {
+        visible.resize(this->_n);
+        visible.resize(this->cullBoxes(f, 0, this->_n, visible.data()));
+    }
+
+    /// \brief test the bounding spheres of all of the boxes against a view frustum
+    /// \param f        the view frustum
+    /// \param visible  set to the indices of the boxes that may be visible
+    void cullSpheres (Frustumf_t const &f, std::vector<uint32_t> &visible) const
+    {
+        visible.resize(this->_n);
+        visible.resize(this->cullSpheres(f, 0, this->_n, visible.data()));
+    }
+
+private:
+    uint32_t _n;                ///< the number of boxes
+    std::vector<float> _minX;   ///< minimum X coordinates
+    std::vector<float> _minY;   ///< minimum Y coordinates
+    std::vector<float> _minZ;   ///< minimum Z coordinates
+    std::vector<float> _maxX;   ///< maximum X coordinates
+    std::vector<float> _maxY;   ///< maximum Y coordinates
+    std::vector<float> _maxZ;   ///< maximum Z coordinates
+
+    /// the coordinate magnitude used to represent empty boxes; we do not use
+    /// the largest float, since the extent computation would overflow to infinity
+    static constexpr float kEmpty = 1.0e30f;
+
+    /// mark the i'th box as empty
+    void _setEmpty (uint32_t i)
+    {
+        this->_minX[i] = this->_minY[i] = this->_minZ[i] = kEmpty;
+        this->_maxX[i] = this->_maxY[i] = this->_maxZ[i] = -kEmpty;
+    }
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_BOUNDS_ARRAY_HPP_
@@ -84,6 +84,16 @@ protected:
     /// \param src  address of data to copy
     void _copyTo (const void *src) { this->_mem->copyTo(src); }
 
+    /// copy data from a subrange of the device memory object
+    /// \param dst     address to copy the data to
+    /// \param offset  offset (in bytes) from the beginning of the buffer
+    ///                to copy the data from
+    /// \param sz      size in bytes of the data to copy
+    void _copyFrom (void *dst, size_t offset, size_t sz)
+    {
+        this->_mem->copyFrom(dst, offset, sz);
+    }
+
 };
 
 /// Buffer class for vertex data; the type parameter `V` is the type of an
@@ -221,6 +231,224 @@ public:
 
 };
 
+/// A persistently-mapped uniform buffer that is used as a per-frame linear
+/// allocator for uniform data, which is accessed by descriptors of type
+/// `eUniformBufferDynamic`.  The buffer is divided into one region per frame
+/// in flight; at the beginning of a frame, `beginFrame` resets the frame's
+/// region and then each `push` copies a block of uniform data into the region
+/// and returns its dynamic offset.  Since the offsets are relative to the start
+/// of the buffer, a single descriptor set (with a range equal to the size of
+/// the largest block that the shaders read) serves all of the frames, and
+/// per-object data of any size up to the range can be supplied at bind time with
+///
+///     cmdBuf.bindDescriptorSets(..., descSet, offset);
+///
+/// The caller must make sure that the GPU has finished with a frame's data
+/// before calling `beginFrame` for that frame again.
+class UniformRing : public Buffer {
+public:
+
+    /// constructor
+    /// \param app      the owning application object
+    /// \param nFrames  the number of frames in flight
+    /// \param frameSz  the number of bytes of uniform data per frame
+    /// \param range    the range of the descriptor (i.e., the size of the
+    ///                 largest block that the shaders read at an offset)
+    UniformRing (Application *app, uint32_t nFrames, size_t frameSz, size_t range)
+      : Buffer (app,
+            vk::BufferUsageFlagBits::eUniformBuffer,
+            nFrames * _alignUp(frameSz, app->limits()->minUniformBufferOffsetAlignment)),
+        _align(app->limits()->minUniformBufferOffsetAlignment),
+        _frameSz(_alignUp(frameSz, app->limits()->minUniformBufferOffsetAlignment)),
+        _range(range), _nFrames(nFrames), _base(0), _top(0)
+    {
+        if (this->_range > this->_frameSz) {
+            ERROR("uniform ring range is larger than the frame size");
+        }
+        this->_ptr = static_cast<char *>(this->_mem->map());
+    }
+
+    /// destructor
+    ~UniformRing () { this->_mem->unmap(); }
+
+    /// \brief the number of bytes per frame that are needed to push a number of
+    ///        blocks, including the padding for the alignment of dynamic offsets
+    /// \param app      the owning application object
+    /// \param nBlocks  the number of blocks that are pushed per frame
+    /// \param range    the range of the descriptor
+    static size_t frameBytes (Application *app, uint32_t nBlocks, size_t range)
+    {
+        return nBlocks * _alignUp(range, app->limits()->minUniformBufferOffsetAlignment);
+    }
+
+    /// the alignment of the dynamic offsets
+    size_t alignment () const { return this->_align; }
+
+    /// the number of bytes that have been allocated in the current frame
+    size_t used () const { return this->_top - this->_base; }
+
+    /// the capacity (in bytes) of a frame's region
+    size_t frameSize () const { return this->_frameSz; }
+
+    /// \brief start allocating data for a frame; this releases the frame's
+    ///        previous contents
+    /// \param frame  the frame index (must be less than the number of frames)
+    void beginFrame (uint32_t frame)
+    {
+        assert (frame < this->_nFrames);
+        this->_base = frame * this->_frameSz;
+        this->_top = this->_base;
+    }
+
+    /// \brief copy a block of uniform data into the current frame's region
+    /// \param src  address of the data
+    /// \param sz   the size of the data in bytes
+    /// \return the dynamic offset of the data
+    uint32_t push (const void *src, size_t sz)
+    {
+        if (sz > this->_range) {
+            ERROR("uniform block is larger than the uniform ring's range");
+        }
+        // the descriptor covers `_range` bytes from the offset, which must
+        // lie within the frame's region
+        if (this->_top + this->_range > this->_base + this->_frameSz) {
+            ERROR("uniform ring is full");
+        }
+        uint32_t offset = this->_top;
+        std::memcpy (this->_ptr + offset, src, sz);
+        this->_top = _alignUp(this->_top + sz, this->_align);
+        return offset;
+    }
+
+    /// \brief copy a value into the current frame's region
+    /// \param data  the value, whose layout must agree with the `std140` layout
+    ///              of the uniform block in the shaders
+    /// \return the dynamic offset of the data
+    template <typename UB>
+    uint32_t push (UB const &data) { return this->push (&data, sizeof(UB)); }
+
+    /// get the buffer-descriptor info for a dynamic uniform buffer
+    vk::DescriptorBufferInfo descInfo () const
+    {
+        return vk::DescriptorBufferInfo(this->_buf, 0, this->_range);
+    }
+
+private:
+    size_t _align;              ///< the alignment of dynamic offsets
+    size_t _frameSz;            ///< the size of a frame's region
+    size_t _range;              ///< the range of the descriptor
+    uint32_t _nFrames;          ///< the number of frames
+    size_t _base;               ///< the start of the current frame's region
+    size_t _top;                ///< the next free byte in the current frame
+    char *_ptr;                 ///< the mapped buffer
+
+    static size_t _alignUp (size_t n, size_t align)
+    {
+        return (n + align - 1) & ~(align - 1);
+    }
+
+};
+
+/// Buffer class for shader-storage data (SSBOs); the type parameter `T` is
+/// the type of the buffer's elements.  The C++ layout of `T` must agree with
+/// the `std430` layout of the buffer in the shaders.
+template <typename T>
+class StorageBuffer : public Buffer {
+public:
+
+    /// the type of the buffer's elements
+    using ElemType = T;
+
+    /// constructor
+    /// \param app     the owning application object
+    /// \param nElems  the number of elements in the buffer
+    /// \param usage   additional usage flags for the buffer (e.g., `eIndirectBuffer`)
+    StorageBuffer (Application *app, uint32_t nElems, vk::BufferUsageFlags usage = {})
+      : Buffer (app,
+            vk::BufferUsageFlagBits::eStorageBuffer
+            | vk::BufferUsageFlagBits::eTransferDst
+            | usage,
+            nElems*sizeof(T)),
+        _nElems(nElems)
+    { }
+
+    /// constructor with initialization
+    /// \param app    the owning application object
+    /// \param src    the array of elements used to initialize the buffer
+    /// \param usage  additional usage flags for the buffer
+    StorageBuffer (
+        Application *app,
+        vk::ArrayProxy<T> const &src,
+        vk::BufferUsageFlags usage = {})
+      : StorageBuffer(app, src.size(), usage)
+    {
+        this->copyTo(src);
+    }
+
+    /// get the number of elements in the buffer
+    uint32_t nElems () const { return this->_nElems; }
+
+    /// copy elements to the device memory object
+    /// \param src  proxy array of elements
+    void copyTo (vk::ArrayProxy<T> const &src)
+    {
+        assert ((src.size() <= this->_nElems) && "src is too large");
+        this->_copyTo(src.data(), 0, src.size()*sizeof(T));
+    }
+
+    /// copy elements to the device memory object
+    /// \param src     proxy array of elements
+    /// \param offset  index of the first element to copy the data to
+    void copyTo (vk::ArrayProxy<T> const &src, uint32_t offset)
+    {
+        assert ((src.size()+offset <= this->_nElems) && "src is too large");
+        this->_copyTo(src.data(), offset*sizeof(T), src.size()*sizeof(T));
+    }
+
+    /// copy elements from the device memory object
+    /// \param dst     the array to copy the elements to
+    /// \param offset  index of the first element to copy
+    /// \param n       the number of elements to copy
+    ///
+    /// The caller is responsible for making sure that any GPU writes to
+    /// the buffer have completed (e.g., by waiting on a fence).
+    void copyFrom (T *dst, uint32_t offset, uint32_t n)
+    {
+        assert ((offset+n <= this->_nElems) && "range is too large");
+        this->_copyFrom(dst, offset*sizeof(T), n*sizeof(T));
+    }
+
+    /// get the default buffer-descriptor info for this buffer
+    vk::DescriptorBufferInfo descInfo ()
+    {
+        return vk::DescriptorBufferInfo(this->_buf, 0, this->_nElems*sizeof(T));
+    }
+
+private:
+    uint32_t _nElems;
+
+};
+
+/// Buffer class for indirect-draw arguments; the type parameter `T` is the type
+/// of the buffer's elements, which is typically `vk::DrawIndexedIndirectCommand`
+/// (for the draw commands) or `uint32_t` (for draw counts).  Indirect buffers are
+/// also storage buffers, so that they can be filled by a compute shader.
+template <typename T>
+class IndirectBuffer : public StorageBuffer<T> {
+public:
+
+    /// constructor
+    /// \param app     the owning application object
+    /// \param nElems  the number of elements in the buffer
+    IndirectBuffer (Application *app, uint32_t nElems)
+      : StorageBuffer<T> (app, nElems, vk::BufferUsageFlagBits::eIndirectBuffer)
+    { }
+
+    /// the stride (in bytes) between elements in the buffer
+    static constexpr uint32_t stride () { return sizeof(T); }
+
+};
+
 } // namespace cs237
 
 #endif // !_CS237_BUFFER_HPP_
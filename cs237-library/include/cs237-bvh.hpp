@@ -0,0 +1,131 @@
+/*! \file cs237-bvh.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * This file implements a bounding-volume hierarchy (BVH) over a collection
+ * of axis-aligned bounding boxes (e.g., the world-space bounds of the objects
+ * in a scene).  The BVH supports view-frustum culling, ray queries (for picking),
+ * and box-overlap queries.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_BVH_HPP_
+#define _CS237_BVH_HPP_
+
+#ifndef _CS237_HPP_
+#  error "cs237-bvh.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+/// A bounding-volume hierarchy over a collection of "primitives", each of
+/// which is represented by its axis-aligned bounding box.  Primitives are
+/// identified by their index in the vector of boxes that was used to build
+/// the hierarchy.
+///
+/// The hierarchy is built using the surface-area heuristic (SAH) with binning.
+/// When primitives move, the `refit` method can be used to update the bounds
+/// of the nodes without changing the structure of the tree; this operation is
+/// much cheaper than rebuilding, but the quality of the tree will degrade
+/// if the primitives move a lot.
+class BVH {
+public:
+
+    /// the maximum number of primitives in a leaf.  The primitive boxes
+    /// for a leaf are stored in an aligned batch of a `BoundsArray`, so that
+    /// leaves can be culled using the batched kernels.
+    static constexpr uint32_t kMaxLeafSz = BoundsArray::kBatchSz;
+
+    BVH () : _nPrims(0) { }
+
+    /// \brief build the hierarchy
+    /// \param boxes  the bounding boxes of the primitives; empty boxes are allowed,
+    ///               but such primitives are never reported by queries.
+    void build (std::vector<AABBf_t> const &boxes);
+
+    /// \brief update the bounds of the hierarchy after the primitives have moved
+    /// \param boxes  the new bounding boxes of the primitives; this vector must
+    ///               have the same size as the one that was used to build the tree
+    void refit (std::vector<AABBf_t> const &boxes);
+
+    /// remove all of the primitives from the hierarchy
+    void clear ();
+
+    /// the number of primitives in the hierarchy
+    uint32_t size () const { return this->_nPrims; }
+
+    /// the number of nodes in the hierarchy
+    uint32_t nNodes () const { return this->_nodes.size(); }
+
+    /// the bounding box of all of the primitives
+    AABBf_t bounds () const
+    {
+        return this->_nodes.empty() ? AABBf_t() : this->_nodes[0].bbox;
+    }
+
+    /// \brief determine which primitives are (potentially) visible in a view frustum
+    /// \param f        the view frustum
+    /// \param visible  set to the IDs of the primitives whose boxes intersect the
+    ///                 frustum.  The test is conservative in the same way as
+    ///                 `Frustum::intersectsBox`.
+    void cullFrustum (Frustumf_t const &f, std::vector<uint32_t> &visible) const;
+
+    /// \brief find the primitives whose boxes are hit by a ray
+    /// \param orig  the origin of the ray
+    /// \param dir   the direction of the ray (does not have to be unit length)
+    /// \param tMax  the maximum ray parameter to consider
+    /// \param hits  set to the IDs of the primitives whose boxes are hit by the
+    ///              ray in the interval [0..tMax]
+    void rayQuery (
+        glm::vec3 const &orig, glm::vec3 const &dir, float tMax,
+        std::vector<uint32_t> &hits) const;
+
+    /// \brief find the primitive whose box is closest along a ray
+    /// \param orig  the origin of the ray
+    /// \param dir   the direction of the ray (does not have to be unit length)
+    /// \param t     set to the ray parameter of the hit (if there is one)
+    /// \return the ID of the primitive or -1 if the ray does not hit anything
+    int32_t closestHit (glm::vec3 const &orig, glm::vec3 const &dir, float &t) const;
+
+    /// \brief find the primitives whose boxes overlap a box
+    /// \param bb    the query box
+    /// \param hits  set to the IDs of the primitives whose boxes overlap `bb`
+    void overlapQuery (AABBf_t const &bb, std::vector<uint32_t> &hits) const;
+
+private:
+    /// BVH nodes; the children of an interior node are stored in adjacent
+    /// slots and always follow their parent in the `_nodes` vector.
+    struct Node {
+        AABBf_t bbox;           ///< the bounds of the node
+        uint32_t first;         ///< index of the left child (interior nodes) or
+                                ///  first slot in `_primBounds` (leaf nodes)
+        uint32_t count;         ///< number of primitives (0 for interior nodes)
+
+        bool isLeaf () const { return this->count > 0; }
+    };
+
+    uint32_t _nPrims;                   ///< the number of primitives
+    std::vector<Node> _nodes;           ///< the nodes; `_nodes[0]` is the root
+    BoundsArray _primBounds;            ///< primitive bounds in leaf order, where each
+                                        ///  leaf starts on a batch boundary
+    std::vector<uint32_t> _primIds;     ///< maps slots in `_primBounds` to primitive IDs
+
+    /// initialize a leaf node for the `n` primitives in `ids`
+    void _makeLeaf (
+        Node &node, std::vector<AABBf_t> const &boxes,
+        uint32_t const *ids, uint32_t n);
+
+    /// add all of the primitives in a subtree to a vector
+    void _addAll (uint32_t nd, std::vector<uint32_t> &ids) const;
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_BVH_HPP_
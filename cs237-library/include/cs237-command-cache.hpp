@@ -0,0 +1,81 @@
+/*! \file cs237-command-cache.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_COMMAND_CACHE_HPP_
+#define _CS237_COMMAND_CACHE_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237-command-cache.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+/// A cache of pre-recorded command buffers, one per swap-chain image.  Most
+/// frames draw the same things as the previous frame with the same image;
+/// when only the contents of uniform buffers change (e.g., the camera moved),
+/// the previously recorded commands can be resubmitted as is.  The cache
+/// has a version number that the window bumps (by calling `invalidate`)
+/// whenever something that is baked into the commands changes, such as the
+/// set of objects being drawn, the render mode, push-constant values, or the
+/// swap chain (which invalidates the framebuffers).  A buffer is re-recorded
+/// the next time that its image is drawn after the version changes.
+///
+/// Note that resubmitting a buffer requires that its previous submission has
+/// completed, which is the case when the window waits on its in-flight fence
+/// before drawing.
+//
+class CommandCache {
+  public:
+
+    /// \brief create an empty cache
+    /// \param app  the owning application
+    explicit CommandCache (Application *app);
+
+    ~CommandCache ();
+
+    /// mark all of the recorded buffers as out of date
+    void invalidate () { this->_version++; }
+
+    /// \brief get the command buffer for a swap-chain image
+    /// \param imageIdx  the index of the swap-chain image
+    /// \param[out] record  set to true if the buffer must be recorded, in which
+    ///                     case it has been reset and the caller must record
+    ///                     the commands for the image into it; set to false if
+    ///                     the buffer holds up-to-date commands that can be
+    ///                     resubmitted
+    /// \return the command buffer
+    vk::CommandBuffer acquire (uint32_t imageIdx, bool &record);
+
+    /// the number of times that a buffer was recorded
+    uint64_t nRecorded () const { return this->_nRecorded; }
+
+    /// the number of times that a recorded buffer was reused
+    uint64_t nReused () const { return this->_nReused; }
+
+  private:
+    /// a command buffer with the version of its commands
+    struct Entry {
+        vk::CommandBuffer cmdBuf;
+        uint64_t version;               ///< 0 means that the buffer has not been recorded
+    };
+
+    Application *_app;                  ///< the owning application
+    uint64_t _version;                  ///< the current version; starts at 1
+    std::vector<Entry> _entries;        ///< the buffers indexed by swap-chain image
+    uint64_t _nRecorded;
+    uint64_t _nReused;
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_COMMAND_CACHE_HPP_
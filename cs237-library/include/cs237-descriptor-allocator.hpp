@@ -0,0 +1,173 @@
+/*! \file cs237-descriptor-allocator.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_DESCRIPTOR_ALLOCATOR_HPP_
+#define _CS237_DESCRIPTOR_ALLOCATOR_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237-descriptor-allocator.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+/// A resource that is bound to a descriptor; used to describe the contents of
+/// the descriptor sets that are returned by `DescriptorAllocator::cached`.
+struct DescriptorResource {
+    uint32_t binding;                   ///< the binding index in the set
+    vk::DescriptorType type;            ///< the descriptor type
+    vk::DescriptorBufferInfo buffer;    ///< the buffer for buffer descriptors
+    vk::DescriptorImageInfo image;      ///< the image/sampler for image descriptors
+
+    /// \brief a uniform or storage buffer
+    /// \param binding  the binding index
+    /// \param type     either `eUniformBuffer` or `eStorageBuffer`
+    /// \param info     the buffer range
+    static DescriptorResource bufferResource (
+        uint32_t binding,
+        vk::DescriptorType type,
+        vk::DescriptorBufferInfo const &info)
+    {
+        return DescriptorResource{binding, type, info, vk::DescriptorImageInfo()};
+    }
+
+    /// \brief an image, sampler, or combined image sampler
+    /// \param binding  the binding index
+    /// \param type     the descriptor type
+    /// \param info     the image view, sampler, and layout
+    static DescriptorResource imageResource (
+        uint32_t binding,
+        vk::DescriptorType type,
+        vk::DescriptorImageInfo const &info)
+    {
+        return DescriptorResource{binding, type, vk::DescriptorBufferInfo(), info};
+    }
+
+};
+
+/// A growable allocator for descriptor sets, which replaces descriptor pools
+/// that are sized up front.  Each layout that is used with the allocator must
+/// be registered (see `layout` and `addLayout`), which lets the allocator size
+/// its pools exactly for the layout.  When a pool is full, a new pool that is
+/// twice as large is added to the layout's list of pools.
+///
+/// There are three kinds of allocation:
+///   - persistent sets, which live as long as the allocator;
+///   - transient sets, which are allocated for a frame and are released in
+///     bulk by `resetFrame`, which resets the frame's pools (instead of
+///     freeing individual sets);
+///   - cached sets, which are persistent sets that are shared by all
+///     requests for the same layout and resources.  This avoids allocating a
+///     new set for every mesh that uses the same texture and sampler.
+///
+/// The allocator is not thread safe.
+//
+class DescriptorAllocator {
+  public:
+
+    /// allocation statistics
+    struct Stats {
+        uint32_t nPools;                ///< the number of pools that have been created
+        uint32_t nSets;                 ///< the number of persistent sets allocated
+        uint32_t nTransientSets;        ///< the number of transient sets allocated
+        uint32_t nCacheHits;            ///< the number of `cached` requests that reused a set
+        uint32_t nCacheMisses;          ///< the number of `cached` requests that allocated a set
+        uint32_t nResets;               ///< the number of frame resets
+    };
+
+    /// \brief create a descriptor allocator
+    /// \param app          the owning application
+    /// \param nFrames      the number of frames in flight (i.e., the number of
+    ///                     independent groups of transient sets)
+    /// \param initialSets  the number of sets in the first pool for a layout
+    DescriptorAllocator (Application *app, uint32_t nFrames = 1, uint32_t initialSets = 16);
+
+    /// destructor; this destroys the pools and so frees all of the allocated sets
+    ~DescriptorAllocator ();
+
+    /// \brief get a descriptor-set layout and register it with the allocator
+    /// \param bindings  the layout bindings
+    /// \return the layout, which is owned by the application (see
+    ///         `Application::descriptorSetLayout`)
+    vk::DescriptorSetLayout layout (std::vector<vk::DescriptorSetLayoutBinding> const &bindings);
+
+    /// \brief register a layout that was created by the caller
+    /// \param layout    the layout
+    /// \param bindings  the bindings that the layout was created with
+    void addLayout (
+        vk::DescriptorSetLayout layout,
+        std::vector<vk::DescriptorSetLayoutBinding> const &bindings);
+
+    /// \brief allocate a persistent descriptor set
+    /// \param layout  the layout of the set; it must be registered
+    /// \return the set
+    vk::DescriptorSet allocate (vk::DescriptorSetLayout layout);
+
+    /// \brief allocate a transient descriptor set for a frame
+    /// \param frame   the frame index (must be less than `nFrames`)
+    /// \param layout  the layout of the set; it must be registered
+    /// \return the set, which is valid until the next `resetFrame(frame)`
+    vk::DescriptorSet allocateTransient (uint32_t frame, vk::DescriptorSetLayout layout);
+
+    /// \brief release all of the transient sets for a frame
+    /// \param frame  the frame index
+    ///
+    /// The caller must ensure that the GPU has finished using the sets (e.g.,
+    /// by waiting on the frame's fence).
+    void resetFrame (uint32_t frame);
+
+    /// \brief get a descriptor set that is bound to the given resources
+    /// \param layout     the layout of the set; it must be registered
+    /// \param resources  the resources bound by the set
+    /// \return a persistent set with the resources written into it; requests
+    ///         with the same layout and resources return the same set
+    vk::DescriptorSet cached (
+        vk::DescriptorSetLayout layout,
+        std::vector<DescriptorResource> const &resources);
+
+    /// get the allocation statistics
+    Stats const &stats () const { return this->_stats; }
+
+  private:
+    /// a growable list of pools for a layout
+    struct PoolList {
+        std::vector<vk::DescriptorPool> pools;  ///< the pools; earlier pools are full
+        uint32_t cur;                           ///< index of the pool to allocate from
+        uint32_t nextSz;                        ///< the number of sets in the next pool
+    };
+
+    /// the allocation state for a registered layout
+    struct LayoutInfo {
+        std::vector<vk::DescriptorPoolSize> setSizes;   ///< descriptor counts for one set
+        PoolList persistent;                            ///< pools for persistent sets
+        std::vector<PoolList> frames;                   ///< per-frame pools for transient sets
+    };
+
+    Application *_app;                  ///< the owning application
+    uint32_t _nFrames;                  ///< the number of frames in flight
+    uint32_t _initialSets;              ///< the size of the first pool of a list
+    std::map<VkDescriptorSetLayout, LayoutInfo> _layouts;
+                                        ///< the registered layouts
+    std::map<std::vector<uint64_t>, vk::DescriptorSet> _cache;
+                                        ///< cached sets keyed by layout and resources
+    Stats _stats;                       ///< allocation statistics
+
+    /// get the information for a registered layout
+    LayoutInfo &_info (vk::DescriptorSetLayout layout);
+
+    /// allocate a set from a list of pools, growing it as necessary
+    vk::DescriptorSet _allocate (LayoutInfo const &info, PoolList &pools, vk::DescriptorSetLayout layout);
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_DESCRIPTOR_ALLOCATOR_HPP_
@@ -0,0 +1,124 @@
+/*! \file cs237-frame-stats.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * Support for benchmarking applications.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_FRAME_STATS_HPP_
+#define _CS237_FRAME_STATS_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237-frame-stats.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+/// Frame statistics for benchmarking.  When an application is run with the
+/// `-bench` option, each window collects the following for every frame:
+///
+///   - the CPU time from acquiring the frame's image to submitting its
+///     commands (i.e., the time to update and record the frame);
+///
+///   - the GPU time of the frame's commands, which is measured with
+///     timestamp queries (when the graphics queue supports them); and
+///
+///   - the wall-clock time between presenting successive frames.
+///
+/// When the window is destroyed, the statistics are written as a JSON object,
+/// along with the time from starting the application to beginning the first
+/// frame (i.e., the load time) and the memory usage.  The window's
+/// synchronization objects (`Window::SyncObjs`) call the methods of this
+/// class, so applications do not need to.
+//
+class FrameStats {
+  public:
+
+    /// \brief create the statistics for a window
+    /// \param app  the owning application
+    explicit FrameStats (Application *app);
+
+    ~FrameStats ();
+
+    /// \brief allocate the timestamp queries for a frame's synchronization objects
+    /// \return the slot for the frame
+    uint32_t newSlot ();
+
+    /// \brief note the start of a frame; the slot's previous commands must be
+    ///        finished (i.e., the caller has waited on the frame's fence)
+    /// \param slot  the frame's slot
+    void beginFrame (uint32_t slot);
+
+    /// \brief note the submission of a frame's commands
+    /// \param slot          the frame's slot
+    /// \param cmdBuf        the frame's command buffer
+    /// \param[out] cmdBufs  the command buffers to submit, which bracket
+    ///                      `cmdBuf` with timestamp queries
+    void submit (
+        uint32_t slot,
+        vk::CommandBuffer cmdBuf,
+        std::vector<vk::CommandBuffer> &cmdBufs);
+
+    /// note that a frame has been presented
+    void endFrame ();
+
+    /// \brief write the statistics as a JSON object; this waits for the
+    ///        device to be idle, so that the last frames are included
+    /// \param file  the output file; "-" means the standard output
+    void report (std::string const &file);
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    /// the timestamp state for a frame
+    struct Slot {
+        vk::CommandBuffer begin;        ///< resets the queries and writes the
+                                        ///  start timestamp
+        vk::CommandBuffer end;          ///< writes the end timestamp
+        bool pending;                   ///< true when there are unread timestamps
+    };
+
+    Application *_app;                  ///< the owning application
+    vk::QueryPool _queryPool;           ///< two timestamps per slot; nullptr if
+                                        ///  timestamps are not supported
+    double _tsPeriod;                   ///< nanoseconds per timestamp tick
+    uint64_t _tsMask;                   ///< mask for the valid timestamp bits
+    std::vector<Slot> _slots;           ///< the frame slots
+    bool _started;                      ///< has the first frame begun?
+    double _loadTime;                   ///< time to the first frame (ms)
+    Clock::time_point _cpuStart;        ///< the start of the current frame
+    Clock::time_point _lastPresent;     ///< when the previous frame was presented
+    std::vector<double> _cpuTimes;      ///< per-frame CPU times (ms)
+    std::vector<double> _gpuTimes;      ///< per-frame GPU times (ms)
+    std::vector<double> _frameTimes;    ///< times between frames (ms)
+
+    /// read a slot's timestamps (if any) and record the GPU time
+    void _readTimestamps (uint32_t slot);
+
+};
+
+/// \brief the scripted camera path for benchmarks; the camera orbits its
+///        look-at point once (while moving in and out) over the path
+/// \param pos      the initial camera position, which is where the path starts
+/// \param at       the look-at point
+/// \param up       the up vector, which is the axis of the orbit
+/// \param frame    the frame number
+/// \param nFrames  the length of the path in frames; 0 means 360 frames
+/// \return the camera position for the frame
+glm::vec3 benchCameraPos (
+    glm::vec3 pos,
+    glm::vec3 at,
+    glm::vec3 up,
+    uint32_t frame,
+    uint32_t nFrames);
+
+} // namespace cs237
+
+#endif // !_CS237_FRAME_STATS_HPP_
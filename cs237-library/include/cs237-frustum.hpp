@@ -0,0 +1,151 @@
+/*! \file cs237-frustum.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * This file implements view frusta for visibility culling.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_FRUSTUM_HPP_
+#define _CS237_FRUSTUM_HPP_
+
+#ifndef _CS237_HPP_
+#  error "cs237-frustum.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+/// the result of classifying a bounding volume against a frustum
+enum class Containment {
+    eOutside,           ///< the volume is completely outside the frustum
+    eIntersects,        ///< the volume straddles at least one of the frustum's planes
+    eInside             ///< the volume is completely inside the frustum
+};
+
+namespace __detail {
+
+/// A view frustum represented as six inward-facing planes.
+template <typename T>
+struct Frustum {
+    using vec3 = glm::vec<3, T, glm::defaultp>;
+    using vec4 = glm::vec<4, T, glm::defaultp>;
+    using mat4 = glm::mat<4, 4, T, glm::defaultp>;
+
+    /// the indices of the planes
+    enum {
+        kLeft = 0, kRight, kBottom, kTop, kNear, kFar,
+        kNumPlanes
+    };
+
+    Plane<T> _planes[kNumPlanes];       ///< the planes; normals point into the frustum
+
+    Frustum () { }
+
+    /// \brief extract the frustum from a view-projection matrix
+    /// \param m  the matrix that maps world space to clip space (i.e., `P * V`)
+    ///
+    /// Points inside the frustum have non-negative signed distance to all of
+    /// the planes.  We assume Vulkan's clip-space convention, where the
+    /// depth range is [0..1] (i.e., `GLM_FORCE_DEPTH_ZERO_TO_ONE`).
+    explicit Frustum (mat4 const &m)
+    {
+        // the rows of the matrix (GLM matrices are column major)
+        vec4 r0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        vec4 r1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        vec4 r2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        vec4 r3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        this->_planes[kLeft] = Plane<T>(r3 + r0);
+        this->_planes[kRight] = Plane<T>(r3 - r0);
+        this->_planes[kBottom] = Plane<T>(r3 + r1);
+        this->_planes[kTop] = Plane<T>(r3 - r1);
+        this->_planes[kNear] = Plane<T>(r2);
+        this->_planes[kFar] = Plane<T>(r3 - r2);
+    }
+
+    /// get the i'th plane of the frustum
+    Plane<T> const &plane (int i) const
+    {
+        assert ((0 <= i) && (i < kNumPlanes));
+        return this->_planes[i];
+    }
+
+    /// is a point inside the frustum?
+    bool includesPt (vec3 const &pt) const
+    {
+        for (int i = 0;  i < kNumPlanes;  ++i) {
+            if (this->_planes[i].distanceToPt(pt) < T(0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief a conservative test for whether a box intersects the frustum.
+    /// \param bb  the box to test
+    /// \return false if the box is definitely outside the frustum and true otherwise
+    ///
+    /// This test only rejects boxes that are completely on the outside of one
+    /// of the planes, so some boxes near the corners of the frustum will be
+    /// reported as intersecting when they are not.  Empty boxes are never visible.
+    bool intersectsBox (AABB<T> const &bb) const
+    {
+        if (bb.isEmpty()) {
+            return false;
+        }
+        vec3 c = T(0.5) * (bb._max + bb._min);
+        vec3 e = T(0.5) * (bb._max - bb._min);
+        for (int i = 0;  i < kNumPlanes;  ++i) {
+            // the projected "radius" of the box onto the plane's normal
+            vec4 const &nd = this->_planes[i]._nd;
+            T r = e.x * std::abs(nd.x) + e.y * std::abs(nd.y) + e.z * std::abs(nd.z);
+            if (nd.x * c.x + nd.y * c.y + nd.z * c.z + nd.w + r < T(0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief classify a box with respect to the frustum.
+    /// \param bb  the box to test
+    /// \return `eOutside` if the box is definitely outside the frustum, `eInside`
+    ///         if it is completely inside, and `eIntersects` otherwise.
+    Containment classifyBox (AABB<T> const &bb) const
+    {
+        if (bb.isEmpty()) {
+            return Containment::eOutside;
+        }
+        vec3 c = T(0.5) * (bb._max + bb._min);
+        vec3 e = T(0.5) * (bb._max - bb._min);
+        Containment res = Containment::eInside;
+        for (int i = 0;  i < kNumPlanes;  ++i) {
+            vec4 const &nd = this->_planes[i]._nd;
+            T r = e.x * std::abs(nd.x) + e.y * std::abs(nd.y) + e.z * std::abs(nd.z);
+            T s = nd.x * c.x + nd.y * c.y + nd.z * c.z + nd.w;
+            if (s + r < T(0)) {
+                return Containment::eOutside;
+            } else if (s - r < T(0)) {
+                res = Containment::eIntersects;
+            }
+        }
+        return res;
+    }
+
+};
+
+} // namespace __detail
+
+/// Single-precision view frusta
+using Frustumf_t = __detail::Frustum<float>;
+/// Double-precision view frusta
+using Frustumd_t = __detail::Frustum<double>;
+
+} // namespace cs237
+
+#endif // !_CS237_FRUSTUM_HPP_
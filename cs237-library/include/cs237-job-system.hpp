@@ -0,0 +1,307 @@
+/*! \file cs237-job-system.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * A work-stealing job system.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_JOB_SYSTEM_HPP_
+#define _CS237_JOB_SYSTEM_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237-job-system.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+class JobSystem;
+template <typename T> class Future;
+
+namespace __detail {
+
+    /// a unit of work
+    struct Task;
+
+    /// the per-thread state of a job-system worker
+    struct Worker;
+
+} // namespace __detail
+
+/// A counter of outstanding tasks.  Tasks that are spawned with a counter
+/// increment it when they are spawned and decrement it when they finish, so
+/// `JobSystem::wait` can wait for a group of tasks.  If any of the tasks
+/// raises an exception, the first one is rethrown by `wait`.
+//
+class TaskCounter {
+  public:
+    TaskCounter () : _n(0), _error(nullptr) { }
+    TaskCounter (TaskCounter const &) = delete;
+    TaskCounter &operator= (TaskCounter const &) = delete;
+
+    /// have all of the tasks finished?
+    bool done () const { return this->_n.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> _n;           ///< the number of unfinished tasks
+    std::mutex _mu;                     ///< protects `_error`
+    std::exception_ptr _error;          ///< the first exception raised by a task
+};
+
+/// A work-stealing job system.  Each worker thread has a Chase-Lev deque of
+/// tasks; a worker pushes and pops tasks at the bottom of its own deque
+/// (so it works depth first on recently spawned, cache-warm tasks) and, when
+/// its deque is empty, steals from the top of the other workers' deques (so
+/// thieves take the oldest, and typically largest, pieces of work).  Tasks
+/// that are spawned by threads that are not workers (e.g., the main thread)
+/// go into a shared queue.
+///
+/// Waiting is cooperative: a thread that waits on a `TaskCounter`, `Future`,
+/// `parallelFor`, or `TaskGraph` executes other tasks until the thing that
+/// it is waiting for is done, so tasks can spawn and wait on subtasks
+/// without deadlocking the system.  Tasks should not block on anything
+/// else (e.g., a mutex that is held across a wait or a `std::future`), since
+/// that ties up a worker.
+///
+/// An application has a shared job system (see `Application::jobs`).
+//
+class JobSystem {
+  public:
+
+    /// \brief create a job system
+    /// \param nThreads  the number of threads that execute tasks, including a
+    ///                  thread that waits for tasks; 0 means one thread per
+    ///                  hardware thread.  The system creates `nThreads-1`
+    ///                  worker threads.
+    explicit JobSystem (uint32_t nThreads = 0);
+
+    JobSystem (JobSystem const &) = delete;
+    JobSystem &operator= (JobSystem const &) = delete;
+
+    /// shut down the worker threads; outstanding tasks are *not* run
+    ~JobSystem ();
+
+    /// the number of threads that execute tasks (i.e., the number of worker
+    /// threads plus one for the waiting thread)
+    uint32_t numThreads () const { return this->_workers.size() + 1; }
+
+    /// \brief spawn a task
+    /// \param fn   the task's function
+    /// \param ctr  optional counter for waiting on the task
+    void run (std::function<void()> fn, TaskCounter *ctr = nullptr);
+
+    /// \brief wait for the tasks of a counter to finish, executing other tasks
+    ///        in the meantime
+    /// \param ctr  the counter to wait on
+    ///
+    /// If one of the tasks raised an exception, then the exception is rethrown
+    /// (and cleared from the counter).
+    void wait (TaskCounter &ctr);
+
+    /// \brief run a function asynchronously
+    /// \param fn  the function to run
+    /// \return a future for the function's result
+    template <typename F>
+    Future<std::invoke_result_t<F>> async (F &&fn);
+
+    /// \brief apply a function to the subranges of a range in parallel
+    /// \param begin  the start of the range
+    /// \param end    the end of the range (exclusive)
+    /// \param grain  the maximum size of a subrange; 0 picks a grain size that
+    ///               gives each thread several subranges
+    /// \param fn     the function, which is applied to [`lo`, `hi`) subranges
+    ///
+    /// The range is split recursively, so that thieves steal large pieces of
+    /// the range.  The call returns when the function has been applied to the
+    /// whole range.
+    void parallelFor (
+        uint32_t begin,
+        uint32_t end,
+        uint32_t grain,
+        std::function<void(uint32_t lo, uint32_t hi)> const &fn);
+
+    /// statistics about the system
+    struct Stats {
+        uint64_t nTasks;                ///< the number of tasks that were executed
+        uint64_t nSteals;               ///< the number of tasks that were stolen
+    };
+
+    /// get the statistics for the system
+    Stats stats () const;
+
+  private:
+    std::vector<__detail::Worker *> _workers;   ///< the worker threads
+    std::mutex _queueMu;                        ///< protects `_queue`
+    std::deque<__detail::Task *> _queue;        ///< tasks spawned by non-workers
+    std::atomic<uint32_t> _nQueued;             ///< the size of `_queue`
+    std::atomic<bool> _quit;                    ///< set to shut down the workers
+    std::atomic<uint64_t> _nExtTasks;           ///< tasks executed by non-workers
+    std::atomic<uint64_t> _nExtSteals;          ///< tasks stolen by non-workers
+
+    // support for idle workers
+    std::mutex _sleepMu;
+    std::condition_variable _sleepCV;
+    std::atomic<uint32_t> _nSleeping;           ///< the number of sleeping workers
+    uint64_t _wakeups;                          ///< incremented (under `_sleepMu`) to
+                                                ///  wake the workers
+
+    /// the worker state of the calling thread, or nullptr if it is not one
+    /// of this system's workers
+    __detail::Worker *_self ();
+
+    /// push a task and wake an idle worker
+    void _push (__detail::Task *task);
+
+    /// find a task to run; `self` is the calling thread's worker state (or
+    /// nullptr).  Returns nullptr if there is no work.
+    __detail::Task *_findWork (__detail::Worker *self);
+
+    /// execute a task and release it
+    void _execute (__detail::Task *task);
+
+    /// is there any work in the system?
+    bool _hasWork () const;
+
+    /// the main loop of a worker thread
+    void _workerMain (__detail::Worker *self);
+
+};
+
+/// The result of a function that was run by `JobSystem::async`.  Waiting on
+/// the result is cooperative (see `JobSystem`), so it is safe to call `get`
+/// from a task.
+//
+template <typename T>
+class Future {
+  public:
+    Future () : _sys(nullptr) { }
+
+    /// is the result available?
+    bool ready () const
+    {
+        assert (this->_state && "ready called on an invalid future");
+        return this->_state->ctr.done();
+    }
+
+    /// \brief wait for the result; if the function raised an exception, then
+    ///        it is rethrown.  `get` may only be called once.
+    T get ()
+    {
+        assert (this->_state && "get called on an invalid future");
+        this->_sys->wait (this->_state->ctr);
+        return this->_state->fut.get();
+    }
+
+  private:
+    friend class JobSystem;
+
+    struct State {
+        TaskCounter ctr;
+        std::promise<T> prom;
+        std::future<T> fut;
+    };
+
+    JobSystem *_sys;
+    std::shared_ptr<State> _state;
+
+    explicit Future (JobSystem *sys) : _sys(sys), _state(std::make_shared<State>())
+    {
+        this->_state->fut = this->_state->prom.get_future();
+    }
+};
+
+template <typename F>
+Future<std::invoke_result_t<F>> JobSystem::async (F &&fn)
+{
+    using T = std::invoke_result_t<F>;
+    Future<T> result(this);
+    auto state = result._state;
+    // the promise captures any exception, so the task itself never fails
+    this->run (
+        [state, fn = std::forward<F>(fn)]() mutable {
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    fn();
+                    state->prom.set_value();
+                } else {
+                    state->prom.set_value(fn());
+                }
+            } catch (...) {
+                state->prom.set_exception(std::current_exception());
+            }
+        },
+        &state->ctr);
+    return result;
+}
+
+/// A graph of tasks with dependencies.  The graph is built by adding tasks and
+/// edges, and then it can be run (any number of times) on a job system; a
+/// task is run once all of the tasks that precede it have finished.
+//
+class TaskGraph {
+  public:
+    /// the ID of a task in the graph
+    using TaskId = uint32_t;
+
+    TaskGraph () { }
+
+    /// \brief add a task to the graph
+    /// \param fn  the task's function
+    /// \return the ID of the task
+    TaskId add (std::function<void()> fn)
+    {
+        this->_nodes.emplace_back(std::move(fn));
+        return TaskId(this->_nodes.size() - 1);
+    }
+
+    /// \brief add a dependency; `before` must finish before `after` starts
+    void precede (TaskId before, TaskId after)
+    {
+        assert ((before < this->_nodes.size()) && (after < this->_nodes.size()));
+        this->_nodes[before].succs.push_back(after);
+        this->_nodes[after].nPreds++;
+    }
+
+    /// the number of tasks in the graph
+    uint32_t size () const { return this->_nodes.size(); }
+
+    /// \brief run the graph and wait for it to finish
+    /// \param js  the job system to run the tasks on
+    ///
+    /// If a task raises an exception, then the tasks that have not started
+    /// yet are skipped and the exception is rethrown.  It is an error for the
+    /// graph to have a cycle.
+    void run (JobSystem &js);
+
+  private:
+    struct Node {
+        std::function<void()> fn;
+        std::vector<TaskId> succs;              ///< the tasks that depend on this one
+        uint32_t nPreds;                        ///< the number of predecessors
+        std::atomic<uint32_t> pending;          ///< unfinished predecessors in the current run
+
+        explicit Node (std::function<void()> &&f)
+          : fn(std::move(f)), nPreds(0), pending(0)
+        { }
+        // the atomic counter is not movable, but it is only meaningful
+        // during a run
+        Node (Node &&n) noexcept
+          : fn(std::move(n.fn)), succs(std::move(n.succs)), nPreds(n.nPreds), pending(0)
+        { }
+    };
+
+    std::vector<Node> _nodes;
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_JOB_SYSTEM_HPP_
@@ -49,6 +49,34 @@ public:
     /// \param src  address of data to copy
     void copyTo (const void *src) { this->copyTo(src, 0, this->_sz); }
 
+    /// copy data from a subrange of the device memory object
+    /// \param dst     address to copy the data to
+    /// \param offset  offset from the beginning of the memory object to copy the data from
+    /// \param sz      size in bytes of the data to copy
+    void copyFrom (void *dst, size_t offset, size_t sz)
+    {
+        assert (offset + sz <= this->_sz);
+
+        auto dev = this->_app->_device;
+
+        auto src = dev.mapMemory(this->_mem, offset, sz, {});
+        memcpy(dst, src, sz);
+        dev.unmapMemory (this->_mem);
+    }
+
+    /// \brief map the whole memory object into the host address space
+    /// \return the address of the mapped memory
+    ///
+    /// This is used for persistently-mapped buffers; the `copyTo` and `copyFrom`
+    /// functions must not be used while the object is mapped.
+    void *map ()
+    {
+        return this->_app->_device.mapMemory(this->_mem, 0, this->_sz, {});
+    }
+
+    /// unmap the memory object
+    void unmap () { this->_app->_device.unmapMemory (this->_mem); }
+
     /// the size of the memory object in bytes
     size_t size () const { return this->_sz; }
 
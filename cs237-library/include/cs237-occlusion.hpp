@@ -0,0 +1,147 @@
+/*! \file cs237-occlusion.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * This file implements a low-resolution software depth buffer with a
+ * hierarchical-Z (Hi-Z) pyramid that can be used for occlusion culling on
+ * the CPU.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_OCCLUSION_HPP_
+#define _CS237_OCCLUSION_HPP_
+
+#ifndef _CS237_HPP_
+#  error "cs237-occlusion.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+/// A software occlusion buffer.  Each frame, the occluders (i.e., large objects)
+/// are rasterized into a low-resolution depth buffer, which is then reduced to
+/// a Hi-Z pyramid where each texel holds the farthest depth of the texels that
+/// it covers.  A bounding box is occluded if its nearest depth is behind the
+/// farthest depth of all of the texels that its screen-space rectangle covers.
+///
+/// The test is meant to be conservative.  Occluder triangles that cross the near
+/// plane are ignored and the depth written for a pixel is the farthest depth of
+/// the triangle over the pixel's area.  Coverage is sampled at pixel centers
+/// along the edges that are shared by two triangles of an occluder mesh (so
+/// adjacent triangles cover the pixels along their common edge), but a pixel
+/// that straddles one of the mesh's screen-space silhouette edges is not
+/// covered.  A silhouette edge is an edge that belongs to a single triangle or
+/// whose two triangles lie on the same side of it on the screen (e.g., the
+/// outline of a closed mesh).  Each triangle is tested against its own
+/// silhouette edges, so a pixel near a silhouette vertex where two triangles
+/// meet can still extend slightly past the silhouette.  Vertices with the same
+/// position are treated as the same vertex, so seams in the texture coordinates
+/// or normals do not split a mesh.
+///
+/// Depth values follow the Vulkan convention (i.e., 0 is the near plane and 1
+/// is the far plane).
+///
+/// Typical use is
+///
+///     occBuf.begin (projM * viewM);
+///     for (each occluder) occBuf.addTriangles (...);
+///     occBuf.finish ();
+///     for (each object) if (! occBuf.isOccluded(bbox)) { draw object }
+///
+class OcclusionBuffer {
+public:
+
+    /// the dimensions of the tiles used by the rasterizer; the width and
+    /// height of the buffer are rounded up to a multiple of these values.
+    static constexpr uint32_t kTileWid = 8;
+    static constexpr uint32_t kTileHt = 8;
+
+    /// \brief create an occlusion buffer
+    /// \param wid  the width of the buffer in pixels
+    /// \param ht   the height of the buffer in pixels
+    OcclusionBuffer (uint32_t wid, uint32_t ht);
+
+    /// the width of the buffer
+    uint32_t width () const { return this->_wid; }
+
+    /// the height of the buffer
+    uint32_t height () const { return this->_ht; }
+
+    /// the number of levels in the Hi-Z pyramid
+    uint32_t numLevels () const { return this->_levels.size(); }
+
+    /// \brief clear the buffer and set the view-projection matrix for the frame
+    /// \param viewProj  the matrix that maps world space to clip space
+    void begin (glm::mat4 const &viewProj);
+
+    /// \brief rasterize a triangle mesh as an occluder
+    /// \param toWorld  the object-to-world-space transform for the mesh
+    /// \param verts    the object-space vertices of the mesh
+    /// \param indices  the vertex indices for the triangles of the mesh; the
+    ///                 number of indices must be a multiple of three
+    ///
+    /// Triangles are not back-face culled.  The silhouette edges of the mesh
+    /// are rasterized conservatively (see above), so a whole occluder should be
+    /// added with a single call.
+    void addTriangles (
+        glm::mat4 const &toWorld,
+        std::vector<glm::vec3> const &verts,
+        std::vector<uint32_t> const &indices);
+
+    /// build the Hi-Z pyramid; this function should be called after all of the
+    /// occluders have been added and before any occlusion tests.
+    void finish ();
+
+    /// \brief test if a world-space box is hidden behind the occluders
+    /// \param bb  the box to test
+    /// \return true if the box is definitely occluded and false otherwise
+    bool isOccluded (AABBf_t const &bb) const;
+
+    /// the number of occluder triangles that were rasterized since the last `begin`
+    uint32_t numTriangles () const { return this->_nTris; }
+
+    /// \brief get a depth value from the Hi-Z pyramid
+    /// \param lev  the pyramid level (level 0 is the full-resolution buffer)
+    /// \param x    the column
+    /// \param y    the row
+    float depthAt (uint32_t lev, uint32_t x, uint32_t y) const
+    {
+        assert (lev < this->_levels.size());
+        Level const &l = this->_levels[lev];
+        assert ((x < l.wid) && (y < l.ht));
+        return l.depth[y * l.wid + x];
+    }
+
+private:
+    /// one level of the Hi-Z pyramid
+    struct Level {
+        uint32_t wid;                   ///< the width of the level
+        uint32_t ht;                    ///< the height of the level
+        std::vector<float> depth;       ///< the farthest depths (row-major order)
+    };
+
+    uint32_t _wid;                      ///< the width of the buffer
+    uint32_t _ht;                       ///< the height of the buffer
+    glm::mat4 _viewProj;                ///< world-space to clip-space transform
+    std::vector<Level> _levels;         ///< the Hi-Z pyramid; `_levels[0]` is the
+                                        ///  depth buffer that occluders are drawn into
+    uint32_t _nTris;                    ///< number of triangles rasterized this frame
+
+    /// rasterize a single screen-space triangle; the vertices are in pixel
+    /// coordinates with the NDC depth in the z component.  Bit `i` of
+    /// `silhouette` is set when the edge opposite `v<i>` is a silhouette edge,
+    /// in which case only pixels that are completely inside the edge are covered.
+    void _drawTriangle (
+        glm::vec3 const &v0, glm::vec3 const &v1, glm::vec3 const &v2,
+        uint32_t silhouette);
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_OCCLUSION_HPP_
@@ -0,0 +1,98 @@
+/*! \file cs237-parallel-recorder.hpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _CS237_PARALLEL_RECORDER_HPP_
+#define _CS237_PARALLEL_RECORDER_HPP_
+
+#ifndef _CS237_HPP_
+#error "cs237-parallel-recorder.hpp should not be included directly"
+#endif
+
+namespace cs237 {
+
+/// Records the commands for a render pass on multiple threads.  A list of
+/// items (e.g., the visible instances) is split into contiguous chunks, one per
+/// thread of a job system, and each chunk is recorded by a task into a
+/// secondary command buffer that inherits the render pass.  The primary command
+/// buffer then executes the secondary buffers in order, so the draw order is
+/// the same as for recording the items sequentially.
+///
+/// Command pools are not thread safe, so every chunk has its own pool for
+/// each frame in flight.  The pools are reset at the start of `record`, so the
+/// GPU must have finished with the frame's previous commands by then (i.e., the
+/// caller must have waited on the frame's fence).
+///
+/// Secondary command buffers do not inherit any state other than the render
+/// pass, so the recording function must bind the pipeline and descriptor sets,
+/// and set the dynamic state (viewport, scissor), at the start of each chunk.
+//
+class ParallelRecorder {
+  public:
+
+    /// \brief the function that records the commands for the items in the
+    ///        range [`begin`, `end`); it is called concurrently on different
+    ///        threads, so it must not modify shared state
+    using RecordFn = std::function<void(vk::CommandBuffer cmdBuf, uint32_t begin, uint32_t end)>;
+
+    /// \brief create a parallel recorder
+    /// \param app      the owning application
+    /// \param nFrames  the number of frames in flight
+    /// \param js       the job system to record on; nullptr means use the
+    ///                 application's job system (see `Application::jobs`)
+    ParallelRecorder (Application *app, uint32_t nFrames = 1, JobSystem *js = nullptr);
+
+    ~ParallelRecorder ();
+
+    /// the number of chunks that the items are split into, which is the
+    /// number of threads in the job system
+    uint32_t numChunks () const { return this->_chunks.size(); }
+
+    /// \brief record the commands for a list of items in parallel
+    /// \param frame    the frame index (less than `nFrames`)
+    /// \param primary  the primary command buffer; it must be in a render pass
+    ///                 that was begun with `vk::SubpassContents::eSecondaryCommandBuffers`
+    /// \param rp       the render pass
+    /// \param subpass  the subpass index
+    /// \param fb       the framebuffer (may be nullptr, but specifying it can make
+    ///                 execution of the secondary buffers more efficient)
+    /// \param nItems   the number of items
+    /// \param fn       the function that records the commands for a range of items
+    void record (
+        uint32_t frame,
+        vk::CommandBuffer primary,
+        vk::RenderPass rp,
+        uint32_t subpass,
+        vk::Framebuffer fb,
+        uint32_t nItems,
+        RecordFn const &fn);
+
+    /// the wall-clock time (in ms) of the most recent call to `record`
+    double lastRecordTime () const { return this->_lastTime; }
+
+  private:
+    /// the command pools and secondary buffers of a chunk (one per frame)
+    struct PerChunk {
+        std::vector<vk::CommandPool> pools;
+        std::vector<vk::CommandBuffer> cmdBufs;
+    };
+
+    Application *_app;                  ///< the owning application
+    JobSystem *_js;                     ///< the job system that does the recording
+    uint32_t _nFrames;                  ///< the number of frames in flight
+    std::vector<PerChunk> _chunks;      ///< per-chunk state
+    double _lastTime;                   ///< the time of the last `record`
+
+};
+
+} // namespace cs237
+
+#endif // !_CS237_PARALLEL_RECORDER_HPP_
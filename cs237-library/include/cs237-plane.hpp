@@ -46,6 +46,14 @@ struct Plane {
         this->_nd = vec4(norm, d);
     }
 
+    /// \brief specify a plane by the coefficients of its equation `ax + by + cz + d = 0`
+    /// \param coeffs the coefficients `(a, b, c, d)`; the normal `(a, b, c)` does
+    ///               not have to be unit length
+    explicit Plane (vec4 const &coeffs)
+    {
+        this->_nd = coeffs / glm::length(vec3(coeffs));
+    }
+
     /// \brief get the plane normal vector
     vec3 norm () const { return vec3(this->_nd); }
 
@@ -19,6 +19,141 @@
 
 namespace cs237 {
 
+/// A descriptor binding that is used by a shader program, as determined by
+/// reflection on the program's SPIR-V code.
+struct ShaderBinding {
+    uint32_t set;                       ///< the descriptor-set index
+    uint32_t binding;                   ///< the binding index in the set
+    vk::DescriptorType type;            ///< the type of descriptor
+    uint32_t count;                     ///< the number of descriptors; this is 0 for
+                                        ///  runtime-sized arrays
+    vk::ShaderStageFlags stages;        ///< the shader stages that use the binding
+};
+
+namespace __detail {
+
+/// \brief determine the descriptor bindings and push constants used by a shader
+/// \param code      the SPIR-V code of the shader
+/// \param nBytes    the size of the code in bytes
+/// \param stage     the shader's stage
+/// \param bindings  the bindings are merged into this vector
+/// \param pcRange   the push-constant range is merged into this range
+void reflectSPIRV (
+    void const *code,
+    size_t nBytes,
+    vk::ShaderStageFlagBits stage,
+    std::vector<ShaderBinding> &bindings,
+    vk::PushConstantRange &pcRange);
+
+/// \brief merge a binding into a vector of bindings; it is an error if the vector
+///        has a binding with the same set and binding index but a different type
+void mergeBinding (std::vector<ShaderBinding> &bindings, ShaderBinding const &sb);
+
+/// \brief merge a push-constant range into another range
+void mergePushConstants (vk::PushConstantRange &pcRange, vk::PushConstantRange const &pc);
+
+} // namespace __detail
+
+/// A set of values for the specialization constants of a shader program.
+/// Specialization constants are declared in GLSL with a `constant_id`
+/// layout qualifier, for example
+///
+///     layout (constant_id = 0) const bool kNormalMapping = false;
+///
+/// and their values are fixed when the pipeline is created, so the driver
+/// can fold them and eliminate the code that they disable.  This allows a
+/// single shader to be compiled into several branch-free pipeline variants.
+/// There is a setter for each type of constant, which must match the type of
+/// the GLSL declaration (e.g., `setBool(0, true)` for the above constant).
+//
+class SpecConstants {
+  public:
+
+    SpecConstants () { this->_update(); }
+
+    SpecConstants (SpecConstants const &other)
+      : _entries(other._entries), _data(other._data)
+    {
+        this->_update();
+    }
+
+    SpecConstants &operator= (SpecConstants const &other)
+    {
+        this->_entries = other._entries;
+        this->_data = other._data;
+        this->_update();
+        return *this;
+    }
+
+    /// \brief set the value of a boolean constant
+    /// \param id  the constant's `constant_id`
+    /// \param b   the value
+    /// \return this object, so that calls can be chained
+    SpecConstants &setBool (uint32_t id, bool b)
+    {
+        // GLSL booleans are 32-bit values
+        return this->_set (id, static_cast<vk::Bool32>(b ? VK_TRUE : VK_FALSE));
+    }
+
+    /// \brief set the value of an integer constant
+    /// \param id  the constant's `constant_id`
+    /// \param n   the value
+    /// \return this object, so that calls can be chained
+    SpecConstants &setInt (uint32_t id, int32_t n) { return this->_set (id, n); }
+
+    /// \brief set the value of an unsigned integer constant
+    /// \param id  the constant's `constant_id`
+    /// \param n   the value
+    /// \return this object, so that calls can be chained
+    SpecConstants &setUint (uint32_t id, uint32_t n) { return this->_set (id, n); }
+
+    /// \brief set the value of a floating-point constant
+    /// \param id  the constant's `constant_id`
+    /// \param f   the value
+    /// \return this object, so that calls can be chained
+    SpecConstants &setFloat (uint32_t id, float f) { return this->_set (id, f); }
+
+    /// is the set of constants empty?
+    bool isEmpty () const { return this->_entries.empty(); }
+
+    /// the Vulkan specialization info for the constants; the pointer is valid
+    /// until this object is modified or destroyed
+    vk::SpecializationInfo const *info () const { return &this->_info; }
+
+  private:
+    std::vector<vk::SpecializationMapEntry> _entries;   ///< the constant IDs and offsets
+    std::vector<char> _data;                            ///< the constant values
+    vk::SpecializationInfo _info;                       ///< refers to `_entries` and `_data`
+
+    template <typename T>
+    SpecConstants &_set (uint32_t id, T v)
+    {
+        for (auto const &ent : this->_entries) {
+            if (ent.constantID == id) {
+                if (ent.size != sizeof(T)) {
+                    ERROR("specialization constant redefined with a different size");
+                }
+                std::memcpy (this->_data.data() + ent.offset, &v, sizeof(T));
+                return *this;
+            }
+        }
+        uint32_t offset = this->_data.size();
+        this->_entries.push_back(vk::SpecializationMapEntry(id, offset, sizeof(T)));
+        this->_data.resize(offset + sizeof(T));
+        std::memcpy (this->_data.data() + offset, &v, sizeof(T));
+        this->_update();
+        return *this;
+    }
+
+    void _update ()
+    {
+        this->_info = vk::SpecializationInfo(
+            this->_entries.size(), this->_entries.data(),
+            this->_data.size(), this->_data.data());
+    }
+
+}; // SpecConstants
+
 /// A wrapper class for loading a pipeline of pre-compiled shaders from
 /// the file system.
 //
@@ -54,6 +189,31 @@ class Shaders {
         std::vector<std::string> const &files,
         vk::ShaderStageFlags stages);
 
+    /*! \brief load a pre-compiled shader program using the application's
+     *         shader-module cache.
+     *  \param app      the application
+     *  \param stem     the base name of the shader files
+     *  \param stages   a bitmask spcifying the shader stages that form the program
+     *
+     * The shader modules are shared with other `Shaders` objects that load the
+     * same files (see `Application::preloadShaders`).
+     */
+    Shaders (
+        Application *app,
+        std::string const &stem,
+        vk::ShaderStageFlags stages);
+
+    /*! \brief load a pre-compiled shader program using the application's
+     *         shader-module cache.
+     *  \param app      the application
+     *  \param files    a vector of the shader file names (in stage order)
+     *  \param stages   a bitmask spcifying the shader stages that form the program
+     */
+    Shaders (
+        Application *app,
+        std::vector<std::string> const &files,
+        vk::ShaderStageFlags stages);
+
     ~Shaders ();
 
     /// return the number of shader stages in the pipeline
@@ -65,12 +225,127 @@ class Shaders {
         return this->_stages;
     }
 
+    /// \brief return the stage create infos specialized for a set of constant
+    ///        values.
+    /// \param consts  the values of the specialization constants; these are
+    ///                supplied to every stage (a stage ignores the constants
+    ///                that it does not declare) and must outlive the pipeline
+    ///                creation
+    /// \return the specialized stage create infos
+    std::vector<vk::PipelineShaderStageCreateInfo> stages (SpecConstants const &consts) const
+    {
+        std::vector<vk::PipelineShaderStageCreateInfo> stages = this->_stages;
+        if (! consts.isEmpty()) {
+            for (auto &stage : stages) {
+                stage.pSpecializationInfo = consts.info();
+            }
+        }
+        return stages;
+    }
+
+    /// the descriptor bindings used by the program's stages
+    std::vector<ShaderBinding> const &bindings () const { return this->_bindings; }
+
+    /// the push-constant range used by the program; the size is zero if the
+    /// program does not use push constants
+    vk::PushConstantRange const &pushConstants () const { return this->_pushConsts; }
+
   private:
+    Application *_app;          ///< the application when the modules are cached;
+                                ///  otherwise nullptr
     vk::Device _device;
     std::vector<vk::PipelineShaderStageCreateInfo> _stages;
+    std::vector<ShaderBinding> _bindings;       ///< reflected descriptor bindings
+    vk::PushConstantRange _pushConsts;          ///< reflected push-constant range
+
+    /// load the stages specified by a stem and stage mask
+    void _loadStages (std::string const &stem, vk::ShaderStageFlags stages);
+
+    /// load the stages specified by a list of files and stage mask
+    void _loadStages (std::vector<std::string> const &files, vk::ShaderStageFlags stages);
+
+    /// load a single stage and add it to the program
+    void _addStage (std::string const &file, vk::ShaderStageFlagBits kind);
 
 }; // Shaders
 
+/// The resource interface of one or more shader programs, which is the merge of
+/// their reflected descriptor bindings and push constants.  Use this class to
+/// build the descriptor-set layouts, pipeline layout, and descriptor-pool sizes
+/// for a group of pipelines that share descriptor sets (see
+/// `Application::createPipelineLayout`).
+///
+/// Notes:
+///  - the push constants of all of the programs are merged into a single range,
+///    so `pushConstants` commands must specify the union of the stages (i.e.,
+///    `pushConstants().stageFlags`).
+///  - runtime-sized descriptor arrays have a count of zero; their size must be
+///    supplied by the application.
+//
+class PipelineInterface {
+  public:
+
+    PipelineInterface () { }
+
+    /// \brief the interface of a single shader program
+    /// \param shaders  the program
+    explicit PipelineInterface (Shaders const *shaders) { this->add (shaders); }
+
+    /// \brief the merged interface of a group of shader programs
+    /// \param shaders  the programs
+    explicit PipelineInterface (std::vector<Shaders const *> const &shaders)
+    {
+        for (auto sh : shaders) {
+            this->add (sh);
+        }
+    }
+
+    /// \brief merge the interface of a shader program into this interface
+    /// \param shaders  the program
+    ///
+    /// It is an error if the program uses a binding with a different descriptor
+    /// type than a program that has already been added.
+    void add (Shaders const *shaders);
+
+    /// \brief mark a buffer binding as dynamic
+    /// \param set      the set index
+    /// \param binding  the binding index in the set
+    ///
+    /// Reflection cannot tell whether a buffer is accessed with a dynamic offset
+    /// (e.g., for data in a `UniformRing`), so this method changes the type of a
+    /// uniform or storage-buffer binding to the corresponding dynamic type.  It
+    /// should be called after all of the programs have been added, and it is an
+    /// error if the binding does not exist or is not a buffer.
+    void setDynamic (uint32_t set, uint32_t binding);
+
+    /// the number of descriptor sets (i.e., one plus the largest set index)
+    uint32_t numSets () const;
+
+    /// the merged bindings, sorted by set and binding index
+    std::vector<ShaderBinding> const &bindings () const { return this->_bindings; }
+
+    /// \brief the layout bindings for a descriptor set
+    /// \param set  the set index
+    /// \return the bindings of the set (empty if the set is not used)
+    std::vector<vk::DescriptorSetLayoutBinding> setBindings (uint32_t set) const;
+
+    /// the merged push-constant range; the size is zero if there are no push
+    /// constants
+    vk::PushConstantRange const &pushConstants () const { return this->_pushConsts; }
+
+    /// \brief the exact descriptor-pool sizes for allocating descriptor sets
+    /// \param nSets  the number of descriptor sets that will be allocated for
+    ///               each set index; missing entries are treated as zero
+    /// \return the pool sizes, which can be used with a `maxSets` that is the
+    ///         sum of `nSets`
+    std::vector<vk::DescriptorPoolSize> poolSizes (std::vector<uint32_t> const &nSets) const;
+
+  private:
+    std::vector<ShaderBinding> _bindings;       ///< merged bindings
+    vk::PushConstantRange _pushConsts;          ///< merged push-constant range
+
+}; // PipelineInterface
+
 } /* namespace cs237 */
 
 #endif /* !_CS237_SHADER_HPP_ */
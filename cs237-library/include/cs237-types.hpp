@@ -23,6 +23,7 @@ namespace cs237 {
     class Window;
     class Buffer;
     class Shaders;
+    class BindlessTextures;
 
 } /* namespace cs237 */
 
@@ -21,6 +21,8 @@
 
 namespace cs237 {
 
+class FrameStats;
+
 /// structure containing parameters for creating windows
 //
 struct CreateWindowInfo {
@@ -54,6 +56,11 @@ struct CreateWindowInfo {
 };
 
 /// abstract base class for simple GLFW windows used to view buffers, etc.
+///
+/// When the application is headless (see `Application::headless`), there is
+/// no GLFW window or surface; instead, the "swap chain" is a small ring of
+/// offscreen color images that have the same interface, so that the derived
+/// window classes do not need to change.
 //
 class Window {
 public:
@@ -85,14 +92,18 @@ public:
     /// Hide the window
     void hide ()
     {
-      glfwHideWindow (this->_win);
+      if (this->_win != nullptr) {
+          glfwHideWindow (this->_win);
+      }
       this->_isVis = false;
     }
 
     /// Show the window (a no-op if it is already visible)
     void show ()
     {
-      glfwShowWindow (this->_win);
+      if (this->_win != nullptr) {
+          glfwShowWindow (this->_win);
+      }
       this->_isVis = true;
     }
 
@@ -112,12 +123,21 @@ public:
     /// method invoked on Iconify events.
     virtual void iconify (bool iconified);
 
-    /// get the value of the "close" flag for the window
+    /// get the value of the "close" flag for the window, which is also set
+    /// once the application's frame limit (see `Application::maxFrames`)
+    /// has been reached
     bool windowShouldClose ()
     {
-        return glfwWindowShouldClose (this->_win);
+        uint32_t maxFrames = this->_app->maxFrames();
+        if ((maxFrames > 0) && (this->_nFrames >= maxFrames)) {
+            return true;
+        }
+        return (this->_win != nullptr) && glfwWindowShouldClose (this->_win);
     }
 
+    /// the number of frames that have been presented
+    uint32_t numFrames () const { return this->_nFrames; }
+
     ///{
     /// Input handling methods; override these in the derived window
     /// classes to do something useful.
@@ -167,24 +187,39 @@ protected:
     /// the collected information about the swap-chain for a window
     struct SwapChain {
         vk::Device device;              ///< the owning logical device
-        vk::SwapchainKHR chain;         ///< the swap chain object
+        vk::SwapchainKHR chain;         ///< the swap chain object (nullptr when headless)
         vk::Format imageFormat;         ///< pixel format of image buffers
         vk::Extent2D extent;            ///< size of swap buffer images
         int numAttachments;             ///< the number of framebuffer attachments
         // the following vectors hold the state for each of the buffers in the
         // swap chain.
         std::vector<vk::Image> images;  ///< images for the swap buffers
+        std::vector<vk::DeviceMemory> imageMems; ///< memory for the images when
+                                        ///  headless (empty otherwise)
         std::vector<vk::ImageView> views; ///< image views for the swap buffers
         std::optional<DepthStencilBuffer> dsBuf; ///< optional depth/stencil-buffer
         std::vector<vk::Framebuffer> fBufs; ///< frame buffers
+        uint32_t nextImage;             ///< the next image to use when headless
 
         SwapChain (vk::Device dev)
-          : device(dev), dsBuf(std::nullopt)
+          : device(dev), chain(nullptr), dsBuf(std::nullopt), nextImage(0)
         { }
 
         /// \brief return the number of buffers in the swap chain
         int size () const { return this->images.size(); }
 
+        /// \brief is the swap chain a ring of offscreen images?
+        bool isOffscreen () const { return !this->chain; }
+
+        /// \brief the layout that the color attachment should be in at the end
+        ///        of the frame's render pass
+        vk::ImageLayout presentLayout () const
+        {
+            return this->isOffscreen()
+                ? vk::ImageLayout::eTransferSrcOptimal
+                : vk::ImageLayout::ePresentSrcKHR;
+        }
+
         /// \brief allocate frame buffers for a rendering pass
         void initFramebuffers (vk::RenderPass renderPass);
 
@@ -213,13 +248,16 @@ protected:
                                         ///  is finished
         vk::Fence inFlight;             ///< fence for synchronizing on the termination
                                         ///  of the rendering operation
+        uint32_t statsSlot;             ///< the frame's slot in the window's
+                                        ///  frame statistics (if benchmarking)
 
         /// \brief create a SyncObjs container
         explicit SyncObjs (Window *w)
           : win(w),
             imageAvailable(nullptr),
             renderFinished(nullptr),
-            inFlight(nullptr)
+            inFlight(nullptr),
+            statsSlot(0)
         {
             this->allocate();
         }
@@ -254,9 +292,12 @@ protected:
     };
 
     Application *_app;                  ///< the owning application
-    GLFWwindow *_win;                   ///< the underlying window
+    GLFWwindow *_win;                   ///< the underlying window (nullptr when headless)
     int _wid, _ht;	                ///< window dimensions
     bool _isVis;                        ///< true when the window is visible
+    uint32_t _nFrames;                  ///< the number of frames presented so far
+    FrameStats *_frameStats;            ///< frame statistics (nullptr unless the
+                                        ///  application is benchmarking)
     bool _keyEnabled;                   ///< true when the Key callback is enabled
     bool _cursorPosEnabled;             ///< true when the CursorPos callback is enabled
     bool _cursorEnterEnabled;           ///< true when the CursorEnter callback is enabled
@@ -275,11 +316,23 @@ protected:
     SwapChainDetails _getSwapChainDetails ();
 
     /// \brief Create the swap chain for this window; this initializes the _swap
-    ///        instance variable.
+    ///        instance variable.  When the application is headless, the swap
+    ///        chain is a ring of offscreen images.
     /// \param depth    set to true if requesting depth-buffer support
     /// \param stencil  set to true if requesting stencil-buffer support
     void _createSwapChain (bool depth, bool stencil);
 
+    /// \brief Create the swap chain for the window's surface; this is a helper
+    ///        for `_createSwapChain` that sets the chain, images, format, and
+    ///        extent of `_swap`.
+    /// \return the extent of the swap-chain images
+    vk::Extent2D _createSurfaceSwapChain ();
+
+    /// \brief Create the ring of offscreen color images that stands in for the
+    ///        swap chain when the application is headless
+    /// \param extent  the size of the images
+    void _createOffscreenImages (vk::Extent2D extent);
+
     /// \brief Recreate the swap chain for this window; this redefines the _swap
     ///        instance variable and is used when some aspect of the presentation
     ///        surface changes.
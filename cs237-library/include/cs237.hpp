@@ -19,12 +19,27 @@
 
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <cassert>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 
 /* GLM include files; we include the extensions, such as transforms
  * and enable the experimental support for `to_string`
@@ -60,6 +75,7 @@ inline void ReportError (const char *file, int line, std::string const &msg)
 
 /* CS23700 support files */
 #include "cs237-types.hpp"
+#include "cs237-job-system.hpp"
 
 #include "cs237-shader.hpp"
 #include "cs237-pipeline.hpp"
@@ -69,10 +85,19 @@ inline void ReportError (const char *file, int line, std::string const &msg)
 #include "cs237-buffer.hpp"
 #include "cs237-image.hpp"
 #include "cs237-texture.hpp"
+#include "cs237-bindless.hpp"
 #include "cs237-depth-buffer.hpp"
+#include "cs237-descriptor-allocator.hpp"
+#include "cs237-parallel-recorder.hpp"
+#include "cs237-command-cache.hpp"
+#include "cs237-frame-stats.hpp"
 
 /* geometric types */
 #include "cs237-aabb.hpp"
 #include "cs237-plane.hpp"
+#include "cs237-frustum.hpp"
+#include "cs237-bounds-array.hpp"
+#include "cs237-bvh.hpp"
+#include "cs237-occlusion.hpp"
 
 #endif // !_CS237_HPP_
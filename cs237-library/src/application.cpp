@@ -11,14 +11,25 @@
  */
 
 #include "cs237.hpp"
+#include <cctype>
+#include <chrono>
 #include <cstring>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <set>
 #include <vector>
 
+#ifdef CS237_WINDOWS
+#  include <process.h>
+#  define getpid _getpid
+#else
+#  include <unistd.h>
+#endif
+
 namespace cs237 {
 
-static std::vector<const char *> requiredExtensions (bool debug);
+static std::vector<const char *> requiredExtensions (bool debug, bool headless);
 static int graphicsQueueIndex (vk::PhysicalDevice dev);
 
 // callback for debug messages
@@ -39,22 +50,60 @@ Application::Application (std::vector<std::string> const &args, std::string cons
   : _name(name),
     _messages(vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning),
     _debug(0),
+    _headless(false),
+    _maxFrames(0),
+    _startTime(std::chrono::steady_clock::now()),
     _gpu(nullptr),
     _propsCache(nullptr),
-    _featuresCache(nullptr)
+    _featuresCache(nullptr),
+    _multiDrawIndirect(false),
+    _drawIndirectCount(false),
+    _tessellation(false),
+    _bindless(false),
+    _memoryBudget(false),
+    _bindlessTxts(nullptr),
+    _jobs(nullptr),
+    _warmCache(false),
+    _nPipelines(0),
+    _pipelineTime(0.0),
+    _shaderHits(0)
 {
     // process the command-line arguments
-    for (auto it : args) {
+    for (size_t i = 0;  i < args.size();  ++i) {
+        auto const &it = args[i];
         if (it == "-debug") {
             this->_messages |= vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning;
             this->_debug = true;
         } else if (it == "-verbose") {
             this->_messages = vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose;
+        } else if (it == "-headless") {
+            this->_headless = true;
+        } else if (it == "-frames") {
+            long n = (i+1 < args.size()) ? std::strtol(args[i+1].c_str(), nullptr, 10) : 0;
+            if (n > 0) {
+                this->_maxFrames = static_cast<uint32_t>(n);
+                ++i;
+            } else {
+                std::cerr << "warning: expected positive frame count after -frames\n";
+            }
+        } else if (it == "-bench") {
+            if (i+1 < args.size()) {
+                this->_benchFile = args[++i];
+            } else {
+                std::cerr << "warning: expected file name after -bench\n";
+            }
         }
     }
 
-    // initialize GLFW
-    glfwInit();
+    // a headless run is unattended, so it must stop on its own
+    if (this->_headless && (this->_maxFrames == 0)) {
+        this->_maxFrames = 1;
+    }
+
+    // initialize GLFW; in headless mode we do not use GLFW at all
+    if (! this->_headless) {
+        glfwInit();
+    }
 
     // create a Vulkan instance
     this->_createInstance();
@@ -70,6 +119,9 @@ Application::Application (std::vector<std::string> const &args, std::string cons
 
 Application::~Application ()
 {
+    // shut down the worker threads first, since tasks might use the device
+    delete this->_jobs;
+
     if (this->_propsCache != nullptr) {
         delete this->_propsCache;
     }
@@ -77,6 +129,34 @@ Application::~Application ()
         delete this->_featuresCache;
     }
 
+    if (this->verbose()) {
+        std::cout << "# " << this->_nPipelines << " pipelines created in "
+            << this->_pipelineTime << " ms ("
+            << (this->_warmCache ? "warm" : "cold") << " pipeline cache)\n";
+        std::cout << "# " << this->_shaderModules.size() << " shader modules loaded ("
+            << this->_shaderHits << " cache hits)\n";
+    }
+
+    // save the pipeline cache for the next run
+    this->_savePipelineCache();
+
+    delete this->_bindlessTxts;
+
+    // delete the cached shader modules
+    for (auto &it : this->_shaderModules) {
+        this->_device.destroyShaderModule(it.second.module);
+    }
+
+    // delete the cached samplers
+    for (auto &it : this->_samplers) {
+        this->_device.destroySampler(it.second);
+    }
+
+    // delete the cached descriptor-set layouts
+    for (auto it : this->_dsLayouts) {
+        this->_device.destroyDescriptorSetLayout(it.second);
+    }
+
     // delete the command pool
     this->_device.destroyCommandPool(this->_cmdPool);
 
@@ -91,7 +171,9 @@ Application::~Application ()
     this->_instance.destroy();
 
     // shut down GLFW
-    glfwTerminate();
+    if (! this->_headless) {
+        glfwTerminate();
+    }
 
 }
 
@@ -107,7 +189,7 @@ void Application::_createInstance ()
         VK_API_VERSION_1_3); /* API version */
 
     // figure out what extensions we are going to need
-    auto extensions = requiredExtensions(this->_debug);
+    auto extensions = requiredExtensions(this->_debug, this->_headless);
 
     // intialize the creation info struct
     vk::InstanceCreateInfo createInfo(
@@ -130,6 +212,9 @@ void Application::_createInstance ()
 
     // create the logical device and get the queues
     this->_createLogicalDevice ();
+
+    // create the pipeline cache
+    this->_loadPipelineCache ();
 }
 
 // check that a device meets the requested features
@@ -320,10 +405,13 @@ void Application::_createLogicalDevice ()
     // get the extensions that are supported by the device
     auto supportedExts = this->supportedDeviceExtensions();
 
-    // set up the extension vector to have swap chains and portability subset (if
-    // supported)
+    // set up the extension vector to have swap chains (unless we are headless)
+    // and portability subset (if supported)
     std::vector<const char*> kDeviceExts;
-    if (extInList(VK_KHR_SWAPCHAIN_EXTENSION_NAME, supportedExts)) {
+    if (this->_headless) {
+        // offscreen rendering does not need a swap chain
+    }
+    else if (extInList(VK_KHR_SWAPCHAIN_EXTENSION_NAME, supportedExts)) {
         kDeviceExts.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     }
     else {
@@ -332,12 +420,55 @@ void Application::_createLogicalDevice ()
     if (extInList("VK_KHR_portability_subset", supportedExts)) {
         kDeviceExts.push_back("VK_KHR_portability_subset");
     }
+    // the memory budget is only used to report memory usage for benchmarks
+    if (this->benchmarking()
+    && extInList(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, supportedExts)) {
+        kDeviceExts.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        this->_memoryBudget = true;
+    }
 
     // for now, we are only enabling a couple of extra features
     vk::PhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.fillModeNonSolid = VK_TRUE;
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    // enable the features needed for GPU-driven rendering (i.e., draw commands
+    // generated by compute shaders) when they are available
+    auto availFeatures = this->features();
+    if (availFeatures->multiDrawIndirect && availFeatures->drawIndirectFirstInstance) {
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+        this->_multiDrawIndirect = true;
+    }
+    if (availFeatures->tessellationShader) {
+        deviceFeatures.tessellationShader = VK_TRUE;
+        this->_tessellation = true;
+    }
+    vk::PhysicalDeviceVulkan12Features vk12Features{};
+    if (this->props()->apiVersion >= VK_API_VERSION_1_2) {
+        auto chain = this->_gpu.getFeatures2<
+            vk::PhysicalDeviceFeatures2,
+            vk::PhysicalDeviceVulkan12Features>();
+        auto const &avail12 = chain.get<vk::PhysicalDeviceVulkan12Features>();
+        if (avail12.drawIndirectCount) {
+            vk12Features.drawIndirectCount = VK_TRUE;
+            this->_drawIndirectCount = true;
+        }
+        // the descriptor-indexing features needed for bindless textures
+        if (avail12.descriptorIndexing
+        && avail12.runtimeDescriptorArray
+        && avail12.shaderSampledImageArrayNonUniformIndexing
+        && avail12.descriptorBindingPartiallyBound
+        && avail12.descriptorBindingSampledImageUpdateAfterBind) {
+            vk12Features.descriptorIndexing = VK_TRUE;
+            vk12Features.runtimeDescriptorArray = VK_TRUE;
+            vk12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            vk12Features.descriptorBindingPartiallyBound = VK_TRUE;
+            vk12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            this->_bindless = true;
+        }
+    }
+
     // initialize the create info
     vk::DeviceCreateInfo createInfo(
         {}, /* flags */
@@ -347,6 +478,9 @@ void Application::_createLogicalDevice ()
             : vk::ArrayProxyNoTemporaries<const char * const>()),
         kDeviceExts, /* enabled extension names */
         &deviceFeatures); /* enabled device features */
+    if (this->_drawIndirectCount || this->_bindless) {
+        createInfo.pNext = &vk12Features;
+    }
 
     // create the logical device
     this->_device = this->_gpu.createDevice(createInfo);
@@ -558,29 +692,48 @@ void Application::_initCommandPool ()
 
 vk::Sampler Application::createSampler (Application::SamplerInfo const &info)
 {
-    vk::SamplerCreateInfo samplerInfo(
-        {}, /* flags */
-        info.magFilter,
-        info.minFilter,
-        info.mipmapMode,
-        info.addressModeU,
-        info.addressModeV,
-        info.addressModeW,
-        0.0, /* mip LOD bias */
-        VK_TRUE, /* anisotropy enable */
-        this->limits()->maxSamplerAnisotropy,
-        VK_FALSE, /* compare enable */
-        vk::CompareOp::eNever, /* compare op */
-        0, /* min LOD */
-        0, /* max LOD */
-        info.borderColor, /* borderColor */
-        VK_FALSE); /* unnormalized coordinates */
-
-    return this->_device.createSampler(samplerInfo);
+    return this->_getSampler (info, false);
 }
 
 vk::Sampler Application::createDepthSampler (SamplerInfo const &info)
 {
+    return this->_getSampler (info, true);
+}
+
+vk::Sampler Application::_getSampler (SamplerInfo const &info, bool depth)
+{
+    // clamp the anisotropy to the device limit, so that requests that only differ
+    // above the limit share a sampler
+    float anisotropy = std::min(info.maxAnisotropy, this->limits()->maxSamplerAnisotropy);
+    bool anisotropyEnable = (anisotropy > 1.0f);
+    if (! anisotropyEnable) {
+        anisotropy = 1.0f;
+    }
+
+    uint32_t anisotropyBits;
+    std::memcpy (&anisotropyBits, &anisotropy, sizeof(anisotropyBits));
+    SamplerKey key = {
+            static_cast<uint32_t>(info.magFilter),
+            static_cast<uint32_t>(info.minFilter),
+            static_cast<uint32_t>(info.mipmapMode),
+            static_cast<uint32_t>(info.addressModeU),
+            static_cast<uint32_t>(info.addressModeV),
+            static_cast<uint32_t>(info.addressModeW),
+            static_cast<uint32_t>(info.borderColor),
+            anisotropyBits,
+            depth ? 1u : 0u
+        };
+
+    auto it = this->_samplers.find(key);
+    if (it != this->_samplers.end()) {
+        return it->second;
+    }
+
+    if (this->_samplers.size() >= this->limits()->maxSamplerAllocationCount) {
+        ERROR("too many samplers; the device limit is "
+            + std::to_string(this->limits()->maxSamplerAllocationCount));
+    }
+
     vk::SamplerCreateInfo samplerInfo(
         {}, /* flags */
         info.magFilter,
@@ -590,19 +743,23 @@ vk::Sampler Application::createDepthSampler (SamplerInfo const &info)
         info.addressModeV,
         info.addressModeW,
         0.0, /* mip LOD bias */
-        VK_TRUE, /* anisotropy enable */
-        this->limits()->maxSamplerAnisotropy,
-/* FIXME: need VkPhysicalDevicePortabilitySubsetFeaturesKHR::mutableComparisonSamplers
+        anisotropyEnable ? VK_TRUE : VK_FALSE, /* anisotropy enable */
+        anisotropy, /* max anisotropy */
+/* FIXME: for depth samplers, we need
+ * VkPhysicalDevicePortabilitySubsetFeaturesKHR::mutableComparisonSamplers
         VK_TRUE, vk::CompareOp::eLessOrEqual,
 */
         VK_FALSE, /* compare enable */
-        vk::CompareOp::eAlways, /* compare op */
+        depth ? vk::CompareOp::eAlways : vk::CompareOp::eNever, /* compare op */
         0, /* min LOD */
         0, /* max LOD */
         info.borderColor, /* borderColor */
         VK_FALSE); /* unnormalized coordinates */
 
-    return this->_device.createSampler(samplerInfo);
+    auto sampler = this->_device.createSampler(samplerInfo);
+    this->_samplers.insert({key, sampler});
+
+    return sampler;
 }
 
 vk::Pipeline Application::createPipeline (
@@ -621,31 +778,134 @@ vk::Pipeline Application::createPipeline (
     uint32_t subPass,
     vk::ArrayProxy<vk::DynamicState> const &dynamic)
 {
-    vk::PipelineInputAssemblyStateCreateInfo asmInfo(
+    return this->_createPipeline(
+        shaders, vertexInfo, prim, primRestart, 0,
+        viewports, scissors, depthClamp, polyMode, cullMode, front,
+        layout, renderPass, subPass, dynamic);
+}
+
+vk::Pipeline Application::createTessellationPipeline (
+    cs237::Shaders *shaders,
+    vk::PipelineVertexInputStateCreateInfo const &vertexInfo,
+    uint32_t patchSz,
+    vk::ArrayProxy<vk::Viewport> const &viewports,
+    vk::ArrayProxy<vk::Rect2D> const &scissors,
+    vk::PolygonMode polyMode,
+    vk::CullModeFlags cullMode,
+    vk::FrontFace front,
+    vk::PipelineLayout layout,
+    vk::RenderPass renderPass,
+    uint32_t subPass,
+    vk::ArrayProxy<vk::DynamicState> const &dynamic)
+{
+    if ((patchSz == 0) || (patchSz > this->props()->limits.maxTessellationPatchSize)) {
+        ERROR("invalid number of control points per patch");
+    }
+
+    return this->_createPipeline(
+        shaders, vertexInfo, vk::PrimitiveTopology::ePatchList, false, patchSz,
+        viewports, scissors, false, polyMode, cullMode, front,
+        layout, renderPass, subPass, dynamic);
+}
+
+vk::Pipeline Application::_createPipeline (
+    cs237::Shaders *shaders,
+    vk::PipelineVertexInputStateCreateInfo const &vertexInfo,
+    vk::PrimitiveTopology prim,
+    bool primRestart,
+    uint32_t patchSz,
+    vk::ArrayProxy<vk::Viewport> const &viewports,
+    vk::ArrayProxy<vk::Rect2D> const &scissors,
+    bool depthClamp,
+    vk::PolygonMode polyMode,
+    vk::CullModeFlags cullMode,
+    vk::FrontFace front,
+    vk::PipelineLayout layout,
+    vk::RenderPass renderPass,
+    uint32_t subPass,
+    vk::ArrayProxy<vk::DynamicState> const &dynamic)
+{
+    std::vector<PipelineDesc> descs(1);
+    PipelineDesc &desc = descs[0];
+    desc.shaders = shaders;
+    desc.vertexInfo = vertexInfo;
+    desc.prim = prim;
+    desc.primRestart = primRestart;
+    desc.patchSz = patchSz;
+    // the data pointers are nullptr when the viewports and scissors are dynamic
+    desc.viewports = (viewports.data() == nullptr)
+        ? std::vector<vk::Viewport>(viewports.size())
+        : std::vector<vk::Viewport>(viewports.begin(), viewports.end());
+    desc.scissors = (scissors.data() == nullptr)
+        ? std::vector<vk::Rect2D>(scissors.size())
+        : std::vector<vk::Rect2D>(scissors.begin(), scissors.end());
+    desc.depthClamp = depthClamp;
+    desc.polyMode = polyMode;
+    desc.cullMode = cullMode;
+    desc.front = front;
+    desc.layout = layout;
+    desc.renderPass = renderPass;
+    desc.subPass = subPass;
+    desc.dynamic = std::vector<vk::DynamicState>(dynamic.begin(), dynamic.end());
+
+    return this->createPipelines(descs)[0];
+}
+
+/// The state that is referenced by the create info for a graphics pipeline;
+/// it must live until the pipeline has been created.
+struct PipelineState {
+    std::vector<vk::PipelineShaderStageCreateInfo> stages;
+    vk::PipelineInputAssemblyStateCreateInfo asmInfo;
+    vk::PipelineTessellationStateCreateInfo tessInfo;
+    vk::PipelineViewportStateCreateInfo viewportState;
+    vk::PipelineRasterizationStateCreateInfo rasterizer;
+    vk::PipelineMultisampleStateCreateInfo multisampling;
+    vk::PipelineDepthStencilStateCreateInfo depthStencil;
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment;
+    vk::PipelineColorBlendStateCreateInfo colorBlending;
+    vk::PipelineDynamicStateCreateInfo dynamicState;
+
+    /// initialize the state for a pipeline description
+    /// \return the create info for the pipeline, which points to this state
+    ///         and to the description
+    vk::GraphicsPipelineCreateInfo init (Application::PipelineDesc const &desc);
+};
+
+vk::GraphicsPipelineCreateInfo PipelineState::init (Application::PipelineDesc const &desc)
+{
+    this->stages = (desc.specConsts != nullptr)
+        ? desc.shaders->stages(*desc.specConsts)
+        : desc.shaders->stages();
+
+    this->asmInfo = vk::PipelineInputAssemblyStateCreateInfo(
+        {}, /* flags */
+        desc.prim, /* topology */
+        desc.primRestart ? VK_TRUE : VK_FALSE); /* primitive restart */
+
+    this->tessInfo = vk::PipelineTessellationStateCreateInfo(
         {}, /* flags */
-        prim, /* topology */
-        primRestart ? VK_TRUE : VK_FALSE); /* primitive restart */
+        desc.patchSz); /* patch control points */
 
-    vk::PipelineViewportStateCreateInfo viewportState(
+    this->viewportState = vk::PipelineViewportStateCreateInfo(
         {}, /* flags */
-        viewports, /* viewport */
-        scissors); /* scissor rects */
+        desc.viewports, /* viewport */
+        desc.scissors); /* scissor rects */
 
-    vk::PipelineRasterizationStateCreateInfo rasterizer(
+    this->rasterizer = vk::PipelineRasterizationStateCreateInfo(
         {},
-        depthClamp ? VK_TRUE : VK_FALSE, /* depth clamp */
+        desc.depthClamp ? VK_TRUE : VK_FALSE, /* depth clamp */
         VK_FALSE, /* rasterizer discard */
-        polyMode, /* polygon mode */
-        cullMode, /* cull mode */
-        front, /* front face orientation */
+        desc.polyMode, /* polygon mode */
+        desc.cullMode, /* cull mode */
+        desc.front, /* front face orientation */
         VK_FALSE, /* depth bias enable */
         0.0f, 0.0f, 0.0f, /* depth bias: constant, clamp, and slope */
         1.0f); /* line width */
 
     // no multisampling, which is the default
-    vk::PipelineMultisampleStateCreateInfo multisampling{};
+    this->multisampling = vk::PipelineMultisampleStateCreateInfo{};
 
-    vk::PipelineDepthStencilStateCreateInfo depthStencil(
+    this->depthStencil = vk::PipelineDepthStencilStateCreateInfo(
         {}, /* flags */
         VK_TRUE, /* depth-test enable */
         VK_TRUE, /* depth-write enable */
@@ -654,7 +914,7 @@ vk::Pipeline Application::createPipeline (
         VK_FALSE); /* stencil-test enable */
         /* defaults for remaining fields */
 
-    vk::PipelineColorBlendAttachmentState colorBlendAttachment(
+    this->colorBlendAttachment = vk::PipelineColorBlendAttachmentState(
         VK_FALSE, /* blend enable */
         vk::BlendFactor::eZero, vk::BlendFactor::eZero,
         vk::BlendOp::eAdd, /* color blend op */
@@ -662,63 +922,364 @@ vk::Pipeline Application::createPipeline (
         vk::BlendOp::eAdd, /* alpha blend op */
         vk::FlagTraits<vk::ColorComponentFlagBits>::allFlags); /* color write mask */
 
-    vk::PipelineColorBlendStateCreateInfo colorBlending(
+    this->colorBlending = vk::PipelineColorBlendStateCreateInfo(
         {}, /* flags */
         VK_FALSE, /* logic-op enable */
         vk::LogicOp::eClear, /* logic op */
-        colorBlendAttachment, /* attachments */
+        this->colorBlendAttachment, /* attachments */
         { 0.0f, 0.0f, 0.0f, 0.0f }); /* blend constants */
 
-    vk::PipelineDynamicStateCreateInfo dynamicState(
+    this->dynamicState = vk::PipelineDynamicStateCreateInfo(
         {}, /* flags */
-        dynamic);
+        desc.dynamic);
 
-    vk::GraphicsPipelineCreateInfo pipelineInfo(
+    return vk::GraphicsPipelineCreateInfo(
         {}, /* flags */
-        shaders->stages(), /* stages */
-        &vertexInfo, /* vertex-input state */
-        &asmInfo, /* input-assembly state */
-        {}, /* tesselation state */
-        &viewportState, /* viewport state */
-        &rasterizer, /* rasterization state */
-        &multisampling, /* multisample state */
-        &depthStencil, /* depth-stencil state */
-        &colorBlending, /* color-blend state */
-        &dynamicState, /* dynamic state */
-        layout, /* layout */
-        renderPass, /* render pass */
-        0, /* subpass */
+        this->stages, /* stages */
+        &desc.vertexInfo, /* vertex-input state */
+        &this->asmInfo, /* input-assembly state */
+        (desc.patchSz > 0) ? &this->tessInfo : nullptr, /* tesselation state */
+        &this->viewportState, /* viewport state */
+        &this->rasterizer, /* rasterization state */
+        &this->multisampling, /* multisample state */
+        &this->depthStencil, /* depth-stencil state */
+        &this->colorBlending, /* color-blend state */
+        &this->dynamicState, /* dynamic state */
+        desc.layout, /* layout */
+        desc.renderPass, /* render pass */
+        desc.subPass, /* subpass */
         nullptr); /* base pipeline */
+}
+
+std::vector<vk::Pipeline> Application::createPipelines (std::vector<PipelineDesc> const &descs)
+{
+    size_t n = descs.size();
+    std::vector<vk::Pipeline> pipes(n);
+    if (n == 0) {
+        return pipes;
+    }
 
-    // create the pipeline
-    auto pipes = this->device().createGraphicsPipelines(
-        nullptr,
-        pipelineInfo);
-    if (pipes.result != vk::Result::eSuccess) {
+    std::vector<PipelineState> states(n);
+    std::vector<vk::GraphicsPipelineCreateInfo> infos(n);
+    for (size_t i = 0;  i < n;  ++i) {
+        if ((descs[i].patchSz > 0) && !this->_tessellation) {
+            ERROR("tessellation shaders are not supported by the device");
+        }
+        infos[i] = states[i].init(descs[i]);
+    }
+
+    // we split the pipelines into contiguous batches, one per thread, and
+    // create each batch with a single call on the job system.  The pipeline
+    // cache is internally synchronized, so the batches can share it.  A
+    // single pipeline is created inline, so that applications that do not
+    // otherwise use the job system do not start its threads.
+    uint32_t nBatches = (n == 1) ? 1 : std::min(uint32_t(n), this->jobs().numThreads());
+    std::vector<char> failed(nBatches, 0);
+    auto batch = [&](uint32_t id) {
+        size_t lo = (id * n) / nBatches;
+        size_t hi = ((id + 1) * n) / nBatches;
+        try {
+            auto result = this->_device.createGraphicsPipelines(
+                this->_pipelineCache,
+                vk::ArrayProxy<const vk::GraphicsPipelineCreateInfo>(
+                    uint32_t(hi - lo), infos.data() + lo));
+            if (result.result == vk::Result::eSuccess) {
+                std::copy (result.value.begin(), result.value.end(), pipes.begin() + lo);
+            } else {
+                failed[id] = 1;
+            }
+        } catch (vk::SystemError const &) {
+            failed[id] = 1;
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    if (nBatches == 1) {
+        batch (0);
+    } else {
+        this->jobs().parallelFor (0, nBatches, 1, [&](uint32_t lo, uint32_t hi) {
+            for (uint32_t id = lo;  id < hi;  ++id) {
+                batch (id);
+            }
+        });
+    }
+    this->_nPipelines += n;
+    this->_pipelineTime += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    if (std::find(failed.begin(), failed.end(), 1) != failed.end()) {
+        // destroy the pipelines from the batches that succeeded
+        for (auto pipe : pipes) {
+            if (pipe) {
+                this->_device.destroyPipeline (pipe);
+            }
+        }
         ERROR("unable to create graphics pipeline!");
     }
-    return pipes.value[0];
+
+    return pipes;
+}
+
+vk::Pipeline Application::createComputePipeline (
+    cs237::Shaders *shaders,
+    vk::PipelineLayout layout,
+    cs237::SpecConstants const *consts)
+{
+    if ((shaders->numStages() != 1)
+    || (shaders->stages()[0].stage != vk::ShaderStageFlagBits::eCompute)) {
+        ERROR("compute pipeline requires a single compute shader");
+    }
+
+    auto stages = (consts != nullptr) ? shaders->stages(*consts) : shaders->stages();
+    vk::ComputePipelineCreateInfo pipelineInfo(
+        {}, /* flags */
+        stages[0], /* stage */
+        layout, /* layout */
+        nullptr, /* base pipeline */
+        -1); /* base pipeline index */
+
+    auto start = std::chrono::steady_clock::now();
+    auto pipe = this->device().createComputePipeline(this->_pipelineCache, pipelineInfo);
+    this->_nPipelines++;
+    this->_pipelineTime += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    if (pipe.result != vk::Result::eSuccess) {
+        ERROR("unable to create compute pipeline!");
+    }
+    return pipe.value;
+}
+
+/******************** reflected layouts ********************/
+
+vk::DescriptorSetLayout Application::descriptorSetLayout (
+    std::vector<vk::DescriptorSetLayoutBinding> const &bindings)
+{
+    // sort the bindings so that the key does not depend on their order
+    std::vector<vk::DescriptorSetLayoutBinding> sorted = bindings;
+    std::sort (sorted.begin(), sorted.end(),
+        [](vk::DescriptorSetLayoutBinding const &a, vk::DescriptorSetLayoutBinding const &b) {
+            return a.binding < b.binding;
+        });
+
+    std::vector<uint32_t> key;
+    key.reserve(4 * sorted.size());
+    for (auto const &b : sorted) {
+        if (b.pImmutableSamplers != nullptr) {
+            ERROR("cached descriptor-set layouts do not support immutable samplers");
+        }
+        key.push_back(b.binding);
+        key.push_back(static_cast<uint32_t>(b.descriptorType));
+        key.push_back(b.descriptorCount);
+        key.push_back(static_cast<uint32_t>(b.stageFlags));
+    }
+
+    auto it = this->_dsLayouts.find(key);
+    if (it != this->_dsLayouts.end()) {
+        return it->second;
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutInfo({}, sorted);
+    auto layout = this->_device.createDescriptorSetLayout(layoutInfo);
+    this->_dsLayouts.insert({key, layout});
+
+    return layout;
+}
+
+std::vector<vk::DescriptorSetLayout> Application::descriptorSetLayouts (
+    PipelineInterface const &iface)
+{
+    std::vector<vk::DescriptorSetLayout> layouts;
+    layouts.reserve(iface.numSets());
+    for (uint32_t set = 0;  set < iface.numSets();  ++set) {
+        auto bindings = iface.setBindings(set);
+        if ((this->_bindlessTxts != nullptr)
+        && (bindings.size() == 1)
+        && (bindings[0].binding == BindlessTextures::kBinding)
+        && (bindings[0].descriptorType == vk::DescriptorType::eCombinedImageSampler)
+        && (bindings[0].descriptorCount == 0)) {
+            // a runtime-sized texture array is the bindless table
+            layouts.push_back(this->_bindlessTxts->layout());
+        } else {
+            layouts.push_back(this->descriptorSetLayout(bindings));
+        }
+    }
+    return layouts;
+}
+
+BindlessTextures *Application::enableBindless (uint32_t maxTextures)
+{
+    if (! this->_bindless) {
+        ERROR("bindless textures are not supported by the device");
+    }
+
+    if (this->_bindlessTxts == nullptr) {
+        // clamp the capacity to the device limits.  A combined image sampler
+        // counts against both the sampler and the sampled-image limits, as
+        // well as the per-stage limit on resources
+        auto props = this->_gpu.getProperties2<
+            vk::PhysicalDeviceProperties2,
+            vk::PhysicalDeviceVulkan12Properties>();
+        auto const &props12 = props.get<vk::PhysicalDeviceVulkan12Properties>();
+        uint32_t limit = std::min({
+            props12.maxDescriptorSetUpdateAfterBindSampledImages,
+            props12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            props12.maxDescriptorSetUpdateAfterBindSamplers,
+            props12.maxPerStageDescriptorUpdateAfterBindSamplers,
+            props12.maxPerStageUpdateAfterBindResources
+        });
+        this->_bindlessTxts = new BindlessTextures(this, std::min(maxTextures, limit));
+    }
+
+    return this->_bindlessTxts;
+}
+
+vk::PipelineLayout Application::createPipelineLayout (PipelineInterface const &iface)
+{
+    std::vector<vk::PushConstantRange> pcrs;
+    if (iface.pushConstants().size > 0) {
+        pcrs.push_back(iface.pushConstants());
+    }
+
+    return this->createPipelineLayout(this->descriptorSetLayouts(iface), pcrs);
+}
+
+/******************** pipeline cache ********************/
+
+/// The header of a pipeline-cache file, which is followed by the cache data.
+/// The data is only valid for the device and driver that produced it, so we
+/// record their identity and ignore files that do not match.
+struct PipelineCacheHeader {
+    char magic[8];                      ///< identifies the file format
+    uint32_t vendorID;                  ///< the device's vendor ID
+    uint32_t deviceID;                  ///< the device ID
+    uint32_t driverVersion;             ///< the driver version
+    uint32_t dataSize;                  ///< the size of the cache data in bytes
+    uint8_t cacheUUID[VK_UUID_SIZE];    ///< the device's pipeline-cache UUID
+};
+
+static const char kCacheMagic[8] = "cs237pc";
+
+/// make a pipeline-cache header for the device
+static PipelineCacheHeader cacheHeader (vk::PhysicalDeviceProperties const *props, size_t sz)
+{
+    PipelineCacheHeader hdr;
+    std::memcpy (hdr.magic, kCacheMagic, sizeof(hdr.magic));
+    hdr.vendorID = props->vendorID;
+    hdr.deviceID = props->deviceID;
+    hdr.driverVersion = props->driverVersion;
+    hdr.dataSize = sz;
+    std::memcpy (hdr.cacheUUID, props->pipelineCacheUUID.data(), VK_UUID_SIZE);
+    return hdr;
+}
+
+std::string Application::_pipelineCacheFile () const
+{
+    // the file is named for the application, with any characters other than
+    // letters and digits replaced by '-'
+    std::string name = this->_name;
+    for (auto &c : name) {
+        if (! std::isalnum(static_cast<unsigned char>(c))) {
+            c = '-';
+        }
+    }
+    return std::string(CS237_BINARY_DIR) + "/cache/" + name + ".pcache";
+}
+
+void Application::_loadPipelineCache ()
+{
+    std::vector<char> data;
+
+    std::string file = this->_pipelineCacheFile();
+    std::ifstream inS(file, std::ios::binary);
+    if (inS.is_open()) {
+        // the data size must match the size of the file, so that a corrupted
+        // header does not cause a huge allocation
+        std::error_code ec;
+        uintmax_t fileSz = std::filesystem::file_size(file, ec);
+        PipelineCacheHeader expect = cacheHeader(this->props(), 0);
+        PipelineCacheHeader hdr;
+        if (!ec && inS.read(reinterpret_cast<char *>(&hdr), sizeof(hdr))
+        && (uintmax_t(hdr.dataSize) + sizeof(hdr) == fileSz)
+        && (std::memcmp(hdr.magic, expect.magic, sizeof(hdr.magic)) == 0)
+        && (hdr.vendorID == expect.vendorID)
+        && (hdr.deviceID == expect.deviceID)
+        && (hdr.driverVersion == expect.driverVersion)
+        && (std::memcmp(hdr.cacheUUID, expect.cacheUUID, VK_UUID_SIZE) == 0)) {
+            data.resize(hdr.dataSize);
+            if (! inS.read(data.data(), data.size())) {
+                // truncated file
+                data.clear();
+            }
+        }
+    }
+
+    vk::PipelineCacheCreateInfo cacheInfo(
+        {}, /* flags */
+        data.size(), /* initial data size */
+        data.data()); /* initial data */
+    this->_pipelineCache = this->_device.createPipelineCache(cacheInfo);
+    this->_warmCache = !data.empty();
+
+}
+
+void Application::_savePipelineCache ()
+{
+    auto data = this->_device.getPipelineCacheData(this->_pipelineCache);
+    this->_device.destroyPipelineCache(this->_pipelineCache);
+
+    if (data.empty()) {
+        return;
+    }
+
+    std::filesystem::path path(this->_pipelineCacheFile());
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    if (ec) {
+        std::cerr << "warning: unable to create directory " << path.parent_path()
+            << " for the pipeline cache\n";
+        return;
+    }
+
+    // we write a temporary file and then rename it, so that other instances of
+    // the application never see a partially written cache.  The temporary file
+    // is in the same directory (so that the rename is atomic) and its name
+    // includes the process ID, so that concurrent runs do not share it.
+    std::filesystem::path tmpPath = path;
+    tmpPath += "." + std::to_string(getpid()) + ".tmp";
+    PipelineCacheHeader hdr = cacheHeader(this->props(), data.size());
+    std::ofstream outS(tmpPath, std::ios::binary | std::ios::trunc);
+    bool ok = outS.is_open()
+        && outS.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr))
+        && outS.write(reinterpret_cast<const char *>(data.data()), data.size());
+    outS.close();
+    if (ok) {
+        std::filesystem::rename(tmpPath, path, ec);
+        ok = !ec;
+    }
+    if (! ok) {
+        std::cerr << "warning: unable to write pipeline cache " << path << "\n";
+        std::filesystem::remove(tmpPath, ec);
+    }
+
 }
 
 /******************** local utility functions ********************/
 
 // A helper function for determining the extensions that are required
 // when creating an instance. These include the extensions required
-// by GLFW and the extensions required for debugging support when
-// `debug` is true.
+// by GLFW (unless `headless` is true, since we do not need a surface)
+// and the extensions required for debugging support when `debug` is true.
 //
-static std::vector<const char *> requiredExtensions (bool debug)
+static std::vector<const char *> requiredExtensions (bool debug, bool headless)
 {
-    uint32_t extCount;
-
-    // extensions required by GLFW
-    const char **glfwReqExts = glfwGetRequiredInstanceExtensions(&extCount);
-
-    // in debug mode we need the debug utilities
-    uint32_t debugExtCount = debug ? 1 : 0;
+    std::vector<const char *> reqExts;
 
     // initialize the vector of extensions with the GLFW extensions
-    std::vector<const char *> reqExts (glfwReqExts, glfwReqExts+extCount);
+    if (! headless) {
+        uint32_t extCount;
+        const char **glfwReqExts = glfwGetRequiredInstanceExtensions(&extCount);
+        reqExts.assign (glfwReqExts, glfwReqExts+extCount);
+    }
 
     reqExts.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
     reqExts.push_back("VK_KHR_get_physical_device_properties2");
@@ -745,9 +1306,13 @@ bool Application::_getQIndices (vk::PhysicalDevice dev)
         && (qFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics)) {
             indices.graphics = i;
         }
-        // check for presentation support
+        // check for presentation support; when headless, "presenting" is
+        // done by the graphics queue
         if (indices.present < 0) {
-            if (glfwGetPhysicalDevicePresentationSupport(this->_instance, dev, i)) {
+            if (this->_headless) {
+                indices.present = indices.graphics;
+            }
+            else if (glfwGetPhysicalDevicePresentationSupport(this->_instance, dev, i)) {
                 indices.present = i;
             }
         }
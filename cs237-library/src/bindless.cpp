@@ -0,0 +1,100 @@
+/*! \file bindless.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+
+namespace cs237 {
+
+BindlessTextures::BindlessTextures (Application *app, uint32_t capacity)
+  : _app(app), _capacity(capacity), _highWater(0)
+{
+    auto device = app->device();
+
+    // the array is partially bound (unused slots are never written) and
+    // can be updated while it is bound
+    vk::DescriptorSetLayoutBinding binding(
+        kBinding, /* binding */
+        vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+        capacity, /* descriptor count */
+        vk::ShaderStageFlagBits::eAll, /* stages */
+        nullptr); /* immutable samplers */
+    vk::DescriptorBindingFlags bindingFlags =
+        vk::DescriptorBindingFlagBits::ePartiallyBound
+        | vk::DescriptorBindingFlagBits::eUpdateAfterBind;
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo(bindingFlags);
+    vk::DescriptorSetLayoutCreateInfo layoutInfo(
+        vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, /* flags */
+        binding, /* bindings */
+        &flagsInfo); /* next */
+    this->_layout = device.createDescriptorSetLayout(layoutInfo);
+
+    vk::DescriptorPoolSize poolSz(vk::DescriptorType::eCombinedImageSampler, capacity);
+    vk::DescriptorPoolCreateInfo poolInfo(
+        vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, /* flags */
+        1, /* max sets */
+        poolSz); /* pool sizes */
+    this->_pool = device.createDescriptorPool(poolInfo);
+
+    vk::DescriptorSetAllocateInfo allocInfo(this->_pool, this->_layout);
+    this->_descSet = device.allocateDescriptorSets(allocInfo)[0];
+
+}
+
+BindlessTextures::~BindlessTextures ()
+{
+    auto device = this->_app->device();
+    device.destroyDescriptorPool(this->_pool);
+    device.destroyDescriptorSetLayout(this->_layout);
+}
+
+uint32_t BindlessTextures::add (__detail::TextureBase const *txt, vk::Sampler sampler)
+{
+    uint32_t idx;
+    if (! this->_free.empty()) {
+        idx = this->_free.back();
+        this->_free.pop_back();
+        this->_live[idx] = true;
+    } else if (this->_highWater < this->_capacity) {
+        idx = this->_highWater++;
+        this->_live.push_back(true);
+    } else {
+        ERROR("bindless texture table is full");
+    }
+
+    vk::DescriptorImageInfo imageInfo(
+        sampler,
+        txt->view(),
+        vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::WriteDescriptorSet write(
+        this->_descSet, /* descriptor set */
+        kBinding, /* binding */
+        idx, /* array element */
+        vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+        imageInfo, /* image info */
+        nullptr, /* buffer info */
+        nullptr); /* texel buffer view */
+    this->_app->device().updateDescriptorSets(write, nullptr);
+
+    return idx;
+}
+
+void BindlessTextures::remove (uint32_t idx)
+{
+    // removing a slot twice would put it on the free list twice
+    assert (this->isLive(idx) && "texture removed twice");
+    // the slot is partially bound, so the stale descriptor is harmless as long
+    // as the shaders do not use the index
+    this->_live[idx] = false;
+    this->_free.push_back(idx);
+}
+
+} // namespace cs237
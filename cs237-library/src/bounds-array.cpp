@@ -0,0 +1,430 @@
+/*! \file bounds-array.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * Batched culling of bounding boxes.  We provide AVX2 (8 boxes per iteration),
+ * SSE2 and NEON (4 boxes per iteration), and scalar implementations of the
+ * culling kernels; the choice is made at compile time.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define CS237_CULL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define CS237_CULL_SSE2
+#elif defined(__aarch64__)
+#  include <arm_neon.h>
+#  define CS237_CULL_NEON
+#endif
+
+namespace cs237 {
+
+namespace {
+
+/// the frustum planes broken out into separate coefficients, which is the
+/// form that the kernels want for broadcasting
+struct PlaneCoeffs {
+    float nx[6], ny[6], nz[6], d[6];    ///< plane equations
+    float ax[6], ay[6], az[6];          ///< absolute values of the normal components
+
+    explicit PlaneCoeffs (Frustumf_t const &f)
+    {
+        for (int i = 0;  i < 6;  ++i) {
+            glm::vec4 const &nd = f.plane(i)._nd;
+            this->nx[i] = nd.x; this->ny[i] = nd.y; this->nz[i] = nd.z; this->d[i] = nd.w;
+            this->ax[i] = std::abs(nd.x);
+            this->ay[i] = std::abs(nd.y);
+            this->az[i] = std::abs(nd.z);
+        }
+    }
+};
+
+/// append the indices of the set bits in `mask` to the `visible` array.  We
+/// use a branch-free loop, since the mask bits are not predictable.
+inline uint32_t compact (
+    uint32_t mask, uint32_t base, uint32_t nLanes,
+    uint32_t *visible, uint32_t nv)
+{
+    for (uint32_t j = 0;  j < nLanes;  ++j) {
+        visible[nv] = base + j;
+        nv += (mask >> j) & 1;
+    }
+    return nv;
+}
+
+} // anonymous namespace
+
+void BoundsArray::reserve (uint32_t n)
+{
+    size_t padded = (n + kBatchSz - 1) & ~size_t(kBatchSz - 1);
+    this->_minX.reserve(padded); this->_maxX.reserve(padded);
+    this->_minY.reserve(padded); this->_maxY.reserve(padded);
+    this->_minZ.reserve(padded); this->_maxZ.reserve(padded);
+}
+
+void BoundsArray::resize (uint32_t n)
+{
+    size_t padded = (n + kBatchSz - 1) & ~size_t(kBatchSz - 1);
+    this->_minX.resize(padded, kEmpty); this->_maxX.resize(padded, -kEmpty);
+    this->_minY.resize(padded, kEmpty); this->_maxY.resize(padded, -kEmpty);
+    this->_minZ.resize(padded, kEmpty); this->_maxZ.resize(padded, -kEmpty);
+    // when shrinking, the padding slots may hold old boxes
+    for (size_t i = n;  i < padded;  ++i) {
+        this->_setEmpty (i);
+    }
+    this->_n = n;
+}
+
+/***** AVX2 kernels *****/
+#if defined(CS237_CULL_AVX2)
+
+uint32_t BoundsArray::cullBoxes (
+    Frustumf_t const &f, uint32_t first, uint32_t n,
+    uint32_t *visible) const
+{
+    assert ((first % kBatchSz) == 0);
+    assert (first + n <= this->_n);
+
+    PlaneCoeffs p(f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    uint32_t nv = 0;
+    for (uint32_t i = first;  i < first + n;  i += 8) {
+        __m256 minX = _mm256_loadu_ps(&this->_minX[i]);
+        __m256 maxX = _mm256_loadu_ps(&this->_maxX[i]);
+        __m256 minY = _mm256_loadu_ps(&this->_minY[i]);
+        __m256 maxY = _mm256_loadu_ps(&this->_maxY[i]);
+        __m256 minZ = _mm256_loadu_ps(&this->_minZ[i]);
+        __m256 maxZ = _mm256_loadu_ps(&this->_maxZ[i]);
+        __m256 cx = _mm256_mul_ps(_mm256_add_ps(maxX, minX), half);
+        __m256 cy = _mm256_mul_ps(_mm256_add_ps(maxY, minY), half);
+        __m256 cz = _mm256_mul_ps(_mm256_add_ps(maxZ, minZ), half);
+        __m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+        __m256 ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+        __m256 ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+        // in the mask, a lane is set if the box is inside all of the planes tested so far
+        __m256 in = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int j = 0;  j < 6;  ++j) {
+            // s + r, where s is the signed distance of the center and r is the
+            // projected radius of the box
+            __m256 s = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(p.nx[j]), cx),
+                    _mm256_mul_ps(_mm256_set1_ps(p.ny[j]), cy)),
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(p.nz[j]), cz),
+                    _mm256_set1_ps(p.d[j])));
+            __m256 r = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(p.ax[j]), ex),
+                    _mm256_mul_ps(_mm256_set1_ps(p.ay[j]), ey)),
+                _mm256_mul_ps(_mm256_set1_ps(p.az[j]), ez));
+            in = _mm256_and_ps(in, _mm256_cmp_ps(_mm256_add_ps(s, r), zero, _CMP_GE_OQ));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(in));
+        nv = compact (mask, i, std::min(8u, first + n - i), visible, nv);
+    }
+    return nv;
+}
+
+uint32_t BoundsArray::cullSpheres (
+    Frustumf_t const &f, uint32_t first, uint32_t n,
+    uint32_t *visible) const
+{
+    assert ((first % kBatchSz) == 0);
+    assert (first + n <= this->_n);
+
+    PlaneCoeffs p(f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    uint32_t nv = 0;
+    for (uint32_t i = first;  i < first + n;  i += 8) {
+        __m256 minX = _mm256_loadu_ps(&this->_minX[i]);
+        __m256 maxX = _mm256_loadu_ps(&this->_maxX[i]);
+        __m256 minY = _mm256_loadu_ps(&this->_minY[i]);
+        __m256 maxY = _mm256_loadu_ps(&this->_maxY[i]);
+        __m256 minZ = _mm256_loadu_ps(&this->_minZ[i]);
+        __m256 maxZ = _mm256_loadu_ps(&this->_maxZ[i]);
+        __m256 cx = _mm256_mul_ps(_mm256_add_ps(maxX, minX), half);
+        __m256 cy = _mm256_mul_ps(_mm256_add_ps(maxY, minY), half);
+        __m256 cz = _mm256_mul_ps(_mm256_add_ps(maxZ, minZ), half);
+        __m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+        __m256 ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+        __m256 ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+        __m256 rad = _mm256_sqrt_ps(_mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(ex, ex), _mm256_mul_ps(ey, ey)),
+            _mm256_mul_ps(ez, ez)));
+        // empty boxes have negative extents
+        __m256 in = _mm256_cmp_ps(ex, zero, _CMP_GE_OQ);
+        for (int j = 0;  j < 6;  ++j) {
+            __m256 s = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(p.nx[j]), cx),
+                    _mm256_mul_ps(_mm256_set1_ps(p.ny[j]), cy)),
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(p.nz[j]), cz),
+                    _mm256_set1_ps(p.d[j])));
+            in = _mm256_and_ps(in, _mm256_cmp_ps(_mm256_add_ps(s, rad), zero, _CMP_GE_OQ));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(in));
+        nv = compact (mask, i, std::min(8u, first + n - i), visible, nv);
+    }
+    return nv;
+}
+
+/***** SSE2 kernels *****/
+#elif defined(CS237_CULL_SSE2)
+
+uint32_t BoundsArray::cullBoxes (
+    Frustumf_t const &f, uint32_t first, uint32_t n,
+    uint32_t *visible) const
+{
+    assert ((first % kBatchSz) == 0);
+    assert (first + n <= this->_n);
+
+    PlaneCoeffs p(f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    uint32_t nv = 0;
+    for (uint32_t i = first;  i < first + n;  i += 4) {
+        __m128 minX = _mm_loadu_ps(&this->_minX[i]);
+        __m128 maxX = _mm_loadu_ps(&this->_maxX[i]);
+        __m128 minY = _mm_loadu_ps(&this->_minY[i]);
+        __m128 maxY = _mm_loadu_ps(&this->_maxY[i]);
+        __m128 minZ = _mm_loadu_ps(&this->_minZ[i]);
+        __m128 maxZ = _mm_loadu_ps(&this->_maxZ[i]);
+        __m128 cx = _mm_mul_ps(_mm_add_ps(maxX, minX), half);
+        __m128 cy = _mm_mul_ps(_mm_add_ps(maxY, minY), half);
+        __m128 cz = _mm_mul_ps(_mm_add_ps(maxZ, minZ), half);
+        __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+        __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+        __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+        __m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int j = 0;  j < 6;  ++j) {
+            __m128 s = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(p.nx[j]), cx),
+                    _mm_mul_ps(_mm_set1_ps(p.ny[j]), cy)),
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(p.nz[j]), cz),
+                    _mm_set1_ps(p.d[j])));
+            __m128 r = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(p.ax[j]), ex),
+                    _mm_mul_ps(_mm_set1_ps(p.ay[j]), ey)),
+                _mm_mul_ps(_mm_set1_ps(p.az[j]), ez));
+            in = _mm_and_ps(in, _mm_cmpge_ps(_mm_add_ps(s, r), zero));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(in));
+        nv = compact (mask, i, std::min(4u, first + n - i), visible, nv);
+    }
+    return nv;
+}
+
+uint32_t BoundsArray::cullSpheres (
+    Frustumf_t const &f, uint32_t first, uint32_t n,
+    uint32_t *visible) const
+{
+    assert ((first % kBatchSz) == 0);
+    assert (first + n <= this->_n);
+
+    PlaneCoeffs p(f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    uint32_t nv = 0;
+    for (uint32_t i = first;  i < first + n;  i += 4) {
+        __m128 minX = _mm_loadu_ps(&this->_minX[i]);
+        __m128 maxX = _mm_loadu_ps(&this->_maxX[i]);
+        __m128 minY = _mm_loadu_ps(&this->_minY[i]);
+        __m128 maxY = _mm_loadu_ps(&this->_maxY[i]);
+        __m128 minZ = _mm_loadu_ps(&this->_minZ[i]);
+        __m128 maxZ = _mm_loadu_ps(&this->_maxZ[i]);
+        __m128 cx = _mm_mul_ps(_mm_add_ps(maxX, minX), half);
+        __m128 cy = _mm_mul_ps(_mm_add_ps(maxY, minY), half);
+        __m128 cz = _mm_mul_ps(_mm_add_ps(maxZ, minZ), half);
+        __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+        __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+        __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+        __m128 rad = _mm_sqrt_ps(_mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)),
+            _mm_mul_ps(ez, ez)));
+        __m128 in = _mm_cmpge_ps(ex, zero);
+        for (int j = 0;  j < 6;  ++j) {
+            __m128 s = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(p.nx[j]), cx),
+                    _mm_mul_ps(_mm_set1_ps(p.ny[j]), cy)),
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(p.nz[j]), cz),
+                    _mm_set1_ps(p.d[j])));
+            in = _mm_and_ps(in, _mm_cmpge_ps(_mm_add_ps(s, rad), zero));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(in));
+        nv = compact (mask, i, std::min(4u, first + n - i), visible, nv);
+    }
+    return nv;
+}
+
+/***** NEON kernels *****/
+#elif defined(CS237_CULL_NEON)
+
+namespace {
+
+/// convert a NEON comparison result to a bit mask
+inline uint32_t movemask (uint32x4_t v)
+{
+    static const uint32_t kBits[4] = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(v, vld1q_u32(kBits)));
+}
+
+} // anonymous namespace
+
+uint32_t BoundsArray::cullBoxes (
+    Frustumf_t const &f, uint32_t first, uint32_t n,
+    uint32_t *visible) const
+{
+    assert ((first % kBatchSz) == 0);
+    assert (first + n <= this->_n);
+
+    PlaneCoeffs p(f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    uint32_t nv = 0;
+    for (uint32_t i = first;  i < first + n;  i += 4) {
+        float32x4_t minX = vld1q_f32(&this->_minX[i]);
+        float32x4_t maxX = vld1q_f32(&this->_maxX[i]);
+        float32x4_t minY = vld1q_f32(&this->_minY[i]);
+        float32x4_t maxY = vld1q_f32(&this->_maxY[i]);
+        float32x4_t minZ = vld1q_f32(&this->_minZ[i]);
+        float32x4_t maxZ = vld1q_f32(&this->_maxZ[i]);
+        float32x4_t cx = vmulq_f32(vaddq_f32(maxX, minX), half);
+        float32x4_t cy = vmulq_f32(vaddq_f32(maxY, minY), half);
+        float32x4_t cz = vmulq_f32(vaddq_f32(maxZ, minZ), half);
+        float32x4_t ex = vmulq_f32(vsubq_f32(maxX, minX), half);
+        float32x4_t ey = vmulq_f32(vsubq_f32(maxY, minY), half);
+        float32x4_t ez = vmulq_f32(vsubq_f32(maxZ, minZ), half);
+        uint32x4_t in = vdupq_n_u32(~0u);
+        for (int j = 0;  j < 6;  ++j) {
+            float32x4_t s = vmlaq_n_f32(vdupq_n_f32(p.d[j]), cx, p.nx[j]);
+            s = vmlaq_n_f32(s, cy, p.ny[j]);
+            s = vmlaq_n_f32(s, cz, p.nz[j]);
+            s = vmlaq_n_f32(s, ex, p.ax[j]);
+            s = vmlaq_n_f32(s, ey, p.ay[j]);
+            s = vmlaq_n_f32(s, ez, p.az[j]);
+            in = vandq_u32(in, vcgeq_f32(s, zero));
+        }
+        nv = compact (movemask(in), i, std::min(4u, first + n - i), visible, nv);
+    }
+    return nv;
+}
+
+uint32_t BoundsArray::cullSpheres (
+    Frustumf_t const &f, uint32_t first, uint32_t n,
+    uint32_t *visible) const
+{
+    assert ((first % kBatchSz) == 0);
+    assert (first + n <= this->_n);
+
+    PlaneCoeffs p(f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    uint32_t nv = 0;
+    for (uint32_t i = first;  i < first + n;  i += 4) {
+        float32x4_t minX = vld1q_f32(&this->_minX[i]);
+        float32x4_t maxX = vld1q_f32(&this->_maxX[i]);
+        float32x4_t minY = vld1q_f32(&this->_minY[i]);
+        float32x4_t maxY = vld1q_f32(&this->_maxY[i]);
+        float32x4_t minZ = vld1q_f32(&this->_minZ[i]);
+        float32x4_t maxZ = vld1q_f32(&this->_maxZ[i]);
+        float32x4_t cx = vmulq_f32(vaddq_f32(maxX, minX), half);
+        float32x4_t cy = vmulq_f32(vaddq_f32(maxY, minY), half);
+        float32x4_t cz = vmulq_f32(vaddq_f32(maxZ, minZ), half);
+        float32x4_t ex = vmulq_f32(vsubq_f32(maxX, minX), half);
+        float32x4_t ey = vmulq_f32(vsubq_f32(maxY, minY), half);
+        float32x4_t ez = vmulq_f32(vsubq_f32(maxZ, minZ), half);
+        float32x4_t rad = vsqrtq_f32(
+            vaddq_f32(vaddq_f32(vmulq_f32(ex, ex), vmulq_f32(ey, ey)), vmulq_f32(ez, ez)));
+        uint32x4_t in = vcgeq_f32(ex, zero);
+        for (int j = 0;  j < 6;  ++j) {
+            float32x4_t s = vmlaq_n_f32(vaddq_f32(vdupq_n_f32(p.d[j]), rad), cx, p.nx[j]);
+            s = vmlaq_n_f32(s, cy, p.ny[j]);
+            s = vmlaq_n_f32(s, cz, p.nz[j]);
+            in = vandq_u32(in, vcgeq_f32(s, zero));
+        }
+        nv = compact (movemask(in), i, std::min(4u, first + n - i), visible, nv);
+    }
+    return nv;
+}
+
+/***** Scalar kernels *****/
+#else
+
+uint32_t BoundsArray::cullBoxes (
+    Frustumf_t const &f, uint32_t first, uint32_t n,
+    uint32_t *visible) const
+{
+    assert ((first % kBatchSz) == 0);
+    assert (first + n <= this->_n);
+
+    PlaneCoeffs p(f);
+    uint32_t nv = 0;
+    for (uint32_t i = first;  i < first + n;  ++i) {
+        float cx = 0.5f * (this->_maxX[i] + this->_minX[i]);
+        float cy = 0.5f * (this->_maxY[i] + this->_minY[i]);
+        float cz = 0.5f * (this->_maxZ[i] + this->_minZ[i]);
+        float ex = 0.5f * (this->_maxX[i] - this->_minX[i]);
+        float ey = 0.5f * (this->_maxY[i] - this->_minY[i]);
+        float ez = 0.5f * (this->_maxZ[i] - this->_minZ[i]);
+        uint32_t in = 1;
+        for (int j = 0;  j < 6;  ++j) {
+            float s = p.nx[j]*cx + p.ny[j]*cy + p.nz[j]*cz + p.d[j]
+                + p.ax[j]*ex + p.ay[j]*ey + p.az[j]*ez;
+            in &= (s >= 0.0f);
+        }
+        visible[nv] = i;
+        nv += in;
+    }
+    return nv;
+}
+
+uint32_t BoundsArray::cullSpheres (
+    Frustumf_t const &f, uint32_t first, uint32_t n,
+    uint32_t *visible) const
+{
+    assert ((first % kBatchSz) == 0);
+    assert (first + n <= this->_n);
+
+    PlaneCoeffs p(f);
+    uint32_t nv = 0;
+    for (uint32_t i = first;  i < first + n;  ++i) {
+        float cx = 0.5f * (this->_maxX[i] + this->_minX[i]);
+        float cy = 0.5f * (this->_maxY[i] + this->_minY[i]);
+        float cz = 0.5f * (this->_maxZ[i] + this->_minZ[i]);
+        float ex = 0.5f * (this->_maxX[i] - this->_minX[i]);
+        float ey = 0.5f * (this->_maxY[i] - this->_minY[i]);
+        float ez = 0.5f * (this->_maxZ[i] - this->_minZ[i]);
+        float rad = std::sqrt(ex*ex + ey*ey + ez*ez);
+        uint32_t in = (ex >= 0.0f);
+        for (int j = 0;  j < 6;  ++j) {
+            float s = p.nx[j]*cx + p.ny[j]*cy + p.nz[j]*cz + p.d[j] + rad;
+            in &= (s >= 0.0f);
+        }
+        visible[nv] = i;
+        nv += in;
+    }
+    return nv;
+}
+
+#endif
+
+} // namespace cs237
@@ -0,0 +1,473 @@
+/*! \file bvh.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * Construction and traversal of bounding-volume hierarchies.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+
+namespace cs237 {
+
+namespace {
+
+/// the number of bins used to evaluate the SAH
+constexpr int kNumBins = 16;
+
+/// the SAH cost of traversing an interior node
+constexpr float kTraversalCost = 1.0f;
+
+/// the SAH cost of testing a primitive in a leaf; this value is small relative to
+/// the traversal cost, since the primitives in a leaf are tested as a batch
+constexpr float kPrimCost = 0.25f;
+
+/// the planes of the frustum that a node must be tested against
+constexpr uint32_t kAllPlanes = (1 << Frustumf_t::kNumPlanes) - 1;
+
+/// \brief test a box against the planes of a frustum that are specified by a mask
+/// \param f     the frustum
+/// \param bb    the box to test
+/// \param mask  on input, the planes to test; on output, the planes that the box
+///              straddles
+/// \return false if the box is outside the frustum
+inline bool testPlanes (Frustumf_t const &f, AABBf_t const &bb, uint32_t &mask)
+{
+    if (bb.isEmpty()) {
+        return false;
+    }
+    glm::vec3 c = 0.5f * (bb._max + bb._min);
+    glm::vec3 e = 0.5f * (bb._max - bb._min);
+    for (int i = 0;  i < Frustumf_t::kNumPlanes;  ++i) {
+        if ((mask & (1 << i)) != 0) {
+            glm::vec4 const &nd = f.plane(i)._nd;
+            float r = e.x * std::abs(nd.x) + e.y * std::abs(nd.y) + e.z * std::abs(nd.z);
+            float s = nd.x * c.x + nd.y * c.y + nd.z * c.z + nd.w;
+            if (s + r < 0.0f) {
+                return false;
+            } else if (s - r >= 0.0f) {
+                // the box is inside this plane, so its descendants are too
+                mask &= ~(1 << i);
+            }
+        }
+    }
+    return true;
+}
+
+/// \brief ray-box intersection using the slab method
+/// \param bb      the box
+/// \param orig    the ray origin
+/// \param invDir  the reciprocal of the ray direction
+/// \param tMax    the maximum ray parameter to consider
+/// \param tEnter  set to the ray parameter where the ray enters the box
+/// \return true if the ray hits the box in the interval [0..tMax]
+inline bool rayHitsBox (
+    AABBf_t const &bb, glm::vec3 const &orig, glm::vec3 const &invDir,
+    float tMax, float &tEnter)
+{
+    if (bb.isEmpty()) {
+        return false;
+    }
+    glm::vec3 t0 = (bb._min - orig) * invDir;
+    glm::vec3 t1 = (bb._max - orig) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float tN = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float tF = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    tEnter = tN;
+    return (tN <= tF);
+}
+
+/// do two non-empty boxes overlap?
+inline bool overlaps (AABBf_t const &a, AABBf_t const &b)
+{
+    return (a._min.x <= b._max.x) && (b._min.x <= a._max.x)
+        && (a._min.y <= b._max.y) && (b._min.y <= a._max.y)
+        && (a._min.z <= b._max.z) && (b._min.z <= a._max.z);
+}
+
+} // anonymous namespace
+
+void BVH::clear ()
+{
+    this->_nPrims = 0;
+    this->_nodes.clear();
+    this->_primBounds.clear();
+    this->_primIds.clear();
+}
+
+void BVH::_makeLeaf (
+    Node &node, std::vector<AABBf_t> const &boxes,
+    uint32_t const *ids, uint32_t n)
+{
+    assert ((0 < n) && (n <= kMaxLeafSz));
+
+    // allocate a batch of slots for the leaf
+    uint32_t slot = this->_primBounds.size();
+    this->_primBounds.resize(slot + BoundsArray::kBatchSz);
+    this->_primIds.resize(slot + BoundsArray::kBatchSz, ~0u);
+
+    node.bbox.clear();
+    node.first = slot;
+    node.count = n;
+    for (uint32_t i = 0;  i < n;  ++i) {
+        uint32_t id = ids[i];
+        this->_primBounds.set(slot + i, boxes[id]);
+        this->_primIds[slot + i] = id;
+        node.bbox += boxes[id];
+    }
+}
+
+void BVH::build (std::vector<AABBf_t> const &boxes)
+{
+    this->clear();
+
+    uint32_t nPrims = boxes.size();
+    if (nPrims == 0) {
+        return;
+    }
+    this->_nPrims = nPrims;
+
+    // the primitive IDs, which get partitioned as we build the tree, and the
+    // box centers that are used to classify the primitives.  Empty boxes are
+    // treated as points at the origin.
+    std::vector<uint32_t> ids(nPrims);
+    std::vector<glm::vec3> centers(nPrims);
+    for (uint32_t i = 0;  i < nPrims;  ++i) {
+        ids[i] = i;
+        centers[i] = boxes[i].isEmpty() ? glm::vec3(0.0f) : boxes[i].center();
+    }
+
+    this->_nodes.reserve(2 * ((nPrims + kMaxLeafSz - 1) / kMaxLeafSz));
+    this->_primBounds.reserve(nPrims + nPrims / 2);
+    this->_nodes.push_back(Node());
+
+    // we use an explicit stack of the nodes to be built, since a poor split
+    // sequence could lead to very deep recursion
+    struct Work {
+        uint32_t nd;            // the node to build
+        uint32_t start;         // the first primitive in `ids`
+        uint32_t n;             // the number of primitives
+    };
+    std::vector<Work> stk;
+    stk.push_back(Work{0, 0, nPrims});
+
+    while (! stk.empty()) {
+        Work w = stk.back();
+        stk.pop_back();
+        uint32_t *nodeIds = ids.data() + w.start;
+
+        // compute the bounds of the node and of the primitive centers
+        AABBf_t bbox, cbox;
+        for (uint32_t i = 0;  i < w.n;  ++i) {
+            bbox += boxes[nodeIds[i]];
+            cbox += centers[nodeIds[i]];
+        }
+
+        // split along the axis with the largest spread of centers
+        glm::vec3 ext = cbox._max - cbox._min;
+        int axis = (ext.x >= ext.y)
+            ? ((ext.x >= ext.z) ? 0 : 2)
+            : ((ext.y >= ext.z) ? 1 : 2);
+        float lo = cbox._min[axis];
+        float spread = ext[axis];
+
+        uint32_t nLeft = 0;
+        if (spread > 0.0f) {
+            // bin the primitives
+            struct Bin { AABBf_t bbox; uint32_t n = 0; };
+            Bin bins[kNumBins];
+            float scale = float(kNumBins) / spread;
+            auto binOf = [&](uint32_t id) {
+                int b = static_cast<int>((centers[id][axis] - lo) * scale);
+                return std::min(b, kNumBins - 1);
+            };
+            for (uint32_t i = 0;  i < w.n;  ++i) {
+                Bin &b = bins[binOf(nodeIds[i])];
+                b.bbox += boxes[nodeIds[i]];
+                b.n++;
+            }
+
+            // sweep from the right to get the costs of the right-hand sides
+            float rightArea[kNumBins];
+            uint32_t rightN[kNumBins];
+            {
+                AABBf_t bb;
+                uint32_t n = 0;
+                for (int i = kNumBins-1;  i > 0;  --i) {
+                    bb += bins[i].bbox;
+                    n += bins[i].n;
+                    rightArea[i] = bb.area();
+                    rightN[i] = n;
+                }
+            }
+
+            // sweep from the left to find the best split, which is between bins
+            // `bestSplit-1` and `bestSplit`.
+            float bestCost = std::numeric_limits<float>::max();
+            int bestSplit = -1;
+            {
+                AABBf_t bb;
+                uint32_t n = 0;
+                for (int i = 1;  i < kNumBins;  ++i) {
+                    bb += bins[i-1].bbox;
+                    n += bins[i-1].n;
+                    if ((n > 0) && (rightN[i] > 0)) {
+                        float cost = bb.area() * float(n) + rightArea[i] * float(rightN[i]);
+                        if (cost < bestCost) {
+                            bestCost = cost;
+                            bestSplit = i;
+                        }
+                    }
+                }
+            }
+
+            // is splitting better than making a leaf?
+            float leafCost = kPrimCost * bbox.area() * float(w.n);
+            bestCost = kTraversalCost * bbox.area() + kPrimCost * bestCost;
+            if ((w.n <= kMaxLeafSz) && (leafCost <= bestCost)) {
+                nLeft = 0;
+            } else if (bestSplit > 0) {
+                uint32_t *mid = std::partition(nodeIds, nodeIds + w.n,
+                    [&](uint32_t id) { return binOf(id) < bestSplit; });
+                nLeft = mid - nodeIds;
+            }
+        }
+
+        if ((w.n > kMaxLeafSz) && ((nLeft == 0) || (nLeft == w.n))) {
+            // we could not find a useful split (e.g., because all of the centers
+            // are the same), so split at the median
+            nLeft = w.n / 2;
+            std::nth_element(nodeIds, nodeIds + nLeft, nodeIds + w.n,
+                [&](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+        }
+
+        if ((nLeft == 0) || (nLeft == w.n)) {
+            this->_makeLeaf (this->_nodes[w.nd], boxes, nodeIds, w.n);
+        } else {
+            // allocate the children, which are stored in adjacent slots
+            uint32_t left = this->_nodes.size();
+            this->_nodes.push_back(Node());
+            this->_nodes.push_back(Node());
+            Node &node = this->_nodes[w.nd];
+            node.bbox = bbox;
+            node.first = left;
+            node.count = 0;
+            stk.push_back(Work{left+1, w.start + nLeft, w.n - nLeft});
+            stk.push_back(Work{left, w.start, nLeft});
+        }
+    }
+}
+
+void BVH::refit (std::vector<AABBf_t> const &boxes)
+{
+    if (boxes.size() != this->_nPrims) {
+        ERROR("BVH::refit: number of boxes does not match");
+    }
+
+    // children always follow their parents, so a reverse traversal of the
+    // nodes visits children before parents
+    for (auto it = this->_nodes.rbegin();  it != this->_nodes.rend();  ++it) {
+        Node &node = *it;
+        if (node.isLeaf()) {
+            node.bbox.clear();
+            for (uint32_t i = node.first;  i < node.first + node.count;  ++i) {
+                AABBf_t const &bb = boxes[this->_primIds[i]];
+                this->_primBounds.set(i, bb);
+                node.bbox += bb;
+            }
+        } else {
+            node.bbox = this->_nodes[node.first].bbox + this->_nodes[node.first+1].bbox;
+        }
+    }
+}
+
+void BVH::_addAll (uint32_t nd, std::vector<uint32_t> &ids) const
+{
+    std::vector<uint32_t> stk;
+    stk.push_back(nd);
+    while (! stk.empty()) {
+        Node const &node = this->_nodes[stk.back()];
+        stk.pop_back();
+        if (node.isLeaf()) {
+            for (uint32_t i = node.first;  i < node.first + node.count;  ++i) {
+                if (! this->_primBounds.isEmpty(i)) {
+                    ids.push_back(this->_primIds[i]);
+                }
+            }
+        } else {
+            stk.push_back(node.first + 1);
+            stk.push_back(node.first);
+        }
+    }
+}
+
+void BVH::cullFrustum (Frustumf_t const &f, std::vector<uint32_t> &visible) const
+{
+    visible.clear();
+    if (this->_nodes.empty()) {
+        return;
+    }
+
+    struct Item {
+        uint32_t nd;            // the node to test
+        uint32_t mask;          // the planes that the node straddles
+    };
+    std::vector<Item> stk;
+    stk.push_back(Item{0, kAllPlanes});
+
+    uint32_t buf[kMaxLeafSz];
+    while (! stk.empty()) {
+        Item item = stk.back();
+        stk.pop_back();
+        Node const &node = this->_nodes[item.nd];
+        uint32_t mask = item.mask;
+        if (! testPlanes (f, node.bbox, mask)) {
+            continue;
+        }
+        if (mask == 0) {
+            // the node is completely inside the frustum
+            this->_addAll (item.nd, visible);
+        } else if (node.isLeaf()) {
+            uint32_t nv = this->_primBounds.cullBoxes(f, node.first, node.count, buf);
+            for (uint32_t i = 0;  i < nv;  ++i) {
+                visible.push_back(this->_primIds[buf[i]]);
+            }
+        } else {
+            stk.push_back(Item{node.first + 1, mask});
+            stk.push_back(Item{node.first, mask});
+        }
+    }
+}
+
+void BVH::rayQuery (
+    glm::vec3 const &orig, glm::vec3 const &dir, float tMax,
+    std::vector<uint32_t> &hits) const
+{
+    hits.clear();
+    if (this->_nodes.empty()) {
+        return;
+    }
+
+    glm::vec3 invDir = 1.0f / dir;
+    std::vector<uint32_t> stk;
+    stk.push_back(0);
+    while (! stk.empty()) {
+        Node const &node = this->_nodes[stk.back()];
+        stk.pop_back();
+        float t;
+        if (! rayHitsBox (node.bbox, orig, invDir, tMax, t)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            for (uint32_t i = node.first;  i < node.first + node.count;  ++i) {
+                if (rayHitsBox (this->_primBounds.get(i), orig, invDir, tMax, t)) {
+                    hits.push_back(this->_primIds[i]);
+                }
+            }
+        } else {
+            stk.push_back(node.first + 1);
+            stk.push_back(node.first);
+        }
+    }
+}
+
+int32_t BVH::closestHit (glm::vec3 const &orig, glm::vec3 const &dir, float &t) const
+{
+    if (this->_nodes.empty()) {
+        return -1;
+    }
+
+    glm::vec3 invDir = 1.0f / dir;
+    float tBest = std::numeric_limits<float>::max();
+    int32_t best = -1;
+
+    struct Item {
+        uint32_t nd;            // the node to visit
+        float tEnter;           // where the ray enters the node's box
+    };
+    std::vector<Item> stk;
+    float tRoot;
+    if (rayHitsBox (this->_nodes[0].bbox, orig, invDir, tBest, tRoot)) {
+        stk.push_back(Item{0, tRoot});
+    }
+    while (! stk.empty()) {
+        Item item = stk.back();
+        stk.pop_back();
+        if (item.tEnter > tBest) {
+            // we have already found a closer hit
+            continue;
+        }
+        Node const &node = this->_nodes[item.nd];
+        if (node.isLeaf()) {
+            for (uint32_t i = node.first;  i < node.first + node.count;  ++i) {
+                float tHit;
+                if (rayHitsBox (this->_primBounds.get(i), orig, invDir, tBest, tHit)
+                && (tHit < tBest)) {
+                    tBest = tHit;
+                    best = this->_primIds[i];
+                }
+            }
+        } else {
+            // visit the nearer child first
+            float t0, t1;
+            bool hit0 = rayHitsBox (this->_nodes[node.first].bbox, orig, invDir, tBest, t0);
+            bool hit1 = rayHitsBox (this->_nodes[node.first+1].bbox, orig, invDir, tBest, t1);
+            if (hit0 && hit1) {
+                if (t0 <= t1) {
+                    stk.push_back(Item{node.first+1, t1});
+                    stk.push_back(Item{node.first, t0});
+                } else {
+                    stk.push_back(Item{node.first, t0});
+                    stk.push_back(Item{node.first+1, t1});
+                }
+            } else if (hit0) {
+                stk.push_back(Item{node.first, t0});
+            } else if (hit1) {
+                stk.push_back(Item{node.first+1, t1});
+            }
+        }
+    }
+
+    if (best >= 0) {
+        t = tBest;
+    }
+    return best;
+}
+
+void BVH::overlapQuery (AABBf_t const &bb, std::vector<uint32_t> &hits) const
+{
+    hits.clear();
+    if (this->_nodes.empty() || bb.isEmpty()) {
+        return;
+    }
+
+    std::vector<uint32_t> stk;
+    stk.push_back(0);
+    while (! stk.empty()) {
+        Node const &node = this->_nodes[stk.back()];
+        stk.pop_back();
+        if (node.bbox.isEmpty() || !overlaps(node.bbox, bb)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            for (uint32_t i = node.first;  i < node.first + node.count;  ++i) {
+                AABBf_t primBB = this->_primBounds.get(i);
+                if (!primBB.isEmpty() && overlaps(primBB, bb)) {
+                    hits.push_back(this->_primIds[i]);
+                }
+            }
+        } else {
+            stk.push_back(node.first + 1);
+            stk.push_back(node.first);
+        }
+    }
+}
+
+} // namespace cs237
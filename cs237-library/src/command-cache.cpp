@@ -0,0 +1,51 @@
+/*! \file command-cache.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+
+namespace cs237 {
+
+CommandCache::CommandCache (Application *app)
+  : _app(app), _version(1), _nRecorded(0), _nReused(0)
+{
+}
+
+CommandCache::~CommandCache ()
+{
+    for (auto &ent : this->_entries) {
+        this->_app->freeCommandBuf (ent.cmdBuf);
+    }
+}
+
+vk::CommandBuffer CommandCache::acquire (uint32_t imageIdx, bool &record)
+{
+    // the buffers are allocated on demand, since the number of swap-chain
+    // images is not known until the swap chain is created
+    while (this->_entries.size() <= imageIdx) {
+        this->_entries.push_back(Entry{this->_app->newCommandBuf(), 0});
+    }
+
+    Entry &ent = this->_entries[imageIdx];
+    if (ent.version == this->_version) {
+        record = false;
+        this->_nReused++;
+    } else {
+        record = true;
+        ent.cmdBuf.reset();
+        ent.version = this->_version;
+        this->_nRecorded++;
+    }
+
+    return ent.cmdBuf;
+}
+
+} // namespace cs237
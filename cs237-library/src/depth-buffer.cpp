@@ -59,7 +59,7 @@ DepthBuffer::~DepthBuffer ()
     this->_app->device().destroyImageView (this->_imageView);
     this->_app->device().freeMemory (this->_mem);
     this->_app->device().destroyImage (this->_image);
-    this->_app->device().destroySampler (this->_sampler);
+    // the sampler is owned by the application's sampler cache
 }
 
 vk::Framebuffer DepthBuffer::createFramebuffer (vk::RenderPass rp)
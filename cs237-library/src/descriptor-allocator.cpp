@@ -0,0 +1,209 @@
+/*! \file descriptor-allocator.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+
+namespace cs237 {
+
+// the maximum number of sets in a single pool
+constexpr uint32_t kMaxPoolSets = 1024;
+
+DescriptorAllocator::DescriptorAllocator (Application *app, uint32_t nFrames, uint32_t initialSets)
+  : _app(app), _nFrames(std::max(nFrames, 1u)), _initialSets(std::max(initialSets, 1u)),
+    _stats{0, 0, 0, 0, 0, 0}
+{
+}
+
+DescriptorAllocator::~DescriptorAllocator ()
+{
+    auto device = this->_app->device();
+    for (auto &it : this->_layouts) {
+        for (auto pool : it.second.persistent.pools) {
+            device.destroyDescriptorPool(pool);
+        }
+        for (auto &frame : it.second.frames) {
+            for (auto pool : frame.pools) {
+                device.destroyDescriptorPool(pool);
+            }
+        }
+    }
+}
+
+vk::DescriptorSetLayout DescriptorAllocator::layout (
+    std::vector<vk::DescriptorSetLayoutBinding> const &bindings)
+{
+    auto layout = this->_app->descriptorSetLayout(bindings);
+    if (this->_layouts.find(layout) == this->_layouts.end()) {
+        this->addLayout (layout, bindings);
+    }
+    return layout;
+}
+
+void DescriptorAllocator::addLayout (
+    vk::DescriptorSetLayout layout,
+    std::vector<vk::DescriptorSetLayoutBinding> const &bindings)
+{
+    if (this->_layouts.find(layout) != this->_layouts.end()) {
+        ERROR("descriptor-set layout is already registered");
+    }
+
+    // count the descriptors of each type that a set requires
+    std::map<vk::DescriptorType, uint32_t> counts;
+    for (auto const &b : bindings) {
+        counts[b.descriptorType] += b.descriptorCount;
+    }
+
+    LayoutInfo info;
+    for (auto const &it : counts) {
+        if (it.second > 0) {
+            info.setSizes.push_back(vk::DescriptorPoolSize(it.first, it.second));
+        }
+    }
+    info.persistent = PoolList{{}, 0, this->_initialSets};
+    info.frames.resize(this->_nFrames, PoolList{{}, 0, this->_initialSets});
+
+    this->_layouts.insert({layout, info});
+}
+
+vk::DescriptorSet DescriptorAllocator::allocate (vk::DescriptorSetLayout layout)
+{
+    auto &info = this->_info(layout);
+    this->_stats.nSets++;
+    return this->_allocate (info, info.persistent, layout);
+}
+
+vk::DescriptorSet DescriptorAllocator::allocateTransient (
+    uint32_t frame,
+    vk::DescriptorSetLayout layout)
+{
+    assert (frame < this->_nFrames);
+    auto &info = this->_info(layout);
+    this->_stats.nTransientSets++;
+    return this->_allocate (info, info.frames[frame], layout);
+}
+
+void DescriptorAllocator::resetFrame (uint32_t frame)
+{
+    assert (frame < this->_nFrames);
+    auto device = this->_app->device();
+    for (auto &it : this->_layouts) {
+        PoolList &frameList = it.second.frames[frame];
+        // we only need to reset the pools that have been allocated from
+        uint32_t n = std::min(frameList.cur + 1, uint32_t(frameList.pools.size()));
+        for (uint32_t i = 0;  i < n;  ++i) {
+            device.resetDescriptorPool(frameList.pools[i]);
+        }
+        frameList.cur = 0;
+    }
+    this->_stats.nResets++;
+}
+
+vk::DescriptorSet DescriptorAllocator::cached (
+    vk::DescriptorSetLayout layout,
+    std::vector<DescriptorResource> const &resources)
+{
+    // the key is the layout followed by the bound resources
+    std::vector<uint64_t> key;
+    key.reserve(1 + 7 * resources.size());
+    key.push_back(reinterpret_cast<uint64_t>(static_cast<VkDescriptorSetLayout>(layout)));
+    for (auto const &r : resources) {
+        key.push_back((uint64_t(r.binding) << 32) | uint64_t(r.type));
+        key.push_back(reinterpret_cast<uint64_t>(static_cast<VkBuffer>(r.buffer.buffer)));
+        key.push_back(r.buffer.offset);
+        key.push_back(r.buffer.range);
+        key.push_back(reinterpret_cast<uint64_t>(static_cast<VkImageView>(r.image.imageView)));
+        key.push_back(reinterpret_cast<uint64_t>(static_cast<VkSampler>(r.image.sampler)));
+        key.push_back(uint64_t(r.image.imageLayout));
+    }
+
+    auto it = this->_cache.find(key);
+    if (it != this->_cache.end()) {
+        this->_stats.nCacheHits++;
+        return it->second;
+    }
+
+    auto &info = this->_info(layout);
+    auto ds = this->_allocate (info, info.persistent, layout);
+    this->_stats.nCacheMisses++;
+
+    // write the resources into the set
+    std::vector<vk::WriteDescriptorSet> writes;
+    writes.reserve(resources.size());
+    for (auto const &r : resources) {
+        bool isBuffer = (r.type == vk::DescriptorType::eUniformBuffer)
+            || (r.type == vk::DescriptorType::eStorageBuffer)
+            || (r.type == vk::DescriptorType::eUniformBufferDynamic)
+            || (r.type == vk::DescriptorType::eStorageBufferDynamic);
+        writes.push_back(vk::WriteDescriptorSet(
+            ds, /* descriptor set */
+            r.binding, /* binding */
+            0, /* array element */
+            1, /* descriptor count */
+            r.type, /* descriptor type */
+            isBuffer ? nullptr : &r.image, /* image info */
+            isBuffer ? &r.buffer : nullptr, /* buffer info */
+            nullptr)); /* texel buffer view */
+    }
+    this->_app->device().updateDescriptorSets(writes, nullptr);
+
+    this->_cache.insert({key, ds});
+
+    return ds;
+}
+
+DescriptorAllocator::LayoutInfo &DescriptorAllocator::_info (vk::DescriptorSetLayout layout)
+{
+    auto it = this->_layouts.find(layout);
+    if (it == this->_layouts.end()) {
+        ERROR("descriptor-set layout has not been registered with the allocator");
+    }
+    return it->second;
+}
+
+vk::DescriptorSet DescriptorAllocator::_allocate (
+    LayoutInfo const &info,
+    PoolList &pools,
+    vk::DescriptorSetLayout layout)
+{
+    auto device = this->_app->device();
+
+    while (true) {
+        if (pools.cur == pools.pools.size()) {
+            // all of the pools are full, so add a new pool that is twice as big
+            // as the previous one
+            std::vector<vk::DescriptorPoolSize> sizes = info.setSizes;
+            for (auto &sz : sizes) {
+                sz.descriptorCount *= pools.nextSz;
+            }
+            vk::DescriptorPoolCreateInfo poolInfo(
+                {}, /* flags */
+                pools.nextSz, /* max sets */
+                sizes); /* pool sizes */
+            pools.pools.push_back(device.createDescriptorPool(poolInfo));
+            pools.nextSz = std::min(2 * pools.nextSz, kMaxPoolSets);
+            this->_stats.nPools++;
+        }
+
+        vk::DescriptorSetAllocateInfo allocInfo(pools.pools[pools.cur], layout);
+        try {
+            return device.allocateDescriptorSets(allocInfo)[0];
+        } catch (vk::OutOfPoolMemoryError const &) {
+            // the current pool is full, so try the next one
+            pools.cur++;
+        } catch (vk::FragmentedPoolError const &) {
+            pools.cur++;
+        }
+    }
+
+}
+
+} // namespace cs237
@@ -0,0 +1,305 @@
+/*! \file frame-stats.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include <fstream>
+#ifndef CS237_WINDOWS
+#include <sys/resource.h>
+#endif
+
+namespace cs237 {
+
+/// the maximum number of frame slots (i.e., frames in flight) per window
+constexpr uint32_t kMaxSlots = 8;
+
+/// the default length of the benchmark camera path
+constexpr uint32_t kDefaultPathLen = 360;
+
+/******************** local helper functions ********************/
+
+// the duration between two times in ms
+template <typename T>
+static double elapsedMS (T start, T end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// write a string as a JSON string literal
+static void writeString (std::ostream &out, std::string const &s)
+{
+    out << '"';
+    for (char c : s) {
+        if ((c == '"') || (c == '\\')) {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// write a summary of a vector of times as a JSON object; an empty vector
+// is written as `null`
+static void writeSummary (std::ostream &out, std::vector<double> times)
+{
+    if (times.empty()) {
+        out << "null";
+        return;
+    }
+
+    std::sort (times.begin(), times.end());
+
+    // the nearest-rank percentile
+    auto pct = [&times](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * double(times.size())));
+        return times[std::max(rank, size_t(1)) - 1];
+    };
+
+    double sum = 0.0;
+    for (auto t : times) {
+        sum += t;
+    }
+
+    out << "{ \"mean\": " << sum / double(times.size())
+        << ", \"p50\": " << pct(0.50)
+        << ", \"p95\": " << pct(0.95)
+        << ", \"p99\": " << pct(0.99)
+        << ", \"max\": " << times.back()
+        << " }";
+}
+
+// the peak resident-set size of the process in bytes (0 if unknown)
+static uint64_t peakRSS ()
+{
+#ifndef CS237_WINDOWS
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return 1024 * static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+    }
+#endif
+    return 0;
+}
+
+/******************** class FrameStats methods ********************/
+
+FrameStats::FrameStats (Application *app)
+  : _app(app), _queryPool(nullptr), _tsPeriod(0.0), _tsMask(0),
+    _started(false), _loadTime(0.0)
+{
+    // timestamps are only supported if the graphics queue has valid bits
+    auto qFamilies = app->_gpu.getQueueFamilyProperties();
+    uint32_t validBits = qFamilies[app->_qIdxs.graphics].timestampValidBits;
+    if (validBits > 0) {
+        this->_tsPeriod = app->limits()->timestampPeriod;
+        this->_tsMask = (validBits < 64) ? ((uint64_t(1) << validBits) - 1) : ~uint64_t(0);
+        vk::QueryPoolCreateInfo poolInfo(
+            {}, /* flags */
+            vk::QueryType::eTimestamp,
+            2 * kMaxSlots); /* query count */
+        this->_queryPool = app->_device.createQueryPool (poolInfo);
+    }
+    else {
+        std::cerr << "warning: GPU timestamps are not supported\n";
+    }
+}
+
+FrameStats::~FrameStats ()
+{
+    for (auto &slot : this->_slots) {
+        this->_app->freeCommandBuf (slot.begin);
+        this->_app->freeCommandBuf (slot.end);
+    }
+    if (this->_queryPool) {
+        this->_app->_device.destroyQueryPool (this->_queryPool);
+    }
+}
+
+uint32_t FrameStats::newSlot ()
+{
+    if (this->_slots.size() >= kMaxSlots) {
+        ERROR("too many frames in flight for benchmarking");
+    }
+
+    uint32_t id = this->_slots.size();
+    Slot slot{nullptr, nullptr, false};
+
+    if (this->_queryPool) {
+        // the timestamp commands are the same every frame, so we record them once
+        slot.begin = this->_app->newCommandBuf();
+        slot.begin.begin (vk::CommandBufferBeginInfo{});
+        slot.begin.resetQueryPool (this->_queryPool, 2*id, 2);
+        slot.begin.writeTimestamp (
+            vk::PipelineStageFlagBits::eTopOfPipe, this->_queryPool, 2*id);
+        slot.begin.end();
+
+        slot.end = this->_app->newCommandBuf();
+        slot.end.begin (vk::CommandBufferBeginInfo{});
+        slot.end.writeTimestamp (
+            vk::PipelineStageFlagBits::eBottomOfPipe, this->_queryPool, 2*id + 1);
+        slot.end.end();
+    }
+
+    this->_slots.push_back (slot);
+
+    return id;
+}
+
+void FrameStats::beginFrame (uint32_t slot)
+{
+    this->_cpuStart = Clock::now();
+
+    if (! this->_started) {
+        this->_started = true;
+        this->_loadTime = elapsedMS(this->_app->_startTime, this->_cpuStart);
+    }
+
+    // the fence has been signaled, so the previous timestamps are available
+    this->_readTimestamps (slot);
+}
+
+void FrameStats::submit (
+    uint32_t slot,
+    vk::CommandBuffer cmdBuf,
+    std::vector<vk::CommandBuffer> &cmdBufs)
+{
+    this->_cpuTimes.push_back (elapsedMS(this->_cpuStart, Clock::now()));
+
+    cmdBufs.clear();
+    if (this->_queryPool) {
+        // a timestamp is written once all of the previously submitted
+        // commands have reached the stage, so the two timestamps bracket
+        // the frame's commands
+        cmdBufs.push_back (this->_slots[slot].begin);
+        cmdBufs.push_back (cmdBuf);
+        cmdBufs.push_back (this->_slots[slot].end);
+        this->_slots[slot].pending = true;
+    } else {
+        cmdBufs.push_back (cmdBuf);
+    }
+}
+
+void FrameStats::endFrame ()
+{
+    // the first frame has no predecessor
+    auto now = Clock::now();
+    if (this->_lastPresent != Clock::time_point()) {
+        this->_frameTimes.push_back (elapsedMS(this->_lastPresent, now));
+    }
+    this->_lastPresent = now;
+}
+
+void FrameStats::_readTimestamps (uint32_t slot)
+{
+    if (! this->_slots[slot].pending) {
+        return;
+    }
+    this->_slots[slot].pending = false;
+
+    auto res = this->_app->_device.getQueryPoolResults<uint64_t> (
+        this->_queryPool,
+        2*slot, 2, /* first query and count */
+        2 * sizeof(uint64_t), sizeof(uint64_t), /* data size and stride */
+        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+    if (res.result == vk::Result::eSuccess) {
+        uint64_t ticks = (res.value[1] - res.value[0]) & this->_tsMask;
+        this->_gpuTimes.push_back (1.0e-6 * this->_tsPeriod * double(ticks));
+    }
+}
+
+void FrameStats::report (std::string const &file)
+{
+    // wait for the last frames so that we can read their timestamps
+    this->_app->_device.waitIdle();
+    for (uint32_t i = 0;  i < this->_slots.size();  ++i) {
+        this->_readTimestamps (i);
+    }
+
+    // the device-local memory that is in use, which requires the memory-budget
+    // extension
+    int64_t devMem = -1;
+    if (this->_app->_memoryBudget) {
+        auto chain = this->_app->_gpu.getMemoryProperties2<
+            vk::PhysicalDeviceMemoryProperties2,
+            vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        auto const &props = chain.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties;
+        auto const &budget = chain.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        devMem = 0;
+        for (uint32_t i = 0;  i < props.memoryHeapCount;  ++i) {
+            if (props.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+                devMem += budget.heapUsage[i];
+            }
+        }
+    }
+
+    std::ofstream outF;
+    if (file != "-") {
+        outF.open (file);
+        if (! outF) {
+            std::cerr << "warning: unable to write benchmark results to '"
+                << file << "'\n";
+            return;
+        }
+    }
+    std::ostream &out = (file != "-") ? outF : std::cout;
+
+    out << "{\n  \"app\": ";
+    writeString (out, this->_app->name());
+    out << ",\n  \"device\": ";
+    writeString (out, std::string(this->_app->props()->deviceName.data()));
+    out << ",\n  \"headless\": " << (this->_app->headless() ? "true" : "false");
+    out << ",\n  \"frames\": " << this->_cpuTimes.size();
+    out << ",\n  \"loadMs\": " << this->_loadTime;
+    out << ",\n  \"cpuRecordMs\": ";
+    writeSummary (out, this->_cpuTimes);
+    out << ",\n  \"gpuMs\": ";
+    writeSummary (out, this->_gpuTimes);
+    out << ",\n  \"frameMs\": ";
+    writeSummary (out, this->_frameTimes);
+    out << ",\n  \"memory\": { \"peakRSSBytes\": " << peakRSS()
+        << ", \"deviceLocalBytes\": ";
+    if (devMem < 0) {
+        out << "null";
+    } else {
+        out << devMem;
+    }
+    out << " }\n}\n";
+}
+
+/******************** benchmark camera path ********************/
+
+glm::vec3 benchCameraPos (
+    glm::vec3 pos,
+    glm::vec3 at,
+    glm::vec3 up,
+    uint32_t frame,
+    uint32_t nFrames)
+{
+    if (nFrames == 0) {
+        nFrames = kDefaultPathLen;
+    }
+    float theta = glm::two_pi<float>() * float(frame % nFrames) / float(nFrames);
+
+    // rotate the offset from the look-at point around the up axis and scale it,
+    // so that the camera moves in and out twice per orbit
+    glm::quat rot = glm::angleAxis(theta, glm::normalize(up));
+    float scale = 1.0f - 0.25f * std::sin(2.0f * theta);
+
+    return at + scale * (rot * (pos - at));
+}
+
+} // namespace cs237
@@ -0,0 +1,556 @@
+/*! \file job-system.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+
+namespace cs237 {
+
+// the initial capacity of a worker's deque (must be a power of 2)
+constexpr int64_t kInitialDequeSz = 256;
+
+// the number of times that an idle worker looks for work before it sleeps
+constexpr int kIdleSpins = 64;
+
+namespace __detail {
+
+struct Task {
+    std::function<void()> fn;
+    TaskCounter *ctr;
+};
+
+// A Chase-Lev work-stealing deque (using the C11 memory-model formulation
+// of Lê et al., "Correct and Efficient Work-Stealing for Weak Memory
+// Models," PPoPP 2013).  The owner pushes and pops at the bottom and other
+// threads steal from the top.  The deque grows when it is full; the old
+// arrays are kept until the deque is destroyed, since a thief might still
+// be reading from one.
+//
+class WorkDeque {
+  public:
+    WorkDeque () : _top(0), _bottom(0), _array(new Array(kInitialDequeSz)) { }
+
+    ~WorkDeque ()
+    {
+        delete this->_array.load(std::memory_order_relaxed);
+        for (auto a : this->_old) {
+            delete a;
+        }
+    }
+
+    // is the deque (probably) empty?
+    bool empty () const
+    {
+        return this->_bottom.load(std::memory_order_relaxed)
+            <= this->_top.load(std::memory_order_relaxed);
+    }
+
+    // push a task on the bottom (owner only)
+    void push (Task *task)
+    {
+        int64_t b = this->_bottom.load(std::memory_order_relaxed);
+        int64_t t = this->_top.load(std::memory_order_acquire);
+        Array *a = this->_array.load(std::memory_order_relaxed);
+        if (b - t > a->mask) {
+            Array *newA = a->grow(b, t);
+            this->_old.push_back(a);
+            a = newA;
+            this->_array.store(a, std::memory_order_release);
+        }
+        a->put(b, task);
+        // the release store publishes the task to the thieves
+        this->_bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // pop a task from the bottom (owner only); returns nullptr if the deque
+    // is empty
+    Task *pop ()
+    {
+        int64_t b = this->_bottom.load(std::memory_order_relaxed) - 1;
+        Array *a = this->_array.load(std::memory_order_relaxed);
+        this->_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = this->_top.load(std::memory_order_relaxed);
+        Task *task = nullptr;
+        if (t <= b) {
+            task = a->get(b);
+            if (t == b) {
+                // last task, so we race with the thieves for it
+                if (! this->_top.compare_exchange_strong(
+                        t, t + 1,
+                        std::memory_order_seq_cst,
+                        std::memory_order_relaxed)) {
+                    task = nullptr;
+                }
+                this->_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            this->_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    // steal a task from the top; returns nullptr if the deque is empty or
+    // if we lost a race with another thread
+    Task *steal ()
+    {
+        int64_t t = this->_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = this->_bottom.load(std::memory_order_acquire);
+        if (t < b) {
+            Array *a = this->_array.load(std::memory_order_acquire);
+            Task *task = a->get(t);
+            if (! this->_top.compare_exchange_strong(
+                    t, t + 1,
+                    std::memory_order_seq_cst,
+                    std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return task;
+        }
+        return nullptr;
+    }
+
+  private:
+    // a circular array of tasks
+    struct Array {
+        int64_t mask;
+        std::unique_ptr<std::atomic<Task *>[]> buf;
+
+        explicit Array (int64_t sz) : mask(sz - 1), buf(new std::atomic<Task *>[sz]) { }
+
+        Task *get (int64_t i) const { return this->buf[i & this->mask].load(std::memory_order_relaxed); }
+        void put (int64_t i, Task *task) { this->buf[i & this->mask].store(task, std::memory_order_relaxed); }
+
+        // make a copy of the live range [t..b) in an array of twice the size
+        Array *grow (int64_t b, int64_t t) const
+        {
+            Array *a = new Array(2 * (this->mask + 1));
+            for (int64_t i = t;  i < b;  ++i) {
+                a->put(i, this->get(i));
+            }
+            return a;
+        }
+    };
+
+    // the top and bottom are on different cache lines, since they are
+    // written by different threads
+    alignas(64) std::atomic<int64_t> _top;
+    alignas(64) std::atomic<int64_t> _bottom;
+    std::atomic<Array *> _array;
+    std::vector<Array *> _old;          // retired arrays
+};
+
+struct Worker {
+    JobSystem *sys;                     // the owning system
+    uint32_t id;                        // the worker's index
+    uint32_t rng;                       // state for picking victims
+    WorkDeque deque;                    // the worker's tasks
+    std::thread thread;
+    std::atomic<uint64_t> nTasks;       // the number of tasks that the worker ran
+    std::atomic<uint64_t> nSteals;      // the number of tasks that the worker stole
+
+    Worker (JobSystem *s, uint32_t i)
+      : sys(s), id(i), rng(2654435761u * (i + 1)), nTasks(0), nSteals(0)
+    { }
+};
+
+} // namespace __detail
+
+// the worker state of the current thread; nullptr for threads that are not
+// workers
+static thread_local __detail::Worker *tlWorker = nullptr;
+
+// a xorshift random-number generator for picking victims
+inline uint32_t nextRandom (uint32_t &state)
+{
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+/******************** class JobSystem ********************/
+
+JobSystem::JobSystem (uint32_t nThreads)
+  : _nQueued(0), _quit(false), _nExtTasks(0), _nExtSteals(0), _nSleeping(0), _wakeups(0)
+{
+    if (nThreads == 0) {
+        nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    // the workers must all exist before any of them starts stealing
+    for (uint32_t id = 0;  id+1 < nThreads;  ++id) {
+        this->_workers.push_back(new __detail::Worker(this, id));
+    }
+    for (auto w : this->_workers) {
+        w->thread = std::thread(&JobSystem::_workerMain, this, w);
+    }
+}
+
+JobSystem::~JobSystem ()
+{
+    this->_quit.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lk(this->_sleepMu);
+        this->_wakeups++;
+    }
+    this->_sleepCV.notify_all();
+    for (auto w : this->_workers) {
+        w->thread.join();
+    }
+
+    // discard any tasks that were not run
+    for (auto w : this->_workers) {
+        while (__detail::Task *task = w->deque.pop()) {
+            delete task;
+        }
+        delete w;
+    }
+    for (auto task : this->_queue) {
+        delete task;
+    }
+}
+
+void JobSystem::run (std::function<void()> fn, TaskCounter *ctr)
+{
+    if (ctr != nullptr) {
+        ctr->_n.fetch_add(1, std::memory_order_relaxed);
+    }
+    this->_push (new __detail::Task{std::move(fn), ctr});
+}
+
+void JobSystem::wait (TaskCounter &ctr)
+{
+    __detail::Worker *self = this->_self();
+    while (! ctr.done()) {
+        __detail::Task *task = this->_findWork (self);
+        if (task != nullptr) {
+            this->_execute (task);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    std::exception_ptr err = nullptr;
+    {
+        std::lock_guard<std::mutex> lk(ctr._mu);
+        std::swap(err, ctr._error);
+    }
+    if (err != nullptr) {
+        std::rethrow_exception(err);
+    }
+}
+
+void JobSystem::parallelFor (
+    uint32_t begin,
+    uint32_t end,
+    uint32_t grain,
+    std::function<void(uint32_t lo, uint32_t hi)> const &fn)
+{
+    if (begin >= end) {
+        return;
+    }
+    if (grain == 0) {
+        // aim for about eight subranges per thread for load balance
+        grain = std::max(1u, (end - begin) / (8 * this->numThreads()));
+    }
+    if (end - begin <= grain) {
+        fn (begin, end);
+        return;
+    }
+
+    // split the range in half, spawning the upper half and continuing with
+    // the lower half, until the pieces are at most `grain` in size
+    TaskCounter ctr;
+    std::function<void(uint32_t, uint32_t)> split = [&](uint32_t lo, uint32_t hi) {
+        while (hi - lo > grain) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            this->run ([&split, mid, hi]() { split (mid, hi); }, &ctr);
+            hi = mid;
+        }
+        fn (lo, hi);
+    };
+
+    // the spawned tasks refer to `split` and `ctr`, so we must wait for them
+    // even if our part of the range fails
+    std::exception_ptr err = nullptr;
+    try {
+        split (begin, end);
+    } catch (...) {
+        err = std::current_exception();
+    }
+    try {
+        this->wait (ctr);
+    } catch (...) {
+        if (err == nullptr) {
+            err = std::current_exception();
+        }
+    }
+    if (err != nullptr) {
+        std::rethrow_exception(err);
+    }
+}
+
+JobSystem::Stats JobSystem::stats () const
+{
+    Stats s{
+        this->_nExtTasks.load(std::memory_order_relaxed),
+        this->_nExtSteals.load(std::memory_order_relaxed)
+    };
+    for (auto w : this->_workers) {
+        s.nTasks += w->nTasks.load(std::memory_order_relaxed);
+        s.nSteals += w->nSteals.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+__detail::Worker *JobSystem::_self ()
+{
+    if ((tlWorker != nullptr) && (tlWorker->sys == this)) {
+        return tlWorker;
+    } else {
+        return nullptr;
+    }
+}
+
+void JobSystem::_push (__detail::Task *task)
+{
+    __detail::Worker *self = this->_self();
+    if (self != nullptr) {
+        self->deque.push (task);
+    } else {
+        std::lock_guard<std::mutex> lk(this->_queueMu);
+        this->_queue.push_back(task);
+        this->_nQueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // wake a sleeping worker.  The fence orders the push before the load of
+    // `_nSleeping`; it pairs with the increment of `_nSleeping` in
+    // `_workerMain`, so either we see the sleeper or it sees the task.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->_nSleeping.load(std::memory_order_relaxed) > 0) {
+        {
+            std::lock_guard<std::mutex> lk(this->_sleepMu);
+            this->_wakeups++;
+        }
+        this->_sleepCV.notify_one();
+    }
+}
+
+__detail::Task *JobSystem::_findWork (__detail::Worker *self)
+{
+    // first, look in our own deque
+    if (self != nullptr) {
+        if (__detail::Task *task = self->deque.pop()) {
+            return task;
+        }
+    }
+
+    // then, the shared queue
+    if (this->_nQueued.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lk(this->_queueMu);
+        if (! this->_queue.empty()) {
+            __detail::Task *task = this->_queue.front();
+            this->_queue.pop_front();
+            this->_nQueued.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+
+    // finally, try to steal from the other workers, starting with a random victim
+    uint32_t n = this->_workers.size();
+    if (n > 0) {
+        static thread_local uint32_t extRng = 0x9e3779b9u;
+        uint32_t start = nextRandom(self != nullptr ? self->rng : extRng) % n;
+        for (uint32_t i = 0;  i < n;  ++i) {
+            __detail::Worker *victim = this->_workers[(start + i) % n];
+            if (victim == self) {
+                continue;
+            }
+            if (__detail::Task *task = victim->deque.steal()) {
+                if (self != nullptr) {
+                    self->nSteals.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    this->_nExtSteals.fetch_add(1, std::memory_order_relaxed);
+                }
+                return task;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+// report an exception from a task that does not have a counter
+static void reportUncaught (std::exception_ptr err)
+{
+    try {
+        std::rethrow_exception(err);
+    } catch (std::exception const &ex) {
+        std::cerr << "warning: uncaught exception in task: " << ex.what() << "\n";
+    } catch (...) {
+        std::cerr << "warning: uncaught exception in task\n";
+    }
+}
+
+void JobSystem::_execute (__detail::Task *task)
+{
+    TaskCounter *ctr = task->ctr;
+
+    try {
+        task->fn();
+    } catch (...) {
+        if (ctr != nullptr) {
+            std::lock_guard<std::mutex> lk(ctr->_mu);
+            if (ctr->_error == nullptr) {
+                ctr->_error = std::current_exception();
+            }
+        } else {
+            reportUncaught (std::current_exception());
+        }
+    }
+
+    __detail::Worker *self = this->_self();
+    if (self != nullptr) {
+        self->nTasks.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        this->_nExtTasks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // the task's state (e.g., a future's shared state) must be released before
+    // the waiter is allowed to proceed, and the counter must not be touched
+    // after it is decremented
+    delete task;
+    if (ctr != nullptr) {
+        ctr->_n.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+bool JobSystem::_hasWork () const
+{
+    if (this->_nQueued.load(std::memory_order_relaxed) > 0) {
+        return true;
+    }
+    for (auto w : this->_workers) {
+        if (! w->deque.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::_workerMain (__detail::Worker *self)
+{
+    tlWorker = self;
+
+    while (! this->_quit.load(std::memory_order_acquire)) {
+        __detail::Task *task = this->_findWork (self);
+        if (task != nullptr) {
+            this->_execute (task);
+            continue;
+        }
+
+        // spin for a while before going to sleep, since new work often
+        // arrives shortly (e.g., in the next phase of a frame)
+        bool found = false;
+        for (int i = 0;  (i < kIdleSpins) && !found;  ++i) {
+            std::this_thread::yield();
+            found = this->_hasWork();
+        }
+        if (found) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(this->_sleepMu);
+        this->_nSleeping.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t w = this->_wakeups;
+        if (!this->_hasWork() && !this->_quit.load(std::memory_order_acquire)) {
+            this->_sleepCV.wait(lk, [this, w]() { return this->_wakeups != w; });
+        }
+        this->_nSleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    tlWorker = nullptr;
+}
+
+/******************** class TaskGraph ********************/
+
+void TaskGraph::run (JobSystem &js)
+{
+    uint32_t n = this->_nodes.size();
+    if (n == 0) {
+        return;
+    }
+
+    // check that the graph is acyclic using Kahn's algorithm
+    {
+        std::vector<uint32_t> nPreds(n);
+        std::vector<TaskId> ready;
+        for (TaskId id = 0;  id < n;  ++id) {
+            nPreds[id] = this->_nodes[id].nPreds;
+            if (nPreds[id] == 0) {
+                ready.push_back(id);
+            }
+        }
+        uint32_t nVisited = 0;
+        while (! ready.empty()) {
+            TaskId id = ready.back();
+            ready.pop_back();
+            nVisited++;
+            for (auto succ : this->_nodes[id].succs) {
+                if (--nPreds[succ] == 0) {
+                    ready.push_back(succ);
+                }
+            }
+        }
+        if (nVisited < n) {
+            ERROR("task graph has a cycle");
+        }
+    }
+
+    for (auto &nd : this->_nodes) {
+        nd.pending.store(nd.nPreds, std::memory_order_relaxed);
+    }
+
+    TaskCounter ctr;
+    std::atomic<bool> failed(false);
+    std::function<void(TaskId)> exec = [&](TaskId id) {
+        Node &nd = this->_nodes[id];
+        if (failed.load(std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            nd.fn();
+        } catch (...) {
+            failed.store(true, std::memory_order_relaxed);
+            throw;
+        }
+        // spawn the successors that are now ready
+        for (auto succ : nd.succs) {
+            if (this->_nodes[succ].pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                js.run ([&exec, succ]() { exec (succ); }, &ctr);
+            }
+        }
+    };
+
+    for (TaskId id = 0;  id < n;  ++id) {
+        if (this->_nodes[id].nPreds == 0) {
+            js.run ([&exec, id]() { exec (id); }, &ctr);
+        }
+    }
+    js.wait (ctr);
+}
+
+} // namespace cs237
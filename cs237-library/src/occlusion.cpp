@@ -0,0 +1,479 @@
+/*! \file occlusion.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * A tiled software rasterizer for occluders and the Hi-Z occlusion test.
+ * The rasterizer processes four pixels at a time using SSE2 or NEON when
+ * available.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#elif defined(__aarch64__)
+#  include <arm_neon.h>
+#endif
+
+namespace cs237 {
+
+namespace {
+
+/***** four-wide vector operations for the rasterizer *****/
+
+#if defined(__SSE2__) || defined(_M_X64)
+
+using F4 = __m128;      // four floats
+using M4 = __m128;      // four lane masks
+
+inline F4 f4Splat (float x) { return _mm_set1_ps(x); }
+inline F4 f4Set (float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+inline F4 f4Load (float const *p) { return _mm_loadu_ps(p); }
+inline void f4Store (float *p, F4 v) { _mm_storeu_ps(p, v); }
+inline F4 f4Add (F4 a, F4 b) { return _mm_add_ps(a, b); }
+inline F4 f4Mul (F4 a, F4 b) { return _mm_mul_ps(a, b); }
+inline F4 f4Min (F4 a, F4 b) { return _mm_min_ps(a, b); }
+inline M4 m4Inside (F4 e0, F4 e1, F4 e2)
+{
+    F4 zero = _mm_setzero_ps();
+    return _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+        _mm_cmpge_ps(e2, zero));
+}
+inline bool m4Any (M4 m) { return _mm_movemask_ps(m) != 0; }
+inline F4 f4Select (M4 m, F4 a, F4 b)
+{
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+
+#elif defined(__aarch64__)
+
+using F4 = float32x4_t;
+using M4 = uint32x4_t;
+
+inline F4 f4Splat (float x) { return vdupq_n_f32(x); }
+inline F4 f4Set (float a, float b, float c, float d)
+{
+    float v[4] = { a, b, c, d };
+    return vld1q_f32(v);
+}
+inline F4 f4Load (float const *p) { return vld1q_f32(p); }
+inline void f4Store (float *p, F4 v) { vst1q_f32(p, v); }
+inline F4 f4Add (F4 a, F4 b) { return vaddq_f32(a, b); }
+inline F4 f4Mul (F4 a, F4 b) { return vmulq_f32(a, b); }
+inline F4 f4Min (F4 a, F4 b) { return vminq_f32(a, b); }
+inline M4 m4Inside (F4 e0, F4 e1, F4 e2)
+{
+    F4 zero = vdupq_n_f32(0.0f);
+    return vandq_u32(vandq_u32(vcgeq_f32(e0, zero), vcgeq_f32(e1, zero)), vcgeq_f32(e2, zero));
+}
+inline bool m4Any (M4 m) { return vmaxvq_u32(m) != 0; }
+inline F4 f4Select (M4 m, F4 a, F4 b) { return vbslq_f32(m, a, b); }
+
+#else
+
+struct F4 { float v[4]; };
+struct M4 { bool v[4]; };
+
+inline F4 f4Splat (float x) { return F4{{x, x, x, x}}; }
+inline F4 f4Set (float a, float b, float c, float d) { return F4{{a, b, c, d}}; }
+inline F4 f4Load (float const *p) { return F4{{p[0], p[1], p[2], p[3]}}; }
+inline void f4Store (float *p, F4 v) { for (int i = 0;  i < 4;  ++i) p[i] = v.v[i]; }
+inline F4 f4Add (F4 a, F4 b)
+{
+    return F4{{a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], a.v[3]+b.v[3]}};
+}
+inline F4 f4Mul (F4 a, F4 b)
+{
+    return F4{{a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3]}};
+}
+inline F4 f4Min (F4 a, F4 b)
+{
+    return F4{{
+        std::min(a.v[0], b.v[0]), std::min(a.v[1], b.v[1]),
+        std::min(a.v[2], b.v[2]), std::min(a.v[3], b.v[3])
+    }};
+}
+inline M4 m4Inside (F4 e0, F4 e1, F4 e2)
+{
+    M4 m;
+    for (int i = 0;  i < 4;  ++i) {
+        m.v[i] = (e0.v[i] >= 0.0f) && (e1.v[i] >= 0.0f) && (e2.v[i] >= 0.0f);
+    }
+    return m;
+}
+inline bool m4Any (M4 m) { return m.v[0] || m.v[1] || m.v[2] || m.v[3]; }
+inline F4 f4Select (M4 m, F4 a, F4 b)
+{
+    F4 r;
+    for (int i = 0;  i < 4;  ++i) {
+        r.v[i] = m.v[i] ? a.v[i] : b.v[i];
+    }
+    return r;
+}
+
+#endif
+
+/// triangles with a smaller screen-space area (in pixels) are ignored
+constexpr float kMinArea = 1.0e-6f;
+
+/// an edge function `a*x + b*y + c`, which is non-negative on the inside
+/// of the edge
+struct Edge {
+    float a, b, c;
+
+    Edge (glm::vec3 const &p, glm::vec3 const &q)
+      : a(p.y - q.y), b(q.x - p.x), c(-(a * p.x + b * p.y))
+    { }
+
+    /// move the edge inward by half a pixel (in the L-infinity norm), so that
+    /// the function is non-negative at a pixel center only when the whole pixel
+    /// is inside the edge
+    void shrink ()
+    {
+        this->c -= 0.5f * (std::abs(this->a) + std::abs(this->b));
+    }
+
+    /// the maximum value of the edge function for pixel centers in a tile
+    float maxOverTile (float x0, float y0) const
+    {
+        float x = (this->a > 0.0f) ? x0 + float(OcclusionBuffer::kTileWid) - 0.5f : x0 + 0.5f;
+        float y = (this->b > 0.0f) ? y0 + float(OcclusionBuffer::kTileHt) - 0.5f : y0 + 0.5f;
+        return this->a * x + this->b * y + this->c;
+    }
+};
+
+/// the signed area of the screen-space triangle (p, q, r), which is positive
+/// when the triangle is counter-clockwise
+inline float orient (glm::vec3 const &p, glm::vec3 const &q, glm::vec3 const &r)
+{
+    return (q.x - p.x) * (r.y - p.y) - (q.y - p.y) * (r.x - p.x);
+}
+
+/// map each vertex to the first vertex that has the same position, so that
+/// meshes that duplicate vertices along texture or normal seams are connected
+std::vector<uint32_t> weldVertices (std::vector<glm::vec3> const &verts)
+{
+    std::vector<uint32_t> order(verts.size());
+    for (uint32_t i = 0;  i < order.size();  ++i) {
+        order[i] = i;
+    }
+    std::sort (order.begin(), order.end(), [&verts](uint32_t i, uint32_t j) {
+        glm::vec3 const &p = verts[i], &q = verts[j];
+        if (p.x != q.x) return p.x < q.x;
+        if (p.y != q.y) return p.y < q.y;
+        if (p.z != q.z) return p.z < q.z;
+        return i < j;
+    });
+
+    std::vector<uint32_t> id(verts.size());
+    for (size_t i = 0;  i < order.size();  ++i) {
+        if ((i > 0) && (verts[order[i]] == verts[order[i-1]])) {
+            id[order[i]] = id[order[i-1]];
+        } else {
+            id[order[i]] = order[i];
+        }
+    }
+    return id;
+}
+
+} // anonymous namespace
+
+OcclusionBuffer::OcclusionBuffer (uint32_t wid, uint32_t ht)
+  : _wid(((wid + kTileWid - 1) / kTileWid) * kTileWid),
+    _ht(((ht + kTileHt - 1) / kTileHt) * kTileHt),
+    _viewProj(1.0f), _nTris(0)
+{
+    if ((wid == 0) || (ht == 0)) {
+        ERROR("OcclusionBuffer: invalid dimensions");
+    }
+
+    // allocate the pyramid
+    uint32_t w = this->_wid;
+    uint32_t h = this->_ht;
+    while (true) {
+        this->_levels.push_back(Level{w, h, std::vector<float>(w * h, 1.0f)});
+        if ((w == 1) && (h == 1)) {
+            break;
+        }
+        w = std::max(1u, (w + 1) / 2);
+        h = std::max(1u, (h + 1) / 2);
+    }
+}
+
+void OcclusionBuffer::begin (glm::mat4 const &viewProj)
+{
+    this->_viewProj = viewProj;
+    this->_nTris = 0;
+    std::fill (this->_levels[0].depth.begin(), this->_levels[0].depth.end(), 1.0f);
+}
+
+void OcclusionBuffer::addTriangles (
+    glm::mat4 const &toWorld,
+    std::vector<glm::vec3> const &verts,
+    std::vector<uint32_t> const &indices)
+{
+    assert (indices.size() % 3 == 0);
+
+    // transform the vertices to screen space; we mark vertices that are in
+    // front of the near plane by setting their depth to a negative value.
+    glm::mat4 m = this->_viewProj * toWorld;
+    float sx = 0.5f * float(this->_wid);
+    float sy = 0.5f * float(this->_ht);
+    std::vector<glm::vec3> scrn(verts.size());
+    for (size_t i = 0;  i < verts.size();  ++i) {
+        glm::vec4 p = m * glm::vec4(verts[i], 1.0f);
+        if ((p.w <= 0.0f) || (p.z < 0.0f)) {
+            scrn[i] = glm::vec3(0.0f, 0.0f, -1.0f);
+        } else {
+            float invW = 1.0f / p.w;
+            scrn[i] = glm::vec3(
+                sx * (p.x * invW + 1.0f),
+                sy * (p.y * invW + 1.0f),
+                p.z * invW);
+        }
+    }
+
+    // triangles that cross the near plane are dropped, which is conservative,
+    // as are triangles that are too small to rasterize
+    size_t nTris = indices.size() / 3;
+    std::vector<char> drawn(nTris);
+    for (size_t t = 0;  t < nTris;  ++t) {
+        glm::vec3 const &v0 = scrn[indices[3*t]];
+        glm::vec3 const &v1 = scrn[indices[3*t+1]];
+        glm::vec3 const &v2 = scrn[indices[3*t+2]];
+        drawn[t] = (v0.z >= 0.0f) && (v1.z >= 0.0f) && (v2.z >= 0.0f)
+            && (std::abs(orient(v0, v1, v2)) >= kMinArea);
+    }
+
+    // find the silhouette edges.  We collect the edges of the drawn triangles,
+    // keyed by their (welded) endpoints, along with the side of the edge that
+    // the triangle is on.  An edge is interior when it has exactly two triangles
+    // that are on opposite sides of it; otherwise it is on the silhouette.
+    struct EdgeRef {
+        uint64_t key;           // the endpoints (smaller ID in the upper half)
+        uint32_t tri;           // the triangle
+        uint32_t opp;           // the index (0..2) of the opposite vertex
+        bool left;              // is the triangle to the left of the edge?
+    };
+    std::vector<uint32_t> id = weldVertices (verts);
+    std::vector<EdgeRef> edges;
+    edges.reserve(3 * nTris);
+    for (size_t t = 0;  t < nTris;  ++t) {
+        if (! drawn[t]) {
+            continue;
+        }
+        for (uint32_t k = 0;  k < 3;  ++k) {
+            uint32_t p = id[indices[3*t + (k+1)%3]];
+            uint32_t q = id[indices[3*t + (k+2)%3]];
+            uint32_t r = indices[3*t + k];
+            if (q < p) {
+                std::swap (p, q);
+            }
+            edges.push_back(EdgeRef{
+                (uint64_t(p) << 32) | uint64_t(q), uint32_t(t), k,
+                orient(scrn[p], scrn[q], scrn[r]) > 0.0f
+            });
+        }
+    }
+    std::sort (edges.begin(), edges.end(),
+        [](EdgeRef const &a, EdgeRef const &b) { return a.key < b.key; });
+
+    std::vector<uint32_t> silhouette(nTris, 0);
+    for (size_t i = 0;  i < edges.size();  ) {
+        size_t j = i + 1;
+        while ((j < edges.size()) && (edges[j].key == edges[i].key)) {
+            ++j;
+        }
+        if ((j - i != 2) || (edges[i].left == edges[i+1].left)) {
+            for (size_t k = i;  k < j;  ++k) {
+                silhouette[edges[k].tri] |= (1u << edges[k].opp);
+            }
+        }
+        i = j;
+    }
+
+    for (size_t t = 0;  t < nTris;  ++t) {
+        if (drawn[t]) {
+            this->_drawTriangle (
+                scrn[indices[3*t]], scrn[indices[3*t+1]], scrn[indices[3*t+2]],
+                silhouette[t]);
+        }
+    }
+}
+
+void OcclusionBuffer::_drawTriangle (
+    glm::vec3 const &v0, glm::vec3 const &p1, glm::vec3 const &p2,
+    uint32_t silhouette)
+{
+    // orient the triangle so that the edge functions are positive on the inside
+    float area = (p1.x - v0.x) * (p2.y - v0.y) - (p1.y - v0.y) * (p2.x - v0.x);
+    if (std::abs(area) < kMinArea) {
+        return;
+    }
+    glm::vec3 v1 = (area > 0.0f) ? p1 : p2;
+    glm::vec3 v2 = (area > 0.0f) ? p2 : p1;
+    if (area < 0.0f) {
+        // swap the flags for the edges opposite v1 and v2
+        silhouette = (silhouette & 1) | ((silhouette & 2) << 1) | ((silhouette & 4) >> 1);
+    }
+    area = std::abs(area);
+
+    // the screen-space bounding box of the triangle clipped to the buffer
+    float xMin = std::max(0.0f, std::floor(std::min(v0.x, std::min(v1.x, v2.x))));
+    float yMin = std::max(0.0f, std::floor(std::min(v0.y, std::min(v1.y, v2.y))));
+    float xMax = std::min(float(this->_wid - 1), std::ceil(std::max(v0.x, std::max(v1.x, v2.x))));
+    float yMax = std::min(float(this->_ht - 1), std::ceil(std::max(v0.y, std::max(v1.y, v2.y))));
+    if ((xMax < xMin) || (yMax < yMin)) {
+        return;
+    }
+    this->_nTris++;
+
+    // edge functions; each edge is opposite the vertex with the same index.
+    // Coverage is sampled at pixel centers, except that the silhouette edges
+    // are moved inward so that partly covered pixels are not covered.
+    Edge e0(v1, v2), e1(v2, v0), e2(v0, v1);
+    if (silhouette & 1) { e0.shrink(); }
+    if (silhouette & 2) { e1.shrink(); }
+    if (silhouette & 4) { e2.shrink(); }
+
+    // the depth plane, plus the offset from the pixel center to the farthest
+    // corner of the pixel, which makes the written depth conservative.  We also
+    // clamp to the farthest vertex to avoid extrapolation at the triangle edges.
+    float dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+    float dzdy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+    float zBias = 0.5f * (std::abs(dzdx) + std::abs(dzdy));
+    float zc = v0.z - dzdx * v0.x - dzdy * v0.y + zBias;
+    F4 zMax = f4Splat(std::max(v0.z, std::max(v1.z, v2.z)));
+
+    // per-lane pixel-center offsets
+    const F4 laneX = f4Set(0.5f, 1.5f, 2.5f, 3.5f);
+    const F4 a0 = f4Splat(e0.a), a1 = f4Splat(e1.a), a2 = f4Splat(e2.a);
+    const F4 dzdx4 = f4Splat(dzdx);
+
+    float *depth = this->_levels[0].depth.data();
+    uint32_t tx0 = uint32_t(xMin) / kTileWid;
+    uint32_t tx1 = uint32_t(xMax) / kTileWid;
+    uint32_t ty0 = uint32_t(yMin) / kTileHt;
+    uint32_t ty1 = uint32_t(yMax) / kTileHt;
+    for (uint32_t ty = ty0;  ty <= ty1;  ++ty) {
+        float y0 = float(ty * kTileHt);
+        for (uint32_t tx = tx0;  tx <= tx1;  ++tx) {
+            float x0 = float(tx * kTileWid);
+            // skip tiles that are completely outside one of the edges
+            if ((e0.maxOverTile(x0, y0) < 0.0f)
+            || (e1.maxOverTile(x0, y0) < 0.0f)
+            || (e2.maxOverTile(x0, y0) < 0.0f)) {
+                continue;
+            }
+            for (uint32_t row = 0;  row < kTileHt;  ++row) {
+                float py = y0 + float(row) + 0.5f;
+                float *rowP = depth + size_t(ty * kTileHt + row) * this->_wid + tx * kTileWid;
+                // the parts of the edge and depth functions that are constant for the row
+                F4 r0 = f4Splat(e0.b * py + e0.c);
+                F4 r1 = f4Splat(e1.b * py + e1.c);
+                F4 r2 = f4Splat(e2.b * py + e2.c);
+                F4 rz = f4Splat(dzdy * py + zc);
+                for (uint32_t col = 0;  col < kTileWid;  col += 4) {
+                    F4 px = f4Add(f4Splat(x0 + float(col)), laneX);
+                    M4 inside = m4Inside(
+                        f4Add(f4Mul(a0, px), r0),
+                        f4Add(f4Mul(a1, px), r1),
+                        f4Add(f4Mul(a2, px), r2));
+                    if (m4Any(inside)) {
+                        F4 z = f4Min(f4Add(f4Mul(dzdx4, px), rz), zMax);
+                        F4 d = f4Load(rowP + col);
+                        f4Store(rowP + col, f4Select(inside, f4Min(d, z), d));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::finish ()
+{
+    // each texel of a level holds the farthest depth of the (up to four)
+    // texels that it covers in the previous level
+    for (size_t lev = 1;  lev < this->_levels.size();  ++lev) {
+        Level const &src = this->_levels[lev-1];
+        Level &dst = this->_levels[lev];
+        for (uint32_t y = 0;  y < dst.ht;  ++y) {
+            uint32_t sy0 = 2*y;
+            uint32_t sy1 = std::min(sy0 + 1, src.ht - 1);
+            for (uint32_t x = 0;  x < dst.wid;  ++x) {
+                uint32_t sx0 = 2*x;
+                uint32_t sx1 = std::min(sx0 + 1, src.wid - 1);
+                dst.depth[y * dst.wid + x] = std::max(
+                    std::max(src.depth[sy0 * src.wid + sx0], src.depth[sy0 * src.wid + sx1]),
+                    std::max(src.depth[sy1 * src.wid + sx0], src.depth[sy1 * src.wid + sx1]));
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::isOccluded (AABBf_t const &bb) const
+{
+    if (bb.isEmpty()) {
+        return false;
+    }
+
+    // project the corners of the box to get its screen-space rectangle and
+    // nearest depth
+    float sx = 0.5f * float(this->_wid);
+    float sy = 0.5f * float(this->_ht);
+    float xMin = std::numeric_limits<float>::max(), xMax = -xMin;
+    float yMin = xMin, yMax = -xMin;
+    float zMin = xMin;
+    for (int i = 0;  i < 8;  ++i) {
+        glm::vec4 p = this->_viewProj * glm::vec4(bb.corner(i), 1.0f);
+        if ((p.w <= 0.0f) || (p.z < 0.0f)) {
+            // the box crosses the near plane
+            return false;
+        }
+        float invW = 1.0f / p.w;
+        float x = sx * (p.x * invW + 1.0f);
+        float y = sy * (p.y * invW + 1.0f);
+        xMin = std::min(xMin, x); xMax = std::max(xMax, x);
+        yMin = std::min(yMin, y); yMax = std::max(yMax, y);
+        zMin = std::min(zMin, p.z * invW);
+    }
+
+    // clip the rectangle to the buffer; boxes that are completely off screen
+    // are left to the frustum culling
+    if ((xMax < 0.0f) || (yMax < 0.0f)
+    || (xMin >= float(this->_wid)) || (yMin >= float(this->_ht))) {
+        return false;
+    }
+    uint32_t x0 = uint32_t(std::max(0.0f, xMin));
+    uint32_t y0 = uint32_t(std::max(0.0f, yMin));
+    uint32_t x1 = std::min(this->_wid - 1, uint32_t(xMax));
+    uint32_t y1 = std::min(this->_ht - 1, uint32_t(yMax));
+
+    // pick the pyramid level where the rectangle covers at most 2x2 texels
+    uint32_t lev = 0;
+    while ((lev + 1 < this->_levels.size())
+    && (((x1 >> lev) - (x0 >> lev) > 1) || ((y1 >> lev) - (y0 >> lev) > 1))) {
+        lev++;
+    }
+
+    Level const &l = this->_levels[lev];
+    for (uint32_t y = (y0 >> lev);  y <= (y1 >> lev);  ++y) {
+        for (uint32_t x = (x0 >> lev);  x <= (x1 >> lev);  ++x) {
+            if (zMin <= l.depth[y * l.wid + x]) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+} // namespace cs237
@@ -0,0 +1,112 @@
+/*! \file parallel-recorder.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include <chrono>
+
+namespace cs237 {
+
+ParallelRecorder::ParallelRecorder (Application *app, uint32_t nFrames, JobSystem *js)
+  : _app(app), _js((js != nullptr) ? js : &app->jobs()),
+    _nFrames(std::max(nFrames, 1u)), _lastTime(0.0)
+{
+    auto device = app->device();
+    this->_chunks.resize(this->_js->numThreads());
+    for (auto &chunk : this->_chunks) {
+        for (uint32_t f = 0;  f < this->_nFrames;  ++f) {
+            // the buffers are re-recorded every frame, so the pool is transient
+            vk::CommandPoolCreateInfo poolInfo(
+                vk::CommandPoolCreateFlagBits::eTransient,
+                app->_qIdxs.graphics);
+            auto pool = device.createCommandPool(poolInfo);
+            vk::CommandBufferAllocateInfo allocInfo(
+                pool,
+                vk::CommandBufferLevel::eSecondary,
+                1); /* buffer count */
+            chunk.pools.push_back(pool);
+            chunk.cmdBufs.push_back(device.allocateCommandBuffers(allocInfo)[0]);
+        }
+    }
+
+}
+
+ParallelRecorder::~ParallelRecorder ()
+{
+    // destroying the pools frees the command buffers
+    auto device = this->_app->device();
+    for (auto &chunk : this->_chunks) {
+        for (auto pool : chunk.pools) {
+            device.destroyCommandPool(pool);
+        }
+    }
+}
+
+void ParallelRecorder::record (
+    uint32_t frame,
+    vk::CommandBuffer primary,
+    vk::RenderPass rp,
+    uint32_t subpass,
+    vk::Framebuffer fb,
+    uint32_t nItems,
+    RecordFn const &fn)
+{
+    assert (frame < this->_nFrames);
+
+    auto start = std::chrono::steady_clock::now();
+
+    auto device = this->_app->device();
+    uint32_t nChunks = this->_chunks.size();
+    vk::CommandBufferInheritanceInfo inheritInfo(rp, subpass, fb);
+    vk::CommandBufferBeginInfo beginInfo(
+        vk::CommandBufferUsageFlagBits::eRenderPassContinue
+        | vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+        &inheritInfo);
+
+    // the chunk boundaries; chunks differ in size by at most one item
+    auto chunkStart = [nItems, nChunks](uint32_t id) {
+        return uint32_t(uint64_t(nItems) * id / nChunks);
+    };
+
+    // each chunk is a separate task, since the chunks use different pools
+    this->_js->parallelFor (0, nChunks, 1, [&](uint32_t lo, uint32_t hi) {
+        for (uint32_t id = lo;  id < hi;  ++id) {
+            uint32_t first = chunkStart(id);
+            uint32_t last = chunkStart(id + 1);
+            if (first < last) {
+                PerChunk &chunk = this->_chunks[id];
+                device.resetCommandPool(chunk.pools[frame]);
+                vk::CommandBuffer cmdBuf = chunk.cmdBufs[frame];
+                cmdBuf.begin(beginInfo);
+                fn (cmdBuf, first, last);
+                cmdBuf.end();
+            }
+        }
+    });
+
+    // execute the secondary buffers in the order of their chunks
+    std::vector<vk::CommandBuffer> cmdBufs;
+    cmdBufs.reserve(nChunks);
+    for (uint32_t id = 0;  id < nChunks;  ++id) {
+        if (chunkStart(id) < chunkStart(id + 1)) {
+            cmdBufs.push_back(this->_chunks[id].cmdBufs[frame]);
+        }
+    }
+    if (! cmdBufs.empty()) {
+        primary.executeCommands(cmdBufs);
+    }
+
+    this->_lastTime = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+}
+
+} // namespace cs237
@@ -11,41 +11,109 @@
  */
 
 #include "cs237.hpp"
-#include <fstream>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+#ifdef CS237_WINDOWS
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
 
 namespace cs237 {
 
-// read the contents of a pre-compiled shader file
-static std::vector<char> _readFile (std::string const &name)
-{
-    std::ifstream file(name, std::ios::ate | std::ios::binary);
+// the contents of a pre-compiled shader file, which is mapped into memory
+// (instead of being copied into a buffer)
+class ShaderFile {
+  public:
+    explicit ShaderFile (std::string const &name);
+    ~ShaderFile ();
 
-    if (!file.is_open()) {
-        ERROR("unable to open shader file \"" + name + "\"!");
-    }
+    void const *data () const { return this->_data; }
+    size_t size () const { return this->_size; }
 
-    // determine the file size; note that the current position is at the *end* of the file.
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
+    // a 64-bit FNV-1a hash of the contents
+    uint64_t hash () const
+    {
+        uint64_t h = 0xcbf29ce484222325ull;
+        auto bytes = static_cast<uint8_t const *>(this->_data);
+        for (size_t i = 0;  i < this->_size;  ++i) {
+            h = (h ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return h;
+    }
 
-    // move back to the beginning and read the contents
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
+  private:
+    void const *_data;
+    size_t _size;
+#ifdef CS237_WINDOWS
+    HANDLE _mapHandle;
+#endif
+};
 
-    file.close();
+#ifdef CS237_WINDOWS
 
-    return buffer;
+ShaderFile::ShaderFile (std::string const &name)
+{
+    HANDLE fh = CreateFileA(
+        name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fh == INVALID_HANDLE_VALUE) {
+        ERROR("unable to open shader file \"" + name + "\"!");
+    }
+    LARGE_INTEGER sz;
+    GetFileSizeEx(fh, &sz);
+    HANDLE mh = CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(fh);
+    if (mh == nullptr) {
+        ERROR("unable to map shader file \"" + name + "\"!");
+    }
+    this->_data = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+    if (this->_data == nullptr) {
+        ERROR("unable to map shader file \"" + name + "\"!");
+    }
+    this->_size = size_t(sz.QuadPart);
+    this->_mapHandle = mh;
+}
 
+ShaderFile::~ShaderFile ()
+{
+    UnmapViewOfFile(this->_data);
+    CloseHandle(this->_mapHandle);
 }
 
-struct Stage {
-    Stage (vk::Device device, std::string const &file, vk::ShaderStageFlagBits k);
+#else // !CS237_WINDOWS
 
-    vk::PipelineShaderStageCreateInfo StageInfo ();
+ShaderFile::ShaderFile (std::string const &name)
+{
+    int fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        ERROR("unable to open shader file \"" + name + "\"!");
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        ERROR("unable to stat shader file \"" + name + "\"!");
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        ERROR("unable to map shader file \"" + name + "\"!");
+    }
+    this->_data = p;
+    this->_size = st.st_size;
+}
 
-    vk::ShaderStageFlagBits kind;
-    vk::ShaderModule module;
-};
+ShaderFile::~ShaderFile ()
+{
+    munmap(const_cast<void *>(this->_data), this->_size);
+}
+
+#endif // CS237_WINDOWS
 
 struct ShaderInfo {
     std::string suffix;
@@ -63,87 +131,210 @@ static std::array<ShaderInfo,5> _shaderInfo = {
     ShaderInfo{ ".comp.spv", vk::ShaderStageFlagBits::eCompute },
 };
 
-Stage::Stage (vk::Device dev, std::string const &name, vk::ShaderStageFlagBits k)
-    : kind(k)
+// create a shader module from SPIR-V code
+static vk::ShaderModule _createModule (vk::Device dev, ShaderFile const &code)
 {
-    // get the code for the shader
-    auto code = _readFile (name);
-
-    // create the shader module
     vk::ShaderModuleCreateInfo moduleInfo(
         {},
         code.size(),
-        reinterpret_cast<const uint32_t*>(code.data()));
+        static_cast<const uint32_t*>(code.data()));
 
-    this->module = dev.createShaderModule(moduleInfo);
+    return dev.createShaderModule(moduleInfo);
+}
+
+/******************** class Shaders ********************/
 
+Shaders::Shaders (vk::Device device, std::string const &stem, vk::ShaderStageFlags stages)
+  : _app(nullptr), _device(device)
+{
+    this->_loadStages (stem, stages);
 }
 
-vk::PipelineShaderStageCreateInfo Stage::StageInfo ()
+Shaders::Shaders (
+    vk::Device device,
+    std::vector<std::string> const &files,
+    vk::ShaderStageFlags stages)
+  : _app(nullptr), _device(device)
 {
-    // info to specify the pipeline stage
-    vk::PipelineShaderStageCreateInfo stageInfo(
-        {},
-        this->kind,
-        this->module,
-        "main",
-        nullptr);
+    this->_loadStages (files, stages);
+}
 
-    return stageInfo;
+Shaders::Shaders (Application *app, std::string const &stem, vk::ShaderStageFlags stages)
+  : _app(app), _device(app->device())
+{
+    this->_loadStages (stem, stages);
 }
 
-Shaders::Shaders (vk::Device device, std::string const &stem, vk::ShaderStageFlags stages)
-  : _device(device)
+Shaders::Shaders (
+    Application *app,
+    std::vector<std::string> const &files,
+    vk::ShaderStageFlags stages)
+  : _app(app), _device(app->device())
+{
+    this->_loadStages (files, stages);
+}
+
+Shaders::~Shaders ()
 {
-    std::vector<Stage> stageVec;
+    for (auto stage : this->_stages) {
+        if (this->_app != nullptr) {
+            this->_app->_releaseShaderModule(stage.module);
+        } else {
+            this->_device.destroyShaderModule(stage.module);
+        }
+    }
+}
 
+void Shaders::_loadStages (std::string const &stem, vk::ShaderStageFlags stages)
+{
     for (int i = 0;  i < _shaderInfo.size();  ++i) {
         if (stages & _shaderInfo[i].bit) {
-            std::string name = stem + _shaderInfo[i].suffix;
-            stageVec.push_back(Stage(device, name, _shaderInfo[i].bit));
+            this->_addStage (stem + _shaderInfo[i].suffix, _shaderInfo[i].bit);
         }
     }
+}
 
-    this->_stages.reserve(stageVec.size());
-    for (auto stage : stageVec) {
-        this->_stages.push_back(stage.StageInfo());
+void Shaders::_loadStages (std::vector<std::string> const &files, vk::ShaderStageFlags stages)
+{
+    int nStages = 0;
+    for (int i = 0;  i < _shaderInfo.size();  ++i) {
+        if (stages & _shaderInfo[i].bit) {
+            nStages++;
+        }
+    }
+    if (files.size() > nStages) {
+        ERROR("more shader source files than shader stages");
+    } else if (files.size() != nStages) {
+        ERROR("mismatch in number of files/stages");
     }
 
+    for (int i = 0, j = 0;  i < _shaderInfo.size();  ++i) {
+        if (stages & _shaderInfo[i].bit) {
+            this->_addStage (files[j++], _shaderInfo[i].bit);
+        }
+    }
 }
 
-Shaders::Shaders (
-    vk::Device device,
-    std::vector<std::string> const &files,
-    vk::ShaderStageFlags stages)
-  : _device(device)
+void Shaders::_addStage (std::string const &file, vk::ShaderStageFlagBits kind)
 {
-    std::vector<Stage> stageVec;
-    for (int i = 0, j = 0;  i < _shaderInfo.size();  ++i) {
-        if (stages & _shaderInfo[i].bit) {
-            if (j < files.size()) {
-                stageVec.push_back(Stage(device, files[j++], _shaderInfo[i].bit));
-            } else {
-                ERROR("more shader source files than shader stages");
-            }
+    vk::ShaderModule module;
+    if (this->_app != nullptr) {
+        auto const &cached = this->_app->_acquireShaderModule(file);
+        module = cached.module;
+        // the cached reflection info does not depend on the stage, so we
+        // attribute the resources to this stage
+        for (auto b : cached.bindings) {
+            b.stages = kind;
+            __detail::mergeBinding (this->_bindings, b);
         }
+        if (cached.pushConsts.size > 0) {
+            vk::PushConstantRange pc = cached.pushConsts;
+            pc.stageFlags = kind;
+            __detail::mergePushConstants (this->_pushConsts, pc);
+        }
+    } else {
+        ShaderFile code(file);
+        // record the descriptors and push constants that the shader uses
+        __detail::reflectSPIRV (code.data(), code.size(), kind, this->_bindings, this->_pushConsts);
+        module = _createModule (this->_device, code);
     }
 
-    if (files.size() != stageVec.size()) {
-        ERROR("mismatch in number of files/stages");
+    // info to specify the pipeline stage
+    this->_stages.push_back(vk::PipelineShaderStageCreateInfo(
+        {},
+        kind,
+        module,
+        "main",
+        nullptr));
+
+}
+
+/******************** Application shader-module cache ********************/
+
+Application::CachedShader const &Application::_acquireShaderModule (std::string const &file)
+{
+    ShaderFile code(file);
+
+    // the key combines the path with the contents, so that a file that has
+    // been recompiled gets a new module
+    std::ostringstream key;
+    key << file << '#' << std::hex << std::setw(16) << std::setfill('0') << code.hash();
+
+    auto it = this->_shaderModules.find(key.str());
+    if (it != this->_shaderModules.end()) {
+        it->second.refCount++;
+        this->_shaderHits++;
+        return it->second;
     }
 
-    this->_stages.reserve(stageVec.size());
-    for (auto stage : stageVec) {
-        this->_stages.push_back(stage.StageInfo());
+    // discard unused modules for older versions of the file
+    for (auto jt = this->_shaderModules.begin();  jt != this->_shaderModules.end(); ) {
+        if ((jt->second.refCount == 0) && (jt->second.path == file)) {
+            this->_device.destroyShaderModule(jt->second.module);
+            jt = this->_shaderModules.erase(jt);
+        } else {
+            ++jt;
+        }
     }
 
+    CachedShader entry;
+    entry.path = file;
+    entry.module = _createModule (this->_device, code);
+    entry.refCount = 1;
+    __detail::reflectSPIRV (
+        code.data(), code.size(), vk::ShaderStageFlagBits::eAll,
+        entry.bindings, entry.pushConsts);
+
+    return this->_shaderModules.insert({key.str(), entry}).first->second;
+
 }
 
-Shaders::~Shaders ()
+void Application::_releaseShaderModule (vk::ShaderModule module)
 {
-    for (auto stage : this->_stages) {
-        this->_device.destroyShaderModule(stage.module);
+    for (auto &it : this->_shaderModules) {
+        if (it.second.module == module) {
+            assert (it.second.refCount > 0);
+            // unreferenced modules stay in the cache until the application exits
+            it.second.refCount--;
+            return;
+        }
     }
 }
 
+uint32_t Application::preloadShaders (std::string const &dir)
+{
+    std::error_code ec;
+    std::filesystem::directory_iterator dirIt(dir, ec);
+    if (ec) {
+        std::cerr << "warning: unable to read shader directory \"" << dir << "\"\n";
+        return 0;
+    }
+
+    // preloading should not count as cache hits
+    uint32_t hits = this->_shaderHits;
+
+    uint32_t n = 0;
+    for (auto const &ent : dirIt) {
+        if (! ent.is_regular_file()) {
+            continue;
+        }
+        std::string path = ent.path().string();
+        for (auto const &info : _shaderInfo) {
+            if ((path.size() > info.suffix.size())
+            && (path.compare(path.size() - info.suffix.size(), std::string::npos, info.suffix) == 0)) {
+                // load the module without holding a reference to it
+                auto const &entry = this->_acquireShaderModule(path);
+                this->_releaseShaderModule(entry.module);
+                n++;
+                break;
+            }
+        }
+    }
+
+    this->_shaderHits = hits;
+
+    return n;
+
+}
+
 } // namespace cs237
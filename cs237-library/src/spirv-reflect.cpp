@@ -0,0 +1,468 @@
+/*! \file spirv-reflect.cpp
+ *
+ * Support code for CMSC 23700 Autumn 2023.
+ *
+ * A minimal reflection pass over SPIR-V modules, which determines the
+ * descriptor bindings and the push-constant range that a shader uses.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "cs237.hpp"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+namespace cs237 {
+
+namespace __detail {
+
+// The parts of the SPIR-V specification that we need
+constexpr uint32_t kSpvMagic = 0x07230203;
+constexpr uint32_t kSpvHeaderWords = 5;
+
+// opcodes
+constexpr uint32_t kOpTypeBool = 20;
+constexpr uint32_t kOpTypeInt = 21;
+constexpr uint32_t kOpTypeFloat = 22;
+constexpr uint32_t kOpTypeVector = 23;
+constexpr uint32_t kOpTypeMatrix = 24;
+constexpr uint32_t kOpTypeImage = 25;
+constexpr uint32_t kOpTypeSampler = 26;
+constexpr uint32_t kOpTypeSampledImage = 27;
+constexpr uint32_t kOpTypeArray = 28;
+constexpr uint32_t kOpTypeRuntimeArray = 29;
+constexpr uint32_t kOpTypeStruct = 30;
+constexpr uint32_t kOpTypePointer = 32;
+constexpr uint32_t kOpConstant = 43;
+constexpr uint32_t kOpSpecConstant = 50;
+constexpr uint32_t kOpVariable = 59;
+constexpr uint32_t kOpDecorate = 71;
+constexpr uint32_t kOpMemberDecorate = 72;
+constexpr uint32_t kOpTypeAccelerationStructure = 5341;
+
+// decorations
+constexpr uint32_t kDecBlock = 2;
+constexpr uint32_t kDecBufferBlock = 3;
+constexpr uint32_t kDecRowMajor = 4;
+constexpr uint32_t kDecArrayStride = 6;
+constexpr uint32_t kDecMatrixStride = 7;
+constexpr uint32_t kDecBinding = 33;
+constexpr uint32_t kDecDescriptorSet = 34;
+constexpr uint32_t kDecOffset = 35;
+
+// storage classes
+constexpr uint32_t kStorageUniformConstant = 0;
+constexpr uint32_t kStorageUniform = 2;
+constexpr uint32_t kStoragePushConstant = 9;
+constexpr uint32_t kStorageStorageBuffer = 12;
+
+// image dimensions
+constexpr uint32_t kDimBuffer = 5;
+constexpr uint32_t kDimSubpassData = 6;
+
+/// the information that we collect about the IDs in a module
+struct SpvModule {
+    /// a type declaration; `ops` are the operands after the result ID
+    struct Type {
+        uint32_t op;
+        std::vector<uint32_t> ops;
+    };
+    /// the decorations of an ID (or of a struct member)
+    struct Decorations {
+        int32_t set = -1;
+        int32_t binding = -1;
+        bool block = false;
+        bool bufferBlock = false;
+        bool rowMajor = false;
+        uint32_t arrayStride = 0;
+        uint32_t matrixStride = 0;
+        uint32_t offset = 0;
+    };
+    /// a global variable
+    struct Var {
+        uint32_t id;
+        uint32_t type;
+        uint32_t storage;
+    };
+
+    std::unordered_map<uint32_t, Type> types;
+    std::unordered_map<uint32_t, uint32_t> constants;   ///< values of integer constants
+    std::unordered_map<uint32_t, Decorations> decs;
+    std::map<std::pair<uint32_t, uint32_t>, Decorations> memberDecs;
+    std::vector<Var> vars;
+
+    /// parse a module; it is an error if the code is not valid SPIR-V
+    SpvModule (uint32_t const *code, size_t nWords);
+
+    /// get a type declaration
+    Type const &type (uint32_t id) const
+    {
+        auto it = this->types.find(id);
+        if (it == this->types.end()) {
+            ERROR("SPIR-V reflection: unknown type ID");
+        }
+        return it->second;
+    }
+
+    /// get the value of an integer constant
+    uint32_t constant (uint32_t id) const
+    {
+        auto it = this->constants.find(id);
+        if (it == this->constants.end()) {
+            ERROR("SPIR-V reflection: array length is not a constant");
+        }
+        return it->second;
+    }
+
+    /// get the decorations of an ID
+    Decorations decorations (uint32_t id) const
+    {
+        auto it = this->decs.find(id);
+        return (it == this->decs.end()) ? Decorations() : it->second;
+    }
+
+    /// get the decorations of a struct member
+    Decorations memberDecorations (uint32_t id, uint32_t member) const
+    {
+        auto it = this->memberDecs.find({id, member});
+        return (it == this->memberDecs.end()) ? Decorations() : it->second;
+    }
+
+    /// the size in bytes of a value of the given type in an explicitly laid-out
+    /// block; `dec` holds the matrix decorations of the enclosing member
+    uint32_t sizeOf (uint32_t ty, Decorations const &dec) const;
+
+};
+
+/// record a decoration
+static void addDecoration (SpvModule::Decorations &d, uint32_t dec, uint32_t const *lits, uint32_t nLits)
+{
+    uint32_t v = (nLits > 0) ? lits[0] : 0;
+    switch (dec) {
+    case kDecBlock: d.block = true; break;
+    case kDecBufferBlock: d.bufferBlock = true; break;
+    case kDecRowMajor: d.rowMajor = true; break;
+    case kDecArrayStride: d.arrayStride = v; break;
+    case kDecMatrixStride: d.matrixStride = v; break;
+    case kDecBinding: d.binding = v; break;
+    case kDecDescriptorSet: d.set = v; break;
+    case kDecOffset: d.offset = v; break;
+    default: break;
+    }
+}
+
+SpvModule::SpvModule (uint32_t const *code, size_t nWords)
+{
+    if ((nWords < kSpvHeaderWords) || (code[0] != kSpvMagic)) {
+        ERROR("SPIR-V reflection: invalid module header");
+    }
+
+    size_t pc = kSpvHeaderWords;
+    while (pc < nWords) {
+        uint32_t op = code[pc] & 0xffff;
+        uint32_t len = code[pc] >> 16;
+        if ((len == 0) || (pc + len > nWords)) {
+            ERROR("SPIR-V reflection: malformed instruction");
+        }
+        uint32_t const *args = code + pc + 1;
+        uint32_t nArgs = len - 1;
+
+        switch (op) {
+        case kOpTypeBool:
+        case kOpTypeInt:
+        case kOpTypeFloat:
+        case kOpTypeVector:
+        case kOpTypeMatrix:
+        case kOpTypeImage:
+        case kOpTypeSampler:
+        case kOpTypeSampledImage:
+        case kOpTypeArray:
+        case kOpTypeRuntimeArray:
+        case kOpTypeStruct:
+        case kOpTypePointer:
+        case kOpTypeAccelerationStructure:
+            this->types[args[0]] = Type{op, std::vector<uint32_t>(args + 1, args + nArgs)};
+            break;
+        case kOpConstant:
+        case kOpSpecConstant:
+            // <result type> <result id> <value>; we only need 32-bit integers for
+            // array lengths.  For specialization constants, this is the default value.
+            if (nArgs >= 3) {
+                this->constants[args[1]] = args[2];
+            }
+            break;
+        case kOpVariable:
+            // <result type> <result id> <storage class> [<initializer>]
+            this->vars.push_back(Var{args[1], args[0], args[2]});
+            break;
+        case kOpDecorate:
+            // <target> <decoration> <literals...>
+            addDecoration (this->decs[args[0]], args[1], args + 2, nArgs - 2);
+            break;
+        case kOpMemberDecorate:
+            // <struct type> <member> <decoration> <literals...>
+            addDecoration (this->memberDecs[{args[0], args[1]}], args[2], args + 3, nArgs - 3);
+            break;
+        default:
+            break;
+        }
+
+        pc += len;
+    }
+
+}
+
+uint32_t SpvModule::sizeOf (uint32_t ty, Decorations const &dec) const
+{
+    Type const &t = this->type(ty);
+    switch (t.op) {
+    case kOpTypeBool:
+        return 4;
+    case kOpTypeInt:
+    case kOpTypeFloat:
+        return t.ops[0] / 8;
+    case kOpTypeVector:
+        return t.ops[1] * this->sizeOf(t.ops[0], dec);
+    case kOpTypeMatrix:
+        if (dec.rowMajor) {
+            // each row is strided; the number of rows is the column-vector length
+            return this->type(t.ops[0]).ops[1] * dec.matrixStride;
+        } else {
+            return t.ops[1] * dec.matrixStride;
+        }
+    case kOpTypeArray:
+        return this->constant(t.ops[1]) * this->decorations(ty).arrayStride;
+    case kOpTypeStruct: {
+            uint32_t sz = 0;
+            for (uint32_t i = 0;  i < t.ops.size();  ++i) {
+                Decorations mdec = this->memberDecorations(ty, i);
+                sz = std::max(sz, mdec.offset + this->sizeOf(t.ops[i], mdec));
+            }
+            return sz;
+        }
+    default:
+        ERROR("SPIR-V reflection: unexpected type in block");
+    }
+}
+
+void mergeBinding (std::vector<ShaderBinding> &bindings, ShaderBinding const &sb)
+{
+    for (auto &b : bindings) {
+        if ((b.set == sb.set) && (b.binding == sb.binding)) {
+            if (b.type != sb.type) {
+                ERROR("conflicting descriptor types for binding "
+                    + std::to_string(b.binding) + " of set " + std::to_string(b.set));
+            }
+            // a count of zero marks a runtime-sized array
+            b.count = ((b.count == 0) || (sb.count == 0)) ? 0 : std::max(b.count, sb.count);
+            b.stages |= sb.stages;
+            return;
+        }
+    }
+    bindings.push_back(sb);
+}
+
+void mergePushConstants (vk::PushConstantRange &pcRange, vk::PushConstantRange const &pc)
+{
+    if (pc.size == 0) {
+        return;
+    } else if (pcRange.size == 0) {
+        pcRange = pc;
+    } else {
+        uint32_t end = std::max(pcRange.offset + pcRange.size, pc.offset + pc.size);
+        pcRange.offset = std::min(pcRange.offset, pc.offset);
+        pcRange.size = end - pcRange.offset;
+        pcRange.stageFlags |= pc.stageFlags;
+    }
+}
+
+void reflectSPIRV (
+    void const *code,
+    size_t nBytes,
+    vk::ShaderStageFlagBits stage,
+    std::vector<ShaderBinding> &bindings,
+    vk::PushConstantRange &pcRange)
+{
+    SpvModule mod(static_cast<uint32_t const *>(code), nBytes / 4);
+
+    for (auto const &var : mod.vars) {
+        SpvModule::Type const &ptrTy = mod.type(var.type);
+        if (ptrTy.op != kOpTypePointer) {
+            continue;
+        }
+        uint32_t ty = ptrTy.ops[1];
+
+        if (var.storage == kStoragePushConstant) {
+            SpvModule::Type const &blk = mod.type(ty);
+            if (blk.op != kOpTypeStruct) {
+                continue;
+            }
+            uint32_t lo = ~0u;
+            uint32_t hi = 0;
+            for (uint32_t i = 0;  i < blk.ops.size();  ++i) {
+                SpvModule::Decorations mdec = mod.memberDecorations(ty, i);
+                lo = std::min(lo, mdec.offset);
+                hi = std::max(hi, mdec.offset + mod.sizeOf(blk.ops[i], mdec));
+            }
+            if (hi > lo) {
+                mergePushConstants (pcRange, vk::PushConstantRange(stage, lo, hi - lo));
+            }
+            continue;
+        }
+
+        if ((var.storage != kStorageUniformConstant)
+        && (var.storage != kStorageUniform)
+        && (var.storage != kStorageStorageBuffer)) {
+            continue;
+        }
+        SpvModule::Decorations vdec = mod.decorations(var.id);
+        if ((vdec.set < 0) || (vdec.binding < 0)) {
+            continue;
+        }
+
+        // strip arrays of descriptors
+        uint32_t count = 1;
+        while (true) {
+            SpvModule::Type const &t = mod.type(ty);
+            if (t.op == kOpTypeArray) {
+                count *= mod.constant(t.ops[1]);
+                ty = t.ops[0];
+            } else if (t.op == kOpTypeRuntimeArray) {
+                count = 0;
+                ty = t.ops[0];
+            } else {
+                break;
+            }
+        }
+
+        // determine the descriptor type
+        SpvModule::Type const &t = mod.type(ty);
+        vk::DescriptorType dty;
+        if (t.op == kOpTypeSampledImage) {
+            SpvModule::Type const &img = mod.type(t.ops[0]);
+            dty = (img.ops[1] == kDimBuffer)
+                ? vk::DescriptorType::eUniformTexelBuffer
+                : vk::DescriptorType::eCombinedImageSampler;
+        } else if (t.op == kOpTypeImage) {
+            // operands: <sampled type> <dim> <depth> <arrayed> <MS> <sampled> <format>
+            uint32_t dim = t.ops[1];
+            bool storage = (t.ops[5] == 2);
+            if (dim == kDimSubpassData) {
+                dty = vk::DescriptorType::eInputAttachment;
+            } else if (dim == kDimBuffer) {
+                dty = storage
+                    ? vk::DescriptorType::eStorageTexelBuffer
+                    : vk::DescriptorType::eUniformTexelBuffer;
+            } else {
+                dty = storage
+                    ? vk::DescriptorType::eStorageImage
+                    : vk::DescriptorType::eSampledImage;
+            }
+        } else if (t.op == kOpTypeSampler) {
+            dty = vk::DescriptorType::eSampler;
+        } else if (t.op == kOpTypeAccelerationStructure) {
+            dty = vk::DescriptorType::eAccelerationStructureKHR;
+        } else if (t.op == kOpTypeStruct) {
+            // before SPIR-V 1.3, storage buffers are uniform-class blocks that are
+            // decorated as `BufferBlock`
+            dty = ((var.storage == kStorageStorageBuffer) || mod.decorations(ty).bufferBlock)
+                ? vk::DescriptorType::eStorageBuffer
+                : vk::DescriptorType::eUniformBuffer;
+        } else {
+            ERROR("SPIR-V reflection: unexpected descriptor type");
+        }
+
+        mergeBinding (bindings, ShaderBinding{
+                uint32_t(vdec.set), uint32_t(vdec.binding), dty, count, stage
+            });
+    }
+
+}
+
+} // namespace __detail
+
+/******************** class PipelineInterface ********************/
+
+void PipelineInterface::add (Shaders const *shaders)
+{
+    for (auto const &sb : shaders->bindings()) {
+        __detail::mergeBinding (this->_bindings, sb);
+    }
+
+    // keep the bindings sorted by set and then binding
+    std::sort (this->_bindings.begin(), this->_bindings.end(),
+        [](ShaderBinding const &a, ShaderBinding const &b) {
+            return (a.set < b.set) || ((a.set == b.set) && (a.binding < b.binding));
+        });
+
+    __detail::mergePushConstants (this->_pushConsts, shaders->pushConstants());
+
+}
+
+void PipelineInterface::setDynamic (uint32_t set, uint32_t binding)
+{
+    for (auto &b : this->_bindings) {
+        if ((b.set == set) && (b.binding == binding)) {
+            if (b.type == vk::DescriptorType::eUniformBuffer) {
+                b.type = vk::DescriptorType::eUniformBufferDynamic;
+            } else if (b.type == vk::DescriptorType::eStorageBuffer) {
+                b.type = vk::DescriptorType::eStorageBufferDynamic;
+            } else if ((b.type != vk::DescriptorType::eUniformBufferDynamic)
+            && (b.type != vk::DescriptorType::eStorageBufferDynamic)) {
+                ERROR("binding " + std::to_string(binding) + " of set "
+                    + std::to_string(set) + " is not a buffer");
+            }
+            return;
+        }
+    }
+    ERROR("binding " + std::to_string(binding) + " of set "
+        + std::to_string(set) + " is not used by the shaders");
+}
+
+uint32_t PipelineInterface::numSets () const
+{
+    return this->_bindings.empty() ? 0 : this->_bindings.back().set + 1;
+}
+
+std::vector<vk::DescriptorSetLayoutBinding> PipelineInterface::setBindings (uint32_t set) const
+{
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    for (auto const &b : this->_bindings) {
+        if (b.set == set) {
+            bindings.push_back(vk::DescriptorSetLayoutBinding(
+                b.binding, /* binding */
+                b.type, /* descriptor type */
+                b.count, /* descriptor count */
+                b.stages, /* stages */
+                nullptr)); /* immutable samplers */
+        }
+    }
+    return bindings;
+}
+
+std::vector<vk::DescriptorPoolSize> PipelineInterface::poolSizes (
+    std::vector<uint32_t> const &nSets) const
+{
+    std::map<vk::DescriptorType, uint32_t> counts;
+    for (auto const &b : this->_bindings) {
+        if (b.set < nSets.size()) {
+            counts[b.type] += b.count * nSets[b.set];
+        }
+    }
+
+    std::vector<vk::DescriptorPoolSize> sizes;
+    for (auto const &it : counts) {
+        if (it.second > 0) {
+            sizes.push_back(vk::DescriptorPoolSize(it.first, it.second));
+        }
+    }
+    return sizes;
+}
+
+} // namespace cs237
@@ -72,11 +72,38 @@ static void scrollCB (GLFWwindow *win, double xoffset, double yoffset)
     winObj->scroll (xoffset, yoffset);
 }
 
+/// the number of offscreen color images that rotate in headless mode
+constexpr uint32_t kNumOffscreenImages = 3;
+
+/// the format of the offscreen color images; this is the surface format
+/// that we prefer when there is a window
+constexpr vk::Format kOffscreenFormat = vk::Format::eB8G8R8A8Srgb;
+
 /******************** class Window methods ********************/
 
 Window::Window (Application *app, CreateWindowInfo const &info)
-    : _app(app), _win(nullptr), _surf(nullptr), _swap(app->_device)
+    : _app(app), _win(nullptr), _nFrames(0), _frameStats(nullptr),
+      _surf(nullptr), _swap(app->_device)
 {
+    if (app->benchmarking()) {
+        this->_frameStats = new FrameStats(app);
+    }
+
+    this->_wid = info.wid;
+    this->_ht = info.ht;
+    this->_isVis = true;
+    this->_keyEnabled = false;
+    this->_cursorPosEnabled = false;
+    this->_cursorEnterEnabled = false;
+    this->_mouseButtonEnabled = false;
+    this->_scrollEnabled = false;
+
+    if (app->headless()) {
+        // no window or surface; just the offscreen images
+        this->_createSwapChain (info.depth, info.stencil);
+        return;
+    }
+
     glfwWindowHint(GLFW_RESIZABLE, info.resizable ? GLFW_TRUE : GLFW_FALSE);
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
@@ -99,14 +126,6 @@ Window::Window (Application *app, CreateWindowInfo const &info)
     glfwSetWindowIconifyCallback (window, iconifyCB);
 
     this->_win = window;
-    this->_wid = info.wid;
-    this->_ht = info.ht;
-    this->_isVis = true;
-    this->_keyEnabled = false;
-    this->_cursorPosEnabled = false;
-    this->_cursorEnterEnabled = false;
-    this->_mouseButtonEnabled = false;
-    this->_scrollEnabled = false;
 
     // set up the Vulkan surface for the window
     VkSurfaceKHR surf;
@@ -122,13 +141,20 @@ Window::Window (Application *app, CreateWindowInfo const &info)
 
 Window::~Window ()
 {
+    if (this->_frameStats != nullptr) {
+        this->_frameStats->report (this->_app->benchFile());
+        delete this->_frameStats;
+    }
+
     // destroy the swap chain as associated state
     this->_swap.cleanup ();
 
-    // delete the surface
-    this->_app->_instance.destroySurfaceKHR(this->_surf);
+    if (this->_win != nullptr) {
+        // delete the surface
+        this->_app->_instance.destroySurfaceKHR(this->_surf);
 
-    glfwDestroyWindow (this->_win);
+        glfwDestroyWindow (this->_win);
+    }
 }
 
 void Window::reshape (int wid, int ht)
@@ -155,6 +181,11 @@ void Window::scroll (double xoffset, double yoffset) { }
 
 void Window::enableKeyEvent (bool enable)
 {
+    if (this->_win == nullptr) {
+        // no events when headless
+        return;
+    }
+
     if (this->_keyEnabled && (! enable)) {
         // disable the callback
         this->_keyEnabled = false;
@@ -170,11 +201,18 @@ void Window::enableKeyEvent (bool enable)
 
 void Window::setCursorMode (int mode)
 {
-    glfwSetInputMode (this->_win, GLFW_CURSOR, mode);
+    if (this->_win != nullptr) {
+        glfwSetInputMode (this->_win, GLFW_CURSOR, mode);
+    }
 }
 
 void Window::enableCursorPosEvent (bool enable)
 {
+    if (this->_win == nullptr) {
+        // no events when headless
+        return;
+    }
+
     if (this->_cursorPosEnabled && (! enable)) {
         // disable the callback
         this->_cursorPosEnabled = false;
@@ -190,6 +228,11 @@ void Window::enableCursorPosEvent (bool enable)
 
 void Window::enableCursorEnterEvent (bool enable)
 {
+    if (this->_win == nullptr) {
+        // no events when headless
+        return;
+    }
+
     if (this->_cursorEnterEnabled && (! enable)) {
         // disable the callback
         this->_cursorEnterEnabled = false;
@@ -205,6 +248,11 @@ void Window::enableCursorEnterEvent (bool enable)
 
 void Window::enableMouseButtonEvent (bool enable)
 {
+    if (this->_win == nullptr) {
+        // no events when headless
+        return;
+    }
+
     if (this->_mouseButtonEnabled && (! enable)) {
         // disable the callback
         this->_mouseButtonEnabled = false;
@@ -220,6 +268,11 @@ void Window::enableMouseButtonEvent (bool enable)
 
 void Window::enableScrollEvent (bool enable)
 {
+    if (this->_win == nullptr) {
+        // no events when headless
+        return;
+    }
+
     if (this->_scrollEnabled && (! enable)) {
         // disable the callback
         this->_scrollEnabled = false;
@@ -256,6 +309,47 @@ void Window::_createSwapChain (bool depth, bool stencil)
     }
     this->_swap.numAttachments = (dsFormat == vk::Format::eUndefined) ? 1 : 2;
 
+    vk::Extent2D extent;
+    if (this->_app->headless()) {
+        extent = vk::Extent2D(uint32_t(this->_wid), uint32_t(this->_ht));
+        this->_createOffscreenImages (extent);
+    } else {
+        extent = this->_createSurfaceSwapChain ();
+    }
+
+    // create an image view per swap-chain image
+    this->_swap.views.resize(this->_swap.images.size());
+    for (int i = 0; i < this->_swap.images.size(); ++i) {
+        this->_swap.views[i] = this->_app->_createImageView(
+            this->_swap.images[i],
+            this->_swap.imageFormat,
+            vk::ImageAspectFlagBits::eColor);
+    }
+
+    if (dsFormat != vk::Format::eUndefined) {
+        // initialize the depth/stencil-buffer
+        DepthStencilBuffer dsBuf;
+        dsBuf.depth = depth;
+        dsBuf.stencil = stencil;
+        dsBuf.format = dsFormat;
+        dsBuf.image = this->_app->_createImage(
+            extent.width, extent.height,
+            dsFormat,
+            vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eDepthStencilAttachment);
+        dsBuf.imageMem = this->_app->_allocImageMemory(
+            dsBuf.image,
+            vk::MemoryPropertyFlagBits::eDeviceLocal);
+        dsBuf.view = this->_app->_createImageView (
+            dsBuf.image,
+            dsFormat,
+            vk::ImageAspectFlagBits::eDepth);
+        this->_swap.dsBuf = dsBuf;
+    }
+}
+
+vk::Extent2D Window::_createSurfaceSwapChain ()
+{
     SwapChainDetails swapChainSupport = this->_getSwapChainDetails ();
 
     // choose the best aspects of the swap chain
@@ -303,34 +397,29 @@ void Window::_createSwapChain (bool depth, bool stencil)
     this->_swap.imageFormat = surfaceFormat.format;
     this->_swap.extent = extent;
 
-    // create an image view per swap-chain image
-    this->_swap.views.resize(this->_swap.images.size());
-    for (int i = 0; i < this->_swap.images.size(); ++i) {
-        this->_swap.views[i] = this->_app->_createImageView(
-            this->_swap.images[i],
-            this->_swap.imageFormat,
-            vk::ImageAspectFlagBits::eColor);
-    }
+    return extent;
+}
 
-    if (dsFormat != vk::Format::eUndefined) {
-        // initialize the depth/stencil-buffer
-        DepthStencilBuffer dsBuf;
-        dsBuf.depth = depth;
-        dsBuf.stencil = stencil;
-        dsBuf.format = dsFormat;
-        dsBuf.image = this->_app->_createImage(
+void Window::_createOffscreenImages (vk::Extent2D extent)
+{
+    this->_swap.chain = nullptr;
+    this->_swap.imageFormat = kOffscreenFormat;
+    this->_swap.extent = extent;
+    this->_swap.nextImage = 0;
+
+    // the images are transfer sources so that the frames can be read back
+    this->_swap.images.resize(kNumOffscreenImages);
+    this->_swap.imageMems.resize(kNumOffscreenImages);
+    for (uint32_t i = 0;  i < kNumOffscreenImages;  ++i) {
+        this->_swap.images[i] = this->_app->_createImage(
             extent.width, extent.height,
-            dsFormat,
+            kOffscreenFormat,
             vk::ImageTiling::eOptimal,
-            vk::ImageUsageFlagBits::eDepthStencilAttachment);
-        dsBuf.imageMem = this->_app->_allocImageMemory(
-            dsBuf.image,
+            vk::ImageUsageFlagBits::eColorAttachment
+                | vk::ImageUsageFlagBits::eTransferSrc);
+        this->_swap.imageMems[i] = this->_app->_allocImageMemory(
+            this->_swap.images[i],
             vk::MemoryPropertyFlagBits::eDeviceLocal);
-        dsBuf.view = this->_app->_createImageView (
-            dsBuf.image,
-            dsFormat,
-            vk::ImageAspectFlagBits::eDepth);
-        this->_swap.dsBuf = dsBuf;
     }
 }
 
@@ -365,7 +454,7 @@ void Window::_initAttachments (
     descs[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
     descs[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
     descs[0].initialLayout = vk::ImageLayout::eUndefined;
-    descs[0].finalLayout = vk::ImageLayout::ePresentSrcKHR;
+    descs[0].finalLayout = this->_swap.presentLayout();
 
     refs[0].attachment = 0;
     refs[0].layout = vk::ImageLayout::eColorAttachmentOptimal;
@@ -510,8 +599,18 @@ void Window::SwapChain::cleanup ()
     }
     this->views.clear();
     /* note that the images are owned by the swap chain object, so we do not have
-     * to destroy them.
+     * to destroy them, unless they are offscreen images.
      */
+    for (auto img : this->images) {
+        if (this->isOffscreen()) {
+            this->device.destroyImage(img);
+        }
+    }
+    for (auto mem : this->imageMems) {
+        this->device.freeMemory(mem);
+    }
+    this->images.clear();
+    this->imageMems.clear();
 
     // cleanup the depth buffer (if present)
     if (this->dsBuf.has_value()) {
@@ -520,7 +619,10 @@ void Window::SwapChain::cleanup ()
         this->device.freeMemory(this->dsBuf->imageMem);
     }
 
-    this->device.destroySwapchainKHR(this->chain);
+    if (this->chain) {
+        this->device.destroySwapchainKHR(this->chain);
+        this->chain = nullptr;
+    }
 }
 
 /******************** struct Window::SyncObjs methods ********************/
@@ -539,6 +641,10 @@ void Window::SyncObjs::allocate ()
 
     vk::FenceCreateInfo fenceInfo(vk::FenceCreateFlagBits::eSignaled);
     this->inFlight = device.createFence(fenceInfo);
+
+    if (this->win->_frameStats != nullptr) {
+        this->statsSlot = this->win->_frameStats->newSlot();
+    }
 }
 
 Window::SyncObjs::~SyncObjs ()
@@ -563,6 +669,19 @@ vk::ResultValue<uint32_t> Window::SyncObjs::acquireNextImage ()
         return vk::ResultValue<uint32_t>(sts, UINT32_MAX);
     }
 
+    if (this->win->_frameStats != nullptr) {
+        this->win->_frameStats->beginFrame (this->statsSlot);
+    }
+
+    auto &swap = this->win->_swap;
+    if (swap.isOffscreen()) {
+        // the fence guarantees that the GPU is done with this frame's
+        // commands, so we can just rotate through the images
+        uint32_t idx = swap.nextImage;
+        swap.nextImage = (idx + 1) % swap.size();
+        return vk::ResultValue<uint32_t>(vk::Result::eSuccess, idx);
+    }
+
     return this->win->device().acquireNextImageKHR(
         this->win->_swap.chain,
         UINT64_MAX,
@@ -582,11 +701,27 @@ void Window::SyncObjs::submitCommands (vk::Queue q, vk::CommandBuffer const &cmd
 {
     assert (this->imageAvailable);
 
+    // when benchmarking, the commands are bracketed by timestamp queries
+    std::vector<vk::CommandBuffer> cmdBufs;
+    if (this->win->_frameStats != nullptr) {
+        this->win->_frameStats->submit (this->statsSlot, cmdBuf, cmdBufs);
+    } else {
+        cmdBufs.push_back (cmdBuf);
+    }
+
+    if (this->win->_swap.isOffscreen()) {
+        // there is no presentation engine to synchronize with
+        vk::SubmitInfo submitInfo;
+        submitInfo.setCommandBuffers (cmdBufs);
+        q.submit({ submitInfo }, this->inFlight);
+        return;
+    }
+
     vk::PipelineStageFlags pipeFlags = vk::PipelineStageFlagBits::eColorAttachmentOutput;
     vk::SubmitInfo submitInfo(
         this->imageAvailable,
         pipeFlags,
-        cmdBuf,
+        cmdBufs,
         this->renderFinished);
 
     q.submit({ submitInfo }, this->inFlight);
@@ -595,6 +730,16 @@ void Window::SyncObjs::submitCommands (vk::Queue q, vk::CommandBuffer const &cmd
 
 vk::Result Window::SyncObjs::present (vk::Queue q, uint32_t imageIndex)
 {
+    this->win->_nFrames++;
+    if (this->win->_frameStats != nullptr) {
+        this->win->_frameStats->endFrame ();
+    }
+
+    if (this->win->_swap.isOffscreen()) {
+        // the image stays in its offscreen buffer
+        return vk::Result::eSuccess;
+    }
+
     vk::PresentInfoKHR presentInfo(
         this->renderFinished,
         this->win->_swap.chain,
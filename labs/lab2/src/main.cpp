@@ -182,7 +182,7 @@ void Lab2Window::_initRenderPass ()
         vk::AttachmentLoadOp::eDontCare, /* stencil load op */
         vk::AttachmentStoreOp::eDontCare, /* stencil store op */
         vk::ImageLayout::eUndefined, /* initial layout */
-        vk::ImageLayout::ePresentSrcKHR); /* final layout */
+        this->_swap.presentLayout()); /* final layout */
 
     vk::AttachmentReference colorAttachmentRef(
         0, /* index */
@@ -293,7 +293,9 @@ void Lab2::run ()
 
     // wait until the window is closed
     while(! win->windowShouldClose()) {
-        glfwPollEvents();
+        if (! this->headless()) {
+            glfwPollEvents();
+        }
         win->draw ();
     }
 
@@ -83,7 +83,8 @@ private:
     SyncObjs _syncObjs;
     // texture state
     cs237::Texture2D *_txt;                     //!< the texture image etc.
-    vk::Sampler _txtSampler;                    //!< the texture sampler
+    vk::Sampler _txtSampler;                    //!< the texture sampler (owned by
+                                                //!  the application)
     // Camera state
     glm::vec3 _camPos;                          //!< camera position in world space
     glm::vec3 _camAt;                           //!< camera look-at point in world space
@@ -165,7 +166,6 @@ Lab4Window::~Lab4Window ()
 
     device.destroyDescriptorPool(this->_descPool);
     device.destroyDescriptorSetLayout(this->_descSetLayout);
-    device.destroySampler(this->_txtSampler);
 
     delete this->_ubo;
     delete this->_idxBuffer;
@@ -279,7 +279,7 @@ void Lab4Window::_initPipeline ()
     // load the shaders
     vk::ShaderStageFlags stages =
         vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
-    auto shaders = new cs237::Shaders(this->device(), kShaderDir + "shader", stages);
+    auto shaders = new cs237::Shaders(this->_app, kShaderDir + "shader", stages);
 
     // vertex input info
     auto vertexInfo = cs237::vertexInputInfo (
@@ -475,7 +475,9 @@ void Lab4::run ()
     // wait until the window is closed
     while(! this->_win->windowShouldClose()) {
         this->_win->draw ();
-        glfwWaitEvents();
+        if (! this->headless()) {
+            glfwWaitEvents();
+        }
     }
 
     // wait until any in-flight rendering is complete
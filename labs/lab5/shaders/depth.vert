@@ -13,21 +13,16 @@
 
 #version 460
 
-layout (set = 0, binding = 0) uniform UB {
+layout (set = 0, binding = 1) uniform ObjectUB {
     mat4 modelMat;      ///< model matrix
-    mat4 viewMat;       ///< view matrix
-    mat4 projMat;       ///< projection matrix
     mat4 shadowMat;     ///< model-space to light-space transform
-    vec3 lightDir;      ///< light direction in eye coordinates
     vec3 color;         ///< flat color to use when texturing is disabled
-    int enableTexture;  ///< non-zero when texturing is enabled
-    int enableShadows;  ///< non-zero when shadows are enabled
-} ubo;
+} obj;
 
 layout (location = 0) in vec3 vPos;	///< vertex position in model coordinates
 
 void main ()
 {
     // light clip coordinates
-    gl_Position = ubo.shadowMat * vec4(vPos, 1);
+    gl_Position = obj.shadowMat * vec4(vPos, 1);
 }
@@ -18,19 +18,24 @@ const vec3 ambLightIllum = vec3(0.15f, 0.15f, 0.15f);
 const vec3 lightIllum = vec3(0.85f, 0.85f, 0.85f);
 const float shadowEffect = 0.25;
 
-layout (set = 0, binding = 0) uniform UB {
-    mat4 modelMat;      ///< model matrix
+/// is shadowing enabled?  The application creates a variant of the view
+/// pipeline for each value.
+layout (constant_id = 0) const bool kEnableShadows = false;
+
+layout (set = 0, binding = 0) uniform FrameUB {
     mat4 viewMat;       ///< view matrix
     mat4 projMat;       ///< projection matrix
-    mat4 shadowMat;     ///< model-space to light-space transform
+    int enableTexture;  ///< non-zero when texturing is enabled
     vec3 lightDir;      ///< light direction in eye coordinates
+} frame;
+layout (set = 0, binding = 1) uniform ObjectUB {
+    mat4 modelMat;      ///< model matrix
+    mat4 shadowMat;     ///< model-space to light-space transform
     vec3 color;         ///< flat color to use when texturing is disabled
-    int enableTexture;  ///< non-zero when texturing is enabled
-    int enableShadows;  ///< non-zero when shadows are enabled
-} ubo;
-layout (set = 0, binding = 1) uniform sampler2D colorMap;
+} obj;
+layout (set = 1, binding = 0) uniform sampler2D colorMap;
 
-layout (set = 1, binding = 0) uniform sampler2D shadowMap;
+layout (set = 2, binding = 0) uniform sampler2D shadowMap;
 
 layout (location = 0) in vec4 fShadowPos; ///< shadow coordinate
 layout (location = 1) in vec3 fNorm;    ///< interpolated vertex normal in
@@ -45,18 +50,18 @@ void main ()
     vec3 norm = normalize(fNorm);
 
     // compute diffuse illumination
-    float intensity = max(dot(ubo.lightDir, norm), 0.0);
+    float intensity = max(dot(frame.lightDir, norm), 0.0);
     vec3 lightC = clamp(ambLightIllum + intensity * lightIllum, 0, 1);
 
     // surface color
     vec3 surfaceC;
-    if (ubo.enableTexture != 0) {
+    if (frame.enableTexture != 0) {
         surfaceC = texture(colorMap, fTC).rgb;
     } else {
-        surfaceC = ubo.color;
+        surfaceC = obj.color;
     }
 
-    /** HINT: when shadowing is enabled, shadow test goes here */
+    /** HINT: when shadowing is enabled (`kEnableShadows`), shadow test goes here */
 
     // the fragment color is the light color times the surface color
     fragColor = vec4(lightC * surfaceC, 1.0);
@@ -13,6 +13,10 @@
 
 #version 460
 
+/// is shadowing enabled?  The application creates a variant of the view
+/// pipeline for each value.
+layout (constant_id = 0) const bool kEnableShadows = false;
+
 // matrix for mapping 2x2x1 clip coordinates to [0,1] range
 const mat4 biasMat = mat4(
     0.5, 0.0, 0.0, 0.0,  // first column
@@ -20,16 +24,17 @@ const mat4 biasMat = mat4(
     0.0, 0.0, 1.0, 0.0,
     0.5, 0.5, 0.0, 1.0);
 
-layout (set = 0, binding = 0) uniform UB {
-    mat4 modelMat;      ///< model matrix
+layout (set = 0, binding = 0) uniform FrameUB {
     mat4 viewMat;       ///< view matrix
     mat4 projMat;       ///< projection matrix
-    mat4 shadowMat;     ///< model-space to light-space transform
+    int enableTexture;  ///< non-zero when texturing is enabled
     vec3 lightDir;      ///< light direction in eye coordinates
+} frame;
+layout (set = 0, binding = 1) uniform ObjectUB {
+    mat4 modelMat;      ///< model matrix
+    mat4 shadowMat;     ///< model-space to light-space transform
     vec3 color;         ///< flat color to use when texturing is disabled
-    int enableTexture;  ///< non-zero when texturing is enabled
-    int enableShadows;  ///< non-zero when shadows are enabled
-} ubo;
+} obj;
 
 layout (location = 0) in vec3 vPos;	///< vertex position in model coordinates
 layout (location = 1) in vec3 vNorm;    ///< vertex normal in model coordinates
@@ -43,12 +48,12 @@ layout (location = 2) out vec2 fTC;     ///< vertex tex coordinate
 void main ()
 {
     // clip coordinates for vertex
-    gl_Position = ubo.projMat * ubo.viewMat * ubo.modelMat * vec4(vPos, 1);
+    gl_Position = frame.projMat * frame.viewMat * obj.modelMat * vec4(vPos, 1);
 
     // eye-space normal; we are assuming modelMat is orthogonal
-    fNorm = mat3x3(ubo.modelMat) * vNorm;
+    fNorm = mat3x3(obj.modelMat) * vNorm;
 
-    /** HINT: when shadowing is enabled, compute `fShadowPos` */
+    /** HINT: when shadowing is enabled (`kEnableShadows`), compute `fShadowPos` */
 
     // propagate texture coords to fragment shader
     fTC = vTC;
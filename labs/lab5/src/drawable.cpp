@@ -19,7 +19,8 @@ Drawable::Drawable (cs237::Application *app, const Mesh *mesh)
     iBuf(new cs237::IndexBuffer<uint16_t>(app, mesh->indices)),
     modelMat(mesh->toWorld),
     color(mesh->color),
-    ubo(new UBO_t(app))
+    uboOffset(0),
+    bbox(mesh->bbox())
 {
     // for this lab, all the meshes should have textures
     assert (mesh->hasTexture());
@@ -42,8 +43,6 @@ Drawable::~Drawable ()
 {
     delete this->iBuf;
     delete this->vBuf;
-    delete this->ubo;
-    vkDestroySampler(this->device, this->sampler, nullptr);
     delete this->tex;
 }
 
@@ -55,34 +54,21 @@ void Drawable::initDescriptors (
     vk::DescriptorSetAllocateInfo allocInfo(dsPool, dsLayout);
     this->descSet = (this->device.allocateDescriptorSets(allocInfo))[0];
 
-    // initialize the descriptors
-    auto uboInfo = this->ubo->descInfo();
+    // initialize the descriptor
     vk::DescriptorImageInfo imageInfo(
         this->sampler,
         this->tex->view(),
         vk::ImageLayout::eShaderReadOnlyOptimal);
-    std::array<vk::WriteDescriptorSet,2> descWrites = {
-        // uniform buffer
-        vk::WriteDescriptorSet(
-            this->descSet, /* descriptor set */
-            0, /* binding */
-            0, /* array element */
-            vk::DescriptorType::eUniformBuffer, /* descriptor type */
-            nullptr, /* image info */
-            uboInfo, /* buffer info */
-            nullptr), /* texel buffer view */
-        // color map
-        vk::WriteDescriptorSet(
-            this->descSet, /* descriptor set */
-            1, /* binding */
-            0, /* array element */
-            vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
-            imageInfo, /* image info */
-            nullptr, /* buffer info */
-            nullptr) /* texel buffer view */
-    };
+    vk::WriteDescriptorSet descWrite(
+        this->descSet, /* descriptor set */
+        0, /* binding */
+        0, /* array element */
+        vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+        imageInfo, /* image info */
+        nullptr, /* buffer info */
+        nullptr); /* texel buffer view */
 
-    device.updateDescriptorSets(descWrites, nullptr);
+    device.updateDescriptorSets(descWrite, nullptr);
 
 }
 
@@ -93,7 +79,7 @@ void Drawable::bindDescriptorSets (
     cmdBuf.bindDescriptorSets(
         vk::PipelineBindPoint::eGraphics,
         pipeLayout,
-        0, /* first set */
+        1, /* first set */
         this->descSet,
         nullptr);
 }
@@ -25,32 +25,34 @@ struct Drawable {
     glm::vec3 color;                    ///< drawable's color
     cs237::Texture2D *tex;              ///< drawable's texture
     vk::DescriptorSet descSet;          ///< descriptor set for the texture sampler
-    UBO_t *ubo;                         ///< the uniform buffer for the drawable
-    vk::Sampler sampler;                ///< the texture sampler
+    uint32_t uboOffset;                 ///< the dynamic offset of the drawable's
+                                        ///  uniforms in the current frame
+    vk::Sampler sampler;                ///< the texture sampler; it is shared
+                                        ///  and owned by the application
+    cs237::AABBf_t bbox;                ///< the world-space bounding box of the drawable
 
     Drawable (cs237::Application *app, const Mesh *mesh);
     ~Drawable ();
 
-    /// allocate the descriptor sets for the drawable
+    /// allocate the color-map descriptor set for the drawable
     /// \param dsPool        the descriptor pool used for allocation
     /// \param dsLayout      the layout of the descriptor sets
     void initDescriptors (vk::DescriptorPool dsPool, vk::DescriptorSetLayout dsLayout);
 
-    /// update the UBO
+    /// copy the drawable's uniforms into the current frame's region of the
+    /// uniform ring and record their offset in `uboOffset`
+    /// \param ubos          the uniform ring
     /// \param worldToLight  the world-space to light-space transform matrix
-    /// \param ub            a UB struct that holds the non-model-dependent
-    ///                      uniform values
-    void updateUBO (glm::mat4 const &worldToLight, UB &ub)
+    void pushUBO (cs237::UniformRing *ubos, glm::mat4 const &worldToLight)
     {
-        // set the per-model fields
+        ObjectUB ub;
         ub.modelMat = this->modelMat;
         ub.shadowMat = worldToLight * this->modelMat;
         ub.color = this->color;
-        // copy to the GPU
-        this->ubo->copyTo(ub);
+        this->uboOffset = ubos->push(ub);
     }
 
-    /// bind the sampler descriptor sets for the drawable as Set 0
+    /// bind the color-map descriptor set for the drawable as Set 1
     void bindDescriptorSets (
         vk::CommandBuffer cmdBuf,
         vk::PipelineLayout pipeLayout);
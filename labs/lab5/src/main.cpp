@@ -35,6 +35,10 @@ constexpr glm::vec3 kLightDir(-0.75f, -1.0f, -0.5f);
 /// the distance to the light's near plane
 constexpr float kLightNearZ = 0.2f;
 
+/// the `constant_id` of the `kEnableShadows` specialization constant in the
+/// scene shaders
+constexpr uint32_t kEnableShadowsID = 0;
+
 /// the dimensions of the depth texture
 constexpr uint32_t kDepthTextureWid = 1024;
 constexpr uint32_t kDepthTextureHt = 1024;
@@ -79,24 +83,41 @@ private:
     // view rendering pass
     vk::RenderPass _viewRenderPass;
     vk::PipelineLayout _viewPipelineLayout;
-    vk::Pipeline _viewPipeline;
+    std::array<vk::Pipeline,2> _viewPipelines;  ///< the view pipelines without and
+                                                ///  with shadows
     std::vector<vk::Framebuffer> _framebuffers;
 
+    // shaders
+    cs237::Shaders *_sceneShaders;              ///< the shaders for the view pass
+    cs237::Shaders *_depthShaders;              ///< the shaders for the shadow pass
+    cs237::PipelineInterface _iface;            ///< the merged interface of the scene
+                                                ///  and depth shaders
+
     // descriptors
     vk::DescriptorPool _descPool;               ///< descriptor-set pool
+    vk::DescriptorSetLayout _uboDSLayout;       ///< the descriptor-set layout for the
+                                                ///  dynamic-UBO descriptor set (`_uboDS`)
     vk::DescriptorSetLayout _drawableDSLayout;  ///< the descriptor-set layout for the
                                                 ///  per-drawable descriptor sets
     vk::DescriptorSetLayout _depthDSLayout;     ///< the descriptor-set layout for the
                                                 ///  per-frame depth-buffer descriptor
                                                 ///  set (`_depthDS`)
+    vk::DescriptorSet _uboDS;                   ///< the dynamic-UBO descriptor set
     vk::DescriptorSet _depthDS;                 ///< the depth-buffer descriptor set
 
-    vk::CommandBuffer _cmdBuf;                  ///< command buffer for rendering
+    cs237::CommandCache _cmdCache;              ///< the recorded command buffers, one per
+                                                ///  swap-chain image
+    vk::CommandBuffer _cmdBuf;                  ///< command buffer for the current frame;
+                                                ///  owned by `_cmdCache`
     SyncObjs _syncObjs;
     std::vector<Drawable *> _objs;              ///< the drawable objects with their
                                                 ///< uniforms, etc.
     cs237::AABBf_t _bbox;                       ///< axis-aligned box that contains
                                                 ///  the objects
+    cs237::BVH _bvh;                            ///< BVH over the drawables' bounding
+                                                ///  boxes; used to select shadow casters
+    std::vector<uint32_t> _casters;             ///< the drawables that can cast shadows
+                                                ///  into the shadow map
 
     // Camera state
     float _angle;                               ///< rotation angle for camera
@@ -104,13 +125,17 @@ private:
     glm::vec3 _camAt;                           ///< camera look-at point in world space
     glm::vec3 _camUp;                           ///< camera up vector in world space
 
-    // cache information for the UBOs
+    // uniform data
+    cs237::UniformRing *_ubos;                  ///< the uniform data for the frames; there
+                                                ///  is one region per swap-chain image
     glm::mat4 _worldToLight;                    ///< world-space to light-space transform
-    UB _uboCache;                               ///< cache the per-drawable UBO data
-    bool _uboNeedsUpdate;                       ///< flag to mark when the contents of
-                                                ///  the per-object UBOs is invalid
+    FrameUB _frameUB;                           ///< the per-frame uniform data
+    uint32_t _frameUBOffset;                    ///< the dynamic offset of the per-frame
+                                                ///  uniforms in the current frame
+    bool _enableShadows;                        ///< true when shadows are enabled
 
-    /// initialize the descriptor pool and descriptor-set layouts
+    /// load the shaders and initialize the descriptor pool and descriptor-set
+    /// layouts from their interface
     void _initDescriptorSetLayouts ();
 
     /// initialize the descriptor-sets
@@ -123,7 +148,7 @@ private:
 
     /// initialize the `_viewRenderPass` field
     void _initViewRenderPass ();
-    /// initialize the `_pipelineLayout` and `_viewPipeline` fields
+    /// initialize the `_viewPipelineLayout` and `_viewPipelines` fields
     void _initViewPipeline ();
 
     /// allocate and initialize the drawables
@@ -132,6 +157,12 @@ private:
     /// initialize the shadow matrix
     void _initShadowMatrix ();
 
+    /// copy the current frame's uniforms into the image's region of `_ubos`
+    void _pushUniforms (uint32_t imageIdx);
+
+    /// bind the dynamic-UBO descriptor set as Set 0 with the offsets for a drawable
+    void _bindUBOs (vk::PipelineLayout pipeLayout, Drawable *obj);
+
     /// record the rendering commands
     void _recordCommandBuffer (uint32_t imageIdx);
 
@@ -143,19 +174,17 @@ private:
         float camZ = kRadius * cos(rAngle);
         this->_camPos = glm::vec3(camX, kCamPosY, camZ);
 
-        // update the UBO cache
-        this->_uboCache.viewMat = glm::lookAt(this->_camPos, this->_camAt, this->_camUp);
-        this->_uboNeedsUpdate = true;
+        // update the per-frame uniforms
+        this->_frameUB.viewMat = glm::lookAt(this->_camPos, this->_camAt, this->_camUp);
     }
 
     /// set the projection matrix based on the current window size
     void _setProjMat ()
     {
-        this->_uboCache.projMat = glm::perspectiveFov(
+        this->_frameUB.projMat = glm::perspectiveFov(
             glm::radians(kFOV),
             float(this->_wid), float(this->_ht),
             kNearZ, kFarZ);
-        this->_uboNeedsUpdate = true;
     }
 
 };
@@ -167,6 +196,7 @@ Lab5Window::Lab5Window (Lab5 *app)
         app,
         // resizable window with depth buffer and no stencil
         cs237::CreateWindowInfo(1024, 768, app->name(), true, true, false)),
+    _cmdCache(app),
     _syncObjs(this)
 {
     // initialize the camera
@@ -179,20 +209,25 @@ Lab5Window::Lab5Window (Lab5 *app)
     this->_setProjMat();
 
     // cache the unit vector that points toward the light
-    this->_uboCache.lightDir = glm::normalize(-kLightDir);
+    this->_frameUB.lightDir = glm::normalize(-kLightDir);
 
     // initially, texturing and shadowing are disabled
-    this->_uboCache.enableTexture = VK_FALSE;
-    this->_uboCache.enableShadows = VK_FALSE;
+    this->_frameUB.enableTexture = VK_FALSE;
+    this->_enableShadows = false;
 
     this->_initDrawables ();
 
+    // the zero matrix marks the light transform as not yet computed
+    this->_worldToLight = glm::mat4(0.0f);
     this->_initShadowMatrix();
 
-    // initialize the UBOs for the objects
-    for (auto obj : this->_objs) {
-        obj->updateUBO(this->_worldToLight, this->_uboCache);
-    }
+    // each frame pushes the per-frame uniforms and the uniforms for each of
+    // the objects into the ring
+    this->_ubos = new cs237::UniformRing (
+        app,
+        this->_swap.size(),
+        cs237::UniformRing::frameBytes (app, 1 + this->_objs.size(), kUBRange),
+        kUBRange);
 
     this->_initDescriptorSetLayouts ();
 
@@ -215,9 +250,6 @@ Lab5Window::Lab5Window (Lab5 *app)
     // create framebuffers for the swap chain
     this->_swap.initFramebuffers (this->_viewRenderPass);
 
-    // set up the command buffer
-    this->_cmdBuf = this->_app->newCommandBuf();
-
     // enable handling of keyboard events
     this->enableKeyEvent (true);
 }
@@ -226,11 +258,15 @@ Lab5Window::~Lab5Window ()
 {
     auto device = this->device();
 
-    /* delete the command buffer */
-    this->_app->freeCommandBuf(this->_cmdBuf);
+    if (this->_app->verbose()) {
+        std::cout << "# command buffers: " << this->_cmdCache.nRecorded()
+            << " recorded, " << this->_cmdCache.nReused() << " reused\n";
+    }
 
     // clean up view resources
-    device.destroyPipeline(this->_viewPipeline);
+    for (auto pipe : this->_viewPipelines) {
+        device.destroyPipeline(pipe);
+    }
     device.destroyRenderPass(this->_viewRenderPass);
     device.destroyPipelineLayout(this->_viewPipelineLayout);
 
@@ -245,11 +281,13 @@ Lab5Window::~Lab5Window ()
     for (auto obj : this->_objs) {
         delete obj;
     }
+    delete this->_ubos;
 
-    // clean up other resources
+    // clean up other resources; the descriptor-set layouts are owned by
+    // the application
     device.destroyDescriptorPool(this->_descPool);
-    device.destroyDescriptorSetLayout(this->_drawableDSLayout);
-    device.destroyDescriptorSetLayout(this->_depthDSLayout);
+    delete this->_depthShaders;
+    delete this->_sceneShaders;
 }
 
 void Lab5Window::_initDrawables ()
@@ -264,6 +302,13 @@ void Lab5Window::_initDrawables ()
     this->_bbox += floorMesh->bbox();
     this->_bbox += crateMesh->bbox();
 
+    // build the BVH for selecting shadow casters
+    std::vector<cs237::AABBf_t> boxes;
+    for (auto obj : this->_objs) {
+        boxes.push_back(obj->bbox);
+    }
+    this->_bvh.build(boxes);
+
     // cleanup
     delete crateMesh;
     delete floorMesh;
@@ -281,57 +326,61 @@ void Lab5Window::_initDescriptorSetLayouts ()
     int nObjs = this->_objs.size();
     assert (nObjs > 0);
 
-    // allocate the descriptor-set pool.  We have one UBO descriptor and one sampler
-    // descriptor per object, plus the depth-buffer sampler
-    std::array<vk::DescriptorPoolSize, 2> poolSizes = {
-            vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, nObjs),
-            vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, nObjs+1)
-        };
+    // load the shaders
+    vk::ShaderStageFlags stages =
+        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+    this->_sceneShaders = new cs237::Shaders(this->_app, kShaderDir + "scene", stages);
+    this->_depthShaders = new cs237::Shaders(this->_app, kShaderDir + "depth", stages);
+
+    // the descriptor sets are bound in both passes, so the layouts come from
+    // the merged interface of the two programs.  Set 0 has the per-frame and
+    // per-object uniform buffers, which are read from `_ubos` at dynamic
+    // offsets, Set 1 has the per-drawable color map, and Set 2 has the
+    // depth-buffer sampler.
+    this->_iface = cs237::PipelineInterface({this->_sceneShaders, this->_depthShaders});
+    if (this->_iface.numSets() != 3) {
+        ERROR("expected three descriptor sets in the scene shaders");
+    }
+    this->_iface.setDynamic (0, 0);
+    this->_iface.setDynamic (0, 1);
+    auto layouts = this->_app->descriptorSetLayouts (this->_iface);
+    this->_uboDSLayout = layouts[0];
+    this->_drawableDSLayout = layouts[1];
+    this->_depthDSLayout = layouts[2];
+
+    // allocate the descriptor-set pool.  We have one UBO set, one Set 1 per
+    // object, and the depth-buffer set
+    auto poolSizes = this->_iface.poolSizes ({1, uint32_t(nObjs), 1});
     vk::DescriptorPoolCreateInfo poolInfo(
         {}, /* flags */
-        nObjs+1, /* max sets */
+        nObjs+2, /* max sets */
         poolSizes); /* pool sizes */
     this->_descPool = this->device().createDescriptorPool(poolInfo);
-
-    // create the descriptor set layout for the drawables, which consists of
-    // two bindings: one for the UBO and one for the color-map
-    {
-        std::array<vk::DescriptorSetLayoutBinding,2> layoutBindings = {
-                vk::DescriptorSetLayoutBinding(
-                    0, /* binding */
-                    vk::DescriptorType::eUniformBuffer, /* descriptor type */
-                    1, /* descriptor count */
-                    vk::ShaderStageFlagBits::eVertex /* stages */
-                        | vk::ShaderStageFlagBits::eFragment,
-                    nullptr), /* immutable samplers */
-                vk::DescriptorSetLayoutBinding(
-                    1, /* binding */
-                    vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
-                    1, /* descriptor count */
-                    vk::ShaderStageFlagBits::eFragment, /* stages */
-                    nullptr) /* immutable samplers */
-            };
-
-        vk::DescriptorSetLayoutCreateInfo layoutInfo({}, layoutBindings);
-        this->_drawableDSLayout = this->device().createDescriptorSetLayout(layoutInfo);
-    }
-
-    // create the descriptor-set layout for the depth-buffer sampler
-    {
-        vk::DescriptorSetLayoutBinding layoutBinding(
-            0, /* binding */
-            vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
-            1, /* descriptor count */
-            vk::ShaderStageFlagBits::eFragment, /* stages */
-            nullptr); /* immutable samplers */
-
-        vk::DescriptorSetLayoutCreateInfo layoutInfo({}, layoutBinding);
-        this->_depthDSLayout = this->device().createDescriptorSetLayout(layoutInfo);
-    }
 }
 
 void Lab5Window::_initDescriptors ()
 {
+    // create the dynamic-UBO descriptor set; both bindings refer to the whole
+    // ring, since the offsets are supplied when the set is bound
+    {
+        vk::DescriptorSetAllocateInfo allocInfo(this->_descPool, this->_uboDSLayout);
+        this->_uboDS = (this->device().allocateDescriptorSets(allocInfo))[0];
+
+        vk::DescriptorBufferInfo uboInfo = this->_ubos->descInfo();
+        std::array<vk::WriteDescriptorSet,2> descWrites;
+        for (uint32_t i = 0;  i < 2;  ++i) {
+            descWrites[i] = vk::WriteDescriptorSet(
+                this->_uboDS, /* descriptor set */
+                i, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eUniformBufferDynamic, /* descriptor type */
+                nullptr, /* image info */
+                uboInfo, /* buffer info */
+                nullptr); /* texel buffer view */
+        }
+        this->device().updateDescriptorSets(descWrites, nullptr);
+    }
+
     // initialize the per-drawable descriptor sets
     for (auto obj : this->_objs) {
         obj->initDescriptors (this->_descPool, this->_drawableDSLayout);
@@ -406,55 +455,62 @@ void Lab5Window::_initDepthPipeline ()
 void Lab5Window::_initViewPipeline ()
 {
     // initialize the pipeline layout for rendering
-    std::array<vk::DescriptorSetLayout,2> layouts = {
-            this->_drawableDSLayout,
-            this->_depthDSLayout
-        };
-    vk::PipelineLayoutCreateInfo layoutInfo(
-        {}, /* flags */
-        layouts, /* set layouts */
-        nullptr); /* push constants */
-    this->_viewPipelineLayout = this->device().createPipelineLayout(layoutInfo);
-
-    // load the shaders
-    vk::ShaderStageFlags stages =
-        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
-    auto shaders = new cs237::Shaders(this->device(), kShaderDir + "scene", stages);
+    this->_viewPipelineLayout = this->_app->createPipelineLayout (this->_iface);
 
     // vertex input info
     auto vertexInfo = cs237::vertexInputInfo (
         Vertex::getBindingDescriptions(),
         Vertex::getAttributeDescriptions());
 
-    std::array<vk::DynamicState, 2> dynamicStates = {
-        vk::DynamicState::eViewport,
-        vk::DynamicState::eScissor
-    };
-
-    this->_viewPipeline = this->_app->createPipeline(
-        shaders,
-        vertexInfo,
-        vk::PrimitiveTopology::eTriangleList,
-        // the viewport and scissor rectangles are specified dynamically, but we need
-        // to specify the counts
-        vk::ArrayProxy<vk::Viewport>(1, nullptr), /* viewports */
-        vk::ArrayProxy<vk::Rect2D>(1, nullptr), /* scissor rects */
-        vk::PolygonMode::eFill,
-        vk::CullModeFlagBits::eBack,
-        // we are following the OpenGL convention for front faces
-        vk::FrontFace::eCounterClockwise,
-        this->_viewPipelineLayout,
-        this->_viewRenderPass,
-        0,
-        dynamicStates);
+    // the scene shaders are specialized on whether shadows are enabled, so we
+    // create both variants of the pipeline in one batch.  The default
+    // description has dynamic viewport and scissor rectangles, back-face
+    // culling, and follows the OpenGL convention for front faces.
+    std::array<cs237::SpecConstants,2> consts;
+    std::vector<cs237::Application::PipelineDesc> descs(2);
+    for (int i = 0;  i < 2;  ++i) {
+        consts[i].setBool (kEnableShadowsID, i != 0);
+        descs[i].shaders = this->_sceneShaders;
+        descs[i].specConsts = &consts[i];
+        descs[i].vertexInfo = vertexInfo;
+        descs[i].layout = this->_viewPipelineLayout;
+        descs[i].renderPass = this->_viewRenderPass;
+    }
+    auto pipes = this->_app->createPipelines (descs);
+    this->_viewPipelines[0] = pipes[0];
+    this->_viewPipelines[1] = pipes[1];
 
     cs237::destroyVertexInputInfo (vertexInfo);
-    delete shaders;
 
 }
 
 /******************** Rendering ********************/
 
+void Lab5Window::_pushUniforms (uint32_t imageIdx)
+{
+    // the image's region of the ring was last used by the image's previous
+    // frame, which has finished since we waited on the in-flight fence.  The
+    // blocks are pushed in the same order every frame, so the offsets for an
+    // image never change and its recorded commands stay valid.
+    this->_ubos->beginFrame (imageIdx);
+    this->_frameUBOffset = this->_ubos->push (this->_frameUB);
+    for (auto obj : this->_objs) {
+        obj->pushUBO (this->_ubos, this->_worldToLight);
+    }
+}
+
+void Lab5Window::_bindUBOs (vk::PipelineLayout pipeLayout, Drawable *obj)
+{
+    // the dynamic offsets are in binding order
+    std::array<uint32_t,2> offsets = { this->_frameUBOffset, obj->uboOffset };
+    this->_cmdBuf.bindDescriptorSets(
+        vk::PipelineBindPoint::eGraphics,
+        pipeLayout,
+        0, /* first set */
+        this->_uboDS,
+        offsets);
+}
+
 void Lab5Window::_recordCommandBuffer (uint32_t imageIdx)
 {
     vk::ClearValue depthClearValue = vk::ClearDepthStencilValue(1.0f, 0);
@@ -462,7 +518,7 @@ void Lab5Window::_recordCommandBuffer (uint32_t imageIdx)
     vk::CommandBufferBeginInfo beginInfo;
     this->_cmdBuf.begin(beginInfo);
 
-    if (this->_uboCache.enableShadows) {
+    if (this->_enableShadows) {
         /* Shadow pass */
         vk::RenderPassBeginInfo depthPassInfo(
             this->_depthRenderPass,
@@ -476,9 +532,24 @@ void Lab5Window::_recordCommandBuffer (uint32_t imageIdx)
             vk::PipelineBindPoint::eGraphics,
             this->_depthPipeline);
 
-        // draw the objects
-        for (auto obj : this->_objs) {
-            // bind the descriptor sets for the ubo and color-map samplers
+        // select the shadow casters; `_worldToLight` maps world space to the
+        // light's clip space, so it defines the light's view frustum.  Until
+        // the matrix has been computed, every drawable is a potential caster.
+        if (this->_worldToLight != glm::mat4(0.0f)) {
+            cs237::Frustumf_t lightFrustum(this->_worldToLight);
+            this->_bvh.cullFrustum(lightFrustum, this->_casters);
+        } else {
+            this->_casters.resize(this->_objs.size());
+            for (uint32_t i = 0;  i < this->_casters.size();  ++i) {
+                this->_casters[i] = i;
+            }
+        }
+
+        // draw the shadow casters
+        for (auto ix : this->_casters) {
+            Drawable *obj = this->_objs[ix];
+            // bind the descriptor sets for the ubos and color-map sampler
+            this->_bindUBOs (this->_depthPipelineLayout, obj);
             obj->bindDescriptorSets(this->_cmdBuf, this->_depthPipelineLayout);
             // render the drawable to the shadow buffer
             obj->draw (this->_cmdBuf);
@@ -503,21 +574,22 @@ void Lab5Window::_recordCommandBuffer (uint32_t imageIdx)
     /*** BEGIN COMMANDS ***/
     this->_cmdBuf.bindPipeline(
         vk::PipelineBindPoint::eGraphics,
-        this->_viewPipeline);
+        this->_viewPipelines[this->_enableShadows ? 1 : 0]);
 
     // set the viewport using the OpenGL convention
     this->_setViewportCmd (this->_cmdBuf, true);
 
-    // bind the descriptor for the depth buffer as Set 1
+    // bind the descriptor for the depth buffer as Set 2
     this->_cmdBuf.bindDescriptorSets(
         vk::PipelineBindPoint::eGraphics,
         this->_viewPipelineLayout,
-        1, /* first set */
+        2, /* first set */
         this->_depthDS,
         nullptr);
 
     for (auto obj : this->_objs) {
-        // bind the descriptor sets for the ubo and color-map samplers
+        // bind the descriptor sets for the ubos and color-map sampler
+        this->_bindUBOs (this->_viewPipelineLayout, obj);
         obj->bindDescriptorSets(this->_cmdBuf, this->_viewPipelineLayout);
 
         // render the drawable
@@ -542,16 +614,16 @@ void Lab5Window::draw ()
 
     this->_syncObjs.reset();
 
-    if (this->_uboNeedsUpdate) {
-        // first we update the UBOs for the objects
-        for (auto obj : this->_objs) {
-            obj->updateUBO(this->_worldToLight, this->_uboCache);
-        }
-        this->_uboNeedsUpdate = false;
-    }
+    // first we push the uniforms for the frame
+    this->_pushUniforms (idx);
 
-    vkResetCommandBuffer(this->_cmdBuf, 0);
-    this->_recordCommandBuffer (idx);
+    // the commands only depend on the shadow mode and the swap chain, so
+    // we can reuse the image's buffer when the camera or texturing changes
+    bool record;
+    this->_cmdBuf = this->_cmdCache.acquire (idx, record);
+    if (record) {
+        this->_recordCommandBuffer (idx);
+    }
 
     // set up submission for the graphics queue
     this->_syncObjs.submitCommands (this->graphicsQ(), this->_cmdBuf);
@@ -570,6 +642,9 @@ void Lab5Window::reshape (int wid, int ht)
     // recreate the new framebuffers
     this->_swap.initFramebuffers (this->_viewRenderPass);
 
+    // the recorded commands refer to the old framebuffers
+    this->_cmdCache.invalidate();
+
     // update the projection matrix
     this->_setProjMat();
 
@@ -587,19 +662,19 @@ void Lab5Window::key (int key, int scancode, int action, int mods)
                 break;
 
             case GLFW_KEY_T:  // 't' or 'T' ==> toggle texturing
-                this->_uboCache.enableTexture =
-                    this->_uboCache.enableTexture ? VK_FALSE : VK_TRUE;
-                this->_uboNeedsUpdate = true;
+                this->_frameUB.enableTexture =
+                    this->_frameUB.enableTexture ? VK_FALSE : VK_TRUE;
                 std::cout << "Toggle texturing "
-                    << (this->_uboCache.enableTexture ? "on\n" : "off\n");
+                    << (this->_frameUB.enableTexture ? "on\n" : "off\n");
                 break;
 
             case GLFW_KEY_S:  // 's' or 'S' ==> toggle shadowing
-                this->_uboCache.enableShadows =
-                    this->_uboCache.enableShadows ? VK_FALSE : VK_TRUE;
-                this->_uboNeedsUpdate = true;
+                this->_enableShadows = ! this->_enableShadows;
+                // the shadow pass and the view-pipeline variant are baked
+                // into the recorded commands
+                this->_cmdCache.invalidate();
                 std::cout << "Toggle shadows "
-                    << (this->_uboCache.enableShadows ? "on\n" : "off\n");
+                    << (this->_enableShadows ? "on\n" : "off\n");
                 break;
 
             case GLFW_KEY_LEFT:
@@ -637,7 +712,9 @@ void Lab5::run ()
     // wait until the window is closed
     while(! this->_win->windowShouldClose()) {
         this->_win->draw ();
-        glfwWaitEvents();
+        if (! this->headless()) {
+            glfwWaitEvents();
+        }
     }
 
     // wait until any in-flight rendering is complete
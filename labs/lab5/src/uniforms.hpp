@@ -2,8 +2,9 @@
  *
  * CMSC 23700 Autumn 2023 Lab 5.
  *
- * The layout of uniform data for the shaders.  We use the same layout
- * for all of the shaders.
+ * The layout of uniform data for the shaders.  The data is split into a
+ * per-frame block and a per-object block, which are pushed into a
+ * `cs237::UniformRing` every frame and accessed with dynamic offsets.
  *
  * \author John Reppy
  */
@@ -16,17 +17,23 @@
 #ifndef _UNIFORMS_HPP_
 #define _UNIFORMS_HPP_
 
-struct UB {
-    alignas(16) glm::mat4 modelMat;             ///< model matrix
+/// the uniform data that is shared by all of the objects in a frame
+struct FrameUB {
     alignas(16) glm::mat4 viewMat;              ///< view matrix
     alignas(16) glm::mat4 projMat;              ///< projection matrix
-    alignas(16) glm::mat4 shadowMat;            ///< model-space to light-space transform
+    alignas(4) vk::Bool32 enableTexture;        ///< non-zero when texturing is enabled
     alignas(16) glm::vec3 lightDir;             ///< light direction in eye coordinates
+};
+
+/// the per-object uniform data
+struct ObjectUB {
+    alignas(16) glm::mat4 modelMat;             ///< model matrix
+    alignas(16) glm::mat4 shadowMat;            ///< model-space to light-space transform
     alignas(16) glm::vec3 color;                ///< flat color to use when texturing is disabled
-    alignas(4) vk::Bool32 enableTexture;        ///< non-zero when texturing is enabled
-    alignas(4) vk::Bool32 enableShadows;        ///< non-zero when shadows are enabled
 };
 
-using UBO_t = cs237::UniformBuffer<UB>;
+/// the range of the uniform-buffer descriptors, which must cover the larger
+/// of the two blocks
+constexpr size_t kUBRange = std::max(sizeof(FrameUB), sizeof(ObjectUB));
 
 #endif // !_UNIFORMS_HPP_
@@ -63,7 +63,9 @@ void Proj1::run ()
 
     // wait until the window is closed
     while(! win->windowShouldClose()) {
-        glfwPollEvents();
+        if (! this->headless()) {
+            glfwPollEvents();
+        }
         win->draw ();
     }
 
@@ -168,6 +168,14 @@ void Proj1Window::draw ()
 
     this->_syncObjs.reset();
 
+    // when benchmarking, the camera follows a scripted path around the scene
+    if (this->_app->benchmarking()) {
+        auto scene = this->_scene();
+        this->_camPos = cs237::benchCameraPos (
+            scene->cameraPos(), scene->cameraLookAt(), scene->cameraUp(),
+            this->numFrames(), this->_app->maxFrames());
+    }
+
     /** HINT: update the UBO, if necessary */
 
     this->_cmdBuffer.reset();
@@ -67,7 +67,9 @@ void Proj2::run ()
 
     // wait until the window is closed
     while(! win->windowShouldClose()) {
-        glfwPollEvents();
+        if (! this->headless()) {
+            glfwPollEvents();
+        }
         win->draw ();
     }
 
@@ -16,7 +16,7 @@
 
 Mesh::Mesh (Proj2 *app, vk::PrimitiveTopology p, OBJ::Model const *model)
   : vBuf(nullptr), iBuf(nullptr), prim(p), cMap(nullptr), nMap(nullptr),
-    cMapSampler(), nMapSampler(), descSet()
+    cMapSampler(), nMapSampler(), descSet(), bbox(model->bounds())
 {
     assert (model->numGroups() == 1);
 
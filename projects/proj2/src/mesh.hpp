@@ -30,6 +30,7 @@ struct Mesh {
     vk::Sampler cMapSampler;            //!< the color-map sampler
     vk::Sampler nMapSampler;            //!< the normal-map sampler
     vk::DescriptorSet descSet;          //!< the descriptor set for the samplers
+    cs237::AABBf_t bbox;                //!< the object-space bounding box of the mesh
 
     //! create a Mesh object by allocating and loading buffers for it.
     //! \param app    the owning app
@@ -35,6 +35,13 @@ void Renderer::_initPipeline (
    ** We recommend that you define a table of properties (e.g., shader names etc.)
    ** that is indexed by the render mode.
    **/
+
+  /** HINT: instead of one set of shaders per mode, you can write a single
+   ** shader program whose features (e.g., lighting and normal mapping) are
+   ** selected by specialization constants.  Set the constants for the mode
+   ** using a `cs237::SpecConstants` object and pass it in the `specConsts`
+   ** field of the pipeline description (see `createPipelines`).
+   **/
 }
 
 
@@ -151,6 +151,16 @@ void Proj2Window::_initMeshes (const Scene *scene)
     /** HINT: put code to construct the meshes and instances
      *  from the scene here
      */
+
+    // compute the world-space bounding boxes and build the BVH for
+    // view-frustum culling
+    std::vector<cs237::AABBf_t> boxes;
+    boxes.reserve(this->_objs.size());
+    for (auto it : this->_objs) {
+        it->updateBBox();
+        boxes.push_back(it->bbox);
+    }
+    this->_bvh.build(boxes);
 }
 
 void Proj2Window::_recordCommandBuffer (uint32_t imageIdx)
@@ -185,8 +195,14 @@ void Proj2Window::_recordCommandBuffer (uint32_t imageIdx)
         this->_vertUBOs[imageIdx],
         this->_fragUBO);
 
-    // render the objects in the scene
-    for (auto it : this->_objs) {
+    // cull the objects that are outside the view frustum
+    cs237::Frustumf_t frustum(this->_ubCache.P * this->_ubCache.viewM);
+    this->_bvh.cullFrustum(frustum, this->_visible);
+
+    // render the visible objects in the scene
+    for (auto ix : this->_visible) {
+        Instance *it = this->_objs[ix];
+
         // bind the descriptors for the object
         rp->bindMeshDescriptorSets (this->_cmdBuffer, it);
 
@@ -214,6 +230,14 @@ void Proj2Window::draw ()
 
     this->_syncObjs.reset();
 
+    // when benchmarking, the camera follows a scripted path around the scene
+    if (this->_app->benchmarking()) {
+        auto scene = this->_scene();
+        this->_camPos = cs237::benchCameraPos (
+            scene->cameraPos(), scene->cameraLookAt(), scene->cameraUp(),
+            this->numFrames(), this->_app->maxFrames());
+    }
+
     /** HINT: update the UBO, if necessary */
 
     this->_cmdBuffer.reset();
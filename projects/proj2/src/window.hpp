@@ -59,6 +59,10 @@ private:
     // scene data
     std::vector<Mesh *> _meshes;                ///< the meshes in the scene
     std::vector<Instance *> _objs;              ///< the objects to render
+    cs237::BVH _bvh;                            ///< BVH over the world-space bounds
+                                                ///  of the objects
+    std::vector<uint32_t> _visible;             ///< the indices of the objects that
+                                                ///  survived culling in the current frame
 
     // Current camera state
     glm::vec3 _camPos;                          ///< camera position in world space
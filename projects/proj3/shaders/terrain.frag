@@ -0,0 +1,63 @@
+/*! \file terrain.frag
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * Fragment shader for the tessellated terrain.  The ground's color map is
+ * lit by the scene's ambient light and its lights, which are treated as
+ * point lights with distance attenuation.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://www.cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+/// a light; see `FragUB` in shader-uniforms.hpp
+struct Light {
+    vec3 lightPos;      ///< world-space position of the light
+    vec3 lightColor;    ///< intensity of the light
+    vec3 lightAtten;    ///< k0, k1, and k2 attenuation coefficients
+};
+
+/// the scene's lighting; see `FragUB` in shader-uniforms.hpp
+struct Lighting {
+    vec3 ambLight;      ///< intensity of the ambient light
+    Light lights[4];    ///< the lights
+    int nLights;        ///< the number of lights
+};
+
+/// the terrain uniforms (see `TessUB` in tess-terrain.hpp)
+layout (std140, set = 0, binding = 0) uniform TerrainUB {
+    vec4 grid;          ///< (X scale, Z scale, half width, half height)
+    vec4 hgt;           ///< (vertical scale, last column, last row, 0)
+    Lighting lighting;  ///< the scene's lighting
+};
+
+/// the ground's color map
+layout (set = 0, binding = 2) uniform sampler2D colorMap;
+
+layout (location = 0) in vec3 fPos;
+layout (location = 1) in vec3 fNorm;
+layout (location = 2) in vec2 fTexCoord;
+
+layout (location = 0) out vec4 fragColor;
+
+void main ()
+{
+    vec3 norm = normalize(fNorm);
+
+    vec3 intensity = lighting.ambLight;
+    for (int i = 0;  i < lighting.nLights;  ++i) {
+        vec3 dir = lighting.lights[i].lightPos - fPos;
+        float d = length(dir);
+        vec3 k = lighting.lights[i].lightAtten;
+        float atten = 1.0 / (k.x + d * (k.y + d * k.z));
+        intensity += atten * max(dot(norm, dir / d), 0.0) * lighting.lights[i].lightColor;
+    }
+
+    fragColor = vec4(clamp(intensity, 0.0, 1.0) * texture(colorMap, fTexCoord).rgb, 1.0);
+}
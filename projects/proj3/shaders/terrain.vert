@@ -0,0 +1,28 @@
+/*! \file terrain.vert
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * Vertex shader for the tessellated terrain (see tess-terrain.hpp).  The
+ * control points of the patches are already in world space, so this shader
+ * just passes them through to the tessellation-control shader.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://www.cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#version 460
+
+/// the control point: world-space X and Z coordinates, plus the vertical
+/// range of the point's patch
+layout (location = 0) in vec4 patchPos;
+
+layout (location = 0) out vec4 tcPos;
+
+void main ()
+{
+    tcPos = patchPos;
+}
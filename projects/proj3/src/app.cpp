@@ -48,16 +48,30 @@ Proj3::Proj3 (std::vector<std::string> const &args)
     }
 
     // load the scene
-    if (this->_scene.load(scenePath)) {
+    if (this->_scene.load(scenePath, this->jobs())) {
         std::cerr << "proj1: cannot load scene from '" << scenePath << "'\n";
         exit(EXIT_FAILURE);
     }
+
+    // load the shaders up front; the renderers and terrain share modules
+    this->preloadShaders(CS237_BINARY_DIR "/projects/proj3/shaders");
+
+    // the allocator grows its pools on demand, so we do not need to know the
+    // number of meshes up front
+    this->_dsAlloc = new cs237::DescriptorAllocator(this);
 }
 
 Proj3::~Proj3 ()
 {
-    this->_device.destroyDescriptorSetLayout(this->_meshDSLayout);
-    this->_device.destroyDescriptorPool(this->_meshDSPool);
+    if (this->verbose()) {
+        auto const &stats = this->_dsAlloc->stats();
+        std::cout << "# descriptor sets: " << stats.nSets << " persistent, "
+            << stats.nTransientSets << " transient, " << stats.nCacheHits
+            << " cache hits, " << stats.nPools << " pools\n";
+    }
+
+    // destroying the allocator frees the descriptor sets
+    delete this->_dsAlloc;
 }
 
 void Proj3::run ()
@@ -67,7 +81,9 @@ void Proj3::run ()
 
     // wait until the window is closed
     while(! win->windowShouldClose()) {
-        glfwPollEvents();
+        if (! this->headless()) {
+            glfwPollEvents();
+        }
         win->draw ();
     }
 
@@ -80,9 +96,5 @@ void Proj3::run ()
 
 vk::DescriptorSet Proj3::allocMeshDS ()
 {
-    // create the descriptor set
-    vk::DescriptorSetAllocateInfo allocInfo(this->_meshDSPool, this->_meshDSLayout);
-
-    return(this->_device.allocateDescriptorSets(allocInfo))[0];
-
+    return this->_dsAlloc->allocate(this->_meshDSLayout);
 }
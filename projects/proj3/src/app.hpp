@@ -34,14 +34,19 @@ public:
     //! allocate a descriptor set for a mesh
     vk::DescriptorSet allocMeshDS ();
 
+    //! the allocator for the application's descriptor sets
+    cs237::DescriptorAllocator *descriptorAllocator () const { return this->_dsAlloc; }
+
 protected:
     Scene _scene;                       //!< the scene to be rendered
-    vk::DescriptorPool _meshDSPool;     //!< the pool for allocating the per-mesh
-                                        //!  descriptor sets
+    cs237::DescriptorAllocator *_dsAlloc;
+                                        //!< the allocator for descriptor sets,
+                                        //!  including the per-mesh sets
 
     /// the descriptor-set layout for the per-mesh sampler descriptor sets.
     /// We put this in the application object, so that it can be shared
-    /// across meshes
+    /// across meshes.  The layout should be created with `_dsAlloc->layout`,
+    /// so it is owned by the application's layout cache.
     vk::DescriptorSetLayout _meshDSLayout;
 
 };
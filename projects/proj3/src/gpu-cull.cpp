@@ -0,0 +1,285 @@
+/*! \file gpu-cull.cpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "gpu-cull.hpp"
+#include <map>
+#include <string_view>
+
+/// path to directory that holds the shaders
+constexpr std::string_view kShaderDir = CS237_BINARY_DIR "/projects/proj3/shaders/";
+
+/// the workgroup size of the culling shader
+constexpr uint32_t kWorkGroupSz = 64;
+
+/// the bindings of the buffers in the descriptor set
+constexpr uint32_t kInstanceBinding = 0;
+constexpr uint32_t kObjBinding = 1;
+constexpr uint32_t kGroupBinding = 2;
+constexpr uint32_t kCmdBinding = 3;
+constexpr uint32_t kCountBinding = 4;
+constexpr uint32_t kNumBindings = 5;
+
+/// the empty-box coordinate used for objects without bounds; see cull.comp
+constexpr float kEmpty = 1e30f;
+
+GPUCull::GPUCull (Proj3 *app, std::vector<Instance *> const &objs)
+  : _app(app), _nObjs(objs.size()), _compact(app->hasDrawIndirectCount())
+{
+    assert (GPUCull::isSupported(app));
+
+    // group the objects by mesh
+    std::map<Mesh *, uint32_t> groupMap;
+    std::vector<uint32_t> groupOf(objs.size());
+    for (uint32_t i = 0;  i < objs.size();  ++i) {
+        auto it = groupMap.find(objs[i]->mesh);
+        if (it == groupMap.end()) {
+            it = groupMap.insert({objs[i]->mesh, this->_groups.size()}).first;
+            this->_groups.push_back(Group{objs[i]->mesh, objs[i], 0, 0});
+        }
+        groupOf[i] = it->second;
+        this->_groups[it->second].maxCmds++;
+    }
+
+    // assign each group a region of the command buffer
+    std::vector<DrawGroup> groups(this->_groups.size());
+    uint32_t nextCmd = 0;
+    for (uint32_t g = 0;  g < this->_groups.size();  ++g) {
+        this->_groups[g].firstCmd = nextCmd;
+        groups[g] = DrawGroup{
+                this->_groups[g].mesh->nIndices(),
+                nextCmd,
+                this->_groups[g].maxCmds,
+                0
+            };
+        nextCmd += this->_groups[g].maxCmds;
+    }
+
+    // initialize the per-object data
+    std::vector<InstanceData> instData(objs.size());
+    std::vector<CullObj> cullObjs(objs.size());
+    std::vector<uint32_t> nextSlot(this->_groups.size(), 0);
+    for (uint32_t i = 0;  i < objs.size();  ++i) {
+        Instance *obj = objs[i];
+        instData[i].toWorld = obj->toWorld;
+        instData[i].normToWorld = glm::mat3x4(obj->normToWorld);
+        instData[i].color = obj->color;
+        CullObj &co = cullObjs[i];
+        uint32_t g = groupOf[i];
+        for (int j = 0;  j < 3;  ++j) {
+            co.bbMin[j] = obj->bbox.isEmpty() ? kEmpty : obj->bbox.min()[j];
+            co.bbMax[j] = obj->bbox.isEmpty() ? -kEmpty : obj->bbox.max()[j];
+        }
+        co.group = g;
+        co.slot = this->_groups[g].firstCmd + nextSlot[g]++;
+    }
+
+    // allocate the buffers; we make sure that they are not empty, since
+    // Vulkan does not allow zero-sized buffers
+    uint32_t n = std::max(this->_nObjs, 1u);
+    uint32_t nGrps = std::max(uint32_t(this->_groups.size()), 1u);
+    this->_instBuf = new cs237::StorageBuffer<InstanceData>(app, n);
+    this->_objBuf = new cs237::StorageBuffer<CullObj>(app, n);
+    this->_groupBuf = new cs237::StorageBuffer<DrawGroup>(app, nGrps);
+    this->_cmdBuf = new cs237::IndirectBuffer<vk::DrawIndexedIndirectCommand>(app, n);
+    this->_countBuf = new cs237::IndirectBuffer<uint32_t>(app, nGrps);
+
+    if (this->_nObjs > 0) {
+        this->_instBuf->copyTo(instData);
+        this->_objBuf->copyTo(cullObjs);
+        this->_groupBuf->copyTo(groups);
+    }
+    std::vector<uint32_t> zeros(nGrps, 0);
+    this->_countBuf->copyTo(zeros);
+
+    this->_initDescriptors ();
+    this->_initPipeline ();
+
+}
+
+GPUCull::~GPUCull ()
+{
+    auto device = this->_device();
+
+    device.destroyPipeline(this->_pipeline);
+    device.destroyPipelineLayout(this->_pipelineLayout);
+    device.destroyDescriptorPool(this->_descPool);
+    device.destroyDescriptorSetLayout(this->_dsLayout);
+
+    delete this->_instBuf;
+    delete this->_objBuf;
+    delete this->_groupBuf;
+    delete this->_cmdBuf;
+    delete this->_countBuf;
+}
+
+void GPUCull::_initDescriptors ()
+{
+    auto device = this->_device();
+
+    vk::DescriptorPoolSize poolSz(vk::DescriptorType::eStorageBuffer, kNumBindings);
+    vk::DescriptorPoolCreateInfo poolInfo(
+        {}, /* flags */
+        1, /* max sets */
+        poolSz); /* pool sizes */
+    this->_descPool = device.createDescriptorPool(poolInfo);
+
+    // the instance data is read by the vertex shaders; the other buffers are
+    // only used by the culling shader
+    std::array<vk::DescriptorSetLayoutBinding, kNumBindings> bindings;
+    for (uint32_t i = 0;  i < kNumBindings;  ++i) {
+        bindings[i] = vk::DescriptorSetLayoutBinding(
+            i, /* binding */
+            vk::DescriptorType::eStorageBuffer, /* descriptor type */
+            1, /* descriptor count */
+            (i == kInstanceBinding) /* stages */
+              ? vk::ShaderStageFlagBits::eVertex
+              : vk::ShaderStageFlagBits::eCompute,
+            nullptr); /* immutable samplers */
+    }
+    vk::DescriptorSetLayoutCreateInfo layoutInfo({}, bindings);
+    this->_dsLayout = device.createDescriptorSetLayout(layoutInfo);
+
+    vk::DescriptorSetAllocateInfo allocInfo(this->_descPool, this->_dsLayout);
+    this->_descSet = (device.allocateDescriptorSets(allocInfo))[0];
+
+    std::array<vk::DescriptorBufferInfo, kNumBindings> bufInfos = {
+            this->_instBuf->descInfo(),
+            this->_objBuf->descInfo(),
+            this->_groupBuf->descInfo(),
+            this->_cmdBuf->descInfo(),
+            this->_countBuf->descInfo()
+        };
+    std::array<vk::WriteDescriptorSet, kNumBindings> writes;
+    for (uint32_t i = 0;  i < kNumBindings;  ++i) {
+        writes[i] = vk::WriteDescriptorSet(
+            this->_descSet, /* descriptor set */
+            i, /* binding */
+            0, /* array element */
+            vk::DescriptorType::eStorageBuffer, /* descriptor type */
+            nullptr, /* image info */
+            bufInfos[i], /* buffer info */
+            nullptr); /* texel buffer view */
+    }
+    device.updateDescriptorSets (writes, nullptr);
+
+}
+
+void GPUCull::_initPipeline ()
+{
+    vk::PushConstantRange pcRange(
+        vk::ShaderStageFlagBits::eCompute,
+        0,
+        sizeof(CullPC));
+    this->_pipelineLayout = this->_app->createPipelineLayout({this->_dsLayout}, {pcRange});
+
+    cs237::Shaders *shaders = new cs237::Shaders(
+        this->_app,
+        std::string(kShaderDir) + "cull",
+        vk::ShaderStageFlagBits::eCompute);
+
+    this->_pipeline = this->_app->createComputePipeline(shaders, this->_pipelineLayout);
+
+    delete shaders;
+
+}
+
+void GPUCull::cullCmd (vk::CommandBuffer cmdBuf, cs237::Frustumf_t const &f)
+{
+    // clear the draw counts
+    cmdBuf.fillBuffer(this->_countBuf->vkBuffer(), 0, VK_WHOLE_SIZE, 0);
+    vk::MemoryBarrier clearBarrier(
+        vk::AccessFlagBits::eTransferWrite, /* src access mask */
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    cmdBuf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eComputeShader,
+        {},
+        clearBarrier,
+        nullptr,
+        nullptr);
+
+    if (this->_nObjs > 0) {
+        CullPC pc;
+        for (int i = 0;  i < 6;  ++i) {
+            cs237::Planef_t const &p = f.plane(i);
+            pc.planes[i] = glm::vec4(p.norm(), p.dist());
+        }
+        pc.nObjs = this->_nObjs;
+        pc.compact = this->_compact ? 1 : 0;
+
+        cmdBuf.bindPipeline(vk::PipelineBindPoint::eCompute, this->_pipeline);
+        cmdBuf.bindDescriptorSets(
+            vk::PipelineBindPoint::eCompute,
+            this->_pipelineLayout,
+            0, /* first set */
+            this->_descSet, /* descriptor sets */
+            nullptr); /* dynamic offsets */
+        cmdBuf.pushConstants(
+            this->_pipelineLayout,
+            vk::ShaderStageFlagBits::eCompute,
+            0,
+            sizeof(CullPC),
+            &pc);
+        cmdBuf.dispatch((this->_nObjs + kWorkGroupSz - 1) / kWorkGroupSz, 1, 1);
+    }
+
+    // make the generated commands visible to the draw commands and the
+    // counts visible to the host (for statistics)
+    vk::MemoryBarrier cullBarrier(
+        vk::AccessFlagBits::eShaderWrite, /* src access mask */
+        vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eHostRead);
+    cmdBuf.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eHost,
+        {},
+        cullBarrier,
+        nullptr,
+        nullptr);
+
+}
+
+void GPUCull::drawCmd (vk::CommandBuffer cmdBuf, uint32_t g)
+{
+    Group const &grp = this->_groups[g];
+    constexpr uint32_t stride = cs237::IndirectBuffer<vk::DrawIndexedIndirectCommand>::stride();
+
+    grp.mesh->bindBuffers (cmdBuf);
+
+    if (this->_compact) {
+        cmdBuf.drawIndexedIndirectCount(
+            this->_cmdBuf->vkBuffer(),
+            grp.firstCmd * stride, /* offset */
+            this->_countBuf->vkBuffer(),
+            g * sizeof(uint32_t), /* count offset */
+            grp.maxCmds, /* max draw count */
+            stride);
+    } else {
+        cmdBuf.drawIndexedIndirect(
+            this->_cmdBuf->vkBuffer(),
+            grp.firstCmd * stride, /* offset */
+            grp.maxCmds, /* draw count */
+            stride);
+    }
+
+}
+
+uint32_t GPUCull::nVisible ()
+{
+    std::vector<uint32_t> counts(this->_countBuf->nElems());
+    this->_countBuf->copyFrom(counts.data(), 0, counts.size());
+
+    uint32_t n = 0;
+    for (auto c : counts) {
+        n += c;
+    }
+    return n;
+}
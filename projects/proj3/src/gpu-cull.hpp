@@ -0,0 +1,154 @@
+/*! \file gpu-cull.hpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * Support for GPU-driven view-frustum culling.  The bounds and per-instance
+ * data for the objects in the scene live in storage buffers; each frame, a
+ * compute shader culls the objects and generates the indirect-draw commands
+ * for the visible ones, so the cost of recording the draw commands on the CPU
+ * depends on the number of meshes, not the number of instances.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _GPU_CULL_HPP_
+#define _GPU_CULL_HPP_
+
+#include "cs237.hpp"
+#include "app.hpp"
+#include "instance.hpp"
+#include "mesh.hpp"
+#include "shader-uniforms.hpp"
+
+/// GPU-driven culling and indirect-draw generation.  The objects are grouped
+/// by mesh and each group has a region of the indirect-command buffer.  When
+/// the device supports `vkCmdDrawIndexedIndirectCount`, the compute shader packs
+/// the commands for the visible objects at the front of their group's region and
+/// the draw count comes from the GPU; otherwise, every object has a command and
+/// the culled objects are drawn with an instance count of zero.
+///
+/// The descriptor set (see `dsLayout`) has the per-instance data (`InstanceData`)
+/// at binding 0, which is visible to the vertex stage; the `firstInstance` of each
+/// generated command is the object's index, so vertex shaders should index the
+/// instance data with `gl_InstanceIndex`.
+class GPUCull {
+public:
+
+    /// \brief create the GPU-culling state for a scene
+    /// \param app   the owning application
+    /// \param objs  the objects in the scene; their world-space bounding boxes
+    ///              must be up to date
+    GPUCull (Proj3 *app, std::vector<Instance *> const &objs);
+
+    ~GPUCull ();
+
+    /// \brief can GPU culling be used on the application's device?
+    /// \param app  the application
+    /// \return true if the device supports indirect draws with multiple draws
+    ///         and non-zero `firstInstance` values
+    static bool isSupported (cs237::Application *app)
+    {
+        return app->hasMultiDrawIndirect();
+    }
+
+    /// the layout of the descriptor set for the culling buffers and instance data
+    vk::DescriptorSetLayout dsLayout () const { return this->_dsLayout; }
+
+    /// the descriptor set for the culling buffers and instance data
+    vk::DescriptorSet descSet () const { return this->_descSet; }
+
+    /// \brief record the commands to cull the objects and generate the draw commands.
+    /// \param cmdBuf  the command buffer to record the commands in; this function
+    ///                must be called outside of a render pass
+    /// \param f       the world-space view frustum
+    void cullCmd (vk::CommandBuffer cmdBuf, cs237::Frustumf_t const &f);
+
+    /// the number of draw groups (i.e., meshes that have instances)
+    uint32_t nGroups () const { return this->_groups.size(); }
+
+    /// \brief get a representative object for a draw group; the objects in a group
+    ///        share their mesh, so this object can be used to bind the per-mesh
+    ///        descriptor sets for the group.
+    /// \param g  the group index
+    Instance *groupObj (uint32_t g) const { return this->_groups[g].obj; }
+
+    /// \brief record the indirect-draw command for a draw group.
+    /// \param cmdBuf  the command buffer to record the commands in
+    /// \param g       the group index
+    ///
+    /// The caller is responsible for binding the pipeline and descriptor sets.
+    void drawCmd (vk::CommandBuffer cmdBuf, uint32_t g);
+
+    /// \brief the number of objects that were visible in the most recently
+    ///        completed frame.
+    ///
+    /// Since this function reads the draw counts from device memory, it should
+    /// only be called after waiting for the frame's fence.
+    uint32_t nVisible ();
+
+private:
+    /// culling information for an object; this struct should agree with the
+    /// `std430` layout in cull.comp
+    struct CullObj {
+        float bbMin[3];         ///< minimum corner of the world-space bounding box
+        uint32_t group;         ///< the object's draw group
+        float bbMax[3];         ///< maximum corner of the world-space bounding box
+        uint32_t slot;          ///< the object's fixed slot in the command buffer
+    };
+
+    /// per-mesh draw-group information for the compute shader
+    struct DrawGroup {
+        uint32_t indexCount;    ///< the number of indices in the mesh
+        uint32_t firstCmd;      ///< index of the group's first command slot
+        uint32_t maxCmds;       ///< the number of command slots in the group
+        uint32_t pad;
+    };
+
+    /// push constants for the compute shader
+    struct CullPC {
+        glm::vec4 planes[6];    ///< the frustum planes
+        uint32_t nObjs;         ///< the number of objects
+        uint32_t compact;       ///< non-zero when the draw count comes from the GPU
+    };
+
+    /// CPU-side information about a draw group
+    struct Group {
+        Mesh *mesh;             ///< the group's mesh
+        Instance *obj;          ///< a representative object
+        uint32_t firstCmd;      ///< index of the group's first command slot
+        uint32_t maxCmds;       ///< the number of objects in the group
+    };
+
+    Proj3 *_app;                                        ///< the owning application
+    uint32_t _nObjs;                                    ///< the number of objects
+    bool _compact;                                      ///< true if using draw counts
+    std::vector<Group> _groups;                         ///< the draw groups
+    cs237::StorageBuffer<InstanceData> *_instBuf;       ///< per-instance draw data
+    cs237::StorageBuffer<CullObj> *_objBuf;             ///< per-object culling data
+    cs237::StorageBuffer<DrawGroup> *_groupBuf;         ///< per-group data
+    cs237::IndirectBuffer<vk::DrawIndexedIndirectCommand> *_cmdBuf;
+                                                        ///< the generated draw commands
+    cs237::IndirectBuffer<uint32_t> *_countBuf;         ///< per-group draw counts
+    vk::DescriptorPool _descPool;                       ///< pool for `_descSet`
+    vk::DescriptorSetLayout _dsLayout;                  ///< layout of `_descSet`
+    vk::DescriptorSet _descSet;                         ///< the buffer descriptors
+    vk::PipelineLayout _pipelineLayout;                 ///< compute-pipeline layout
+    vk::Pipeline _pipeline;                             ///< the culling pipeline
+
+    /// get the device handle
+    vk::Device _device () const { return this->_app->device(); }
+
+    /// initialize the descriptor pool, layout, and set
+    void _initDescriptors ();
+
+    /// initialize the compute pipeline
+    void _initPipeline ();
+
+};
+
+#endif // !_GPU_CULL_HPP_
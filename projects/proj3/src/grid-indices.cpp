@@ -0,0 +1,106 @@
+/*! \file grid-indices.cpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "grid-indices.hpp"
+
+/// append the strip for the cells [col0..col1) of the row of cells `row`; the
+/// strip alternates between the top and bottom vertices of the cells, which
+/// gives the same triangles as `gridTriangleList`.
+static void addStrip (
+    std::vector<uint32_t> &indices,
+    uint32_t nCols, uint32_t row, uint32_t col0, uint32_t col1)
+{
+    if (!indices.empty()) {
+        indices.push_back(kRestartIndex);
+    }
+    uint32_t top = row * nCols;
+    uint32_t bot = top + nCols;
+    for (uint32_t j = col0;  j <= col1;  ++j) {
+        indices.push_back(top + j);
+        indices.push_back(bot + j);
+    }
+}
+
+/// extract the even bits of a 32-bit Morton code
+static uint32_t compactBits (uint32_t x)
+{
+    x &= 0x55555555;
+    x = (x | (x >> 1)) & 0x33333333;
+    x = (x | (x >> 2)) & 0x0f0f0f0f;
+    x = (x | (x >> 4)) & 0x00ff00ff;
+    x = (x | (x >> 8)) & 0x0000ffff;
+    return x;
+}
+
+std::vector<uint32_t> gridTriangleList (uint32_t nRows, uint32_t nCols)
+{
+    assert ((nRows >= 2) && (nCols >= 2));
+
+    std::vector<uint32_t> indices;
+    indices.reserve(6 * size_t(nRows - 1) * (nCols - 1));
+    for (uint32_t i = 0;  i+1 < nRows;  ++i) {
+        for (uint32_t j = 0;  j+1 < nCols;  ++j) {
+            uint32_t v00 = i * nCols + j;
+            indices.push_back(v00);
+            indices.push_back(v00 + nCols);
+            indices.push_back(v00 + 1);
+            indices.push_back(v00 + 1);
+            indices.push_back(v00 + nCols);
+            indices.push_back(v00 + nCols + 1);
+        }
+    }
+
+    return indices;
+}
+
+std::vector<uint32_t> gridTriangleStrips (uint32_t nRows, uint32_t nCols, uint32_t blockSz)
+{
+    assert ((nRows >= 2) && (nCols >= 2));
+
+    uint32_t nCellRows = nRows - 1;
+    uint32_t nCellCols = nCols - 1;
+    std::vector<uint32_t> indices;
+
+    if (blockSz == 0) {
+        indices.reserve(size_t(nCellRows) * (2 * nCols + 1));
+        for (uint32_t i = 0;  i < nCellRows;  ++i) {
+            addStrip (indices, nCols, i, 0, nCellCols);
+        }
+        return indices;
+    }
+
+    // the number of blocks in each dimension and the number of Morton codes
+    // that we need to cover them
+    uint32_t nBRows = (nCellRows + blockSz - 1) / blockSz;
+    uint32_t nBCols = (nCellCols + blockSz - 1) / blockSz;
+    uint32_t side = 1;
+    while ((side < nBRows) || (side < nBCols)) {
+        side *= 2;
+    }
+    // there is one strip per row of cells in each column of blocks
+    indices.reserve(size_t(nCellRows) * nBCols * (2 * blockSz + 3));
+    for (uint32_t code = 0;  code < side * side;  ++code) {
+        uint32_t bi = compactBits(code >> 1);
+        uint32_t bj = compactBits(code);
+        if ((bi >= nBRows) || (bj >= nBCols)) {
+            continue;
+        }
+        uint32_t row1 = std::min((bi + 1) * blockSz, nCellRows);
+        uint32_t col0 = bj * blockSz;
+        uint32_t col1 = std::min(col0 + blockSz, nCellCols);
+        for (uint32_t i = bi * blockSz;  i < row1;  ++i) {
+            addStrip (indices, nCols, i, col0, col1);
+        }
+    }
+
+    return indices;
+}
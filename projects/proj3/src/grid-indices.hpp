@@ -0,0 +1,56 @@
+/*! \file grid-indices.hpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * This file declares functions that generate the index arrays for rendering
+ * a regular grid of vertices (e.g., a height field or a terrain tile).
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _GRID_INDICES_HPP_
+#define _GRID_INDICES_HPP_
+
+#include "cs237.hpp"
+
+/// the index value that restarts a triangle strip when the pipeline is created
+/// with primitive restart enabled (the maximum value of a 32-bit index)
+constexpr uint32_t kRestartIndex = 0xffffffff;
+
+/// the default size (in cells) of the blocks used for Z-order strips
+constexpr uint32_t kDefaultStripBlock = 8;
+
+/// \brief generate triangle-list indices for a grid
+/// \param nRows  the number of rows of vertices in the grid
+/// \param nCols  the number of columns of vertices in the grid
+/// \return the indices, which use six indices per grid cell
+///
+/// The vertex in row `i` and column `j` of the grid is assumed to have index
+/// `i*nCols + j`.  The triangles are counter-clockwise when the grid is viewed
+/// from above with rows running along +Z and columns running along +X.
+std::vector<uint32_t> gridTriangleList (uint32_t nRows, uint32_t nCols);
+
+/// \brief generate triangle-strip indices for a grid, where the strips are
+///        separated by `kRestartIndex`
+/// \param nRows    the number of rows of vertices in the grid
+/// \param nCols    the number of columns of vertices in the grid
+/// \param blockSz  when zero, there is one strip per row of cells; otherwise,
+///                 the grid is divided into `blockSz` x `blockSz` blocks of
+///                 cells, which are visited in Z (Morton) order with one strip
+///                 per row of cells in the block.
+/// \return the indices
+///
+/// The vertex numbering and the triangles are the same as for `gridTriangleList`.
+/// Row strips use a little more than two indices per cell, but a strip shares
+/// its vertices with the previous strip only when the GPU's post-transform
+/// vertex cache can hold two rows of the grid.  The Z-order strips are shorter,
+/// so they use a few more indices, but the blocks keep the shared vertices in
+/// the cache.
+std::vector<uint32_t> gridTriangleStrips (uint32_t nRows, uint32_t nCols, uint32_t blockSz = 0);
+
+#endif // !_GRID_INDICES_HPP_
@@ -20,14 +20,15 @@ HeightField::HeightField (
     float width, float height, float vScale,
     glm::vec3 const &color,
     cs237::Image2D *cmap,
-    cs237::Image2D *nmap)
+    cs237::Image2D *nmap,
+    cs237::JobSystem &js)
   : _img(new cs237::Image2D(file, false)),
     _halfWid(0.5*width), _halfHt(0.5*height),
     _minHt(0), _maxHt(0),
     _scaleX(width / float(this->numCols() - 1)),
     _scaleY(vScale),
     _scaleZ(height / float(this->numRows() -1 )),
-    _color(color), _colorMap(cmap), _normMap(nmap)
+    _color(color), _colorMap(cmap), _normMap(nmap), _ownsNormMap(false)
 {
   // validate the arguments
     if ((this->_img->type() != cs237::ChannelTy::U8)
@@ -37,26 +38,81 @@ HeightField::HeightField (
     if ((width <= 0.0) || (height <= 0.0) || (vScale <= 0.0)) {
         ERROR("HeightField::HeightField: invalid scaling");
     }
-  // find the maximum height of the height-field
-    int minHt, maxHt;
-    if (this->_img->type() == cs237::ChannelTy::U8) {
-        const uint8_t *p = static_cast<const uint8_t *>(this->_img->data());
-        minHt = maxHt = *p++;
-        for (int i = 1;  i < this->numVerts();  i++, p++) {
-            if (*p > maxHt) maxHt = *p;
-            else if (*p < minHt) minHt = *p;
+    if ((this->numRows() < 2) || (this->numCols() < 2)) {
+        ERROR("HeightField::HeightField: height field must be at least 2x2");
+    }
+  // build the min/max pyramid; the top level gives the range of heights
+    this->_buildPyramid ();
+    PyrLevel const &top = this->_pyramid.back();
+    this->_minHt = this->_scaleY * float(top.minV[0]);
+    this->_maxHt = this->_scaleY * float(top.maxV[0]);
+  // generate a normal map (at the resolution of the color map) if one was not provided
+    if (this->_normMap == nullptr) {
+        uint32_t wid = (cmap != nullptr) ? cmap->width() : this->numCols();
+        uint32_t ht = (cmap != nullptr) ? cmap->height() : this->numRows();
+        this->_normMap = this->generateNormalMap (wid, ht, js);
+        this->_ownsNormMap = true;
+    }
+
+}
+
+HeightField::~HeightField ()
+{
+    if (this->_ownsNormMap) {
+        delete this->_normMap;
+    }
+    delete this->_img;
+}
+
+// build the min/max pyramid
+void HeightField::_buildPyramid ()
+{
+  // level 0 holds the range of the four corners of each cell
+    PyrLevel lev0;
+    lev0.nRows = this->numRows() - 1;
+    lev0.nCols = this->numCols() - 1;
+    lev0.minV.resize(lev0.nRows * lev0.nCols);
+    lev0.maxV.resize(lev0.nRows * lev0.nCols);
+    for (uint32_t r = 0;  r < lev0.nRows;  ++r) {
+        for (uint32_t c = 0;  c < lev0.nCols;  ++c) {
+            uint16_t v00 = this->valueAt(r, c);
+            uint16_t v01 = this->valueAt(r, c+1);
+            uint16_t v10 = this->valueAt(r+1, c);
+            uint16_t v11 = this->valueAt(r+1, c+1);
+            uint32_t idx = r * lev0.nCols + c;
+            lev0.minV[idx] = std::min(std::min(v00, v01), std::min(v10, v11));
+            lev0.maxV[idx] = std::max(std::max(v00, v01), std::max(v10, v11));
         }
     }
-    else {
-        const uint16_t *p = static_cast<const uint16_t *>(this->_img->data());
-        minHt = maxHt = *p++;
-        for (int i = 1;  i < this->numVerts();  i++, p++) {
-            if (*p > maxHt) maxHt = *p;
-            else if (*p < minHt) minHt = *p;
+    this->_pyramid.push_back(std::move(lev0));
+
+  // each higher level combines 2x2 blocks of the level below (the blocks on the
+  // last row/column may be partial)
+    while ((this->_pyramid.back().nRows > 1) || (this->_pyramid.back().nCols > 1)) {
+        PyrLevel const &prev = this->_pyramid.back();
+        PyrLevel lev;
+        lev.nRows = (prev.nRows + 1) / 2;
+        lev.nCols = (prev.nCols + 1) / 2;
+        lev.minV.resize(lev.nRows * lev.nCols);
+        lev.maxV.resize(lev.nRows * lev.nCols);
+        for (uint32_t r = 0;  r < lev.nRows;  ++r) {
+            uint32_t pr1 = std::min(2*r + 2, prev.nRows);
+            for (uint32_t c = 0;  c < lev.nCols;  ++c) {
+                uint32_t pc1 = std::min(2*c + 2, prev.nCols);
+                uint16_t lo = 0xffff, hi = 0;
+                for (uint32_t pr = 2*r;  pr < pr1;  ++pr) {
+                    for (uint32_t pc = 2*c;  pc < pc1;  ++pc) {
+                        uint32_t pIdx = pr * prev.nCols + pc;
+                        lo = std::min(lo, prev.minV[pIdx]);
+                        hi = std::max(hi, prev.maxV[pIdx]);
+                    }
+                }
+                lev.minV[r * lev.nCols + c] = lo;
+                lev.maxV[r * lev.nCols + c] = hi;
+            }
         }
+        this->_pyramid.push_back(std::move(lev));
     }
-    this->_minHt = this->_scaleY * float(minHt);
-    this->_maxHt = this->_scaleY * float(maxHt);
 
 }
 
@@ -71,3 +127,261 @@ uint16_t HeightField::valueAt (uint32_t row, uint32_t col) const
         return static_cast<uint16_t *>(this->_img->data())[idx];
     }
 }
+
+// compute a coarse conservative triangle mesh for use as an occluder
+void HeightField::occluderMesh (
+    uint32_t gridSz,
+    std::vector<glm::vec3> &verts,
+    std::vector<uint32_t> &indices) const
+{
+    assert (gridSz >= 2);
+
+    // the coarse grid samples every `step` rows/columns, plus the last row/column
+    uint32_t nRows = this->numRows();
+    uint32_t nCols = this->numCols();
+    uint32_t step = std::max(1u, (std::max(nRows, nCols) - 1 + gridSz - 2) / (gridSz - 1));
+    std::vector<uint32_t> rows, cols;
+    for (uint32_t r = 0;  r < nRows - 1;  r += step) { rows.push_back(r); }
+    rows.push_back(nRows - 1);
+    for (uint32_t c = 0;  c < nCols - 1;  c += step) { cols.push_back(c); }
+    cols.push_back(nCols - 1);
+
+    verts.clear();
+    verts.reserve(rows.size() * cols.size());
+    for (uint32_t i = 0;  i < rows.size();  ++i) {
+        // the range of rows covered by the coarse cells adjacent to this vertex
+        uint32_t r0 = (i > 0) ? rows[i-1] : rows[i];
+        uint32_t r1 = (i+1 < rows.size()) ? rows[i+1] : rows[i];
+        for (uint32_t j = 0;  j < cols.size();  ++j) {
+            uint32_t c0 = (j > 0) ? cols[j-1] : cols[j];
+            uint32_t c1 = (j+1 < cols.size()) ? cols[j+1] : cols[j];
+            glm::vec3 v = this->vertexAt(rows[i], cols[j]);
+            v.y = this->bounds(r0, c0, r1, c1).min().y;
+            verts.push_back(v);
+        }
+    }
+
+    indices.clear();
+    indices.reserve(6 * (rows.size() - 1) * (cols.size() - 1));
+    uint32_t w = cols.size();
+    for (uint32_t i = 0;  i+1 < rows.size();  ++i) {
+        for (uint32_t j = 0;  j+1 < cols.size();  ++j) {
+            uint32_t v00 = i * w + j;
+            indices.push_back(v00);   indices.push_back(v00 + w); indices.push_back(v00 + 1);
+            indices.push_back(v00 + 1); indices.push_back(v00 + w); indices.push_back(v00 + w + 1);
+        }
+    }
+}
+
+// helper for the bounds query
+void HeightField::_rangeQuery (
+    uint32_t lev, uint32_t i, uint32_t j,
+    uint32_t r0, uint32_t c0, uint32_t r1, uint32_t c1,
+    uint16_t &lo, uint16_t &hi) const
+{
+    PyrLevel const &L = this->_pyramid[lev];
+
+  // the range of cells covered by the entry
+    uint32_t nr0 = i << lev;
+    uint32_t nc0 = j << lev;
+    uint32_t nr1 = std::min((i + 1) << lev, this->_pyramid[0].nRows);
+    uint32_t nc1 = std::min((j + 1) << lev, this->_pyramid[0].nCols);
+
+    if ((nr1 <= r0) || (r1 <= nr0) || (nc1 <= c0) || (c1 <= nc0)) {
+        return; // disjoint
+    }
+    if ((r0 <= nr0) && (nr1 <= r1) && (c0 <= nc0) && (nc1 <= c1)) {
+        // the entry is inside the query region
+        uint32_t idx = i * L.nCols + j;
+        lo = std::min(lo, L.minV[idx]);
+        hi = std::max(hi, L.maxV[idx]);
+        return;
+    }
+    // partial overlap, so we recurse on the children (level 0 entries are
+    // either disjoint or inside, so we never get here with lev == 0)
+    PyrLevel const &K = this->_pyramid[lev-1];
+    for (uint32_t ci = 2*i;  ci < std::min(2*i + 2, K.nRows);  ++ci) {
+        for (uint32_t cj = 2*j;  cj < std::min(2*j + 2, K.nCols);  ++cj) {
+            this->_rangeQuery (lev-1, ci, cj, r0, c0, r1, c1, lo, hi);
+        }
+    }
+}
+
+// the world-space bounds of a region of the height field
+cs237::AABBf_t HeightField::bounds (uint32_t row0, uint32_t col0, uint32_t row1, uint32_t col1) const
+{
+    assert ((row0 < row1) && (row1 < this->numRows()));
+    assert ((col0 < col1) && (col1 < this->numCols()));
+
+    uint16_t lo = 0xffff, hi = 0;
+    this->_rangeQuery (this->_pyramid.size() - 1, 0, 0, row0, col0, row1, col1, lo, hi);
+
+    glm::vec3 p0 = this->vertexAt(row0, col0);
+    glm::vec3 p1 = this->vertexAt(row1, col1);
+    return cs237::AABBf_t(
+        glm::vec3(p0.x, this->_scaleY * float(lo), p0.z),
+        glm::vec3(p1.x, this->_scaleY * float(hi), p1.z));
+}
+
+// bilinear interpolation of the height at a world-space position
+float HeightField::heightAt (float x, float z) const
+{
+    uint32_t nRows = this->numRows();
+    uint32_t nCols = this->numCols();
+
+  // convert to grid coordinates and clamp to the height field
+    float gc = glm::clamp((x + this->_halfWid) / this->_scaleX, 0.0f, float(nCols - 1));
+    float gr = glm::clamp((z + this->_halfHt) / this->_scaleZ, 0.0f, float(nRows - 1));
+    uint32_t c = std::min(uint32_t(gc), nCols - 2);
+    uint32_t r = std::min(uint32_t(gr), nRows - 2);
+    float fc = gc - float(c);
+    float fr = gr - float(r);
+
+    float h0 = glm::mix(float(this->valueAt(r, c)), float(this->valueAt(r, c+1)), fc);
+    float h1 = glm::mix(float(this->valueAt(r+1, c)), float(this->valueAt(r+1, c+1)), fc);
+    return this->_scaleY * glm::mix(h0, h1, fr);
+}
+
+// Moller-Trumbore ray-triangle intersection; returns the ray parameter of the hit
+// or a negative number if there is no hit
+static float rayTri (
+    glm::vec3 const &orig, glm::vec3 const &dir,
+    glm::vec3 const &v0, glm::vec3 const &v1, glm::vec3 const &v2)
+{
+    constexpr float kEps = 1e-7f;
+    glm::vec3 e1 = v1 - v0;
+    glm::vec3 e2 = v2 - v0;
+    glm::vec3 p = glm::cross(dir, e2);
+    float det = glm::dot(e1, p);
+    if (std::fabs(det) < kEps) {
+        return -1.0f;
+    }
+    float invDet = 1.0f / det;
+    glm::vec3 s = orig - v0;
+    float u = glm::dot(s, p) * invDet;
+    if ((u < 0.0f) || (u > 1.0f)) {
+        return -1.0f;
+    }
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(dir, q) * invDet;
+    if ((v < 0.0f) || (u + v > 1.0f)) {
+        return -1.0f;
+    }
+    return glm::dot(e2, q) * invDet;
+}
+
+// find the first intersection of a ray with the height field
+bool HeightField::intersectRay (
+    glm::vec3 const &orig, glm::vec3 const &dir,
+    float tMax, float &tHit) const
+{
+  // we work in grid space, where X is the column, Y is the height-field value,
+  // and Z is the row.  Since this transformation is affine, the ray parameter
+  // is the same as in world space.
+    glm::vec3 o(
+        (orig.x + this->_halfWid) / this->_scaleX,
+        orig.y / this->_scaleY,
+        (orig.z + this->_halfHt) / this->_scaleZ);
+    glm::vec3 d(dir.x / this->_scaleX, dir.y / this->_scaleY, dir.z / this->_scaleZ);
+    uint32_t nCellRows = this->_pyramid[0].nRows;
+    uint32_t nCellCols = this->_pyramid[0].nCols;
+
+  // clip the ray to the footprint of a pyramid entry; returns false if the
+  // clipped interval is empty
+    auto clip = [&](uint32_t lev, uint32_t i, uint32_t j, float &t0, float &t1) -> bool {
+        float lo[2] = { float(j << lev), float(i << lev) };
+        float hi[2] = {
+            float(std::min((j + 1) << lev, nCellCols)),
+            float(std::min((i + 1) << lev, nCellRows))
+        };
+        float os[2] = { o.x, o.z };
+        float ds[2] = { d.x, d.z };
+        for (int k = 0;  k < 2;  ++k) {
+            if (ds[k] == 0.0f) {
+                if ((os[k] < lo[k]) || (os[k] > hi[k])) {
+                    return false;
+                }
+            } else {
+                float inv = 1.0f / ds[k];
+                float ta = (lo[k] - os[k]) * inv;
+                float tb = (hi[k] - os[k]) * inv;
+                if (ta > tb) std::swap(ta, tb);
+                t0 = std::max(t0, ta);
+                t1 = std::min(t1, tb);
+            }
+        }
+        return (t0 <= t1);
+    };
+
+  // a pending pyramid entry and the ray interval inside its footprint
+    struct Item {
+        uint32_t lev, i, j;
+        float t0, t1;
+    };
+    std::vector<Item> stk;
+    stk.reserve(4 * this->_pyramid.size());
+
+    uint32_t top = this->_pyramid.size() - 1;
+    float t0 = 0.0f, t1 = tMax;
+    if (clip(top, 0, 0, t0, t1)) {
+        stk.push_back(Item{top, 0, 0, t0, t1});
+    }
+
+    while (! stk.empty()) {
+        Item it = stk.back();
+        stk.pop_back();
+
+        // skip the entry if the ray is above or below it over its footprint
+        PyrLevel const &L = this->_pyramid[it.lev];
+        uint32_t idx = it.i * L.nCols + it.j;
+        float y0 = o.y + it.t0 * d.y;
+        float y1 = o.y + it.t1 * d.y;
+        if ((std::min(y0, y1) > float(L.maxV[idx])) || (std::max(y0, y1) < float(L.minV[idx]))) {
+            continue;
+        }
+
+        if (it.lev == 0) {
+            // test the cell's triangles; the diagonal agrees with the mesh's
+            // triangulation.  Since the cells are visited front to back, the
+            // first hit is the nearest one.
+            float r = float(it.i), c = float(it.j);
+            glm::vec3 v00(c, float(this->valueAt(it.i, it.j)), r);
+            glm::vec3 v01(c + 1.0f, float(this->valueAt(it.i, it.j+1)), r);
+            glm::vec3 v10(c, float(this->valueAt(it.i+1, it.j)), r + 1.0f);
+            glm::vec3 v11(c + 1.0f, float(this->valueAt(it.i+1, it.j+1)), r + 1.0f);
+            float ta = rayTri(o, d, v00, v10, v01);
+            float tb = rayTri(o, d, v01, v10, v11);
+            bool hitA = (ta >= 0.0f) && (ta <= tMax);
+            bool hitB = (tb >= 0.0f) && (tb <= tMax);
+            if (hitA || hitB) {
+                tHit = (hitA && hitB) ? std::min(ta, tb) : (hitA ? ta : tb);
+                return true;
+            }
+            continue;
+        }
+
+        // push the children that the ray passes through, farthest first
+        PyrLevel const &K = this->_pyramid[it.lev - 1];
+        Item kids[4];
+        int nKids = 0;
+        for (uint32_t ci = 2*it.i;  ci < std::min(2*it.i + 2, K.nRows);  ++ci) {
+            for (uint32_t cj = 2*it.j;  cj < std::min(2*it.j + 2, K.nCols);  ++cj) {
+                float k0 = it.t0, k1 = it.t1;
+                if (clip(it.lev - 1, ci, cj, k0, k1)) {
+                    // insertion sort by decreasing entry time
+                    int k = nKids++;
+                    while ((k > 0) && (kids[k-1].t0 < k0)) {
+                        kids[k] = kids[k-1];
+                        --k;
+                    }
+                    kids[k] = Item{it.lev - 1, ci, cj, k0, k1};
+                }
+            }
+        }
+        for (int k = 0;  k < nKids;  ++k) {
+            stk.push_back(kids[k]);
+        }
+    }
+
+    return false;
+}
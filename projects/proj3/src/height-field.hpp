@@ -30,12 +30,17 @@ class HeightField {
     /// \param color   the color for non-texturing modes
     /// \param cmap    the color texture image for the ground
     /// \param nmap    the the normal-map texture image for the ground
+    /// \param js      the job system used to generate the normal map when
+    ///                `nmap` is nullptr
     HeightField (
         std::string const &file,
         float width, float height, float vScale,
         glm::vec3 const &color,
         cs237::Image2D *cmap,
-        cs237::Image2D *nmap);
+        cs237::Image2D *nmap,
+        cs237::JobSystem &js);
+
+    ~HeightField ();
 
     /// the width of the ground object in world-space
     float width () const { return 2.0f * this->_halfWid; }
@@ -49,6 +54,14 @@ class HeightField {
     /// the number of rows of data in the height-field
     uint32_t numCols () const { return this->_img->width(); }
 
+    /// the vertical scale factor that maps height-field values to world-space
+    /// Y coordinates
+    float vScale () const { return this->_scaleY; }
+
+    /// the height-field image; this image can be used as the source of a
+    /// texture for rendering the height field on the GPU
+    cs237::Image2D const *image () const { return this->_img; }
+
     /// the number of vertices in the mesh represented by the height field
     uint32_t numVerts () const { return this->numRows() * this->numCols(); }
 
@@ -82,16 +95,105 @@ class HeightField {
             glm::vec3( this->_halfWid, this->_maxHt,  this->_halfHt));
     }
 
+    /// \brief the world-space bounds of a rectangular region of the height field;
+    ///        this query uses the min/max pyramid, so its cost is proportional
+    ///        to the perimeter of the region (in samples) instead of its area.
+    /// \param row0  the first row of the region
+    /// \param col0  the first column of the region
+    /// \param row1  the last row of the region; must be greater than `row0`
+    /// \param col1  the last column of the region; must be greater than `col0`
+    /// \return the bounding box of the samples in the region
+    cs237::AABBf_t bounds (uint32_t row0, uint32_t col0, uint32_t row1, uint32_t col1) const;
+
+    /// \brief the height of the ground at a world-space position, which is computed
+    ///        by bilinear interpolation of the surrounding samples.  Positions
+    ///        outside the height field are clamped to its edges.
+    /// \param x  the world-space X coordinate
+    /// \param z  the world-space Z coordinate
+    /// \return the world-space Y coordinate of the ground
+    float heightAt (float x, float z) const;
+
+    /// \brief find the first intersection of a ray with the surface of the height
+    ///        field (i.e., the triangles of the full-resolution mesh).  The search
+    ///        descends the min/max pyramid in front-to-back order and skips
+    ///        regions where the ray is entirely above or below the ground.
+    /// \param orig  the world-space origin of the ray
+    /// \param dir   the world-space direction of the ray (does not have to be unit length)
+    /// \param tMax  the maximum ray parameter to consider
+    /// \param t     set to the ray parameter of the hit (if there is one)
+    /// \return true if the ray hits the ground in the interval [0..tMax]
+    bool intersectRay (glm::vec3 const &orig, glm::vec3 const &dir, float tMax, float &t) const;
+
+    /// \brief the world-space surface normal at a sample, which is computed from
+    ///        central differences of the neighboring samples (one-sided differences
+    ///        are used on the edges of the height field)
+    /// \param row  the sample's row
+    /// \param col  the sample's column
+    glm::vec3 normalAt (uint32_t row, uint32_t col) const;
+
+    /// \brief the world-space surface tangent at a sample, which is the unit-length
+    ///        direction of the surface along the +X axis
+    /// \param row  the sample's row
+    /// \param col  the sample's column
+    glm::vec3 tangentAt (uint32_t row, uint32_t col) const;
+
+    /// \brief generate a tangent-space normal map for the height field
+    /// \param wid  the width of the normal map in texels
+    /// \param ht   the height of the normal map in texels
+    /// \param js   the job system that generates the rows in parallel
+    /// \return an RGBA8 image that encodes the normal at the center of each texel
+    ///
+    /// The normal map covers the whole height field using the same texture
+    /// coordinates as the ground mesh, and the normals are encoded relative to
+    /// the unperturbed frame (i.e., tangent = +X, bitangent = +Z, and normal = +Y),
+    /// so a flat ground is (128, 128, 255).  We produce four-channel texels, since
+    /// many Vulkan implementations do not support 24-bit formats; the alpha
+    /// channel is 255.  The slopes of the surface are
+    /// bilinearly interpolated between samples, so the map can have a higher
+    /// resolution than the height field.  The work is split into bands of rows
+    /// that are run on the job system and each row is packed using SIMD
+    /// instructions.
+    cs237::DataImage2D *generateNormalMap (
+        uint32_t wid, uint32_t ht,
+        cs237::JobSystem &js) const;
+
+    /// the number of levels in the min/max pyramid
+    uint32_t numPyramidLevels () const { return this->_pyramid.size(); }
+
+    /// \brief compute a coarse triangle mesh for use as an occluder
+    /// \param gridSz   the maximum number of vertices along each side of the grid
+    /// \param verts    set to the world-space vertices of the occluder
+    /// \param indices  set to the triangle indices of the occluder
+    ///
+    /// The occluder is conservative: each vertex takes the minimum height of the
+    /// height-field samples in the cells around it, so the occluder lies on or
+    /// below the full-resolution surface.
+    void occluderMesh (
+        uint32_t gridSz,
+        std::vector<glm::vec3> &verts,
+        std::vector<uint32_t> &indices) const;
+
     /// return the color for the ground in wireframe and flat-shading rendering modes
     glm::vec3 const &color () const { return this->_color; }
 
     /// return the color map image for the ground
     cs237::Image2D *colorMap () const { return this->_colorMap; }
 
-    /// return the normal map image for the ground
+    /// return the normal map image for the ground; this image is generated
+    /// from the height field when the scene does not provide one
     cs237::Image2D *normalMap () const { return this->_normMap; }
 
   private:
+    /// a level of the min/max pyramid.  Level 0 has one entry per grid cell
+    /// (i.e., the square between four adjacent samples) and each entry at
+    /// level `k` covers a 2^k x 2^k block of cells.
+    struct PyrLevel {
+        uint32_t nRows;                 ///< the number of rows in the level
+        uint32_t nCols;                 ///< the number of columns in the level
+        std::vector<uint16_t> minV;     ///< minimum height-field values
+        std::vector<uint16_t> maxV;     ///< maximum height-field values
+    };
+
     const cs237::Image2D *_img; ///< the underlying image data
     const float _halfWid;       ///< half the width in world space
     const float _halfHt;        ///< half the height in world space
@@ -106,6 +208,28 @@ class HeightField {
                                 ///  normal-mapping modes
     cs237::Image2D *_normMap;	///< the normal-map texture image for the ground in
                                 ///  normal-mapping mode.
+    bool _ownsNormMap;          ///< true if `_normMap` was generated by this object
+    std::vector<PyrLevel> _pyramid;
+                                ///< the min/max pyramid; the last level has a
+                                ///  single entry that covers the whole height field
+
+    /// build the min/max pyramid
+    void _buildPyramid ();
+
+    /// compute the slopes of the surface along the X and Z axes (i.e., dY/dX
+    /// and dY/dZ in world space) for the samples of a row
+    /// \param row  the row of the height field
+    /// \param sx   an array of `numCols()` elements that is set to the X slopes
+    /// \param sz   an array of `numCols()` elements that is set to the Z slopes
+    void _slopeRow (uint32_t row, float *sx, float *sz) const;
+
+    /// helper for `bounds` that computes the range of values in the cells
+    /// [r0..r1) x [c0..c1) that are covered by the pyramid entry (i, j) at
+    /// level `lev`
+    void _rangeQuery (
+        uint32_t lev, uint32_t i, uint32_t j,
+        uint32_t r0, uint32_t c0, uint32_t r1, uint32_t c1,
+        uint16_t &lo, uint16_t &hi) const;
 
 };
 
@@ -0,0 +1,233 @@
+/*! \file hf-tiler.cpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * This file contains a program that converts a grayscale PNG height field
+ * to the tiled height-field format (see tiled-hf.hpp).  The PNG file is read
+ * one row at a time, so the memory used by the conversion is proportional to
+ * the width of the height field times the tile size.  Unlike the cs237 image
+ * loader, there is no limit on the image size.
+ *
+ * Usage:
+ *
+ *      hf-tiler [ -t <tile-cells> ] <in.png> <out.hft>
+ *
+ * where the tile size must be a multiple of 64 (the default is 256).
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "tiled-hf.hpp"
+#include <png.h>
+#include <cstdio>
+#include <cstring>
+
+/// the default number of cells along the side of a tile
+constexpr uint32_t kDefaultTileCells = 256;
+
+/// the number of cells along the side of the coarse grid that is used to
+/// compute a tile's error
+constexpr uint32_t kCoarseCells = 64;
+
+/// the tile data is aligned to this boundary in the output file
+constexpr uint64_t kDataAlign = 4096;
+
+static void usage ()
+{
+    std::cerr << "usage: hf-tiler [ -t <tile-cells> ] <in.png> <out.hft>\n";
+    exit (EXIT_FAILURE);
+}
+
+/// the maximum vertical error of a tile when it is rendered as a `kCoarseCells`
+/// x `kCoarseCells` grid.  The tile's samples are `data[(i+1)*sz + (j+1)]` for
+/// `0 <= i,j <= n`, where `sz = n+3` and `n` is the number of cells in the tile.
+static float coarseError (std::vector<uint16_t> const &data, uint32_t n)
+{
+    uint32_t sz = n + 3;
+    uint32_t s = n / kCoarseCells;
+    auto h = [&](uint32_t i, uint32_t j) { return float(data[(i+1)*sz + (j+1)]); };
+
+    float err = 0.0f;
+    for (uint32_t i = 0;  i <= n;  ++i) {
+        uint32_t ci = std::min(i / s, kCoarseCells - 1) * s;
+        float v = float(i - ci) / float(s);
+        for (uint32_t j = 0;  j <= n;  ++j) {
+            uint32_t cj = std::min(j / s, kCoarseCells - 1) * s;
+            float u = float(j - cj) / float(s);
+            // the coarse cell's diagonal runs from (ci+s, cj) to (ci, cj+s)
+            float approx;
+            if (u + v <= 1.0f) {
+                float h00 = h(ci, cj);
+                approx = h00 + u * (h(ci, cj+s) - h00) + v * (h(ci+s, cj) - h00);
+            } else {
+                float h11 = h(ci+s, cj+s);
+                approx = h11 + (1.0f - u) * (h(ci+s, cj) - h11) + (1.0f - v) * (h(ci, cj+s) - h11);
+            }
+            err = std::max(err, std::abs(h(i, j) - approx));
+        }
+    }
+
+    return err;
+}
+
+int main (int argc, char *argv[])
+{
+    int argi = 1;
+    if ((argc > 1) && (std::strcmp(argv[1], "-t") == 0)) {
+        if (argc < 3) {
+            usage();
+        }
+        argi = 3;
+    }
+    const uint32_t tileCells = (argi > 1) ? std::atoi(argv[2]) : kDefaultTileCells;
+    if ((argc - argi != 2) || (tileCells == 0) || (tileCells % kCoarseCells != 0)) {
+        usage();
+    }
+    std::string inFile = argv[argi];
+    std::string outFile = argv[argi+1];
+
+    FILE *inF = std::fopen(inFile.c_str(), "rb");
+    if (inF == nullptr) {
+        std::cerr << "hf-tiler: unable to open \"" << inFile << "\"\n";
+        return EXIT_FAILURE;
+    }
+
+  // set up the PNG reader
+    png_structp pngPtr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop infoPtr = (pngPtr != nullptr) ? png_create_info_struct(pngPtr) : nullptr;
+    if (infoPtr == nullptr) {
+        std::cerr << "hf-tiler: unable to initialize PNG reader\n";
+        return EXIT_FAILURE;
+    }
+    if (setjmp (png_jmpbuf(pngPtr))) {
+        std::cerr << "hf-tiler: error reading \"" << inFile << "\"\n";
+        return EXIT_FAILURE;
+    }
+    png_init_io (pngPtr, inF);
+    png_read_info (pngPtr, infoPtr);
+
+    png_uint_32 width, height;
+    int bitDepth, colorType, interlaceType;
+    png_get_IHDR (pngPtr, infoPtr, &width, &height, &bitDepth, &colorType,
+        &interlaceType, nullptr, nullptr);
+    if ((colorType != PNG_COLOR_TYPE_GRAY) || (bitDepth < 8)) {
+        std::cerr << "hf-tiler: expected an 8 or 16-bit grayscale image\n";
+        return EXIT_FAILURE;
+    }
+    if (interlaceType != PNG_INTERLACE_NONE) {
+        std::cerr << "hf-tiler: interlaced images are not supported\n";
+        return EXIT_FAILURE;
+    }
+    if ((width < 2) || (height < 2)) {
+        std::cerr << "hf-tiler: image is too small\n";
+        return EXIT_FAILURE;
+    }
+    if (bitDepth == 16) {
+        // PNG files store data in network byte order (big-endian), but the x86 is little-endian
+        png_set_swap (pngPtr);
+    }
+    png_read_update_info (pngPtr, infoPtr);
+
+  // the output header
+    TiledHFHeader hdr;
+    std::memcpy (hdr.magic, TiledHFHeader::kMagic, sizeof(hdr.magic));
+    hdr.version = TiledHFHeader::kVersion;
+    hdr.nCols = width;
+    hdr.nRows = height;
+    hdr.tileCells = tileCells;
+    hdr.nTileCols = (width - 1 + tileCells - 1) / tileCells;
+    hdr.nTileRows = (height - 1 + tileCells - 1) / tileCells;
+    hdr.minV = 0xffff;
+    hdr.maxV = 0;
+    hdr.maxErr = 0.0f;
+    uint64_t nTiles = uint64_t(hdr.nTileRows) * hdr.nTileCols;
+    uint64_t tableEnd = sizeof(TiledHFHeader) + nTiles * sizeof(TiledHFTileInfo);
+    hdr.dataOffset = (tableEnd + kDataAlign - 1) & ~(kDataAlign - 1);
+
+    FILE *outF = std::fopen(outFile.c_str(), "wb");
+    if (outF == nullptr) {
+        std::cerr << "hf-tiler: unable to create \"" << outFile << "\"\n";
+        return EXIT_FAILURE;
+    }
+    // the header and tile table are written at the end, once they are known
+    std::vector<TiledHFTileInfo> table(nTiles);
+    std::fseek (outF, hdr.dataOffset, SEEK_SET);
+
+  // a tile row needs the samples from one row before the tile to one row after
+  // it, which is `tileCells+3` rows, so we keep a ring buffer of that many rows
+    uint32_t sz = tileCells + 3;
+    std::vector<std::vector<uint16_t>> ring(sz, std::vector<uint16_t>(width));
+    std::vector<png_byte> rowBuf(png_get_rowbytes(pngPtr, infoPtr));
+    uint32_t nextRow = 0;
+    auto sampleRow = [&](int64_t r) -> std::vector<uint16_t> const & {
+        return ring[std::clamp<int64_t>(r, 0, height - 1) % sz];
+    };
+
+    std::vector<uint16_t> tile(sz * sz);
+    for (uint32_t tr = 0;  tr < hdr.nTileRows;  ++tr) {
+        int64_t r0 = int64_t(tr) * tileCells - 1;
+        // read the rows that this tile row needs
+        uint32_t lastRow = std::min<int64_t>(r0 + sz - 1, height - 1);
+        while (nextRow <= lastRow) {
+            png_read_row (pngPtr, rowBuf.data(), nullptr);
+            std::vector<uint16_t> &dst = ring[nextRow % sz];
+            if (bitDepth == 16) {
+                std::memcpy (dst.data(), rowBuf.data(), width * sizeof(uint16_t));
+            } else {
+                for (uint32_t c = 0;  c < width;  ++c) {
+                    dst[c] = rowBuf[c];
+                }
+            }
+            nextRow++;
+        }
+        for (uint32_t tc = 0;  tc < hdr.nTileCols;  ++tc) {
+            int64_t c0 = int64_t(tc) * tileCells - 1;
+            for (uint32_t i = 0;  i < sz;  ++i) {
+                std::vector<uint16_t> const &src = sampleRow(r0 + i);
+                for (uint32_t j = 0;  j < sz;  ++j) {
+                    tile[i*sz + j] = src[std::clamp<int64_t>(c0 + j, 0, width - 1)];
+                }
+            }
+            // the range of the tile's samples, excluding the border
+            TiledHFTileInfo &info = table[uint64_t(tr) * hdr.nTileCols + tc];
+            info.minV = 0xffff;
+            info.maxV = 0;
+            for (uint32_t i = 1;  i <= tileCells + 1;  ++i) {
+                for (uint32_t j = 1;  j <= tileCells + 1;  ++j) {
+                    info.minV = std::min(info.minV, tile[i*sz + j]);
+                    info.maxV = std::max(info.maxV, tile[i*sz + j]);
+                }
+            }
+            info.err = coarseError (tile, tileCells);
+            hdr.minV = std::min(hdr.minV, info.minV);
+            hdr.maxV = std::max(hdr.maxV, info.maxV);
+            hdr.maxErr = std::max(hdr.maxErr, info.err);
+            if (std::fwrite(tile.data(), sizeof(uint16_t), tile.size(), outF) != tile.size()) {
+                std::cerr << "hf-tiler: error writing \"" << outFile << "\"\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    png_destroy_read_struct (&pngPtr, &infoPtr, nullptr);
+    std::fclose (inF);
+
+  // write the header and tile table
+    std::fseek (outF, 0, SEEK_SET);
+    if ((std::fwrite(&hdr, sizeof(hdr), 1, outF) != 1)
+    ||  (std::fwrite(table.data(), sizeof(TiledHFTileInfo), nTiles, outF) != nTiles)
+    ||  (std::fclose(outF) != 0)) {
+        std::cerr << "hf-tiler: error writing \"" << outFile << "\"\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "hf-tiler: " << width << "x" << height << " samples -> "
+        << hdr.nTileCols << "x" << hdr.nTileRows << " tiles of " << tileCells << "x"
+        << tileCells << " cells\n";
+
+    return EXIT_SUCCESS;
+}
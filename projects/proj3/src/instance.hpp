@@ -25,6 +25,15 @@ struct Instance {
     glm::mat4 toWorld;          //!< affine transform from object space to world space
     glm::mat3 normToWorld;      //!< linear transform that maps object-space normals
                                 //!  to world-space normals
+    cs237::AABBf_t bbox;        //!< world-space bounding box of the object; this
+                                //!  is used for view-frustum culling
+
+    /// compute the world-space bounding box from the mesh's bounding box
+    /// and the object's `toWorld` transform
+    void updateBBox ()
+    {
+        this->bbox = this->mesh->bbox.transform(this->toWorld);
+    }
 };
 
 #endif /*! _INSTANCE_HPP_ */
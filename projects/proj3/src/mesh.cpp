@@ -15,9 +15,15 @@
 #include "height-field.hpp"
 #include <vector>
 
+/// meshes with more triangles than this limit are not used as occluders
+constexpr uint32_t kMaxOccluderTris = 4096;
+
+/// the size of the grid used for height-field occluders
+constexpr uint32_t kHFOccluderGridSz = 33;
+
 Mesh::Mesh (Proj3 *app, vk::PrimitiveTopology p, OBJ::Model const *model)
   : vBuf(nullptr), iBuf(nullptr), prim(p), cMap(nullptr), nMap(nullptr),
-    cMapSampler(), nMapSampler(), descSet()
+    cMapSampler(), nMapSampler(), descSet(), bbox(model->bounds()), ground(false)
 {
     assert (model->numGroups() == 1);
 
@@ -99,7 +105,17 @@ Mesh::Mesh (Proj3 *app, vk::PrimitiveTopology p, OBJ::Model const *model)
     // index buffer initialization
     this->iBuf->copyTo(vk::ArrayProxy<uint32_t>(grp.nIndices, grp.indices));
 
-    /** HINT: other initialization, such as color and normal maps, and samplers */
+    // keep a CPU-side copy of small meshes for occlusion culling
+    if ((p == vk::PrimitiveTopology::eTriangleList)
+    && (grp.nIndices / 3 <= kMaxOccluderTris)) {
+        this->occVerts.assign(grp.verts, grp.verts + grp.nVerts);
+        this->occIndices.assign(grp.indices, grp.indices + grp.nIndices);
+    }
+
+    /** HINT: other initialization, such as color and normal maps, and samplers.
+     ** Meshes that share a texture and sampler can share a descriptor set by
+     ** getting it from `descriptorAllocator()->cached`.
+     **/
 }
 
 Mesh::Mesh (cs237::Application *app, const HeightField *hf)
@@ -107,7 +123,7 @@ Mesh::Mesh (cs237::Application *app, const HeightField *hf)
     iBuf(new cs237::IndexBuffer<uint32_t>(app, 3*hf->numTris())),
     prim(vk::PrimitiveTopology::eTriangleList),
     cMap(nullptr), nMap(nullptr),
-    cMapSampler(), nMapSampler(), descSet()
+    cMapSampler(), nMapSampler(), descSet(), bbox(hf->bbox()), ground(true)
 {
     /** HINT: you will need to compute the Vertex values for the grid points in
      ** the heightfield and then initialize the vertex and index buffers.
@@ -119,6 +135,9 @@ Mesh::Mesh (cs237::Application *app, const HeightField *hf)
      **/
 
     /** HINT: other initialization, such as color and normal maps */
+
+    // a coarse version of the ground for occlusion culling
+    hf->occluderMesh (kHFOccluderGridSz, this->occVerts, this->occIndices);
 }
 
 Mesh::~Mesh ()
@@ -133,3 +152,11 @@ void Mesh::draw (vk::CommandBuffer cmdBuf)
 {
     /** HINT: index-mode drawing commands here */
 }
+
+void Mesh::bindBuffers (vk::CommandBuffer cmdBuf)
+{
+    vk::Buffer vertBuffers[] = {this->vBuf->vkBuffer()};
+    vk::DeviceSize offsets[] = {0};
+    cmdBuf.bindVertexBuffers(0, vertBuffers, offsets);
+    cmdBuf.bindIndexBuffer(this->iBuf->vkBuffer(), 0, vk::IndexType::eUint32);
+}
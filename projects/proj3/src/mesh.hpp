@@ -27,9 +27,14 @@ struct Mesh {
     vk::PrimitiveTopology prim;         //!< the primitive type for rendering the mesh
     cs237::Texture2D *cMap;             //!< the color-map texture for the object
     cs237::Texture2D *nMap;             //!< the normal-map texture for the object
-    vk::Sampler cMapSampler;            //!< the color-map sampler
-    vk::Sampler nMapSampler;            //!< the normal-map sampler
+    vk::Sampler cMapSampler;            //!< the color-map sampler (owned by the app)
+    vk::Sampler nMapSampler;            //!< the normal-map sampler (owned by the app)
     vk::DescriptorSet descSet;          //!< the descriptor set for the samplers
+    cs237::AABBf_t bbox;                //!< the object-space bounding box of the mesh
+    bool ground;                        //!< true for the height-field mesh
+    std::vector<glm::vec3> occVerts;    //!< object-space vertices of the occluder geometry;
+                                        //!  empty if the mesh is not used as an occluder
+    std::vector<uint32_t> occIndices;   //!< triangle indices of the occluder geometry
 
     //! create a Mesh object by allocating and loading buffers for it.
     //! \param app    the owning app
@@ -45,6 +50,9 @@ struct Mesh {
     //! create a Mesh object for a height-field
     Mesh (cs237::Application *app, const class HeightField *hf);
 
+    /// can this mesh be used as an occluder?
+    bool isOccluder () const { return !this->occIndices.empty(); }
+
     /// return the number of indices in the mesh
     uint32_t nIndices() const { return this->iBuf->nIndices(); }
 
@@ -52,6 +60,10 @@ struct Mesh {
     //! `vkCmdDrawIndexed`.
     void draw (vk::CommandBuffer cmdBuf);
 
+    //! record commands in the command buffer to bind the mesh's vertex and
+    //! index buffers; this is used for drawing the mesh with indirect draws.
+    void bindBuffers (vk::CommandBuffer cmdBuf);
+
 };
 
 #endif // !_MESH_HPP_
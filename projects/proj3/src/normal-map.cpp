@@ -0,0 +1,268 @@
+/*! \file normal-map.cpp
+ *
+ * \author John Reppy
+ *
+ * This file implements the normal and normal-map generation methods of the
+ * HeightField class.  The texels of a normal map are computed by a kernel that
+ * processes 8 (AVX2) or 4 (SSE2 and NEON) texels per iteration, with a scalar
+ * fallback; the choice is made at compile time.
+ */
+
+/* CMSC23700 Project 3 sample code (Autumn 2023)
+ *
+ * COPYRIGHT (c) 2023 John Reppy (http://www.cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "height-field.hpp"
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define HF_NMAP_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define HF_NMAP_SSE2
+#elif defined(__aarch64__)
+#  include <arm_neon.h>
+#  define HF_NMAP_NEON
+#endif
+
+namespace {
+
+/// the minimum number of normal-map rows per task; smaller maps are not
+/// worth splitting
+constexpr uint32_t kMinRowsPerTask = 64;
+
+/// encode a component of a unit vector as an unsigned byte; the range [-1..1]
+/// maps to [0..255]
+inline uint8_t encode (float v)
+{
+    return uint8_t(127.5f * v + 128.0f);
+}
+
+/// scalar version of `packNormals` for a single texel
+inline uint32_t packNormal (float sx, float sz)
+{
+    float s = 1.0f / std::sqrt(sx * sx + sz * sz + 1.0f);
+    return uint32_t(encode(-sx * s))            // tangent (+X)
+        | (uint32_t(encode(-sz * s)) << 8)      // bitangent (+Z)
+        | (uint32_t(encode(s)) << 16)           // normal (+Y)
+        | 0xff000000;                           // alpha
+}
+
+/// compute the tangent-space normals for `n` texels from the slopes of the
+/// surface and pack them as RGBA8 texels (we assume a little-endian machine).
+/// The normal for the slopes `sx` and `sz` is normalize(-sx, 1, -sz) in world
+/// space, which is (-sx, -sz, 1) in the tangent frame.
+void packNormals (const float *sx, const float *sz, uint32_t *rgba, uint32_t n)
+{
+    uint32_t i = 0;
+
+#if defined(HF_NMAP_AVX2)
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 negScale = _mm256_set1_ps(-127.5f);
+    const __m256 scale = _mm256_set1_ps(127.5f);
+    const __m256 bias = _mm256_set1_ps(128.0f);
+    const __m256i alpha = _mm256_set1_epi32(0xff000000);
+    for (;  i + 8 <= n;  i += 8) {
+        __m256 x = _mm256_loadu_ps(sx + i);
+        __m256 z = _mm256_loadu_ps(sz + i);
+        __m256 len2 = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(z, z)), one);
+        __m256 s = _mm256_div_ps(one, _mm256_sqrt_ps(len2));
+        __m256i r = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(x, s), negScale), bias));
+        __m256i g = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(z, s), negScale), bias));
+        __m256i b = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(s, scale), bias));
+        __m256i pix = _mm256_or_si256(
+            _mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+            _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgba + i), pix);
+    }
+#elif defined(HF_NMAP_SSE2)
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 negScale = _mm_set1_ps(-127.5f);
+    const __m128 scale = _mm_set1_ps(127.5f);
+    const __m128 bias = _mm_set1_ps(128.0f);
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+    for (;  i + 4 <= n;  i += 4) {
+        __m128 x = _mm_loadu_ps(sx + i);
+        __m128 z = _mm_loadu_ps(sz + i);
+        __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)), one);
+        __m128 s = _mm_div_ps(one, _mm_sqrt_ps(len2));
+        __m128i r = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(x, s), negScale), bias));
+        __m128i g = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(z, s), negScale), bias));
+        __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(s, scale), bias));
+        __m128i pix = _mm_or_si128(
+            _mm_or_si128(r, _mm_slli_epi32(g, 8)),
+            _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(rgba + i), pix);
+    }
+#elif defined(HF_NMAP_NEON)
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t negScale = vdupq_n_f32(-127.5f);
+    const float32x4_t scale = vdupq_n_f32(127.5f);
+    const float32x4_t bias = vdupq_n_f32(128.0f);
+    const uint32x4_t alpha = vdupq_n_u32(0xff000000);
+    for (;  i + 4 <= n;  i += 4) {
+        float32x4_t x = vld1q_f32(sx + i);
+        float32x4_t z = vld1q_f32(sz + i);
+        float32x4_t len2 = vaddq_f32(vaddq_f32(vmulq_f32(x, x), vmulq_f32(z, z)), one);
+        float32x4_t s = vdivq_f32(one, vsqrtq_f32(len2));
+        uint32x4_t r = vcvtq_u32_f32(vmlaq_f32(bias, vmulq_f32(x, s), negScale));
+        uint32x4_t g = vcvtq_u32_f32(vmlaq_f32(bias, vmulq_f32(z, s), negScale));
+        uint32x4_t b = vcvtq_u32_f32(vmlaq_f32(bias, s, scale));
+        uint32x4_t pix = vorrq_u32(
+            vorrq_u32(r, vshlq_n_u32(g, 8)),
+            vorrq_u32(vshlq_n_u32(b, 16), alpha));
+        vst1q_u32(rgba + i, pix);
+    }
+#endif
+
+    // scalar code for the remaining texels
+    for (;  i < n;  ++i) {
+        rgba[i] = packNormal (sx[i], sz[i]);
+    }
+}
+
+} // anonymous namespace
+
+// compute the slopes of the surface for the samples of a row
+void HeightField::_slopeRow (uint32_t row, float *sx, float *sz) const
+{
+    uint32_t nCols = this->numCols();
+    uint32_t lastRow = this->numRows() - 1;
+    uint32_t lastCol = nCols - 1;
+
+    // central differences in the interior and one-sided differences on the edges
+    uint32_t rPrev = (row > 0) ? row - 1 : 0;
+    uint32_t rNext = std::min(row + 1, lastRow);
+    float zScale = this->_scaleY / (float(rNext - rPrev) * this->_scaleZ);
+    float xScale = this->_scaleY / (2.0f * this->_scaleX);
+    float xEdgeScale = this->_scaleY / this->_scaleX;
+
+    auto slopes = [&](auto const *data) {
+        auto const *prev = data + size_t(rPrev) * nCols;
+        auto const *cur = data + size_t(row) * nCols;
+        auto const *next = data + size_t(rNext) * nCols;
+        sx[0] = xEdgeScale * (float(cur[1]) - float(cur[0]));
+        for (uint32_t c = 1;  c < lastCol;  ++c) {
+            sx[c] = xScale * (float(cur[c+1]) - float(cur[c-1]));
+        }
+        sx[lastCol] = xEdgeScale * (float(cur[lastCol]) - float(cur[lastCol-1]));
+        for (uint32_t c = 0;  c < nCols;  ++c) {
+            sz[c] = zScale * (float(next[c]) - float(prev[c]));
+        }
+    };
+
+    if (this->_img->type() == cs237::ChannelTy::U8) {
+        slopes (static_cast<const uint8_t *>(this->_img->data()));
+    } else {
+        slopes (static_cast<const uint16_t *>(this->_img->data()));
+    }
+}
+
+glm::vec3 HeightField::normalAt (uint32_t row, uint32_t col) const
+{
+    // we compute the slopes directly, instead of using `_slopeRow`, since we
+    // only need one sample
+    uint32_t lastRow = this->numRows() - 1;
+    uint32_t lastCol = this->numCols() - 1;
+    uint32_t c0 = (col > 0) ? col - 1 : 0, c1 = std::min(col + 1, lastCol);
+    uint32_t r0 = (row > 0) ? row - 1 : 0, r1 = std::min(row + 1, lastRow);
+    float sx = this->_scaleY * (float(this->valueAt(row, c1)) - float(this->valueAt(row, c0)))
+        / (float(c1 - c0) * this->_scaleX);
+    float sz = this->_scaleY * (float(this->valueAt(r1, col)) - float(this->valueAt(r0, col)))
+        / (float(r1 - r0) * this->_scaleZ);
+
+    return glm::normalize(glm::vec3(-sx, 1.0f, -sz));
+}
+
+glm::vec3 HeightField::tangentAt (uint32_t row, uint32_t col) const
+{
+    uint32_t lastCol = this->numCols() - 1;
+    uint32_t c0 = (col > 0) ? col - 1 : 0, c1 = std::min(col + 1, lastCol);
+    float sx = this->_scaleY * (float(this->valueAt(row, c1)) - float(this->valueAt(row, c0)))
+        / (float(c1 - c0) * this->_scaleX);
+
+    return glm::normalize(glm::vec3(1.0f, sx, 0.0f));
+}
+
+cs237::DataImage2D *HeightField::generateNormalMap (
+    uint32_t wid, uint32_t ht,
+    cs237::JobSystem &js) const
+{
+    if ((wid == 0) || (ht == 0)) {
+        ERROR("HeightField::generateNormalMap: invalid normal-map size");
+    }
+
+    cs237::DataImage2D *img = new cs237::DataImage2D(
+        wid, ht, cs237::Channels::RGBA, cs237::ChannelTy::U8);
+    uint32_t *texels = static_cast<uint32_t *>(img->data());
+
+    uint32_t nRows = this->numRows();
+    uint32_t nCols = this->numCols();
+
+    // the position of each texel column in the grid; the texel centers map to
+    // the texture coordinates of the mesh (i.e., s = col / (nCols-1)).  The
+    // texels in grid cell `c` are [cellStart[c]..cellStart[c+1]), so the
+    // horizontal interpolation can be done a cell at a time without gathers.
+    std::vector<float> colFrac(wid);
+    std::vector<uint32_t> cellStart(nCols, wid);
+    float colStep = float(nCols - 1) / float(wid);
+    for (uint32_t x = wid;  x-- > 0;  ) {
+        float gx = (float(x) + 0.5f) * colStep;
+        uint32_t c = std::min(uint32_t(gx), nCols - 2);
+        colFrac[x] = gx - float(c);
+        cellStart[c] = x;
+    }
+    for (uint32_t c = nCols - 1;  c-- > 0;  ) {
+        cellStart[c] = std::min(cellStart[c], cellStart[c+1]);
+    }
+
+    // compute the texel rows [y0..y1)
+    float rowStep = float(nRows - 1) / float(ht);
+    auto work = [&](uint32_t y0, uint32_t y1) {
+        // the slopes of the two grid rows that bracket the current texel row
+        std::vector<float> sxA(nCols), szA(nCols), sxB(nCols), szB(nCols);
+        // the slopes interpolated to the texel row and to the texels
+        std::vector<float> sxRow(nCols), szRow(nCols), sxTex(wid), szTex(wid);
+        uint32_t rowA = nRows;  // no slope rows yet
+        for (uint32_t y = y0;  y < y1;  ++y) {
+            float gz = (float(y) + 0.5f) * rowStep;
+            uint32_t r0 = std::min(uint32_t(gz), nRows - 2);
+            float fz = gz - float(r0);
+            if (r0 != rowA) {
+                // the slope rows are reused while the texel rows stay in the same
+                // grid cell, and the second row becomes the first when we advance
+                // to the next cell
+                if (r0 == rowA + 1) {
+                    std::swap (sxA, sxB); std::swap (szA, szB);
+                } else {
+                    this->_slopeRow (r0, sxA.data(), szA.data());
+                }
+                this->_slopeRow (r0 + 1, sxB.data(), szB.data());
+                rowA = r0;
+            }
+            for (uint32_t c = 0;  c < nCols;  ++c) {
+                sxRow[c] = sxA[c] + fz * (sxB[c] - sxA[c]);
+                szRow[c] = szA[c] + fz * (szB[c] - szA[c]);
+            }
+            for (uint32_t c = 0;  c+1 < nCols;  ++c) {
+                float sx0 = sxRow[c], dsx = sxRow[c+1] - sx0;
+                float sz0 = szRow[c], dsz = szRow[c+1] - sz0;
+                for (uint32_t x = cellStart[c];  x < cellStart[c+1];  ++x) {
+                    sxTex[x] = sx0 + colFrac[x] * dsx;
+                    szTex[x] = sz0 + colFrac[x] * dsz;
+                }
+            }
+            packNormals (sxTex.data(), szTex.data(), texels + size_t(y) * wid, wid);
+        }
+    };
+
+    // split the rows into bands of a few per thread, which are processed in
+    // parallel by the job system
+    uint32_t grain = std::max(kMinRowsPerTask, ht / (4 * js.numThreads()));
+    js.parallelFor (0, ht, grain, work);
+
+    return img;
+}
@@ -24,6 +24,7 @@ constexpr std::string_view kShaderDir = CS237_BINARY_DIR "/projects/proj3/shader
 Renderer::~Renderer ()
 {
     this->_device().destroyPipeline(this->_pipeline);
+    this->_device().destroyPipeline(this->_terrainPipeline);
     this->_device().destroyPipelineLayout(this->_pipelineLayout);
 }
 
@@ -33,7 +34,18 @@ void Renderer::_initPipeline (
 {
   /** HINT: here you need to create the pipeline for the renderer based on its mode.
    ** We recommend that you define a table of properties (e.g., shader names etc.)
-   ** that is indexed by the render mode.
+   ** that is indexed by the render mode.  Load the shaders with the
+   ** `cs237::Shaders` constructor that takes the application, so that the
+   ** modules come from the application's shader cache (the shaders are
+   ** preloaded when the application starts).
+   **/
+
+  /** HINT: also create `_terrainPipeline`, which uses the same shaders and
+   ** layout, but with `vk::PrimitiveTopology::eTriangleStrip` and primitive
+   ** restart enabled (the `primRestart` argument of `createPipeline`).  The
+   ** two pipelines can be compiled concurrently by describing them with
+   ** `cs237::Application::PipelineDesc` and passing both descriptions to a
+   ** single call of `createPipelines`.
    **/
 }
 
@@ -63,7 +75,12 @@ void TextureRenderer::bindFrameDescriptorSets (
 /// \param inst     the instance to be rendered using the UBO
 void TextureRenderer::bindMeshDescriptorSets (vk::CommandBuffer cmdBuf, Instance *inst)
 {
-    /** HINT: bind the sampler descriptor sets */
+    /** HINT: bind the sampler descriptor sets.  If the application has
+     ** enabled bindless mode (`app->bindlessTextures()` is not nullptr), the
+     ** texture table is bound once per frame instead, and the mesh's texture
+     ** indices are passed to the shaders in push constants or instance data,
+     ** so consecutive instances do not need a descriptor-set bind.
+     **/
 }
 
 /******************** class NormalMapRenderer ********************/
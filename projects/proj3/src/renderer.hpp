@@ -35,6 +35,16 @@ public:
         cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, this->_pipeline);
     }
 
+    /// issue a command to bind the pipeline for drawing the LOD terrain, which
+    /// is the same as the main pipeline, except that it uses triangle strips
+    /// with primitive restart (see terrain.hpp).  The two pipelines share the
+    /// same layout, so the bound descriptor sets and push constants are not
+    /// disturbed.
+    void bindTerrainPipelineCmd (vk::CommandBuffer cmdBuf)
+    {
+        cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, this->_terrainPipeline);
+    }
+
     /// bind the descriptor sets for rendering a frame
     /// \param cmdBuf   the command buffer to store the bind command in
     /// \param vertUBO  the vertex-shader uniform-buffer-object information for
@@ -55,6 +65,24 @@ public:
         vk::CommandBuffer cmdBuf,
         Instance *inst) = 0;
 
+    /// the index of the descriptor set for the per-instance data that is used
+    /// when drawing with GPU culling
+    static constexpr uint32_t kInstanceDataSet = 3;
+
+    /// bind the descriptor set for the per-instance data (see gpu-cull.hpp);
+    /// the renderer must have been created with the instance-data layout
+    /// \param cmdBuf   the command buffer to store the bind command in
+    /// \param descSet  the descriptor set for the instance data
+    void bindInstanceDescriptorSet (vk::CommandBuffer cmdBuf, vk::DescriptorSet descSet)
+    {
+        cmdBuf.bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics,
+            this->_pipelineLayout,
+            kInstanceDataSet, /* first set */
+            descSet, /* descriptor sets */
+            nullptr); /* dynamic offsets */
+    }
+
     void pushConstants (vk::CommandBuffer cmdBuf, PushConsts const &pc)
     {
         cmdBuf.pushConstants(
@@ -72,9 +100,11 @@ protected:
     vk::PipelineLayout _pipelineLayout; ///< the pipeline layout for this renderer's
                                         ///  graphics pipeline
     vk::Pipeline _pipeline;             ///< the graphics pipeline for this renderer
+    vk::Pipeline _terrainPipeline;      ///< the graphics pipeline for the LOD terrain
 
     Renderer (Proj3 *app, vk::RenderPass rp)
-      : _app(app), _renderPass(rp), _pipelineLayout(nullptr), _pipeline(nullptr)
+      : _app(app), _renderPass(rp), _pipelineLayout(nullptr), _pipeline(nullptr),
+        _terrainPipeline(nullptr)
     { }
 
     /// initialize the renderer's pipeline
@@ -94,12 +124,17 @@ public:
         Proj3 *app,
         vk::RenderPass rp,
         vk::DescriptorSetLayout vertDSLayout,
-        vk::DescriptorSetLayout fragDSLayout)
+        vk::DescriptorSetLayout fragDSLayout,
+        vk::DescriptorSetLayout instDSLayout = nullptr)
       : Renderer (app, rp)
     {
         std::vector<vk::DescriptorSetLayout> layouts = {
                 vertDSLayout, fragDSLayout, app->meshDSLayout()
             };
+        if (instDSLayout) {
+            // layout for the instance data used with GPU culling
+            layouts.push_back(instDSLayout);
+        }
         this->_initPipeline(RenderMode::eTextureShading, layouts);
 
     }
@@ -136,12 +171,17 @@ public:
         Proj3 *app,
         vk::RenderPass rp,
         vk::DescriptorSetLayout vertDSLayout,
-        vk::DescriptorSetLayout fragDSLayout)
+        vk::DescriptorSetLayout fragDSLayout,
+        vk::DescriptorSetLayout instDSLayout = nullptr)
       : Renderer (app, rp)
     {
         std::vector<vk::DescriptorSetLayout> layouts = {
                 vertDSLayout, fragDSLayout, app->meshDSLayout()
             };
+        if (instDSLayout) {
+            // layout for the instance data used with GPU culling
+            layouts.push_back(instDSLayout);
+        }
         this->_initPipeline(RenderMode::eNormalMapShading, layouts);
     }
 
@@ -113,7 +113,7 @@ static bool loadFloat (json::Number const *jv, float &f)
 
 /***** class Scene member functions *****/
 
-bool Scene::load (std::string const &path)
+bool Scene::load (std::string const &path, cs237::JobSystem &js)
 {
     if (this->_loaded) {
         std::cerr << "Scene is already loaded" << std::endl;
@@ -275,19 +275,29 @@ bool Scene::load (std::string const &path)
         json::String const *hf = ground->fieldAsString("height-field");
         json::String const *cmap = ground->fieldAsString("color-map");
         json::String const *nmap = ground->fieldAsString("normal-map");
-        if ((hf == nullptr) || (cmap == nullptr) || (nmap == nullptr)
+        if ((hf == nullptr) || (cmap == nullptr)
         ||  loadGroundSize (ground->fieldAsObject("size"), wid, ht)
         ||  loadFloat (ground->fieldAsNumber ("v-scale"), vScale)
         ||  loadColor (ground->fieldAsObject("color"), color)) {
             std::cerr << "Invalid ground description in \"" << path << "\"\n";
             return true;
         }
-        // load the color-map and normal-map textures
+        // load the color-map and normal-map textures; the normal map is optional,
+        // since the HeightField class generates one when it is missing
         this->_loadTexture (sceneDir, cmap->value());
         cs237::Image2D *cmapImg = this->textureByName (cmap->value());
-        this->_loadTexture (sceneDir, nmap->value(), true);
-        cs237::Image2D *nmapImg = this->textureByName (nmap->value());
-        this->_hf = new HeightField (sceneDir + hf->value(), wid, ht, vScale, color, cmapImg, nmapImg);
+        cs237::Image2D *nmapImg = nullptr;
+        if (nmap != nullptr) {
+            this->_loadTexture (sceneDir, nmap->value(), true);
+            nmapImg = this->textureByName (nmap->value());
+        }
+        // tiled height fields (".hft" files) are streamed, instead of being loaded
+        std::string hfFile = sceneDir + hf->value();
+        if ((hfFile.size() > 4) && (hfFile.compare(hfFile.size() - 4, 4, ".hft") == 0)) {
+            this->_tiledHF = new TiledHeightField (hfFile, wid, ht, vScale, color);
+        } else {
+            this->_hf = new HeightField (hfFile, wid, ht, vScale, color, cmapImg, nmapImg, js);
+        }
     }
 
     if ((ground == nullptr) && (objs->length() == 0)) {
@@ -337,13 +347,14 @@ cs237::Image2D *Scene::textureByName (std::string name) const
 
 Scene::Scene ()
     : _loaded(false), _wid(0), _ht(0), _fov(0),
-      _camPos(), _camAt(), _camUp(), _hf(nullptr),
+      _camPos(), _camAt(), _camUp(), _hf(nullptr), _tiledHF(nullptr),
       _models(), _objs(), _lights(), _texs()
 { }
 
 Scene::~Scene ()
 {
     if (this->_hf != nullptr) { delete this->_hf; }
+    if (this->_tiledHF != nullptr) { delete this->_tiledHF; }
     for (auto it : this->_models) {
         delete it;
     }
@@ -22,6 +22,7 @@
 #include "cs237.hpp"
 #include "obj.hpp"
 #include "height-field.hpp"
+#include "tiled-hf.hpp"
 
 //! an instance of a model, which has its own position and color.
 struct SceneObj {
@@ -58,8 +59,9 @@ class Scene {
 
   //! load a scene from the specified path
   //! \param path  the path to the scene directory
+  //! \param js    the job system used to generate missing normal maps
   //! \return true if there were any errors loading the scene and false otherwise
-    bool load (std::string const &path);
+    bool load (std::string const &path, cs237::JobSystem &js);
 
   //! the width of the viewport as specified by the scene
     int width () const { return this->_wid; }
@@ -101,6 +103,11 @@ class Scene {
   //! or nullptr if there is no ground in the scene.
     const HeightField *ground () const { return this->_hf; }
 
+  //! return the tiled height-field that represents the ground object when
+  //! the ground is streamed, or nullptr.  At most one of `ground()` and
+  //! `streamingGround()` is not nullptr.
+    TiledHeightField *streamingGround () const { return this->_tiledHF; }
+
   //! return the number of objects in the scene
     int numObjects () const { return this->_objs.size(); }
 
@@ -149,6 +156,8 @@ class Scene {
 
     HeightField *_hf;           //!< the height field that represents the ground; nullptr if
                                 //!  the scene does not have a ground Object
+    TiledHeightField *_tiledHF; //!< the streamed height field that represents the ground;
+                                //!  nullptr if the ground is not streamed
 
     std::vector<OBJ::Model const *> _models;            //!< the OBJ models in the scene
     std::vector<SceneObj> _objs;                        //!< the objects in the scene
@@ -23,6 +23,7 @@
 #ifndef _CS237_HPP_
 #include "cs237.hpp"
 #endif
+#include <cstddef>
 
 /// The layout of a uniform buffer for the camera and viewport-dependent
 /// information used in the vertex shaders.  Because the camera and/or
@@ -83,7 +84,9 @@ using VertexUBO_t = VertexInfo::UBO_t;
 using FragInfo = UBOInfo<FragUB>;
 using FragUBO_t = FragInfo::UBO_t;
 
-/// Per-instance data, which we communicate using push constants
+/// Per-instance data, which we communicate using push constants.  This struct
+/// occupies the 128 bytes of push-constant space that every device is
+/// guaranteed to support, so there is no room for additional fields.
 struct PushConsts {
     /* stuff for vertex shaders */
     alignas(16) glm::mat4 toWorld;      //!< model transform maps to world space
@@ -92,4 +95,32 @@ struct PushConsts {
     alignas(16) glm::vec3 color;        //!< uniform color for object
 };
 
+/// Per-instance data for drawing with GPU culling, where the draws are generated
+/// by a compute shader and there is no opportunity to set push constants.  The
+/// instance data is stored in a storage buffer that the vertex shaders index with
+/// `gl_InstanceIndex` (see gpu-cull.hpp); the fields are the same as `PushConsts`.
+/// The buffer uses the std430 layout, where the columns of a `mat3` have a
+/// 16-byte stride, so the normal matrix is stored as a `glm::mat3x4` (i.e., three
+/// `vec4` columns).  The matching GLSL declaration is
+///
+///     struct InstanceData {
+///         mat4 toWorld;
+///         mat3 normToWorld;
+///         vec3 color;
+///     };
+///     layout (std430, set = 3, binding = 0) readonly buffer Instances {
+///         InstanceData instances[];
+///     };
+///
+struct InstanceData {
+    alignas(16) glm::mat4 toWorld;      //!< model transform maps to world space
+    alignas(16) glm::mat3x4 normToWorld; //!< model transform for normal vectors
+                                        //!  (the fourth row is padding)
+    alignas(16) glm::vec3 color;        //!< uniform color for object
+};
+static_assert(offsetof(InstanceData, toWorld) == 0, "bad InstanceData layout");
+static_assert(offsetof(InstanceData, normToWorld) == 64, "bad InstanceData layout");
+static_assert(offsetof(InstanceData, color) == 112, "bad InstanceData layout");
+static_assert(sizeof(InstanceData) == 128, "bad InstanceData layout");
+
 #endif // !_SHADER_UNIFORMS_HPP_
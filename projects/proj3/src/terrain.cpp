@@ -0,0 +1,562 @@
+/*! \file terrain.cpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "terrain.hpp"
+#include "grid-indices.hpp"
+
+/// the number of vertices around the perimeter of a tile
+constexpr uint32_t kPerimSz = 4 * Terrain::kTileCells;
+
+/// the number of vertices in a tile (grid plus skirt)
+constexpr uint32_t kTileVerts = Terrain::kTileSz * Terrain::kTileSz + kPerimSz;
+
+/// distances to the camera are clamped to this value when computing the
+/// screen-space error
+constexpr float kMinDist = 1e-3f;
+
+/// the grid indices of the perimeter of a tile in counter-clockwise order
+/// (when viewed from above); the skirt vertex for `perim[k]` is at index
+/// `kTileSz*kTileSz + k`.
+static std::vector<uint32_t> perimeter ()
+{
+    constexpr uint32_t n = Terrain::kTileSz;
+    constexpr uint32_t last = Terrain::kTileCells;
+
+    std::vector<uint32_t> perim;
+    perim.reserve(kPerimSz);
+    for (uint32_t j = 0;  j < last;  ++j) {     // first row, left to right
+        perim.push_back(j);
+    }
+    for (uint32_t i = 0;  i < last;  ++i) {     // last column, top to bottom
+        perim.push_back(i * n + last);
+    }
+    for (uint32_t j = last;  j > 0;  --j) {     // last row, right to left
+        perim.push_back(last * n + j);
+    }
+    for (uint32_t i = last;  i > 0;  --i) {     // first column, bottom to top
+        perim.push_back(i * n);
+    }
+    assert (perim.size() == kPerimSz);
+
+    return perim;
+}
+
+/// the indices for the tile grid and skirts, which are shared by all tiles.
+/// The grid is drawn as Z-order triangle strips (see grid-indices.hpp) and
+/// the skirt is a single strip around the perimeter.  Grid triangles are
+/// counter-clockwise when viewed from above and skirt triangles are
+/// counter-clockwise when viewed from outside the tile.
+static std::vector<uint32_t> tileIndices ()
+{
+    std::vector<uint32_t> indices = gridTriangleStrips(
+        Terrain::kTileSz, Terrain::kTileSz, kDefaultStripBlock);
+    auto perim = perimeter();
+    uint32_t skirt0 = Terrain::kTileSz * Terrain::kTileSz;
+    indices.push_back(kRestartIndex);
+    for (uint32_t k = 0;  k < kPerimSz;  ++k) {
+        indices.push_back(skirt0 + k);
+        indices.push_back(perim[k]);
+    }
+    // close the loop
+    indices.push_back(skirt0);
+    indices.push_back(perim[0]);
+
+    return indices;
+}
+
+Terrain::Terrain (cs237::Application *app, const HeightField *hf, uint32_t maxTiles)
+  : _app(app), _hf(hf), _tau(kDefaultTolerance), _nLevels(1), _skirtDepth(0),
+    _maxTiles(std::max(maxTiles, 1u)), _frame(0), _iBuf(nullptr)
+{
+    if ((hf->numRows() < 2) || (hf->numCols() < 2)) {
+        ERROR("Terrain::Terrain: height field is too small");
+    }
+
+    // the root's stride is the smallest power of two such that a tile covers
+    // the height field
+    uint32_t nCells = std::max(hf->numRows(), hf->numCols()) - 1;
+    uint32_t stride = 1;
+    while (kTileCells * stride < nCells) {
+        stride *= 2;
+        this->_nLevels++;
+    }
+
+    this->_buildNode (0, 0, stride);
+
+    // the error of a node bounds the error of its descendants, so the root's
+    // error bounds the vertical gap between any two adjacent tiles
+    this->_skirtDepth = this->_nodes[0].err;
+    for (auto &nd : this->_nodes) {
+        nd.bbox._min.y -= this->_skirtDepth;
+    }
+
+    this->_iBuf = new cs237::IndexBuffer<uint32_t>(app, tileIndices());
+
+}
+
+Terrain::~Terrain ()
+{
+    for (auto &tile : this->_tiles) {
+        delete tile.vBuf;
+    }
+    delete this->_iBuf;
+}
+
+uint32_t Terrain::_buildNode (uint32_t row, uint32_t col, uint32_t stride)
+{
+    uint32_t id = this->_nodes.size();
+    this->_nodes.push_back(Node{ {}, 0.0f, row, col, stride, {0, 0, 0, 0}, -1 });
+
+    uint32_t lastRow = this->_hf->numRows() - 1;
+    uint32_t lastCol = this->_hf->numCols() - 1;
+
+    cs237::AABBf_t bbox;
+    float err = 0.0f;
+    if (stride > 1) {
+        // build the children that cover some part of the height field
+        uint32_t half = stride / 2;
+        uint32_t span = kTileCells * half;
+        for (uint32_t q = 0;  q < 4;  ++q) {
+            uint32_t r = row + (q >> 1) * span;
+            uint32_t c = col + (q & 1) * span;
+            if ((r < lastRow) && (c < lastCol)) {
+                uint32_t kid = this->_buildNode (r, c, half);
+                this->_nodes[id].kids[q] = kid;
+                bbox += this->_nodes[kid].bbox;
+                err = std::max(err, this->_nodes[kid].err);
+            }
+        }
+        // the error with respect to the full-resolution surface is bounded by
+        // the error with respect to the children plus the children's error
+        err += this->_localError (row, col, stride);
+    }
+    else {
+        // leaf node, so get the bounds from the height field's min/max pyramid
+        uint32_t r1 = std::min(row + kTileCells, lastRow);
+        uint32_t c1 = std::min(col + kTileCells, lastCol);
+        bbox = this->_hf->bounds (row, col, r1, c1);
+    }
+
+    this->_nodes[id].bbox = bbox;
+    this->_nodes[id].err = err;
+
+    return id;
+}
+
+float Terrain::_localError (uint32_t row, uint32_t col, uint32_t stride) const
+{
+    uint32_t lastRow = this->_hf->numRows() - 1;
+    uint32_t lastCol = this->_hf->numCols() - 1;
+    uint32_t half = stride / 2;
+
+    // height of the sample (i, j) on the children's grid
+    auto height = [&](uint32_t i, uint32_t j) {
+        return this->_hf->vertexAt(
+            std::min(row + i * half, lastRow),
+            std::min(col + j * half, lastCol)).y;
+    };
+
+    // the samples that are on the children's grid, but not the node's grid, are
+    // at the midpoints of the node's grid edges, where the node's surface is
+    // the average of the edge's endpoints.  The diagonal of a grid cell runs
+    // from (i+1, j) to (i, j+1), which matches the index buffer.
+    float err = 0.0f;
+    for (uint32_t i = 0;  i <= 2*kTileCells;  ++i) {
+        for (uint32_t j = (i & 1) ? 0 : 1;  j <= 2*kTileCells;  j += (i & 1) ? 1 : 2) {
+            float approx;
+            if ((i & 1) == 0) {         // on a row of the node's grid
+                approx = 0.5f * (height(i, j-1) + height(i, j+1));
+            }
+            else if ((j & 1) == 0) {    // on a column of the node's grid
+                approx = 0.5f * (height(i-1, j) + height(i+1, j));
+            }
+            else {                      // on a diagonal of the node's grid
+                approx = 0.5f * (height(i+1, j-1) + height(i-1, j+1));
+            }
+            err = std::max(err, std::abs(height(i, j) - approx));
+        }
+    }
+
+    return err;
+}
+
+Vertex Terrain::_vertex (uint32_t row, uint32_t col) const
+{
+    uint32_t lastRow = this->_hf->numRows() - 1;
+    uint32_t lastCol = this->_hf->numCols() - 1;
+    row = std::min(row, lastRow);
+    col = std::min(col, lastCol);
+
+    Vertex v;
+    v.pos = this->_hf->vertexAt(row, col);
+    v.norm = this->_hf->normalAt(row, col);
+    v.txtCoord = glm::vec2(float(col) / float(lastCol), float(row) / float(lastRow));
+    // the texture's t axis runs along +Z, which is opposite to cross(N, T)
+    v.tan = glm::vec4(this->_hf->tangentAt(row, col), -1.0f);
+
+    return v;
+}
+
+void Terrain::_tileVerts (Node const &nd, std::vector<Vertex> &verts) const
+{
+    verts.clear();
+    verts.reserve(kTileVerts);
+    for (uint32_t i = 0;  i < kTileSz;  ++i) {
+        for (uint32_t j = 0;  j < kTileSz;  ++j) {
+            verts.push_back(this->_vertex(nd.row + i * nd.stride, nd.col + j * nd.stride));
+        }
+    }
+    static const std::vector<uint32_t> perim = perimeter();
+    for (auto ix : perim) {
+        Vertex v = verts[ix];
+        v.pos.y -= this->_skirtDepth;
+        verts.push_back(v);
+    }
+}
+
+void Terrain::_loadTile (uint32_t id)
+{
+    assert (this->_nodes[id].tile < 0);
+
+    // find a slot in the cache; we evict the least-recently used tile that
+    // is not needed for the current frame
+    int32_t slot = -1;
+    if (this->_tiles.size() < this->_maxTiles) {
+        slot = this->_tiles.size();
+    } else {
+        uint64_t oldest = this->_frame;
+        for (uint32_t i = 0;  i < this->_tiles.size();  ++i) {
+            if (this->_tiles[i].lastUsed < oldest) {
+                oldest = this->_tiles[i].lastUsed;
+                slot = i;
+            }
+        }
+        if (slot < 0) {
+            // all of the cached tiles are in use, so we have to grow the cache
+            slot = this->_tiles.size();
+        }
+    }
+
+    if (slot == int32_t(this->_tiles.size())) {
+        this->_tiles.push_back(Tile{
+                new cs237::VertexBuffer<Vertex>(this->_app, kTileVerts),
+                id,
+                this->_frame
+            });
+    } else {
+        this->_nodes[this->_tiles[slot].node].tile = -1;
+        this->_tiles[slot].node = id;
+        this->_tiles[slot].lastUsed = this->_frame;
+    }
+
+    std::vector<Vertex> verts;
+    this->_tileVerts (this->_nodes[id], verts);
+    this->_tiles[slot].vBuf->copyTo(verts);
+
+    this->_nodes[id].tile = slot;
+}
+
+void Terrain::selectTiles (cs237::Frustumf_t const &f, glm::vec3 const &camPos, float pixScale)
+{
+    this->_frame++;
+    this->_selected.clear();
+
+    this->_stk.clear();
+    this->_stk.push_back(0);
+    while (! this->_stk.empty()) {
+        uint32_t id = this->_stk.back();
+        this->_stk.pop_back();
+        Node const &nd = this->_nodes[id];
+
+        if (! f.intersectsBox(nd.bbox)) {
+            continue;
+        }
+
+        // refine the node if its projected error is too large
+        bool refine = false;
+        if (! nd.isLeaf()) {
+            float dist = std::max(nd.bbox.distanceToPt(camPos), kMinDist);
+            refine = (nd.err * pixScale > this->_tau * dist);
+        }
+
+        if (refine) {
+            for (auto kid : nd.kids) {
+                if (kid != 0) {
+                    this->_stk.push_back(kid);
+                }
+            }
+        } else {
+            this->_selected.push_back(id);
+        }
+    }
+
+    // mark the cached tiles as used before loading the missing ones, so that
+    // they are not evicted
+    for (auto id : this->_selected) {
+        if (this->_nodes[id].tile >= 0) {
+            this->_tiles[this->_nodes[id].tile].lastUsed = this->_frame;
+        }
+    }
+    for (auto id : this->_selected) {
+        if (this->_nodes[id].tile < 0) {
+            this->_loadTile (id);
+        }
+    }
+
+}
+
+void Terrain::draw (vk::CommandBuffer cmdBuf)
+{
+    cmdBuf.bindIndexBuffer(this->_iBuf->vkBuffer(), 0, vk::IndexType::eUint32);
+
+    vk::DeviceSize offsets[] = {0};
+    for (auto id : this->_selected) {
+        vk::Buffer vertBuffers[] = {this->_tiles[this->_nodes[id].tile].vBuf->vkBuffer()};
+        cmdBuf.bindVertexBuffers(0, vertBuffers, offsets);
+        cmdBuf.drawIndexed(this->_iBuf->nIndices(), 1, 0, 0, 0);
+    }
+}
+
+/***** class StreamingTerrain member functions *****/
+
+StreamingTerrain::StreamingTerrain (cs237::Application *app, TiledHeightField *hf, uint32_t maxChunks)
+  : _app(app), _hf(hf), _tau(Terrain::kDefaultTolerance), _radius(0), _skirtDepth(0),
+    _maxChunks(std::max(maxChunks, 1u)), _nLoads(0), _frame(0), _iBuf(nullptr)
+{
+    if (hf->tileCells() % Terrain::kTileCells != 0) {
+        ERROR("StreamingTerrain::StreamingTerrain: invalid tile size");
+    }
+
+    // by default, we stream the tiles that are within a few tiles of the camera,
+    // which is as many as fit in the height field's budget
+    float tileWid = hf->width() * float(hf->tileCells()) / float(hf->numCols() - 1);
+    this->_radius = 0.5f * std::sqrt(float(hf->maxTiles())) * tileWid;
+
+    // the coarse grid of a tile is at most `maxError` from the full-resolution
+    // surface, which bounds the gap between adjacent tiles
+    this->_skirtDepth = hf->maxError();
+
+    this->_iBuf = new cs237::IndexBuffer<uint32_t>(app, tileIndices());
+
+}
+
+StreamingTerrain::~StreamingTerrain ()
+{
+    for (auto &chunk : this->_chunks) {
+        delete chunk.vBuf;
+    }
+    delete this->_iBuf;
+}
+
+void StreamingTerrain::_chunkVerts (
+    TiledHeightField::Tile const &t,
+    uint32_t chunk,
+    std::vector<Vertex> &verts) const
+{
+    uint32_t n = this->_hf->tileCells();
+    uint32_t sz = this->_hf->tileSz();
+    uint32_t s = n / Terrain::kTileCells;
+    int64_t lastRow = this->_hf->numRows() - 1;
+    int64_t lastCol = this->_hf->numCols() - 1;
+    int64_t tileRow = int64_t(t.row) * n;
+    int64_t tileCol = int64_t(t.col) * n;
+
+    // the first sample and stride of the chunk's grid
+    int64_t row0 = tileRow, col0 = tileCol, stride = s;
+    if (chunk > 0) {
+        row0 += ((chunk - 1) / s) * Terrain::kTileCells;
+        col0 += ((chunk - 1) % s) * Terrain::kTileCells;
+        stride = 1;
+    }
+
+    // the world-space position of a sample, where the coordinates are clamped to
+    // the height field; the tile's border covers the neighbors of its samples
+    auto pos = [&](int64_t r, int64_t c) {
+        r = std::clamp<int64_t>(r, 0, lastRow);
+        c = std::clamp<int64_t>(c, 0, lastCol);
+        uint16_t v = t.data[(r - tileRow + 1) * sz + (c - tileCol + 1)];
+        return this->_hf->position(r, c, v);
+    };
+
+    verts.clear();
+    verts.reserve(kTileVerts);
+    for (uint32_t i = 0;  i < Terrain::kTileSz;  ++i) {
+        int64_t r = std::min(row0 + i * stride, lastRow);
+        for (uint32_t j = 0;  j < Terrain::kTileSz;  ++j) {
+            int64_t c = std::min(col0 + j * stride, lastCol);
+            // central differences for the tangents of the surface (see HeightField::normalAt)
+            glm::vec3 dx = pos(r, c+1) - pos(r, c-1);
+            glm::vec3 dz = pos(r+1, c) - pos(r-1, c);
+            Vertex v;
+            v.pos = pos(r, c);
+            v.norm = glm::normalize(glm::cross(dz, dx));
+            v.txtCoord = glm::vec2(float(c) / float(lastCol), float(r) / float(lastRow));
+            v.tan = glm::vec4(glm::normalize(dx), -1.0f);
+            verts.push_back(v);
+        }
+    }
+    static const std::vector<uint32_t> perim = perimeter();
+    for (auto ix : perim) {
+        Vertex v = verts[ix];
+        v.pos.y -= this->_skirtDepth;
+        verts.push_back(v);
+    }
+}
+
+uint32_t StreamingTerrain::_loadChunk (TiledHeightField::Tile const &t, uint32_t chunk)
+{
+    uint64_t key = _chunkKey(this->_hf->tileId(t.row, t.col), chunk);
+    assert (this->_findChunk(key) < 0);
+
+    // find a slot in the cache; we evict the least-recently used chunk that
+    // is not needed for the current frame
+    int32_t slot = -1;
+    if (this->_chunks.size() < this->_maxChunks) {
+        slot = this->_chunks.size();
+    } else {
+        uint64_t oldest = this->_frame;
+        for (uint32_t i = 0;  i < this->_chunks.size();  ++i) {
+            if (this->_chunks[i].lastUsed < oldest) {
+                oldest = this->_chunks[i].lastUsed;
+                slot = i;
+            }
+        }
+        if (slot < 0) {
+            // all of the cached chunks are in use, so we have to grow the cache
+            slot = this->_chunks.size();
+        }
+    }
+
+    if (slot == int32_t(this->_chunks.size())) {
+        this->_chunks.push_back(Chunk{
+                new cs237::VertexBuffer<Vertex>(this->_app, kTileVerts),
+                key,
+                this->_frame
+            });
+    } else {
+        this->_chunkMap.erase(this->_chunks[slot].key);
+        this->_chunks[slot].key = key;
+        this->_chunks[slot].lastUsed = this->_frame;
+    }
+
+    std::vector<Vertex> verts;
+    this->_chunkVerts (t, chunk, verts);
+    this->_chunks[slot].vBuf->copyTo(verts);
+
+    this->_chunkMap.insert({key, slot});
+    this->_nLoads++;
+
+    return slot;
+}
+
+void StreamingTerrain::selectTiles (cs237::Frustumf_t const &f, glm::vec3 const &camPos, float pixScale)
+{
+    this->_frame++;
+    this->_nLoads = 0;
+    this->_selected.clear();
+
+    // page in the tiles around the camera; this call does not wait for I/O, so
+    // the tiles that are still being loaded are skipped below
+    this->_hf->update (camPos, this->_radius);
+
+    uint32_t n = this->_hf->tileCells();
+    uint32_t s = n / Terrain::kTileCells;
+    uint64_t lastRow = this->_hf->numRows() - 1;
+    uint64_t lastCol = this->_hf->numCols() - 1;
+
+    auto select = [this](uint32_t slot) {
+        this->_chunks[slot].lastUsed = this->_frame;
+        this->_selected.push_back(slot);
+    };
+
+    // the wanted tiles are ordered by distance, so the per-frame limit on
+    // loading chunks favors the tiles that are nearest to the camera
+    std::vector<uint32_t> fine;
+    for (auto id : this->_hf->wanted()) {
+        uint32_t tr = this->_hf->tileRow(id);
+        uint32_t tc = this->_hf->tileCol(id);
+        TiledHeightField::Tile const *t = this->_hf->tile(tr, tc);
+        if (t == nullptr) {
+            continue;
+        }
+
+        cs237::AABBf_t bbox = this->_hf->tileBBox(tr, tc);
+        bbox._min.y -= this->_skirtDepth;
+        if (! f.intersectsBox(bbox)) {
+            continue;
+        }
+
+        // use the full-resolution chunks if the coarse grid's projected error
+        // is too large
+        float dist = std::max(bbox.distanceToPt(camPos), kMinDist);
+        if (this->_hf->tileError(tr, tc) * pixScale > this->_tau * dist) {
+            // the chunks that are inside the height field and the view frustum
+            fine.clear();
+            for (uint32_t ci = 0;  ci < s;  ++ci) {
+                uint64_t r0 = uint64_t(tr) * n + ci * Terrain::kTileCells;
+                for (uint32_t cj = 0;  cj < s;  ++cj) {
+                    uint64_t c0 = uint64_t(tc) * n + cj * Terrain::kTileCells;
+                    if ((r0 >= lastRow) || (c0 >= lastCol)) {
+                        continue;
+                    }
+                    glm::vec3 p0 = this->_hf->position(r0, c0, 0);
+                    glm::vec3 p1 = this->_hf->position(
+                        std::min(r0 + Terrain::kTileCells, lastRow),
+                        std::min(c0 + Terrain::kTileCells, lastCol),
+                        0);
+                    cs237::AABBf_t cbox(
+                        glm::vec3(p0.x, bbox.min().y, p0.z),
+                        glm::vec3(p1.x, bbox.max().y, p1.z));
+                    if (f.intersectsBox(cbox)) {
+                        fine.push_back(1 + ci * s + cj);
+                    }
+                }
+            }
+            // load the missing chunks (up to the per-frame limit); if any are
+            // still missing, we use the coarse grid for this frame
+            bool ready = true;
+            for (auto chunk : fine) {
+                int32_t slot = this->_findChunk(_chunkKey(id, chunk));
+                if (slot >= 0) {
+                    this->_chunks[slot].lastUsed = this->_frame;
+                } else if (this->_nLoads < kMaxLoadsPerFrame) {
+                    this->_loadChunk (*t, chunk);
+                } else {
+                    ready = false;
+                }
+            }
+            if (ready) {
+                for (auto chunk : fine) {
+                    select (this->_findChunk(_chunkKey(id, chunk)));
+                }
+                continue;
+            }
+        }
+
+        // the coarse grid is always loaded, since it is only one chunk
+        int32_t slot = this->_findChunk(_chunkKey(id, 0));
+        select ((slot < 0) ? this->_loadChunk(*t, 0) : slot);
+    }
+
+}
+
+void StreamingTerrain::draw (vk::CommandBuffer cmdBuf)
+{
+    cmdBuf.bindIndexBuffer(this->_iBuf->vkBuffer(), 0, vk::IndexType::eUint32);
+
+    vk::DeviceSize offsets[] = {0};
+    for (auto slot : this->_selected) {
+        vk::Buffer vertBuffers[] = {this->_chunks[slot].vBuf->vkBuffer()};
+        cmdBuf.bindVertexBuffers(0, vertBuffers, offsets);
+        cmdBuf.drawIndexed(this->_iBuf->nIndices(), 1, 0, 0, 0);
+    }
+}
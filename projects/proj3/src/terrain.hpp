@@ -0,0 +1,271 @@
+/*! \file terrain.hpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * This file defines the Terrain class, which renders a HeightField using
+ * view-dependent levels of detail, and the StreamingTerrain class, which
+ * renders a TiledHeightField.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _TERRAIN_HPP_
+#define _TERRAIN_HPP_
+
+#include "cs237.hpp"
+#include "height-field.hpp"
+#include "tiled-hf.hpp"
+#include "vertex.hpp"
+
+/// the ways that the ground can be rendered
+enum class TerrainMode : int {
+    eFullMesh = 0,      ///< a single full-resolution mesh
+    eChunkedLOD,        ///< view-dependent tiles from a quadtree of levels of detail
+    eTessellated,       ///< a coarse grid of patches that is refined by tessellation
+                        ///  shaders (see tess-terrain.hpp)
+    eNumModes
+};
+
+/// Chunked level-of-detail terrain.  The height field is covered by a quadtree
+/// of tiles, where every tile is a grid of `kTileSz` x `kTileSz` vertices.  The
+/// leaves of the tree sample the height field at full resolution and each level
+/// up doubles the sampling stride (i.e., geomipmapping).  Each node records
+/// the maximum vertical error of its tile with respect to the full-resolution
+/// surface, and each frame we select the coarsest tiles whose projected error
+/// is within a tolerance (in pixels).  Cracks between adjacent tiles at
+/// different levels are hidden by skirts that hang down from the tile edges.
+///
+/// Tile geometry is generated on demand and kept in a fixed-size cache of
+/// vertex buffers that is managed with a least-recently-used policy; all tiles
+/// share a single index buffer of triangle strips.  Thus the cost of a frame
+/// depends on the view and not on the size of the height field.
+class Terrain {
+public:
+
+    /// the number of vertices along each side of a tile
+    static constexpr uint32_t kTileSz = 65;
+
+    /// the number of cells along each side of a tile
+    static constexpr uint32_t kTileCells = kTileSz - 1;
+
+    /// the number of triangles in a tile (two per cell plus two per skirt segment)
+    static constexpr uint32_t kTileTris = 2 * kTileCells * kTileCells + 8 * kTileCells;
+
+    /// the default number of tiles in the cache
+    static constexpr uint32_t kDefaultMaxTiles = 512;
+
+    /// the default screen-space error tolerance (in pixels)
+    static constexpr float kDefaultTolerance = 2.0f;
+
+    /// \brief construct the terrain for a height field
+    /// \param app       the owning application
+    /// \param hf        the height field
+    /// \param maxTiles  the number of tiles in the geometry cache
+    Terrain (cs237::Application *app, const HeightField *hf, uint32_t maxTiles = kDefaultMaxTiles);
+
+    ~Terrain ();
+
+    /// the screen-space error tolerance (in pixels)
+    float errorTolerance () const { return this->_tau; }
+
+    /// set the screen-space error tolerance (in pixels)
+    void setErrorTolerance (float tau) { this->_tau = std::max(tau, 0.1f); }
+
+    /// the number of levels of detail
+    uint32_t numLevels () const { return this->_nLevels; }
+
+    /// the number of nodes in the quadtree
+    uint32_t numNodes () const { return this->_nodes.size(); }
+
+    /// \brief select the tiles that are used to render a view; this function loads
+    ///        the geometry of any selected tiles that are not in the cache.
+    /// \param f         the world-space view frustum
+    /// \param camPos    the world-space camera position
+    /// \param pixScale  the number of pixels covered by a unit-length vertical
+    ///                  feature at unit distance from the camera, which is
+    ///                  `0.5 * viewportHt * P[1][1]` for a projection matrix `P`
+    ///
+    /// Since tiles that were used in the previous frame may be evicted from the
+    /// cache, this function should only be called after the previous frame's
+    /// rendering is complete.
+    void selectTiles (cs237::Frustumf_t const &f, glm::vec3 const &camPos, float pixScale);
+
+    /// the number of tiles selected by the last call to `selectTiles`
+    uint32_t numSelected () const { return this->_selected.size(); }
+
+    /// the number of triangles (including skirts) selected by the last call to
+    /// `selectTiles`
+    uint32_t numTris () const { return this->_selected.size() * kTileTris; }
+
+    /// \brief record the commands to draw the selected tiles.
+    /// \param cmdBuf  the command buffer to record the commands in
+    ///
+    /// The caller is responsible for binding the pipeline and descriptor sets
+    /// and setting the push constants (the tile vertices are in world space).
+    /// The tiles are triangle strips that are separated by `kRestartIndex`, so
+    /// the pipeline must use `eTriangleStrip` with primitive restart enabled.
+    void draw (vk::CommandBuffer cmdBuf);
+
+private:
+    /// a node in the quadtree
+    struct Node {
+        cs237::AABBf_t bbox;    ///< world-space bounds of the node (including skirts)
+        float err;              ///< the maximum vertical error (in world-space units)
+                                ///  of the node's tile
+        uint32_t row;           ///< the height-field row of the node's first sample
+        uint32_t col;           ///< the height-field column of the node's first sample
+        uint32_t stride;        ///< the distance between samples in the node's tile
+        uint32_t kids[4];       ///< the indices of the children; 0 if the child
+                                ///  is missing (the root is never a child)
+        int32_t tile;           ///< the node's slot in the tile cache or -1
+
+        /// leaves are at full resolution
+        bool isLeaf () const { return this->stride == 1; }
+    };
+
+    /// a slot in the tile cache
+    struct Tile {
+        cs237::VertexBuffer<Vertex> *vBuf;      ///< the tile's vertices
+        uint32_t node;                          ///< the node that owns the tile
+        uint64_t lastUsed;                      ///< the last frame the tile was selected
+    };
+
+    cs237::Application *_app;           ///< the owning application
+    const HeightField *_hf;             ///< the height field
+    float _tau;                         ///< screen-space error tolerance in pixels
+    uint32_t _nLevels;                  ///< the number of levels of detail
+    float _skirtDepth;                  ///< how far the skirts hang below the tile edges
+    uint32_t _maxTiles;                 ///< the size of the tile cache
+    uint64_t _frame;                    ///< the current frame number
+    std::vector<Node> _nodes;           ///< the quadtree; `_nodes[0]` is the root
+    std::vector<Tile> _tiles;           ///< the tile cache
+    cs237::IndexBuffer<uint32_t> *_iBuf;///< the index buffer shared by all tiles
+    std::vector<uint32_t> _selected;    ///< the nodes selected for the current frame
+    std::vector<uint32_t> _stk;         ///< scratch stack for the tree traversal
+
+    /// build the subtree with the given first sample and stride
+    /// \return the index of the subtree's root
+    uint32_t _buildNode (uint32_t row, uint32_t col, uint32_t stride);
+
+    /// the maximum vertical error of a node's tile with respect to the tile of
+    /// its children (i.e., the samples at half the stride)
+    float _localError (uint32_t row, uint32_t col, uint32_t stride) const;
+
+    /// the world-space vertex of the height field at the given sample, where
+    /// the coordinates are clamped to the height field
+    Vertex _vertex (uint32_t row, uint32_t col) const;
+
+    /// compute the vertices of a node's tile
+    void _tileVerts (Node const &nd, std::vector<Vertex> &verts) const;
+
+    /// load the geometry for a node into the cache
+    void _loadTile (uint32_t id);
+
+};
+
+/// Terrain for a height field that is streamed from a tiled height-field file.
+/// Each file tile that is resident and near the camera is drawn either as a
+/// single coarse 65x65 grid or, when the coarse grid's projected error is too
+/// large, as a set of full-resolution chunks.  The grids use the same layout
+/// (and index buffer) as the tiles of the `Terrain` class, and skirts hide the
+/// cracks between coarse and fine tiles.  Tiles that are not resident yet are
+/// not drawn, so rendering never waits for the height-field data.
+class StreamingTerrain {
+public:
+
+    /// the default number of chunks in the geometry cache
+    static constexpr uint32_t kDefaultMaxChunks = 512;
+
+    /// the maximum number of chunks whose geometry is generated in a frame
+    static constexpr uint32_t kMaxLoadsPerFrame = 16;
+
+    /// \brief construct the terrain for a tiled height field
+    /// \param app        the owning application
+    /// \param hf         the height field; the terrain calls its `update` function
+    /// \param maxChunks  the number of chunks in the geometry cache
+    StreamingTerrain (cs237::Application *app, TiledHeightField *hf, uint32_t maxChunks = kDefaultMaxChunks);
+
+    ~StreamingTerrain ();
+
+    /// the screen-space error tolerance (in pixels)
+    float errorTolerance () const { return this->_tau; }
+
+    /// set the screen-space error tolerance (in pixels)
+    void setErrorTolerance (float tau) { this->_tau = std::max(tau, 0.1f); }
+
+    /// the distance from the camera (in world-space units) within which tiles
+    /// are streamed in and drawn
+    float viewRadius () const { return this->_radius; }
+
+    /// set the view radius
+    void setViewRadius (float r) { this->_radius = std::max(r, 0.0f); }
+
+    /// \brief update the resident tiles and select the chunks that are used to
+    ///        render a view; the arguments are as for `Terrain::selectTiles`.
+    void selectTiles (cs237::Frustumf_t const &f, glm::vec3 const &camPos, float pixScale);
+
+    /// the number of chunks selected by the last call to `selectTiles`
+    uint32_t numSelected () const { return this->_selected.size(); }
+
+    /// the number of triangles (including skirts) selected by the last call to
+    /// `selectTiles`
+    uint32_t numTris () const { return this->_selected.size() * Terrain::kTileTris; }
+
+    /// \brief record the commands to draw the selected chunks.
+    /// \param cmdBuf  the command buffer to record the commands in
+    ///
+    /// The caller is responsible for binding the pipeline and descriptor sets
+    /// and setting the push constants (the chunk vertices are in world space).
+    /// As with `Terrain::draw`, the pipeline must use triangle strips with
+    /// primitive restart.
+    void draw (vk::CommandBuffer cmdBuf);
+
+private:
+    /// a slot in the chunk cache
+    struct Chunk {
+        cs237::VertexBuffer<Vertex> *vBuf;      ///< the chunk's vertices
+        uint64_t key;                           ///< the chunk's key (see `_chunkKey`)
+        uint64_t lastUsed;                      ///< the last frame the chunk was selected
+    };
+
+    cs237::Application *_app;           ///< the owning application
+    TiledHeightField *_hf;              ///< the height field
+    float _tau;                         ///< screen-space error tolerance in pixels
+    float _radius;                      ///< the view radius
+    float _skirtDepth;                  ///< how far the skirts hang below the chunk edges
+    uint32_t _maxChunks;                ///< the size of the chunk cache
+    uint32_t _nLoads;                   ///< the number of chunks loaded in this frame
+    uint64_t _frame;                    ///< the current frame number
+    std::vector<Chunk> _chunks;         ///< the chunk cache
+    std::map<uint64_t, uint32_t> _chunkMap;
+                                        ///< map from chunk keys to cache slots
+    cs237::IndexBuffer<uint32_t> *_iBuf;///< the index buffer shared by all chunks
+    std::vector<uint32_t> _selected;    ///< the slots of the chunks selected for the
+                                        ///  current frame
+
+    /// the cache key for a chunk of a tile; chunk 0 is the coarse grid for the
+    /// whole tile and the full-resolution chunks are numbered from 1 in row-major order
+    static uint64_t _chunkKey (uint64_t tileId, uint32_t chunk) { return (tileId << 16) | chunk; }
+
+    /// the cache slot of a chunk or -1 if the chunk is not in the cache
+    int32_t _findChunk (uint64_t key) const
+    {
+        auto it = this->_chunkMap.find(key);
+        return (it == this->_chunkMap.end()) ? -1 : int32_t(it->second);
+    }
+
+    /// load the geometry for a chunk into the cache
+    /// \return the chunk's slot in the cache
+    uint32_t _loadChunk (TiledHeightField::Tile const &t, uint32_t chunk);
+
+    /// compute the vertices of a chunk
+    void _chunkVerts (TiledHeightField::Tile const &t, uint32_t chunk, std::vector<Vertex> &verts) const;
+
+};
+
+#endif // !_TERRAIN_HPP_
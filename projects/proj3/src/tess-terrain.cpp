@@ -0,0 +1,306 @@
+/*! \file tess-terrain.cpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "tess-terrain.hpp"
+#include <string_view>
+
+/// path to directory that holds the shaders
+constexpr std::string_view kShaderDir = CS237_BINARY_DIR "/projects/proj3/shaders/";
+
+/// the target screen-space length (in pixels) of the edges of the tessellated
+/// triangles
+constexpr float kEdgePixels = 8.0f;
+
+/// the bindings of the descriptor set
+constexpr uint32_t kUBOBinding = 0;
+constexpr uint32_t kHeightBinding = 1;
+constexpr uint32_t kColorBinding = 2;
+constexpr uint32_t kNumBindings = 3;
+
+/// the number of control points per patch
+constexpr uint32_t kPatchSz = 4;
+
+TessTerrain::TessTerrain (Proj3 *app, vk::RenderPass renderPass)
+  : _app(app)
+{
+    assert (TessTerrain::isSupported(app));
+
+    const Scene *scene = app->scene();
+    const HeightField *hf = scene->ground();
+    assert (hf != nullptr);
+
+    uint32_t lastRow = hf->numRows() - 1;
+    uint32_t lastCol = hf->numCols() - 1;
+    if ((lastRow < kPatchesPerSide) || (lastCol < kPatchesPerSide)) {
+        ERROR("height field is too small for the tessellated terrain");
+    }
+
+    this->_maxLevel = std::min(64.0f,
+        float(app->props()->limits.maxTessellationGenerationLevel));
+
+    // the patch grid; the patch boundaries are on height-field samples, so the
+    // bounds of a patch are the bounds of its samples
+    std::vector<PatchVertex> verts;
+    verts.reserve(kPatchSz * this->numPatches());
+    for (uint32_t i = 0;  i < kPatchesPerSide;  ++i) {
+        uint32_t r0 = (i * lastRow) / kPatchesPerSide;
+        uint32_t r1 = ((i + 1) * lastRow) / kPatchesPerSide;
+        for (uint32_t j = 0;  j < kPatchesPerSide;  ++j) {
+            uint32_t c0 = (j * lastCol) / kPatchesPerSide;
+            uint32_t c1 = ((j + 1) * lastCol) / kPatchesPerSide;
+            cs237::AABBf_t box = hf->bounds(r0, c0, r1, c1);
+            glm::vec3 p0 = hf->vertexAt(r0, c0);
+            glm::vec3 p1 = hf->vertexAt(r1, c1);
+            float minY = box.min().y;
+            float maxY = box.max().y;
+            // see terrain.tesc for the order of the control points
+            verts.push_back(PatchVertex{glm::vec2(p0.x, p0.z), minY, maxY});
+            verts.push_back(PatchVertex{glm::vec2(p1.x, p0.z), minY, maxY});
+            verts.push_back(PatchVertex{glm::vec2(p1.x, p1.z), minY, maxY});
+            verts.push_back(PatchVertex{glm::vec2(p0.x, p1.z), minY, maxY});
+        }
+    }
+    this->_vertBuf = new cs237::VertexBuffer<PatchVertex>(app, verts);
+
+    // the uniforms
+    TessUB ub;
+    ub.grid = glm::vec4(
+        hf->width() / float(lastCol),
+        hf->height() / float(lastRow),
+        0.5f * hf->width(),
+        0.5f * hf->height());
+    ub.hgt = glm::vec4(hf->vScale(), float(lastCol), float(lastRow), 0.0f);
+    ub.lighting.ambLight = scene->ambientLight();
+    ub.lighting.nLights = std::min(scene->numLights(), 4);
+    for (int i = 0;  i < ub.lighting.nLights;  ++i) {
+        SpotLight const &l = scene->light(i);
+        ub.lighting.lights[i].lightPos = l.pos;
+        ub.lighting.lights[i].lightColor = l.intensity;
+        ub.lighting.lights[i].lightAtten = glm::vec3(l.k0, l.k1, l.k2);
+    }
+    this->_ubo = new cs237::UniformBuffer<TessUB>(app, ub);
+
+    // the height field is an unsigned-integer texture, so it is read with
+    // `texelFetch` and the shaders do their own filtering
+    this->_hfTxt = new cs237::Texture2D(app, hf->image());
+    cs237::Application::SamplerInfo hfSamplerInfo(
+        vk::Filter::eNearest,                   // magnification filter
+        vk::Filter::eNearest,                   // minification filter
+        vk::SamplerMipmapMode::eNearest,        // mipmap mode
+        vk::SamplerAddressMode::eClampToEdge,   // addressing mode for U coordinates
+        vk::SamplerAddressMode::eClampToEdge,   // addressing mode for V coordinates
+        vk::BorderColor::eIntOpaqueBlack);      // border color
+    this->_hfSampler = app->createSampler(hfSamplerInfo);
+
+    this->_colorTxt = new cs237::Texture2D(app, hf->colorMap(), true);
+    cs237::Application::SamplerInfo colorSamplerInfo(
+        vk::Filter::eLinear,                    // magnification filter
+        vk::Filter::eLinear,                    // minification filter
+        vk::SamplerMipmapMode::eLinear,         // mipmap mode
+        vk::SamplerAddressMode::eClampToEdge,   // addressing mode for U coordinates
+        vk::SamplerAddressMode::eClampToEdge,   // addressing mode for V coordinates
+        vk::BorderColor::eIntOpaqueBlack);      // border color
+    this->_colorSampler = app->createSampler(colorSamplerInfo);
+
+    this->_initDescriptors ();
+    this->_initPipeline (renderPass);
+
+}
+
+TessTerrain::~TessTerrain ()
+{
+    auto device = this->_device();
+
+    device.destroyPipeline(this->_pipeline);
+    device.destroyPipelineLayout(this->_pipelineLayout);
+    device.destroyDescriptorPool(this->_descPool);
+    device.destroyDescriptorSetLayout(this->_dsLayout);
+
+    delete this->_vertBuf;
+    delete this->_ubo;
+    delete this->_hfTxt;
+    delete this->_colorTxt;
+}
+
+void TessTerrain::_initDescriptors ()
+{
+    auto device = this->_device();
+
+    std::array<vk::DescriptorPoolSize, 2> poolSizes = {
+            vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, 1),
+            vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, 2)
+        };
+    vk::DescriptorPoolCreateInfo poolInfo(
+        {}, /* flags */
+        1, /* max sets */
+        poolSizes); /* pool sizes */
+    this->_descPool = device.createDescriptorPool(poolInfo);
+
+    std::array<vk::DescriptorSetLayoutBinding, kNumBindings> bindings = {
+            vk::DescriptorSetLayoutBinding(
+                kUBOBinding, /* binding */
+                vk::DescriptorType::eUniformBuffer, /* descriptor type */
+                1, /* descriptor count */
+                vk::ShaderStageFlagBits::eTessellationControl /* stages */
+                  | vk::ShaderStageFlagBits::eTessellationEvaluation
+                  | vk::ShaderStageFlagBits::eFragment,
+                nullptr), /* immutable samplers */
+            vk::DescriptorSetLayoutBinding(
+                kHeightBinding, /* binding */
+                vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                1, /* descriptor count */
+                vk::ShaderStageFlagBits::eTessellationControl /* stages */
+                  | vk::ShaderStageFlagBits::eTessellationEvaluation,
+                nullptr), /* immutable samplers */
+            vk::DescriptorSetLayoutBinding(
+                kColorBinding, /* binding */
+                vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                1, /* descriptor count */
+                vk::ShaderStageFlagBits::eFragment, /* stages */
+                nullptr) /* immutable samplers */
+        };
+    vk::DescriptorSetLayoutCreateInfo layoutInfo({}, bindings);
+    this->_dsLayout = device.createDescriptorSetLayout(layoutInfo);
+
+    vk::DescriptorSetAllocateInfo allocInfo(this->_descPool, this->_dsLayout);
+    this->_descSet = (device.allocateDescriptorSets(allocInfo))[0];
+
+    auto bufInfo = this->_ubo->descInfo();
+    vk::DescriptorImageInfo hfInfo(
+        this->_hfSampler,
+        this->_hfTxt->view(),
+        vk::ImageLayout::eShaderReadOnlyOptimal);
+    vk::DescriptorImageInfo colorInfo(
+        this->_colorSampler,
+        this->_colorTxt->view(),
+        vk::ImageLayout::eShaderReadOnlyOptimal);
+    std::array<vk::WriteDescriptorSet, kNumBindings> writes = {
+            vk::WriteDescriptorSet(
+                this->_descSet, /* descriptor set */
+                kUBOBinding, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eUniformBuffer, /* descriptor type */
+                nullptr, /* image info */
+                bufInfo, /* buffer info */
+                nullptr), /* texel buffer view */
+            vk::WriteDescriptorSet(
+                this->_descSet, /* descriptor set */
+                kHeightBinding, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                hfInfo, /* image info */
+                nullptr, /* buffer info */
+                nullptr), /* texel buffer view */
+            vk::WriteDescriptorSet(
+                this->_descSet, /* descriptor set */
+                kColorBinding, /* binding */
+                0, /* array element */
+                vk::DescriptorType::eCombinedImageSampler, /* descriptor type */
+                colorInfo, /* image info */
+                nullptr, /* buffer info */
+                nullptr) /* texel buffer view */
+        };
+    device.updateDescriptorSets (writes, nullptr);
+
+}
+
+void TessTerrain::_initPipeline (vk::RenderPass renderPass)
+{
+    vk::PushConstantRange pcRange(
+        vk::ShaderStageFlagBits::eTessellationControl
+          | vk::ShaderStageFlagBits::eTessellationEvaluation,
+        0,
+        sizeof(TessPC));
+    this->_pipelineLayout = this->_app->createPipelineLayout({this->_dsLayout}, {pcRange});
+
+    vk::ShaderStageFlags stages =
+        vk::ShaderStageFlagBits::eVertex
+        | vk::ShaderStageFlagBits::eTessellationControl
+        | vk::ShaderStageFlagBits::eTessellationEvaluation
+        | vk::ShaderStageFlagBits::eFragment;
+    cs237::Shaders *shaders = new cs237::Shaders(
+        this->_app,
+        std::string(kShaderDir) + "terrain",
+        stages);
+
+    // a single vec4 attribute per control point
+    std::vector<vk::VertexInputBindingDescription> bindings = {
+            vk::VertexInputBindingDescription(
+                0, sizeof(PatchVertex), vk::VertexInputRate::eVertex)
+        };
+    std::vector<vk::VertexInputAttributeDescription> attrs = {
+            vk::VertexInputAttributeDescription(
+                0, 0, vk::Format::eR32G32B32A32Sfloat, 0)
+        };
+    auto vertexInfo = cs237::vertexInputInfo (bindings, attrs);
+
+    std::array<vk::DynamicState, 2> dynamicStates = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor
+    };
+
+    this->_pipeline = this->_app->createTessellationPipeline(
+        shaders,
+        vertexInfo,
+        kPatchSz,
+        // the viewport and scissor rectangles are specified dynamically, but we need
+        // to specify the counts
+        vk::ArrayProxy<vk::Viewport>(1, nullptr), /* viewports */
+        vk::ArrayProxy<vk::Rect2D>(1, nullptr), /* scissor rects */
+        vk::PolygonMode::eFill,
+        // the winding of the generated triangles depends on the tessellator's
+        // domain orientation, so we do not cull; the terrain is a height
+        // field, so its back faces are only visible from below anyway
+        vk::CullModeFlagBits::eNone,
+        vk::FrontFace::eCounterClockwise,
+        this->_pipelineLayout,
+        renderPass,
+        0,
+        dynamicStates);
+
+    cs237::destroyVertexInputInfo (vertexInfo);
+    delete shaders;
+
+}
+
+void TessTerrain::drawCmd (
+    vk::CommandBuffer cmdBuf,
+    glm::mat4 const &viewProj,
+    glm::vec3 const &camPos,
+    float pixScale)
+{
+    TessPC pc;
+    pc.viewProj = viewProj;
+    pc.camPos = glm::vec4(camPos, pixScale);
+    pc.params = glm::vec4(kEdgePixels, this->_maxLevel, 0.0f, 0.0f);
+
+    cmdBuf.bindPipeline(vk::PipelineBindPoint::eGraphics, this->_pipeline);
+    cmdBuf.bindDescriptorSets(
+        vk::PipelineBindPoint::eGraphics,
+        this->_pipelineLayout,
+        0, /* first set */
+        this->_descSet, /* descriptor sets */
+        nullptr); /* dynamic offsets */
+    cmdBuf.pushConstants(
+        this->_pipelineLayout,
+        vk::ShaderStageFlagBits::eTessellationControl
+          | vk::ShaderStageFlagBits::eTessellationEvaluation,
+        0,
+        sizeof(TessPC),
+        &pc);
+
+    vk::Buffer vertBuffers[] = {this->_vertBuf->vkBuffer()};
+    vk::DeviceSize offsets[] = {0};
+    cmdBuf.bindVertexBuffers(0, vertBuffers, offsets);
+    cmdBuf.draw(kPatchSz * this->numPatches(), 1, 0, 0);
+
+}
@@ -0,0 +1,137 @@
+/*! \file tess-terrain.hpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * Terrain rendering with tessellation shaders.  The height field is uploaded
+ * to the GPU as a texture and the CPU only supplies a coarse grid of patches;
+ * the tessellation-control shader picks the subdivision of each patch edge from
+ * its size on the screen and the tessellation-evaluation shader displaces the
+ * generated vertices by the height field.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _TESS_TERRAIN_HPP_
+#define _TESS_TERRAIN_HPP_
+
+#include "cs237.hpp"
+#include "app.hpp"
+#include "height-field.hpp"
+#include "shader-uniforms.hpp"
+
+/// Tessellated terrain for a HeightField.  The ground is covered by a fixed
+/// `kPatchesPerSide` x `kPatchesPerSide` grid of quad patches, so the amount of
+/// vertex data does not depend on the resolution of the height field.  Each
+/// control point carries the vertical range of its patch, which the control
+/// shader uses to cull patches that are outside the view frustum (by setting
+/// their tessellation levels to zero).  The edge levels are computed from the
+/// screen-space diameter of the edge, which only depends on the edge's endpoints,
+/// so adjacent patches agree on the level of a shared edge and there are no
+/// cracks.
+///
+/// Since a patch is subdivided at most `maxTessellationGenerationLevel` times
+/// along each side (64 on most devices), the finest level of detail samples the
+/// height field at full resolution only when the height field has fewer than
+/// `kPatchesPerSide * 64` samples per side; bigger height fields are rendered
+/// with a coarser sampling.
+///
+/// This class is self contained: it has its own pipeline and descriptor set,
+/// which holds the terrain parameters and the scene's lighting (a `TessUB`),
+/// the height-field texture, and the ground's color map.
+class TessTerrain {
+public:
+
+    /// the number of patches along each side of the ground
+    static constexpr uint32_t kPatchesPerSide = 16;
+
+    /// \brief create the tessellated terrain for the scene's ground
+    /// \param app         the owning application; its scene must have a ground
+    ///                    height field
+    /// \param renderPass  the render pass that the terrain is drawn in
+    TessTerrain (Proj3 *app, vk::RenderPass renderPass);
+
+    ~TessTerrain ();
+
+    /// \brief can the tessellated terrain be used on the application's device?
+    /// \param app  the application
+    /// \return true if the device supports tessellation shaders
+    static bool isSupported (cs237::Application *app)
+    {
+        return app->hasTessellation();
+    }
+
+    /// the number of patches in the grid
+    uint32_t numPatches () const { return kPatchesPerSide * kPatchesPerSide; }
+
+    /// \brief record the commands to draw the terrain.
+    /// \param cmdBuf    the command buffer to record the commands in
+    /// \param viewProj  the world-to-clip-space transform
+    /// \param camPos    the world-space camera position
+    /// \param pixScale  the screen-space size (in pixels) of a unit-length
+    ///                  feature at unit distance from the camera
+    ///
+    /// This function binds its own pipeline, so the caller must rebind its
+    /// pipeline if it draws anything after the terrain.  The viewport and
+    /// scissor rectangle are dynamic state and must be set by the caller.
+    void drawCmd (
+        vk::CommandBuffer cmdBuf,
+        glm::mat4 const &viewProj,
+        glm::vec3 const &camPos,
+        float pixScale);
+
+private:
+    /// a control point of a patch; this struct should agree with the vertex
+    /// attribute in terrain.vert
+    struct PatchVertex {
+        glm::vec2 pos;          ///< world-space X and Z coordinates
+        float minY;             ///< the minimum world-space Y coordinate in the patch
+        float maxY;             ///< the maximum world-space Y coordinate in the patch
+    };
+
+    /// the layout of the uniform buffer; this struct should agree with the
+    /// `std140` layout in the terrain shaders
+    struct TessUB {
+        alignas(16) glm::vec4 grid;     //!< (X scale, Z scale, half width, half height)
+        alignas(16) glm::vec4 hgt;      //!< (vertical scale, last column, last row, 0)
+        alignas(16) FragUB lighting;    //!< the scene's lighting
+    };
+
+    /// push constants for the tessellation shaders
+    struct TessPC {
+        alignas(16) glm::mat4 viewProj; //!< world-to-clip-space transform
+        alignas(16) glm::vec4 camPos;   //!< camera position (xyz) and `pixScale` (w)
+        alignas(16) glm::vec4 params;   //!< target edge length in pixels (x) and
+                                        //!  the maximum tessellation level (y)
+    };
+
+    Proj3 *_app;                                        ///< the owning application
+    float _maxLevel;                                    ///< the maximum tessellation level
+    cs237::VertexBuffer<PatchVertex> *_vertBuf;         ///< the patch control points
+    cs237::UniformBuffer<TessUB> *_ubo;                 ///< terrain and lighting uniforms
+    cs237::Texture2D *_hfTxt;                           ///< the height-field texture
+    cs237::Texture2D *_colorTxt;                        ///< the ground's color map
+    vk::Sampler _hfSampler;                             ///< sampler for `_hfTxt`
+    vk::Sampler _colorSampler;                          ///< sampler for `_colorTxt`
+    vk::DescriptorPool _descPool;                       ///< pool for `_descSet`
+    vk::DescriptorSetLayout _dsLayout;                  ///< layout of `_descSet`
+    vk::DescriptorSet _descSet;                         ///< the terrain descriptors
+    vk::PipelineLayout _pipelineLayout;                 ///< the pipeline layout
+    vk::Pipeline _pipeline;                             ///< the tessellation pipeline
+
+    /// get the device handle
+    vk::Device _device () const { return this->_app->device(); }
+
+    /// initialize the descriptor pool, layout, and set
+    void _initDescriptors ();
+
+    /// initialize the graphics pipeline
+    void _initPipeline (vk::RenderPass renderPass);
+
+};
+
+#endif // !_TESS_TERRAIN_HPP_
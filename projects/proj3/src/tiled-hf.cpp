@@ -0,0 +1,331 @@
+/*! \file tiled-hf.cpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#include "tiled-hf.hpp"
+#include <cstring>
+
+#ifdef CS237_WINDOWS
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+TiledHeightField::TiledHeightField (
+    std::string const &file,
+    float width, float height, float vScale,
+    glm::vec3 const &color,
+    uint32_t maxTiles)
+  : _halfWid(0.5*width), _halfHt(0.5*height),
+    _scaleX(0), _scaleY(vScale), _scaleZ(0),
+    _color(color), _maxTiles(std::max(maxTiles, 1u)), _frame(0),
+    _map(nullptr), _mapSz(0), _mapHandle(nullptr),
+    _quit(false)
+{
+    if ((width <= 0.0) || (height <= 0.0) || (vScale <= 0.0)) {
+        ERROR("TiledHeightField::TiledHeightField: invalid scaling");
+    }
+
+    this->_mapFile (file);
+
+  // validate the header
+    if (this->_mapSz < sizeof(TiledHFHeader)) {
+        ERROR("TiledHeightField::TiledHeightField: file is too small");
+    }
+    std::memcpy (&this->_hdr, this->_map, sizeof(TiledHFHeader));
+    if (std::memcmp(this->_hdr.magic, TiledHFHeader::kMagic, sizeof(TiledHFHeader::kMagic)) != 0) {
+        ERROR("TiledHeightField::TiledHeightField: bad magic number");
+    }
+    if (this->_hdr.version != TiledHFHeader::kVersion) {
+        ERROR("TiledHeightField::TiledHeightField: unsupported version");
+    }
+    if ((this->_hdr.nRows < 2) || (this->_hdr.nCols < 2)
+    ||  (this->_hdr.tileCells == 0) || (this->_hdr.tileCells % 64 != 0)
+    ||  (uint64_t(this->_hdr.nTileRows) * this->_hdr.tileCells < this->_hdr.nRows - 1)
+    ||  (uint64_t(this->_hdr.nTileCols) * this->_hdr.tileCells < this->_hdr.nCols - 1)) {
+        ERROR("TiledHeightField::TiledHeightField: invalid dimensions");
+    }
+    uint64_t nTiles = uint64_t(this->_hdr.nTileRows) * this->_hdr.nTileCols;
+    if ((this->_hdr.dataOffset < sizeof(TiledHFHeader) + nTiles * sizeof(TiledHFTileInfo))
+    ||  (this->_hdr.dataOffset + nTiles * this->_hdr.tileBytes() > this->_mapSz)) {
+        ERROR("TiledHeightField::TiledHeightField: file is truncated");
+    }
+
+    this->_scaleX = width / float(this->numCols() - 1);
+    this->_scaleZ = height / float(this->numRows() - 1);
+
+    this->_loader = std::thread(&TiledHeightField::_loaderLoop, this);
+
+}
+
+TiledHeightField::~TiledHeightField ()
+{
+  // stop the loader
+    {
+        std::lock_guard<std::mutex> lk(this->_mu);
+        this->_quit = true;
+    }
+    this->_cv.notify_one();
+    this->_loader.join();
+
+  // free the tiles; the pending tiles are either in the request queue or
+  // the done queue
+    for (auto &it : this->_resident) {
+        delete it.second;
+    }
+    for (auto t : this->_free) {
+        delete t;
+    }
+    for (auto t : this->_requests) {
+        delete t;
+    }
+    for (auto t : this->_done) {
+        delete t;
+    }
+
+    this->_unmapFile ();
+
+}
+
+cs237::AABBf_t TiledHeightField::tileBBox (uint32_t row, uint32_t col) const
+{
+    TiledHFTileInfo const &info = this->_tileInfo(row, col);
+    uint32_t n = this->_hdr.tileCells;
+    uint32_t r1 = std::min((row + 1) * n, this->numRows() - 1);
+    uint32_t c1 = std::min((col + 1) * n, this->numCols() - 1);
+    glm::vec3 p0 = this->position(row * n, col * n, info.minV);
+    glm::vec3 p1 = this->position(r1, c1, info.maxV);
+    return cs237::AABBf_t(p0, p1);
+}
+
+void TiledHeightField::update (glm::vec3 const &pos, float radius)
+{
+    this->_frame++;
+
+  // add the tiles that have been loaded since the last update to the resident set
+    std::vector<Tile *> done;
+    {
+        std::lock_guard<std::mutex> lk(this->_mu);
+        std::swap(done, this->_done);
+    }
+    for (auto t : done) {
+        uint64_t id = this->tileId(t->row, t->col);
+        this->_pending.erase(id);
+        // the tile is marked as used below if it is still wanted
+        t->lastUsed = this->_frame - 1;
+        this->_resident.insert({id, t});
+    }
+
+  // find the tiles that are within the radius, ordered by distance
+    float tileWid = this->_scaleX * float(this->_hdr.tileCells);
+    float tileHt = this->_scaleZ * float(this->_hdr.tileCells);
+    auto tileRange = [](float lo, float hi, float sz, uint32_t n, uint32_t &t0, uint32_t &t1) {
+        t0 = uint32_t(std::clamp(std::floor(lo / sz), 0.0f, float(n)));
+        t1 = uint32_t(std::clamp(std::ceil(hi / sz), 0.0f, float(n)));
+    };
+    uint32_t tr0, tr1, tc0, tc1;
+    tileRange(pos.z + this->_halfHt - radius, pos.z + this->_halfHt + radius, tileHt,
+        this->_hdr.nTileRows, tr0, tr1);
+    tileRange(pos.x + this->_halfWid - radius, pos.x + this->_halfWid + radius, tileWid,
+        this->_hdr.nTileCols, tc0, tc1);
+
+    std::vector<std::pair<float, uint64_t>> near;
+    for (uint32_t r = tr0;  r < tr1;  ++r) {
+        for (uint32_t c = tc0;  c < tc1;  ++c) {
+            // distance in the XZ plane from the camera to the tile's rectangle
+            float x0 = tileWid * float(c) - this->_halfWid;
+            float z0 = tileHt * float(r) - this->_halfHt;
+            float dx = std::max(std::max(x0 - pos.x, pos.x - (x0 + tileWid)), 0.0f);
+            float dz = std::max(std::max(z0 - pos.z, pos.z - (z0 + tileHt)), 0.0f);
+            float d2 = dx*dx + dz*dz;
+            if (d2 <= radius * radius) {
+                near.push_back({d2, this->tileId(r, c)});
+            }
+        }
+    }
+    std::sort(near.begin(), near.end());
+    if (near.size() > this->_maxTiles) {
+        near.resize(this->_maxTiles);
+    }
+    this->_wanted.clear();
+    for (auto const &it : near) {
+        this->_wanted.push_back(it.second);
+    }
+    std::vector<uint64_t> wantedSet(this->_wanted);
+    std::sort(wantedSet.begin(), wantedSet.end());
+    auto isWanted = [&wantedSet](uint64_t id) {
+        return std::binary_search(wantedSet.begin(), wantedSet.end(), id);
+    };
+
+  // mark the wanted tiles that are resident as used in this update
+    for (auto id : this->_wanted) {
+        auto it = this->_resident.find(id);
+        if (it != this->_resident.end()) {
+            it->second->lastUsed = this->_frame;
+        }
+    }
+
+  // cancel the requests that the loader has not started and that are no
+  // longer wanted
+    {
+        std::lock_guard<std::mutex> lk(this->_mu);
+        auto keep = std::stable_partition(
+            this->_requests.begin(), this->_requests.end(),
+            [&](Tile *t) { return isWanted(this->tileId(t->row, t->col)); });
+        for (auto it = keep;  it != this->_requests.end();  ++it) {
+            this->_pending.erase(this->tileId((*it)->row, (*it)->col));
+            this->_free.push_back(*it);
+        }
+        this->_requests.erase(keep, this->_requests.end());
+    }
+
+  // request the missing tiles.  The number of tiles (resident, pending, or free)
+  // never exceeds the budget, so when we run out of storage we evict the
+  // least-recently used tile that is not wanted
+    std::vector<Tile *> reqs;
+    for (auto id : this->_wanted) {
+        if ((this->_resident.find(id) != this->_resident.end())
+        ||  (this->_pending.find(id) != this->_pending.end())) {
+            continue;
+        }
+        Tile *t = nullptr;
+        if (! this->_free.empty()) {
+            t = this->_free.back();
+            this->_free.pop_back();
+        }
+        else if (this->_resident.size() + this->_pending.size() < this->_maxTiles) {
+            t = new Tile;
+        }
+        else {
+            auto victim = this->_resident.end();
+            for (auto it = this->_resident.begin();  it != this->_resident.end();  ++it) {
+                if ((it->second->lastUsed < this->_frame)
+                && ((victim == this->_resident.end())
+                    || (it->second->lastUsed < victim->second->lastUsed))) {
+                    victim = it;
+                }
+            }
+            if (victim == this->_resident.end()) {
+                break;
+            }
+            t = victim->second;
+            this->_resident.erase(victim);
+        }
+        t->row = this->tileRow(id);
+        t->col = this->tileCol(id);
+        this->_pending.insert(id);
+        reqs.push_back(t);
+    }
+    if (! reqs.empty()) {
+        {
+            std::lock_guard<std::mutex> lk(this->_mu);
+            this->_requests.insert(this->_requests.end(), reqs.begin(), reqs.end());
+        }
+        this->_cv.notify_one();
+    }
+
+}
+
+void TiledHeightField::_loaderLoop ()
+{
+    size_t nSamples = size_t(this->tileSz()) * this->tileSz();
+
+    while (true) {
+        Tile *t;
+        {
+            std::unique_lock<std::mutex> lk(this->_mu);
+            this->_cv.wait(lk, [this]() { return this->_quit || !this->_requests.empty(); });
+            if (this->_quit) {
+                return;
+            }
+            t = this->_requests.front();
+            this->_requests.pop_front();
+        }
+
+        // copy the tile out of the mapped file; this is where the page faults
+        // happen, which is why it is done off of the rendering thread.  We
+        // assume a little-endian host.
+        const uint8_t *src = this->_map + this->_hdr.dataOffset
+            + this->tileId(t->row, t->col) * this->_hdr.tileBytes();
+        t->data.resize(nSamples);
+        std::memcpy (t->data.data(), src, this->_hdr.tileBytes());
+
+        {
+            std::lock_guard<std::mutex> lk(this->_mu);
+            this->_done.push_back(t);
+        }
+    }
+}
+
+#ifdef CS237_WINDOWS
+
+void TiledHeightField::_mapFile (std::string const &file)
+{
+    HANDLE fh = CreateFileA(
+        file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fh == INVALID_HANDLE_VALUE) {
+        ERROR("TiledHeightField: unable to open \"" + file + "\"");
+    }
+    LARGE_INTEGER sz;
+    GetFileSizeEx(fh, &sz);
+    HANDLE mh = CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(fh);
+    if (mh == nullptr) {
+        ERROR("TiledHeightField: unable to map \"" + file + "\"");
+    }
+    this->_map = static_cast<const uint8_t *>(MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0));
+    if (this->_map == nullptr) {
+        ERROR("TiledHeightField: unable to map \"" + file + "\"");
+    }
+    this->_mapSz = size_t(sz.QuadPart);
+    this->_mapHandle = mh;
+}
+
+void TiledHeightField::_unmapFile ()
+{
+    UnmapViewOfFile(this->_map);
+    CloseHandle(static_cast<HANDLE>(this->_mapHandle));
+}
+
+#else // !CS237_WINDOWS
+
+void TiledHeightField::_mapFile (std::string const &file)
+{
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        ERROR("TiledHeightField: unable to open \"" + file + "\"");
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        ERROR("TiledHeightField: unable to stat \"" + file + "\"");
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        ERROR("TiledHeightField: unable to map \"" + file + "\"");
+    }
+    // the tiles are read in an unpredictable order
+    madvise(p, st.st_size, MADV_RANDOM);
+    this->_map = static_cast<const uint8_t *>(p);
+    this->_mapSz = st.st_size;
+}
+
+void TiledHeightField::_unmapFile ()
+{
+    munmap(const_cast<uint8_t *>(this->_map), this->_mapSz);
+}
+
+#endif // CS237_WINDOWS
@@ -0,0 +1,263 @@
+/*! \file tiled-hf.hpp
+ *
+ * CS23700 Autumn 2023 Sample Code for Project 3
+ *
+ * This file defines the tiled height-field file format and the TiledHeightField
+ * class, which streams the tiles of a height field that is too large to keep
+ * in memory.
+ *
+ * \author John Reppy
+ */
+
+/*
+ * COPYRIGHT (c) 2023 John Reppy (http://cs.uchicago.edu/~jhr)
+ * All rights reserved.
+ */
+
+#ifndef _TILED_HF_HPP_
+#define _TILED_HF_HPP_
+
+#include "cs237.hpp"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+/// The header of a tiled height-field (".hft") file.  The header is followed
+/// by a table of `TiledHFTileInfo` records (one per tile in row-major order),
+/// and then, starting at `dataOffset`, by the tile data.  A tile covers
+/// `tileCells` x `tileCells` cells of the height field and is stored as
+/// `(tileCells+3)` x `(tileCells+3)` little-endian 16-bit samples in row-major
+/// order.  The extra samples are a one-sample border on every side, which is
+/// needed to compute the normals at the tile's edges; samples that are outside
+/// the height field are clamped to its edges.  The `hf-tiler` program converts
+/// PNG files to this format.
+struct TiledHFHeader {
+    char magic[8];              ///< the file's magic number (`kMagic`)
+    uint32_t version;           ///< the format version (`kVersion`)
+    uint32_t nCols;             ///< the number of samples per row of the height field
+    uint32_t nRows;             ///< the number of rows of samples in the height field
+    uint32_t tileCells;         ///< the number of cells along the side of a tile
+    uint32_t nTileCols;         ///< the number of tiles per row
+    uint32_t nTileRows;         ///< the number of rows of tiles
+    uint16_t minV;              ///< the minimum sample value
+    uint16_t maxV;              ///< the maximum sample value
+    float maxErr;               ///< the maximum of the tiles' `err` fields
+    uint64_t dataOffset;        ///< file offset of the first tile's data
+
+    static constexpr char kMagic[8] = { 'C', 'S', '2', '3', '7', 'H', 'F', 'T' };
+    static constexpr uint32_t kVersion = 1;
+
+    /// the number of samples along the side of a tile (including the border)
+    uint32_t tileSz () const { return this->tileCells + 3; }
+
+    /// the number of bytes of sample data per tile
+    uint64_t tileBytes () const { return uint64_t(this->tileSz()) * this->tileSz() * sizeof(uint16_t); }
+};
+
+/// per-tile information in a tiled height-field file
+struct TiledHFTileInfo {
+    uint16_t minV;              ///< the minimum sample value in the tile (excluding the border)
+    uint16_t maxV;              ///< the maximum sample value in the tile (excluding the border)
+    float err;                  ///< the maximum vertical error (in sample units) of the
+                                ///  tile when it is rendered as a single 64x64 grid
+};
+
+/// A height field that is backed by a memory-mapped tiled height-field file.
+/// Only a bounded number of tiles are resident in memory at any time; each
+/// frame, the renderer calls `update` with the camera position to request
+/// the tiles around the camera.  Missing tiles are copied out of the file by
+/// a background loader thread, so `update` never waits for I/O, and the least
+/// recently used tiles are evicted when the budget is exceeded.
+class TiledHeightField {
+  public:
+
+    /// the default number of resident tiles
+    static constexpr uint32_t kDefaultMaxTiles = 64;
+
+    /// a resident tile
+    struct Tile {
+        uint32_t row;                   ///< the tile's row
+        uint32_t col;                   ///< the tile's column
+        std::vector<uint16_t> data;     ///< the tile's samples (including the border)
+        uint64_t lastUsed;              ///< the last update in which the tile was wanted
+    };
+
+    /// \brief open a tiled height-field file
+    /// \param file      the name of the tiled height-field file
+    /// \param width     the width (X dimension) covered by the ground in
+    ///                  world-space coordinates
+    /// \param height    the height (Z dimension) covered by the ground in
+    ///                  world-space coordinates
+    /// \param vScale    the vertical scaling (Y dimension) factor
+    /// \param color     the color for non-texturing modes
+    /// \param maxTiles  the maximum number of tiles that are resident in memory
+    TiledHeightField (
+        std::string const &file,
+        float width, float height, float vScale,
+        glm::vec3 const &color,
+        uint32_t maxTiles = kDefaultMaxTiles);
+
+    ~TiledHeightField ();
+
+    /// the width of the ground object in world-space
+    float width () const { return 2.0f * this->_halfWid; }
+
+    /// the height of the ground object in world-space
+    float height () const { return 2.0f * this->_halfHt; }
+
+    /// the number of rows of data in the height-field
+    uint32_t numRows () const { return this->_hdr.nRows; }
+
+    /// the number of columns of data in the height-field
+    uint32_t numCols () const { return this->_hdr.nCols; }
+
+    /// the number of cells along the side of a tile
+    uint32_t tileCells () const { return this->_hdr.tileCells; }
+
+    /// the number of samples along the side of a tile's data (including the border)
+    uint32_t tileSz () const { return this->_hdr.tileSz(); }
+
+    /// the number of rows of tiles
+    uint32_t numTileRows () const { return this->_hdr.nTileRows; }
+
+    /// the number of columns of tiles
+    uint32_t numTileCols () const { return this->_hdr.nTileCols; }
+
+    /// the color of the ground
+    glm::vec3 color () const { return this->_color; }
+
+    /// the vertical scaling factor
+    float vScale () const { return this->_scaleY; }
+
+    /// the maximum number of resident tiles
+    uint32_t maxTiles () const { return this->_maxTiles; }
+
+    /// the number of resident tiles
+    uint32_t numResident () const { return this->_resident.size(); }
+
+    /// the number of tiles that have been requested, but are not resident yet
+    uint32_t numPending () const { return this->_pending.size(); }
+
+    /// return the world-space position of a sample; the row and column may be
+    /// outside the height field by one sample
+    glm::vec3 position (int64_t row, int64_t col, uint16_t v) const
+    {
+        return glm::vec3(
+            this->_scaleX * float(col) - this->_halfWid,
+            this->_scaleY * float(v),
+            this->_scaleZ * float(row) - this->_halfHt);
+    }
+
+    /// return the world-space AABB for the height field
+    cs237::AABBf_t bbox () const {
+        return cs237::AABBf_t(
+            glm::vec3(-this->_halfWid, this->_scaleY * float(this->_hdr.minV), -this->_halfHt),
+            glm::vec3( this->_halfWid, this->_scaleY * float(this->_hdr.maxV),  this->_halfHt));
+    }
+
+    /// return the world-space AABB of a tile; this information is available
+    /// whether the tile is resident or not
+    cs237::AABBf_t tileBBox (uint32_t row, uint32_t col) const;
+
+    /// return the maximum vertical error (in world-space units) of a tile when
+    /// it is rendered as a single 64x64 grid
+    float tileError (uint32_t row, uint32_t col) const
+    {
+        return this->_scaleY * this->_tileInfo(row, col).err;
+    }
+
+    /// the maximum vertical error (in world-space units) over all of the tiles
+    float maxError () const { return this->_scaleY * this->_hdr.maxErr; }
+
+    /// \brief update the set of resident tiles for a new camera position.
+    /// \param pos     the world-space camera position
+    /// \param radius  the tiles that are within this distance of the camera
+    ///                (in the XZ plane) are requested, nearest first
+    ///
+    /// This function adds the tiles that have been loaded since the previous
+    /// call to the resident set, evicting the least-recently used tiles as
+    /// necessary, and queues requests for the missing tiles.  It does not wait
+    /// for I/O.
+    void update (glm::vec3 const &pos, float radius);
+
+    /// \brief get a resident tile
+    /// \param row  the tile's row
+    /// \param col  the tile's column
+    /// \return a pointer to the tile, or nullptr if the tile is not resident.
+    ///         The pointer is valid until the next call to `update`.
+    Tile const *tile (uint32_t row, uint32_t col) const
+    {
+        auto it = this->_resident.find(this->tileId(row, col));
+        return (it == this->_resident.end()) ? nullptr : it->second;
+    }
+
+    /// the tiles that were wanted by the last call to `update`, ordered by
+    /// increasing distance from the camera (as tile IDs; see `tileRow` and `tileCol`)
+    std::vector<uint64_t> const &wanted () const { return this->_wanted; }
+
+    /// the ID of a tile
+    uint64_t tileId (uint32_t row, uint32_t col) const
+    {
+        return uint64_t(row) * this->_hdr.nTileCols + col;
+    }
+
+    /// the row of a tile ID
+    uint32_t tileRow (uint64_t id) const { return uint32_t(id / this->_hdr.nTileCols); }
+
+    /// the column of a tile ID
+    uint32_t tileCol (uint64_t id) const { return uint32_t(id % this->_hdr.nTileCols); }
+
+  private:
+    TiledHFHeader _hdr;         ///< the file's header
+    const float _halfWid;       ///< half the width in world space
+    const float _halfHt;        ///< half the height in world space
+    float _scaleX;              ///< horizontal scaling factor in X dimension
+    const float _scaleY;        ///< vertical scaling factor (Y dimension)
+    float _scaleZ;              ///< horizontal scaling factor in Z dimension
+    const glm::vec3 _color;     ///< the color of the ground
+    uint32_t _maxTiles;         ///< the budget of resident tiles
+    uint64_t _frame;            ///< the number of calls to `update`
+
+    // the memory-mapped file
+    const uint8_t *_map;        ///< the base address of the mapping
+    size_t _mapSz;              ///< the size of the mapping
+    void *_mapHandle;           ///< OS-specific handle for the mapping
+
+    // resident tiles; only accessed by the rendering thread
+    std::map<uint64_t, Tile *> _resident;       ///< the resident tiles by ID
+    std::vector<Tile *> _free;                  ///< evicted tiles whose storage can be reused
+    std::vector<uint64_t> _wanted;              ///< the tiles wanted by the last update
+    std::set<uint64_t> _pending;                ///< the IDs of the outstanding requests
+
+    // the loader thread and its queues, which are protected by `_mu`
+    std::thread _loader;                        ///< the loader thread
+    std::mutex _mu;                             ///< lock for the queues
+    std::condition_variable _cv;                ///< signals new requests to the loader
+    std::deque<Tile *> _requests;               ///< tiles to load (the `row` and `col`
+                                                ///  fields specify the tile)
+    std::vector<Tile *> _done;                  ///< loaded tiles
+    bool _quit;                                 ///< set to stop the loader
+
+    /// the per-tile information of a tile
+    TiledHFTileInfo const &_tileInfo (uint32_t row, uint32_t col) const
+    {
+        assert ((row < this->_hdr.nTileRows) && (col < this->_hdr.nTileCols));
+        return reinterpret_cast<const TiledHFTileInfo *>(this->_map + sizeof(TiledHFHeader))
+            [this->tileId(row, col)];
+    }
+
+    /// map the file into memory
+    void _mapFile (std::string const &file);
+
+    /// unmap the file
+    void _unmapFile ();
+
+    /// the loader thread's main loop
+    void _loaderLoop ();
+
+};
+
+#endif // !_TILED_HF_HPP_
@@ -16,11 +16,23 @@
 #include "renderer.hpp"
 #include "shader-uniforms.hpp"
 #include "vertex.hpp"
+#include <chrono>
 
 /// constants to define the near and far planes of the view frustum
 constexpr float kNearZ = 0.5;   // how close to the origin you can get
 constexpr float kFarZ = 500.0f;  // distance to far plane
 
+/// the resolution of the occlusion-culling depth buffer
+constexpr uint32_t kOccBufWid = 256;
+constexpr uint32_t kOccBufHt = 128;
+
+/// an object is used as an occluder when the ratio of the diagonal of its
+/// bounding box to its distance from the camera exceeds this value
+constexpr float kOccluderSize = 0.5f;
+
+/// the number of bounding boxes per task when testing for occlusion
+constexpr uint32_t kOccTestGrain = 256;
+
 Proj3Window::Proj3Window (Proj3 *app)
   : cs237::Window (
         app,
@@ -30,7 +42,18 @@ Proj3Window::Proj3Window (Proj3 *app)
             app->scene()->height(),
             "", true, true, false)),
     _mode(RenderMode::eTextureShading),
-    _syncObjs(this)
+    _cmdCache(app),
+    _syncObjs(this),
+    _occlusionCulling(true),
+    _occBuf(kOccBufWid, kOccBufHt),
+    _terrainMode(TerrainMode::eChunkedLOD),
+    _terrain(nullptr),
+    _streamTerrain(nullptr),
+    _groundObj(nullptr),
+    _tessTerrain(nullptr),
+    _gpuCulling(false),
+    _gpuCull(nullptr),
+    _stats{0, 0, 0, 0.0, 0}
 {
     // initialize the camera from the scene
     this->_camPos = app->scene()->cameraPos();
@@ -43,14 +66,16 @@ Proj3Window::Proj3Window (Proj3 *app)
 
     this->_initRenderPass ();
 
+    // the tessellated terrain has its own pipeline, so it needs the render pass
+    if ((app->scene()->ground() != nullptr) && TessTerrain::isSupported(app)) {
+        this->_tessTerrain = new TessTerrain(app, this->_renderPass);
+    }
+
     // create framebuffers for the swap chain
     this->_swap.initFramebuffers (this->_renderPass);
 
     /** HINT: add additional initialization for uniform buffers and renderers */
 
-    // create the command buffer
-    this->_cmdBuffer = app->newCommandBuf();
-
     // enable handling of keyboard events
     this->enableKeyEvent (true);
 }
@@ -59,13 +84,17 @@ Proj3Window::~Proj3Window ()
 {
     auto device = this->device();
 
-    /* delete the command buffer */
-    this->_app->freeCommandBuf (this->_cmdBuffer);
+    if (this->_app->verbose()) {
+        std::cout << "# command buffers: " << this->_cmdCache.nRecorded()
+            << " recorded, " << this->_cmdCache.nReused() << " reused\n";
+    }
+
+    delete this->_gpuCull;
+    delete this->_terrain;
+    delete this->_streamTerrain;
+    delete this->_tessTerrain;
 
     device.destroyRenderPass(this->_renderPass);
-    device.destroyDescriptorPool(this->_descPool);
-    device.destroyDescriptorSetLayout(this->_vertDSLayout);
-    device.destroyDescriptorSetLayout(this->_fragDSLayout);
 
     for (auto it : this->_vertUBOs) {
         delete it.ubo;
@@ -116,23 +145,21 @@ void Proj3Window::_initUBOs ()
 {
     auto device = this->device();
 
-    // create the descriptor pool; we have one descriptor per frame plus one for the
+    // the descriptor sets are allocated from the application's descriptor
+    // allocator; we need one vertex-shader set per frame plus one set for the
     // per-scene fragment-shader uniforms
-    int nSets = this->_swap.size() + 1;
-    vk::DescriptorPoolSize poolSz(
-        vk::DescriptorType::eUniformBuffer,
-        nSets+1);
-    vk::DescriptorPoolCreateInfo poolInfo(
-        {}, /* flags */
-        nSets+1, /* max sets */
-        poolSz); /* pool sizes */
-    this->_descPool = device.createDescriptorPool(poolInfo);
+    Proj3 *app = reinterpret_cast<Proj3 *>(this->_app);
+    cs237::DescriptorAllocator *dsAlloc = app->descriptorAllocator();
 
     /** HINT: create the vertex-shader and fragment-shader descriptor
-     ** layouts for the uniform buffers.
+     ** layouts for the uniform buffers using `dsAlloc->layout`, which
+     ** registers the layouts with the allocator (the layouts are owned
+     ** by the application, so they should not be destroyed).
      **/
 
-    /** HINT: allocate the uniform buffers and descriptors. */
+    /** HINT: allocate the uniform buffers and descriptors; use
+     ** `dsAlloc->allocate` to allocate the descriptor sets.
+     **/
 
     /** HINT: initialize the fragment-shader uniform buffer. */
 }
@@ -142,7 +169,11 @@ void Proj3Window::_initRenderers ()
     Proj3 *app = reinterpret_cast<Proj3 *>(this->_app);
 
     // create the renderers
-    /** HINT: create the renderer objects for each of the modes here */
+    /** HINT: create the renderer objects for each of the modes here.  When
+     ** `_gpuCull` is not nullptr, pass `this->_gpuCull->dsLayout()` as the
+     ** instance-data layout, so that the renderers can draw the commands
+     ** generated by the GPU-culling pass.
+     **/
 
 }
 
@@ -151,6 +182,39 @@ void Proj3Window::_initMeshes (const Scene *scene)
     /** HINT: put code to construct the meshes and instances
      *  from the scene here
      */
+
+    // compute the world-space bounding boxes and build the BVH for
+    // view-frustum culling
+    std::vector<cs237::AABBf_t> boxes;
+    boxes.reserve(this->_objs.size());
+    for (auto it : this->_objs) {
+        it->updateBBox();
+        boxes.push_back(it->bbox);
+    }
+    this->_bvh.build(boxes);
+
+    // the level-of-detail terrain for the ground
+    for (auto it : this->_objs) {
+        if (it->mesh->ground) {
+            this->_groundObj = it;
+        }
+    }
+    if ((scene->ground() != nullptr) && (this->_groundObj != nullptr)) {
+        this->_terrain = new Terrain(this->_app, scene->ground());
+    }
+
+    // a streamed ground does not have a mesh; its tiles are loaded on demand
+    /** HINT: to texture a streamed ground, create a ground instance (with
+     ** `ground` set) whose mesh holds the ground's color and normal maps.
+     **/
+    if (scene->streamingGround() != nullptr) {
+        this->_streamTerrain = new StreamingTerrain(this->_app, scene->streamingGround());
+    }
+
+    // set up GPU-driven culling, if the device supports it
+    if (GPUCull::isSupported(this->_app)) {
+        this->_gpuCull = new GPUCull(reinterpret_cast<Proj3 *>(this->_app), this->_objs);
+    }
 }
 
 void Proj3Window::_recordCommandBuffer (uint32_t imageIdx)
@@ -160,6 +224,14 @@ void Proj3Window::_recordCommandBuffer (uint32_t imageIdx)
     vk::CommandBufferBeginInfo beginInfo;
     this->_cmdBuffer.begin(beginInfo);
 
+    // the view frustum in world space
+    cs237::Frustumf_t frustum(this->_ubCache.P * this->_ubCache.viewM);
+
+    // the culling pass must be recorded outside of the render pass
+    if (this->_gpuCulling) {
+        this->_gpuCull->cullCmd (this->_cmdBuffer, frustum);
+    }
+
     std::array<vk::ClearValue,2> clearValues = {
             vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f), /* clear the window to black */
             vk::ClearDepthStencilValue(1.0f, 0.0f)
@@ -185,8 +257,62 @@ void Proj3Window::_recordCommandBuffer (uint32_t imageIdx)
         this->_vertUBOs[imageIdx],
         this->_fragUBO);
 
-    // render the objects in the scene
-    for (auto it : this->_objs) {
+    if (this->_gpuCulling) {
+        // the counts are from the previous frame, since this frame's culling
+        // pass has not run yet
+        this->_stats.nVisible = this->_gpuCull->nVisible();
+        this->_stats.nCulled = this->_objs.size() - this->_stats.nVisible;
+        this->_stats.nOccluded = 0;
+        this->_stats.occTime = 0.0;
+
+        this->_drawIndirectCmds (rp);
+    } else {
+        // cull the objects that are outside the view frustum
+        this->_bvh.cullFrustum(frustum, this->_visible);
+        this->_stats.nCulled = this->_objs.size() - this->_visible.size();
+
+        // cull the objects that are hidden behind other objects
+        if (this->_occlusionCulling) {
+            this->_occlusionCull ();
+        } else {
+            this->_stats.nOccluded = 0;
+            this->_stats.occTime = 0.0;
+        }
+        this->_stats.nVisible = this->_visible.size();
+
+        this->_drawVisibleCmds (rp);
+    }
+
+    // the LOD terrain is drawn with push constants, so it is not used when
+    // the GPU-culling pass generates the draws
+    if (this->_useTerrainLOD()) {
+        this->_drawTerrainCmds (rp, frustum);
+    } else if (this->_useTessTerrain()) {
+        this->_drawTessTerrainCmds ();
+    } else {
+        this->_stats.nTiles = 0;
+    }
+
+    /*** END COMMANDS ***/
+
+    this->_cmdBuffer.endRenderPass();
+
+    this->_cmdBuffer.end();
+
+}
+
+void Proj3Window::_drawVisibleCmds (Renderer *rp)
+{
+    bool skipGround = this->_useTerrainLOD() || this->_useTessTerrain();
+
+    // render the visible objects in the scene
+    for (auto ix : this->_visible) {
+        Instance *it = this->_objs[ix];
+
+        if (skipGround && it->mesh->ground) {
+            continue;
+        }
+
         // bind the descriptors for the object
         rp->bindMeshDescriptorSets (this->_cmdBuffer, it);
 
@@ -194,13 +320,67 @@ void Proj3Window::_recordCommandBuffer (uint32_t imageIdx)
 
         it->mesh->draw (this->_cmdBuffer);
     }
+}
 
-    /*** END COMMANDS ***/
+void Proj3Window::_drawIndirectCmds (Renderer *rp)
+{
+    // the per-instance data replaces the push constants
+    rp->bindInstanceDescriptorSet (this->_cmdBuffer, this->_gpuCull->descSet());
 
-    this->_cmdBuffer.endRenderPass();
+    // one indirect draw per mesh
+    for (uint32_t g = 0;  g < this->_gpuCull->nGroups();  ++g) {
+        rp->bindMeshDescriptorSets (this->_cmdBuffer, this->_gpuCull->groupObj(g));
+        this->_gpuCull->drawCmd (this->_cmdBuffer, g);
+    }
+}
 
-    this->_cmdBuffer.end();
+void Proj3Window::_drawTerrainCmds (Renderer *rp, cs237::Frustumf_t const &frustum)
+{
+    // the screen-space size of a unit-length feature at unit distance
+    float pixScale = 0.5f * float(this->_swap.extent.height) * std::abs(this->_ubCache.P[1][1]);
+
+    // the tiles are in world space
+    PushConsts pc;
+    pc.toWorld = glm::mat4(1.0f);
+    pc.normToWorld = glm::mat3(1.0f);
+
+    if (this->_streamTerrain != nullptr) {
+        this->_streamTerrain->selectTiles (frustum, this->_camPos, pixScale);
+        this->_stats.nTiles = this->_streamTerrain->numSelected();
+        pc.color = this->_scene()->streamingGround()->color();
+    } else {
+        this->_terrain->selectTiles (frustum, this->_camPos, pixScale);
+        this->_stats.nTiles = this->_terrain->numSelected();
+        pc.color = this->_scene()->ground()->color();
+    }
+
+    // the terrain is drawn last, so we do not have to restore the main pipeline
+    rp->bindTerrainPipelineCmd (this->_cmdBuffer);
+    rp->pushConstants (this->_cmdBuffer, pc);
+    if (this->_groundObj != nullptr) {
+        rp->bindMeshDescriptorSets (this->_cmdBuffer, this->_groundObj);
+    }
 
+    if (this->_streamTerrain != nullptr) {
+        this->_streamTerrain->draw (this->_cmdBuffer);
+    } else {
+        this->_terrain->draw (this->_cmdBuffer);
+    }
+}
+
+void Proj3Window::_drawTessTerrainCmds ()
+{
+    // the screen-space size of a unit-length feature at unit distance
+    float pixScale = 0.5f * float(this->_swap.extent.height) * std::abs(this->_ubCache.P[1][1]);
+
+    // the patches are culled on the GPU, so we report all of them; the terrain
+    // is drawn last, so we do not have to restore the main pipeline
+    this->_stats.nTiles = this->_tessTerrain->numPatches();
+    this->_tessTerrain->drawCmd (
+        this->_cmdBuffer,
+        this->_ubCache.P * this->_ubCache.viewM,
+        this->_camPos,
+        pixScale);
 }
 
 void Proj3Window::draw ()
@@ -214,10 +394,31 @@ void Proj3Window::draw ()
 
     this->_syncObjs.reset();
 
+    // when benchmarking, the camera follows a scripted path around the scene
+    if (this->_app->benchmarking()) {
+        auto scene = this->_scene();
+        this->_camPos = cs237::benchCameraPos (
+            scene->cameraPos(), scene->cameraLookAt(), scene->cameraUp(),
+            this->numFrames(), this->_app->maxFrames());
+        this->_cmdCache.invalidate();
+    }
+
     /** HINT: update the UBO, if necessary */
 
-    this->_cmdBuffer.reset();
-    this->_recordCommandBuffer (idx);
+    // the streamed terrain's tiles are loaded in the background, so the
+    // selected tiles can change even when the view does not
+    if (this->_useTerrainLOD() && (this->_streamTerrain != nullptr)) {
+        this->_cmdCache.invalidate();
+    }
+
+    // reuse the image's commands if nothing that they depend on has changed
+    bool record;
+    this->_cmdBuffer = this->_cmdCache.acquire (idx, record);
+    if (record) {
+        CullStats prevStats = this->_stats;
+        this->_recordCommandBuffer (idx);
+        this->_reportStats (prevStats);
+    }
 
     // set up submission for the graphics queue
     this->_syncObjs.submitCommands (this->graphicsQ(), this->_cmdBuffer);
@@ -226,6 +427,68 @@ void Proj3Window::draw ()
     this->_syncObjs.present (this->presentationQ(), idx);
 }
 
+void Proj3Window::_occlusionCull ()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // render the large objects into the occlusion buffer
+    this->_occBuf.begin (this->_ubCache.P * this->_ubCache.viewM);
+    for (auto ix : this->_visible) {
+        Instance *obj = this->_objs[ix];
+        if (obj->mesh->isOccluder()) {
+            float diag = glm::length(obj->bbox.max() - obj->bbox.min());
+            float dist = obj->bbox.distanceToPt(this->_camPos);
+            if (diag > kOccluderSize * dist) {
+                this->_occBuf.addTriangles (
+                    obj->toWorld, obj->mesh->occVerts, obj->mesh->occIndices);
+            }
+        }
+    }
+    this->_occBuf.finish ();
+
+    // test the objects in parallel (the occlusion buffer is read only at this
+    // point) and then filter out the objects that are hidden
+    std::vector<char> hidden(this->_visible.size());
+    this->_app->jobs().parallelFor (0, uint32_t(this->_visible.size()), kOccTestGrain,
+        [this, &hidden](uint32_t lo, uint32_t hi) {
+            for (uint32_t i = lo;  i < hi;  ++i) {
+                hidden[i] = this->_occBuf.isOccluded(this->_objs[this->_visible[i]]->bbox);
+            }
+        });
+    size_t nv = 0;
+    for (size_t i = 0;  i < this->_visible.size();  ++i) {
+        if (! hidden[i]) {
+            this->_visible[nv++] = this->_visible[i];
+        }
+    }
+    this->_stats.nOccluded = this->_visible.size() - nv;
+    this->_visible.resize(nv);
+
+    this->_stats.occTime = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void Proj3Window::_reportStats (CullStats const &prev)
+{
+    // to avoid flooding the output, we only report when the counts change
+    if (this->_app->verbose()
+    && ((prev.nVisible != this->_stats.nVisible)
+        || (prev.nCulled != this->_stats.nCulled)
+        || (prev.nOccluded != this->_stats.nOccluded)
+        || (prev.nTiles != this->_stats.nTiles))) {
+        int nObjs = this->_objs.size();
+        std::cout << "# " << this->_stats.nVisible << " visible, "
+            << this->_stats.nCulled << " culled, "
+            << this->_stats.nOccluded << " occluded ("
+            << (nObjs > 0 ? (100 * this->_stats.nOccluded) / nObjs : 0)
+            << "%); occlusion cost " << this->_stats.occTime << " ms";
+        if (this->_stats.nTiles > 0) {
+            std::cout << "; " << this->_stats.nTiles << " terrain tiles";
+        }
+        std::cout << "\n";
+    }
+}
+
 void Proj3Window::reshape (int wid, int ht)
 {
     // invoke the super-method reshape method
@@ -234,6 +497,9 @@ void Proj3Window::reshape (int wid, int ht)
     // recreate the new framebuffers
     this->_swap.initFramebuffers (this->_renderPass);
 
+    // the recorded commands refer to the old framebuffers
+    this->_cmdCache.invalidate();
+
     /** HINT: update the UBO cache */
 
 }
@@ -245,9 +511,27 @@ void Proj3Window::key (int key, int scancode, int action, int mods)
     || (mods & (GLFW_MOD_CONTROL|GLFW_MOD_ALT|GLFW_MOD_SUPER))) {
 
         switch (key) {
+            case GLFW_KEY_G:  // 'g' or 'G' ==> toggle GPU-driven culling
+                if (this->_gpuCull != nullptr) {
+                    this->_gpuCulling = !this->_gpuCulling;
+                }
+                break;
+            case GLFW_KEY_L:  // 'l' or 'L' ==> cycle through the terrain modes
+                if (this->_terrainMode == TerrainMode::eFullMesh) {
+                    this->_terrainMode = TerrainMode::eChunkedLOD;
+                } else if ((this->_terrainMode == TerrainMode::eChunkedLOD)
+                && (this->_tessTerrain != nullptr)) {
+                    this->_terrainMode = TerrainMode::eTessellated;
+                } else {
+                    this->_terrainMode = TerrainMode::eFullMesh;
+                }
+                break;
             case GLFW_KEY_N:  // 'n' or 'n' ==> switch to normal-mapping mode
                 this->_mode = RenderMode::eNormalMapShading;
                 break;
+            case GLFW_KEY_O:  // 'o' or 'O' ==> toggle occlusion culling
+                this->_occlusionCulling = !this->_occlusionCulling;
+                break;
             case GLFW_KEY_S:  // 's' or 'S' ==> toggle shadows
                 /** HINT: toggle the shadow state here */
                 break;
@@ -263,6 +547,11 @@ void Proj3Window::key (int key, int scancode, int action, int mods)
             default: // ignore all other keys
                 return;
         }
+
+        // the handled keys change the render mode, the culling, or the view;
+        // the visible objects and the terrain LOD depend on the view, so the
+        // commands must be re-recorded
+        this->_cmdCache.invalidate();
     }
 
 }
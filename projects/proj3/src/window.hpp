@@ -15,11 +15,14 @@
 
 #include "cs237.hpp"
 #include "app.hpp"
+#include "gpu-cull.hpp"
 #include "instance.hpp"
 #include "render-modes.hpp"
 #include "renderer.hpp"
 #include "scene.hpp"
 #include "shader-uniforms.hpp"
+#include "terrain.hpp"
+#include "tess-terrain.hpp"
 
 /// The Project 1 Window class
 class Proj3Window : public cs237::Window {
@@ -39,16 +42,20 @@ public:
 private:
     vk::RenderPass _renderPass;                 ///< the shared render pass for drawing
     RenderMode _mode;                           ///< the current rendering mode
-    vk::CommandBuffer _cmdBuffer;               ///< the command buffer
+    cs237::CommandCache _cmdCache;              ///< the recorded command buffers, one per
+                                                ///  swap-chain image
+    vk::CommandBuffer _cmdBuffer;               ///< the command buffer for the current
+                                                ///  frame; owned by `_cmdCache`
     SyncObjs _syncObjs;                         ///< synchronization objects for the
                                                 ///  swap chain
 
     // support for uniform buffers
-    vk::DescriptorPool _descPool;               ///< the descriptor pool for uniforms
     vk::DescriptorSetLayout _vertDSLayout;      ///< layout of descriptor set for
-                                                ///  vertex-shader uniforms
+                                                ///  vertex-shader uniforms; owned by
+                                                ///  the application
     vk::DescriptorSetLayout _fragDSLayout;      ///< layout of descriptor set for
-                                                ///  fragment-shader uniforms
+                                                ///  fragment-shader uniforms; owned by
+                                                ///  the application
     std::vector<VertexInfo> _vertUBOs;          ///< vector of uniform buffers for
                                                 ///  vertex-shader info.  We have one
                                                 ///  per frame to avoid races.
@@ -59,6 +66,10 @@ private:
     // scene data
     std::vector<Mesh *> _meshes;                ///< the meshes in the scene
     std::vector<Instance *> _objs;              ///< the objects to render
+    cs237::BVH _bvh;                            ///< BVH over the world-space bounds
+                                                ///  of the objects
+    std::vector<uint32_t> _visible;             ///< the indices of the objects that
+                                                ///  survived culling in the current frame
 
     // Current camera state
     glm::vec3 _camPos;                          ///< camera position in world space
@@ -68,6 +79,39 @@ private:
                                                 ///  cache gets updated when the camera
                                                 ///  state or the viewport changes
 
+    // occlusion culling
+    bool _occlusionCulling;                     ///< true when occlusion culling is enabled
+    cs237::OcclusionBuffer _occBuf;             ///< software depth buffer for occluders
+
+    // level-of-detail terrain
+    TerrainMode _terrainMode;                   ///< how the ground is rendered
+    Terrain *_terrain;                          ///< LOD terrain for the ground; nullptr
+                                                ///  if the scene does not have ground
+    StreamingTerrain *_streamTerrain;           ///< terrain for a streamed ground; nullptr
+                                                ///  if the ground is not streamed
+    Instance *_groundObj;                       ///< the ground object, which supplies the
+                                                ///  descriptor sets for the terrain
+    TessTerrain *_tessTerrain;                  ///< tessellated terrain for the ground;
+                                                ///  nullptr if the scene does not have
+                                                ///  ground or the device does not
+                                                ///  support tessellation
+
+    // GPU-driven culling
+    bool _gpuCulling;                           ///< true when culling is done on the GPU
+    GPUCull *_gpuCull;                          ///< GPU-culling state; nullptr if the
+                                                ///  device does not support it
+
+    /// culling statistics for a frame
+    struct CullStats {
+        int nVisible;                           ///< number of instances that were drawn
+        int nCulled;                            ///< number of instances outside the
+                                                ///  view frustum
+        int nOccluded;                          ///< number of instances hidden by occluders
+        double occTime;                         ///< CPU time for occlusion culling (in ms)
+        int nTiles;                             ///< number of terrain tiles drawn
+    };
+    CullStats _stats;                           ///< statistics for the most recent frame
+
     /// allocate and initialize the meshes and drawables
     void _initMeshes (const Scene *scene);
 
@@ -85,6 +129,44 @@ private:
     /// record the rendering commands
     void _recordCommandBuffer (uint32_t imageIdx);
 
+    /// record the commands to draw the visible objects in `_visible`
+    void _drawVisibleCmds (Renderer *rp);
+
+    /// record the commands to draw the objects using the commands generated
+    /// by the GPU-culling pass
+    void _drawIndirectCmds (Renderer *rp);
+
+    /// select the terrain tiles for the current view and record the commands
+    /// to draw them
+    void _drawTerrainCmds (Renderer *rp, cs237::Frustumf_t const &frustum);
+
+    /// is the ground drawn using the LOD terrain?  A streamed ground is always
+    /// drawn this way, since it does not have a mesh.
+    bool _useTerrainLOD () const
+    {
+        return !this->_gpuCulling
+            && ((this->_streamTerrain != nullptr)
+                || ((this->_terrain != nullptr)
+                    && (this->_terrainMode == TerrainMode::eChunkedLOD)));
+    }
+
+    /// record the commands to draw the tessellated terrain
+    void _drawTessTerrainCmds ();
+
+    /// is the ground drawn using the tessellated terrain?
+    bool _useTessTerrain () const
+    {
+        return !this->_gpuCulling
+            && (this->_tessTerrain != nullptr)
+            && (this->_terrainMode == TerrainMode::eTessellated);
+    }
+
+    /// remove the instances that are hidden by occluders from `_visible`
+    void _occlusionCull ();
+
+    /// report the culling statistics for the last frame (verbose mode only)
+    void _reportStats (CullStats const &prev);
+
     /// get the scene being rendered
     const Scene *_scene () const
     {